@@ -20,8 +20,13 @@
  *   static int gen_lexer_initialize(struct gen_lexer *lexer, GENLEX_IO_T ctx);
  *   
  *     Initializes the lexer structure.  Note that the lexer does no
- *     dynamic memory allocation, and the user can tune the size of its
- *     internal buffer.
+ *     dynamic memory allocation (unless GENLEX_CONFIG_POOL is set), and
+ *     the user can tune the size of its internal buffer.
+ *
+ *   static inline void gen_lexer_reset(struct gen_lexer *lexer, GENLEX_IO_T ctx);
+ *
+ *     Restarts an initialized lexer on new input in constant time.  The
+ *     lexer keeps its pool, tables and trace, and gives back its buffer.
  *
  *   static int gen_lexer_next_token(struct gen_lexer *lexer);
  *
@@ -45,13 +50,230 @@
  *
  *   static GENLEX_FLOAT_T gen_lexer_token_float_value(struct gen_lexer *lexer);
  *
- *     (Only present if GENLEX_CONFIG_FLOATS is defined)
+ *     (Only present if GENLEX_CONFIG_FLOATS is defined and
+ *     GENLEX_CONFIG_DECIMAL isn't)
  *     If the lexical token is GENLEX_FLT_TOKEN, this will return the
  *     float represented by that token.  Otherwise, the value is
  *     unspecified.
+ *
+ *   static struct gen_lexer_decimal gen_lexer_token_decimal_value(struct gen_lexer *lexer);
+ *
+ *     (Only present if GENLEX_CONFIG_DECIMAL is defined)
+ *     If the lexical token is GENLEX_FLOAT_TOKEN, this will return the
+ *     exact decimal represented by that token: (-1)^neg * coef * 10^exp.
+ *     If big is set, the number has more significant digits than coef
+ *     holds, and only the token's text has its value.  Otherwise, the
+ *     value is unspecified.
+ *
+ *   static const unsigned char *gen_lexer_token_blob(struct gen_lexer *lexer, size_t *lenp);
+ *
+ *     (Only present if GENLEX_CONFIG_BLOBS is defined)
+ *     If the lexical token is GENLEX_BLOB_TOKEN, this will return the
+ *     decoded bytes of the literal, which are in the blob arena, and
+ *     their number in *lenp.  Otherwise, the value is unspecified.
+ *
+ *   static inline void gen_lexer_blob_arena(struct gen_lexer *lexer, unsigned char *buf, size_t cap);
+ *   static inline size_t gen_lexer_blob_arena_used(const struct gen_lexer *lexer);
+ *
+ *     (Only present if GENLEX_CONFIG_BLOBS is defined)
+ *     Gives the lexer the cap bytes at buf to decode blob literals into,
+ *     and tells how many of them are taken.  Each blob goes after the
+ *     last, so all of them stay valid until the arena is given again,
+ *     which starts it over.  A lexer starts with no arena, and
+ *     gen_lexer_reset() keeps it.
+ *
+ *   static void gen_lexer_token_record(struct gen_lexer *lexer, int tok, struct gen_lexer_token *rec);
+ *
+ *     Saves the position, span and value of the current token in a
+ *     struct gen_lexer_token that outlives the next call to
+ *     gen_lexer_next_token().
+ *
+ *   static inline int gen_lexer_skip_group(struct gen_lexer *lexer, int open, int close);
+ *
+ *     Skips a bracketed group whose open literal was the last token
+ *     read, through the matching close literal, which becomes the
+ *     current token.  Only the nesting depth and whether the input is in
+ *     a string, character or comment are tracked: nothing is copied or
+ *     converted, and with GENLEX_CONFIG_MEMORY the bytes in between are
+ *     scanned straight from the buffer.  Returns close, or the error the
+ *     tokens would have had (GENLEX_ERR_UNEXPECTED_EOF if the group
+ *     isn't closed).  open and close are counted as single characters,
+ *     even inside a literal pair.
+ *
+ * With GENLEX_LOOKAHEAD defined, parsers that need lookahead can use
+ * these instead of gen_lexer_next_token():
+ *
+ *   static int gen_lexer_peek(struct gen_lexer *lexer, unsigned int k);
+ *
+ *     Returns the k-th token after the current one without consuming
+ *     it: gen_lexer_peek(lexer,0) is the token that the next
+ *     gen_lexer_advance() will return.  k must be less than
+ *     GENLEX_LOOKAHEAD.  Each token is scanned only once, no matter how
+ *     often it is peeked.
+ *
+ *   static const unsigned char *gen_lexer_peek_string(struct gen_lexer *lexer, unsigned int k, size_t *lenp);
+ *   static GENLEX_INT_T gen_lexer_peek_int_value(struct gen_lexer *lexer, unsigned int k);
+ *   static GENLEX_FLOAT_T gen_lexer_peek_float_value(struct gen_lexer *lexer, unsigned int k);
+ *   static struct gen_lexer_decimal gen_lexer_peek_decimal_value(struct gen_lexer *lexer, unsigned int k);
+ *   static const unsigned char *gen_lexer_peek_blob(struct gen_lexer *lexer, unsigned int k, size_t *lenp);
+ *
+ *     Text and values of the k-th token after the current one, like the
+ *     gen_lexer_token_*() accessors.  The float, decimal and blob ones
+ *     are present along with their gen_lexer_token_*() counterparts.
+ *
+ *   static int gen_lexer_advance(struct gen_lexer *lexer);
+ *
+ *     Consumes the next token and makes it the current token, so that
+ *     gen_lexer_token_string() and the other accessors refer to it.
+ *     Returns the token, like gen_lexer_next_token().
+ *
+ *     Each buffered token keeps its own text buffer, so the text of the
+ *     current token and of every peeked token stays valid until the
+ *     token is advanced past.
+ *
+ * With GENLEX_CONFIG_MEMORY, GENLEX_CONFIG_STREAM or GENLEX_SEEK, a
+ * parser can back up over any number of tokens:
+ *
+ *   static int gen_lexer_mark(struct gen_lexer *lexer, struct gen_lexer_mark *mark);
+ *
+ *     Records the lexer's position after the current token in mark.
+ *     Returns 0, or GENLEX_ERR_INVALID_STATE if the stream no longer
+ *     holds that position (only possible with tokens peeked ahead).
+ *     On streams, the buffer keeps everything from the oldest live
+ *     mark on, and the stream keeps the offsets of the live marks to
+ *     know which that is; GENLEX_ERR_NO_MEMORY if it has no room for
+ *     another.
+ *
+ *   static int gen_lexer_reset_to(struct gen_lexer *lexer, const struct gen_lexer_mark *mark);
+ *
+ *     Moves the lexer back to mark, in O(1).  The next token is scanned
+ *     from the marked position; any peeked tokens are discarded.
+ *     Returns 0 or GENLEX_ERR_INVALID_STATE.  A mark can be reset to
+ *     any number of times until it is released.  A raw text mode's
+ *     progress through raw_until is restored with the position, but not
+ *     the mode itself.
+ *
+ *   static void gen_lexer_release_mark(struct gen_lexer *lexer, const struct gen_lexer_mark *mark);
+ *
+ *     Releases a mark, letting a stream discard the input that only it
+ *     held.  Marks can be released in any order.
+ *
+ * With GENLEX_CONFIG_STATS:
+ *
+ *   static const struct gen_lexer_stats *gen_lexer_stats(const struct gen_lexer *lexer);
+ *
+ *     Returns the counters accumulated since the lexer was initialized:
+ *     tokens of each kind, bytes of whitespace, comments, strings,
+ *     symbols and numbers, GENLEX_GETC and GENLEX_UNGETC calls, keyword
+ *     lookups and the keywords compared during them, the high-water
+ *     mark of the token buffer and the number of each error.
+ *
+ * With GENLEX_CONFIG_POOL:
+ *
+ *   static void gen_lexer_pool_init(struct gen_lexer_pool *pool, size_t max_free);
+ *   static void gen_lexer_pool_free(struct gen_lexer_pool *pool);
+ *
+ *     A pool of GENLEX_STRING_MAX byte token buffers.  It keeps up to
+ *     max_free returned buffers for reuse; gen_lexer_pool_free()
+ *     releases them.  A pool isn't locked, so use one per thread.
+ *
+ *   static inline void gen_lexer_use_pool(struct gen_lexer *lexer, struct gen_lexer_pool *pool);
+ *
+ *     Makes lexer borrow its buffers from pool.  Without a pool, they
+ *     come straight from malloc().
+ *
+ * With GENLEX_CONFIG_TRACE:
+ *
+ *   static void gen_lexer_trace_init(struct gen_lexer_trace *tr);
+ *
+ *     Clears a trace.  A trace may be shared by any number of lexers,
+ *     on any number of threads.
+ *
+ *   static inline void gen_lexer_trace_attach(struct gen_lexer *lexer,
+ *       struct gen_lexer_trace *tr);
+ *
+ *     Starts recording the tokens of lexer into tr, or stops if tr is
+ *     NULL.  gen_lexer_initialize() detaches the lexer.
+ *
+ *   static size_t gen_lexer_trace_events(const struct gen_lexer_trace *tr,
+ *       struct gen_lexer_trace_event *out, size_t max);
+ *
+ *     Copies up to max of the most recent tokens recorded in tr, newest
+ *     first, and returns how many were copied.  Safe to call while
+ *     lexers are recording; an event being overwritten is skipped.
+ *
+ *   static int gen_lexer_trace_dump(const struct gen_lexer_trace *tr, FILE *f);
+ *
+ *     Writes the histograms of tr to f as folded stacks, one line per
+ *     token kind and latency bucket weighted by the cycles spent in it,
+ *     for flamegraph.pl and similar tools:
+ *
+ *       gen_lexer_next_token;string;4096-8191 1843200
+ *
+ *     Returns 0, or GENLEX_ERR_IO if writing failed.
+ *
+ * With GENLEX_CONFIG_RUNTIME, the lexical configuration is data rather
+ * than macros, so one copy of the lexer serves any number of dialects:
+ *
+ *   static int gen_lexer_compile(struct gen_lexer_tables *tab, const struct gen_lexer_config *cfg);
+ *
+ *     Compiles a configuration into dispatch tables: a class table
+ *     indexed by byte and a keyword hash table.  Returns 0,
+ *     GENLEX_ERR_NO_MEMORY, or GENLEX_ERR_INVALID_STATE if raw_until is
+ *     empty or isn't shorter than half of GENLEX_STRING_MAX.  The tables
+ *     are never modified after this, so any number of lexers on any
+ *     number of threads can share them.  They refer to the arrays and
+ *     strings of cfg, which must outlive them.
+ *
+ *   static void gen_lexer_tables_free(struct gen_lexer_tables *tab);
+ *
+ *     Frees compiled tables once no lexer uses them.
+ *
+ *   static int gen_lexer_initialize_with(struct gen_lexer *lexer,
+ *       const struct gen_lexer_tables *tab, GENLEX_IO_T ctx);
+ *
+ *     Initializes a lexer that uses the compiled tables.  This replaces
+ *     gen_lexer_initialize() in this mode.
+ *
+ *   A configuration with raw_until set compiles to a raw text mode,
+ *   for the text around the code islands of a template or the body of
+ *   a heredoc.  Its other fields are ignored: the lexer returns the
+ *   text up to the next raw_until, unchanged, as raw_token, and then
+ *   raw_until itself as raw_until_token (or 0 at the end of the
+ *   input).  With GENLEX_CONFIG_MEMORY the text is copied straight
+ *   from the buffer.  Text longer than the token buffer comes as
+ *   several raw_tokens in a row.
+ *
+ * With GENLEX_MODE_DEPTH as well, a lexer can switch between the tables
+ * of several modes without losing its place in the input:
+ *
+ *   static inline int gen_lexer_push_mode(struct gen_lexer *lexer,
+ *       const struct gen_lexer_tables *tab);
+ *
+ *     Scans the tokens after the current one with tab, until the
+ *     matching gen_lexer_pop_mode().  Returns 0, or
+ *     GENLEX_ERR_INVALID_STATE if GENLEX_MODE_DEPTH modes are already
+ *     pushed.  Tokens already peeked (see GENLEX_LOOKAHEAD) keep the
+ *     mode they were scanned in.
+ *
+ *   static inline int gen_lexer_pop_mode(struct gen_lexer *lexer);
+ *
+ *     Goes back to the mode that was current before the last push.
+ *     Returns 0, or GENLEX_ERR_INVALID_STATE if no mode was pushed.
+ *
+ *   static inline const struct gen_lexer_tables *gen_lexer_mode(const struct gen_lexer *lexer);
+ *
+ *     Returns the tables of the current mode.
+ *
+ *   The position, the token buffer and the raw_until_token owed by a
+ *   raw text mode all carry across a switch, and gen_lexer_reset() goes
+ *   back to the tables the lexer was initialized with.  A raw_token
+ *   cut short by the token buffer may have read the first bytes of
+ *   raw_until already; a switch right after it drops them.
  */
 
-/* Required I/O definitions:
+/* Required I/O definitions (unless GENLEX_CONFIG_MEMORY or
+ * GENLEX_CONFIG_STREAM is set):
  *
  * GENLEX_IO_T
  *
@@ -68,6 +290,16 @@
  *      Pushes an unsigned char back onto the input.  ch will be the
  *      last character returned by GENLEX_GETC().
  *
+ * Optional I/O definitions:
+ *
+ * GENLEX_SEEK(ctx,off)
+ *
+ *      Repositions the input so that the next GENLEX_GETC() returns the
+ *      byte at offset off, and returns 0 on success.  off is always an
+ *      offset the lexer has already read past.  Defining this enables
+ *      gen_lexer_mark() and gen_lexer_reset_to(); the memory and stream
+ *      inputs provide their own.
+ *
  * Required configuration options:
  *
  * GENLEX_IS_SYMBOL(ch,pos)
@@ -105,6 +337,14 @@
  *      declares an internal buffer that is GENLEX_STRING_MAX+1 bytes
  *      long and uses this to store strings and symbol identifiers.
  *
+ * GENLEX_CONFIG_POOL
+ *
+ *      #define to 1 to keep the buffer out of struct gen_lexer.  The lexer
+ *      borrows one (see gen_lexer_use_pool()) when a token has text to
+ *      copy, and gives it back after the first token that has none, at
+ *      the end of the input and on gen_lexer_reset().  Idle lexers then
+ *      take a few dozen bytes each.  Not available with GENLEX_LOOKAHEAD.
+ *
  * GENLEX_KEYWORDS
  *
  *      A list of keywords and associated token values.
@@ -129,6 +369,43 @@
  *
  * Optional configuration options:
  *
+ * GENLEX_CONFIG_MEMORY
+ *
+ *   #define to 1 to lex a memory-resident buffer.  glex.h then supplies
+ *   GENLEX_IO_T, GENLEX_GETC and GENLEX_UNGETC itself, and the IO
+ *   context passed to gen_lexer_initialize() is a
+ *   struct gen_lexer_membuf * describing the buffer.  This is required
+ *   by drivers that need random access to the input, like the parallel
+ *   driver in glex_parallel.h.
+ *
+ * GENLEX_CONFIG_STREAM
+ *
+ *   #define to 1 to lex a stream through a block buffer.  As with
+ *   GENLEX_CONFIG_MEMORY, glex.h supplies the I/O definitions.  The IO
+ *   context is a struct gen_lexer_stream *, set up with
+ *   gen_lexer_stream_init() and a read callback.  The buffer normally
+ *   keeps a fixed size; it only grows while a mark holds on to input
+ *   that has already been scanned.
+ *
+ * GENLEX_CONFIG_POS64
+ *
+ *   #define to 1 to keep offsets, lines and columns as unsigned long
+ *   long instead of unsigned int, for inputs of 4 GiB and more.  The
+ *   position type is GENLEX_POS_T in either case.  The stream backend
+ *   lexes such inputs in constant memory; for a mapped file, see
+ *   glex_mmap.h.
+ *
+ * GENLEX_CONFIG_UTF8
+ *
+ *   #define to 1 to accept Unicode identifiers in UTF-8: a symbol may
+ *   also start with a code point that is XID_Start and continue with
+ *   ones that are XID_Continue, looked up in the tables of glex_xid.h.
+ *   GENLEX_IS_SYMBOL still decides for ASCII and only sees bytes below
+ *   0x80, so ASCII symbols are scanned as before.  A malformed sequence
+ *   is GENLEX_ERR_INVALID_UTF8, and a code point that can't be where
+ *   it is (including one right after a symbol) GENLEX_ERR_INVALID_CHAR.
+ *   Columns still count bytes.
+ *
  * GENLEX_CONFIG_ONLY_OFFSET    (not implemented)
  *   
  *   If set to 1, disables tracking the line and column for each token
@@ -147,6 +424,116 @@
  *      character and zero otherwise.  If this macro is not defined,
  *      whitespace defaults to the set recognized by isspace(3).
  *
+ * GENLEX_DFA_HEADER
+ *
+ *   Name of a header generated by glexgen from this configuration, e.g.
+ *   #define GENLEX_DFA_HEADER "mylexer_dfa.h".  The header replaces the
+ *   table scans for keywords, literal pairs and comments, and the
+ *   character class checks, with generated code.  See glexgen.c.
+ *
+ * GENLEX_CONFIG_STATS
+ *
+ *   #define to 1 to keep the counters returned by gen_lexer_stats() in
+ *   struct gen_lexer.  Without it, none of the counting is compiled in.
+ *
+ * GENLEX_TRACE_BEGIN(lexer), GENLEX_TRACE_END(lexer,tok)
+ *
+ *   Hooks run by gen_lexer_next_token() before it scans a token and
+ *   after, with the token it returns (0 at the end of the input).  By
+ *   default they do nothing.  GENLEX_CONFIG_TRACE defines them to the
+ *   built-in tracer.
+ *
+ * GENLEX_CONFIG_TRACE
+ *
+ *   #define to 1 for the built-in tracer (see gen_lexer_trace_attach()).
+ *   It times every token with GENLEX_TRACE_CYCLES() and records it in a
+ *   lock-free ring of the last GENLEX_TRACE_RING tokens, with offset,
+ *   length and cycles, and in a histogram per token kind with one bucket
+ *   per power of two cycles.  Requires GCC or clang atomics.
+ *
+ * GENLEX_TRACE_RING
+ *
+ *   Number of tokens kept by the tracer, a power of two.  Defaults to
+ *   1024.
+ *
+ * GENLEX_TRACE_CYCLES()
+ *
+ *   Cycle counter used by the tracer.  Defaults to the time stamp
+ *   counter on x86, the virtual counter on AArch64 and nanoseconds of
+ *   CLOCK_MONOTONIC elsewhere.
+ *
+ * GENLEX_CONFIG_KIND_TABLE
+ *
+ *   #define to 1 to pick the kind of each token with one lookup in a
+ *   table of character kinds and a switch, instead of testing the first
+ *   character against each kind in turn.  Whitespace is skipped through
+ *   the same table.  The rest of a token is read by the same loops as
+ *   without the option, so it shows most on input with many short
+ *   tokens.  Tokens are the same as without the option.  Without
+ *   GENLEX_CONFIG_RUNTIME the table lives in struct gen_lexer (256
+ *   bytes) and is filled in by gen_lexer_initialize().
+ *
+ * GENLEX_CONFIG_RUNTIME
+ *
+ *   #define to 1 to take the lexical configuration from a
+ *   struct gen_lexer_config at run time (see gen_lexer_compile()).
+ *   GENLEX_IS_SYMBOL, GENLEX_IS_WHITESPACE, GENLEX_LITERALS,
+ *   GENLEX_LITERAL_PAIRS, GENLEX_KEYWORDS, GENLEX_COMMENT_PAIRS,
+ *   GENLEX_ESCAPES, GENLEX_KEYWORDS_CASE_INSENSITIVE and the token
+ *   values must not be defined.  The I/O definitions,
+ *   GENLEX_STRING_MAX, GENLEX_INT_T and GENLEX_CONFIG_FLOATS still
+ *   apply; configurations with a zero float_token don't parse floats.
+ *
+ * GENLEX_MODE_DEPTH
+ *
+ *   With GENLEX_CONFIG_RUNTIME, the number of modes that
+ *   gen_lexer_push_mode() can stack.  Each takes a pointer in struct
+ *   gen_lexer.  Without it, there are no mode functions.
+ *
+ * GENLEX_ESCAPES
+ *
+ *      A list of the escape sequences of strings and character
+ *      literals, one GENLEX_ESCAPE(ch, action, arg) per escape: the byte
+ *      after the backslash, what it stands for, and an argument.
+ *
+ *        { GENLEX_ESCAPE('n', GENLEX_ESC_CHAR, '\n'),   the byte arg
+ *          GENLEX_ESCAPE('x', GENLEX_ESC_HEX, 2),      a byte in 1 to arg hex digits
+ *          GENLEX_ESCAPE('0', GENLEX_ESC_OCTAL, 3),    a byte in up to arg octal
+ *                                                      digits, starting with '0'
+ *          GENLEX_ESCAPE('u', GENLEX_ESC_UNICODE, 4) } a code point in exactly arg
+ *                                                      hex digits, stored as UTF-8
+ *
+ *      Any other byte after a backslash is
+ *      GENLEX_ERR_UNRECOGNIZED_ESCAPE, as are values too large for a
+ *      byte or a code point and unpaired UTF-16 surrogates.  The value
+ *      of a character literal is the decoded byte or code point.  The
+ *      list is compiled into a const table indexed by the escape byte,
+ *      by the compiler: GENLEX_ESCAPE expands to a designated
+ *      initializer there, and to a struct gen_lexer_escape anywhere
+ *      else.  GENLEX_C90_ESCAPES and GENLEX_JSON_ESCAPES are ready-made
+ *      lists.  Defaults to GENLEX_DEFAULT_ESCAPES: \n, \t, \r, \" and
+ *      \\.  With GENLEX_CONFIG_RUNTIME, the escapes come from struct
+ *      gen_lexer_config instead.
+ *
+ * GENLEX_KEYWORDS_CASE_INSENSITIVE
+ *
+ *      #define to 1 to match keywords without regard to the case of
+ *      ASCII letters, so that SELECT, Select and select are all the
+ *      keyword "select" (however it is spelled in GENLEX_KEYWORDS).
+ *      The token's text keeps the input's spelling.  Only A-Z and a-z
+ *      fold; other bytes, including UTF-8, must match exactly.  The
+ *      hash table of GENLEX_CONFIG_RUNTIME compares the symbol eight
+ *      bytes at a time, folded in place, and the matcher that glexgen
+ *      generates accepts either case; a symbol that isn't a keyword
+ *      costs about what it did before.  With GENLEX_CONFIG_RUNTIME, set
+ *      keywords_nocase in struct gen_lexer_config instead.
+ *
+ * GENLEX_LOOKAHEAD
+ *
+ *      Number of tokens that can be peeked ahead of the current one
+ *      with gen_lexer_peek().  Each buffered token takes a
+ *      GENLEX_STRING_MAX byte text buffer in struct gen_lexer.
+ *
  * GENLEX_KEYWORD_TRIE          (NOT IMPLEMENTED)
  *
  *      #define to 1 to use a trie table for keyword lookup
@@ -168,6 +555,37 @@
  *
  *      #define to 1 to enable parsing floating point numbers.
  *
+ * GENLEX_CONFIG_DECIMAL
+ *
+ *      #define to 1, with GENLEX_CONFIG_FLOATS, to return numbers with a
+ *      fraction or an exponent as exact decimals instead of converting
+ *      them with strtod().  The value of a GENLEX_FLOAT_TOKEN is then a
+ *      struct gen_lexer_decimal (see gen_lexer_token_decimal_value())
+ *      built from the digits as they are in the input, so 1.50 is 150
+ *      and -2, and 1.5e3 is 15 and 2.  Leading zeros don't count towards
+ *      the 19 significant digits coef holds; a number with more, or with
+ *      an exponent of more than 9 digits, is marked big, and the
+ *      caller converts its text.
+ *
+ * GENLEX_CONFIG_BLOBS
+ *
+ *      #define to 1 to lex blob literals: a symbol that is
+ *      GENLEX_BLOB_HEX_PREFIX ("x" by default) or
+ *      GENLEX_BLOB_BASE64_PREFIX ("b64") right before a string, as in
+ *      x"00ff" or b64"AP8=".  The string holds pairs of hex digits, or
+ *      base64 (RFC 4648, padding optional), and nothing else.  It is
+ *      decoded as it is read, into the arena given to
+ *      gen_lexer_blob_arena() rather than the token buffer, so it isn't
+ *      limited by GENLEX_STRING_MAX.  The token is GENLEX_BLOB_TOKEN, and
+ *      its text is the prefix.  A string that isn't valid is
+ *      GENLEX_ERR_INVALID_BLOB, and one that doesn't fit in what is left
+ *      of the arena GENLEX_ERR_BUFFER_OVERFLOW; the literal is consumed
+ *      either way.  With GENLEX_CONFIG_MEMORY the string is decoded
+ *      straight from the buffer, and on x86 16 digits at a time with
+ *      SSSE3 if the CPU has it (#define GENLEX_BLOB_SSSE3 to 0 to leave
+ *      that out).  Not available with GENLEX_CONFIG_RUNTIME,
+ *      glex_index.h, glex_parallel.h or glex_batch.h.
+ *
  * GENLEX_CONFIG_MULTILINE_STRING               (NOT IMPLEMENTED)
  *
  *      #define to 1 to enable parsing multi-line strings.
@@ -197,13 +615,218 @@
  *      Real (floating point) type used in lexer.  If not defined,
  *      defaults to double.
  *
+ * GENLEX_BLOB_TOKEN
+ *
+ *      Token returned by lexer to indicate a blob literal.  Required if
+ *      GENLEX_CONFIG_BLOBS is defined.
+ *
  *
  */
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
+
+/* Type of offsets, lines and columns */
+#if GENLEX_CONFIG_POS64
+#  define GENLEX_POS_T  unsigned long long
+#else
+#  define GENLEX_POS_T  unsigned int
+#endif
+
+enum gen_lexer_errors {
+  GENLEX_ERR_INVALID_CHAR        = -1,
+  GENLEX_ERR_BUFFER_OVERFLOW     = -2,
+  GENLEX_ERR_UNEXPECTED_EOF      = -3,
+  GENLEX_ERR_UNEXPECTED_EOL      = -4,
+  GENLEX_ERR_UNRECOGNIZED_ESCAPE = -5,
+  GENLEX_ERR_INTEGER_OVERFLOW    = -6,
+  GENLEX_ERR_FLOAT_OVERFLOW      = -7,
+  GENLEX_ERR_INVALID_INTEGER     = -8,
+  GENLEX_ERR_NO_MEMORY           = -9,
+  GENLEX_ERR_IO                  = -10,
+  GENLEX_ERR_INVALID_UTF8        = -11,
+  GENLEX_ERR_INVALID_BLOB        = -12,
+  GENLEX_ERR_UNKNOWN_ERROR     = -100,
+  GENLEX_ERR_INVALID_STATE     = -101,
+  GENLEX_ERR_UNIMPLEMENTED    = -1000,  /* FIXME: should be removed after development */
+};
+
+#if GENLEX_CONFIG_MEMORY
+#  if defined(GENLEX_IO_T) || defined(GENLEX_GETC) || defined(GENLEX_UNGETC)
+#    error GENLEX_IO_T, GENLEX_GETC and GENLEX_UNGETC are provided by GENLEX_CONFIG_MEMORY
+#  endif
+
+/* Memory-resident input.  data[0..len) is the whole input and pos is
+ * the offset of the next byte to be read.
+ */
+struct gen_lexer_membuf {
+  const unsigned char *data;
+  size_t len;
+  size_t pos;
+};
+
+static inline int gen_lexer_membuf_getc(struct gen_lexer_membuf *mb)
+{
+  if (mb->pos >= mb->len) { return -1; }
+  return mb->data[mb->pos++];
+}
+
+static inline void gen_lexer_membuf_ungetc(int c, struct gen_lexer_membuf *mb)
+{
+  /* reading EOF doesn't advance pos, so pushing it back is a no-op */
+  if ((c != -1) && (mb->pos > 0)) { mb->pos--; }
+}
+
+#  define GENLEX_IO_T            struct gen_lexer_membuf *
+#  define GENLEX_GETC(ctx)       (gen_lexer_membuf_getc(ctx))
+#  define GENLEX_UNGETC(ch,ctx)  (gen_lexer_membuf_ungetc((ch),(ctx)))
+#endif /* GENLEX_CONFIG_MEMORY */
+
+#if GENLEX_CONFIG_STREAM
+#  if GENLEX_CONFIG_MEMORY
+#    error GENLEX_CONFIG_STREAM and GENLEX_CONFIG_MEMORY are mutually exclusive
+#  endif
+#  if defined(GENLEX_IO_T) || defined(GENLEX_GETC) || defined(GENLEX_UNGETC) || defined(GENLEX_SEEK)
+#    error GENLEX_IO_T, GENLEX_GETC, GENLEX_UNGETC and GENLEX_SEEK are provided by GENLEX_CONFIG_STREAM
+#  endif
+
+/* Block-buffered input.  buf[0..len) holds the input from offset start
+ * on, and buf[pos] is the next byte to be read.  Bytes before the
+ * oldest live mark (pins[0]) are discarded when the buffer is refilled.
+ * If the read callback starts partway into the input, set start to
+ * that offset and gen_lexer_reset_to() a mark there before lexing.
+ */
+struct gen_lexer_stream {
+  size_t (*read)(void *arg, unsigned char *dst, size_t n);
+  void *arg;
+
+  unsigned char *buf;
+  size_t cap;
+  GENLEX_POS_T start;  /* offset of buf[0] in the input */
+  size_t len;
+  size_t pos;
+
+  /* offsets of the live marks, oldest first; the same offset may be
+   * there more than once
+   */
+  GENLEX_POS_T *pins;
+  size_t npins;
+  size_t pincap;
+
+  int eof;
+  int err;    /* GENLEX_ERR_NO_MEMORY if the buffer couldn't grow */
+};
+
+/* read callback for stdio streams: arg is the FILE * */
+static inline size_t gen_lexer_stream_read_file(void *arg, unsigned char *dst, size_t n)
+{
+  return fread(dst, 1, n, (FILE *)arg);
+}
+
+/* Sets up a stream with a cap byte buffer.  Returns 1 on success and 0
+ * if the buffer couldn't be allocated.
+ */
+static inline int gen_lexer_stream_init(struct gen_lexer_stream *st,
+    size_t (*read)(void *arg, unsigned char *dst, size_t n), void *arg, size_t cap)
+{
+  memset(st, 0, sizeof *st);
+  if (cap < 2) { cap = 2; }  /* room for the byte kept for ungetc */
+  st->read = read;
+  st->arg = arg;
+  st->cap = cap;
+  st->buf = (unsigned char *)malloc(cap);
+  return st->buf != NULL;
+}
+
+static inline void gen_lexer_stream_free(struct gen_lexer_stream *st)
+{
+  free(st->buf);
+  free(st->pins);
+  st->buf = NULL;
+  st->pins = NULL;
+  st->cap = st->len = st->pos = 0;
+  st->npins = st->pincap = 0;
+}
+
+static int genlex_stream_fill(struct gen_lexer_stream *st)
+{
+  size_t keep, n;
+
+  if (st->eof) { return 0; }
+
+  /* keep the last byte read for GENLEX_UNGETC, and everything from the
+   * oldest mark on
+   */
+  keep = (st->pos > 0) ? st->pos-1 : 0;
+  if ((st->npins > 0) && (st->pins[0] - st->start < keep)) {
+    keep = st->pins[0] - st->start;
+  }
+
+  if (keep > 0) {
+    memmove(st->buf, st->buf + keep, st->len - keep);
+    st->start += keep;
+    st->len -= keep;
+    st->pos -= keep;
+  }
+
+  if (st->len == st->cap) {
+    unsigned char *p = (unsigned char *)realloc(st->buf, 2*st->cap);
+    if (p == NULL) {
+      st->err = GENLEX_ERR_NO_MEMORY;
+      return 0;
+    }
+    st->buf = p;
+    st->cap *= 2;
+  }
+
+  n = st->read(st->arg, st->buf + st->len, st->cap - st->len);
+  if (n == 0) {
+    st->eof = 1;
+    return 0;
+  }
+
+  st->len += n;
+  return 1;
+}
+
+static inline int gen_lexer_stream_getc(struct gen_lexer_stream *st)
+{
+  if ((st->pos >= st->len) && !genlex_stream_fill(st)) { return -1; }
+  return st->buf[st->pos++];
+}
+
+static inline void gen_lexer_stream_ungetc(int c, struct gen_lexer_stream *st)
+{
+  if ((c != -1) && (st->pos > 0)) { st->pos--; }
+}
+
+static inline int gen_lexer_stream_seek(struct gen_lexer_stream *st, GENLEX_POS_T off)
+{
+  if ((off < st->start) || (off - st->start > st->len)) { return -1; }
+  st->pos = off - st->start;
+  return 0;
+}
+
+#  define GENLEX_IO_T            struct gen_lexer_stream *
+#  define GENLEX_GETC(ctx)       (gen_lexer_stream_getc(ctx))
+#  define GENLEX_UNGETC(ch,ctx)  (gen_lexer_stream_ungetc((ch),(ctx)))
+#  define GENLEX_SEEK(ctx,off)   (gen_lexer_stream_seek((ctx),(off)))
+#endif /* GENLEX_CONFIG_STREAM */
+
+#if GENLEX_CONFIG_MEMORY
+static inline int gen_lexer_membuf_seek(struct gen_lexer_membuf *mb, GENLEX_POS_T off)
+{
+  /* offsets past the end are left by reading EOF */
+  mb->pos = (off < mb->len) ? off : mb->len;
+  return 0;
+}
+
+#  define GENLEX_SEEK(ctx,off)   (gen_lexer_membuf_seek((ctx),(off)))
+#endif
 
 #if !defined(GENLEX_IO_T)
 #  define GENLEX_IO_T  void *
@@ -213,6 +836,47 @@
 #  error  GENLEX_GETC and GENLEX_UNGETC must be defined
 #endif
 
+#if GENLEX_CONFIG_RUNTIME
+#  if defined(GENLEX_IS_SYMBOL) || defined(GENLEX_IS_WHITESPACE) || \
+      defined(GENLEX_LITERALS) || defined(GENLEX_LITERAL_PAIRS) || \
+      defined(GENLEX_KEYWORDS) || defined(GENLEX_COMMENT_PAIRS) || \
+      defined(GENLEX_ID_TOKEN) || defined(GENLEX_STRING_TOKEN) || \
+      defined(GENLEX_INT_TOKEN) || defined(GENLEX_FLOAT_TOKEN) || \
+      defined(GENLEX_COMMENT_TOKEN) || defined(GENLEX_ESCAPES) || \
+      defined(GENLEX_KEYWORDS_CASE_INSENSITIVE)
+#    error GENLEX_CONFIG_RUNTIME takes the lexical configuration from struct gen_lexer_config
+#  endif
+#  if defined(GENLEX_DFA_HEADER)
+#    error GENLEX_DFA_HEADER cannot be used with GENLEX_CONFIG_RUNTIME
+#  endif
+
+#  include <ctype.h>
+
+/* The configuration lives in the lexer's compiled tables.  These stand
+ * in for the configuration macros and expect the lexer in scope as
+ * `lexer', which it is everywhere they are used.
+ */
+#  define GENLEX_IS_SYMBOL(ch,pos)      (genlex_rt_is_symbol(lexer->tab,(ch),(pos)))
+#  define GENLEX_IS_WHITESPACE(ch)      (lexer->tab->cls[(unsigned char)(ch)] & GENLEX_CLS_WS)
+#  define GENLEX_ID_TOKEN               (lexer->tab->id_token)
+#  define GENLEX_STRING_TOKEN           (lexer->tab->string_token)
+#  define GENLEX_INT_TOKEN              (lexer->tab->int_token)
+#  define GENLEX_FLOAT_TOKEN            (lexer->tab->float_token)
+#  define GENLEX_COMMENT_TOKEN          (lexer->tab->comment_token)
+#  define GENLEX_FLOATS_ENABLED         (lexer->tab->float_token != 0)
+
+#  define gen_lexer_comments            (lexer->tab->comments)
+#  define GENLEX_NUM_COMMENT_PAIRS      (lexer->tab->ncomments)
+#  define gen_lexer_literal_pairs       (lexer->tab->pairs)
+#  define GENLEX_NUM_LITERAL_PAIRS      (lexer->tab->npairs)
+
+#  define GENLEX_HAVE_COMMENTS          1
+#  define GENLEX_HAVE_LITERAL_PAIRS     1
+#  define GENLEX_MAY_BEGIN_COMMENT(ch)  (lexer->tab->cls[(ch)] & GENLEX_CLS_COMMENT)
+#  define GENLEX_MAY_BEGIN_PAIR(ch)     (lexer->tab->cls[(ch)] & GENLEX_CLS_PAIR)
+#  define GENLEX_ESC_OP(ch)             (lexer->tab->esc[(ch)])
+#else /* !GENLEX_CONFIG_RUNTIME */
+
 #if !defined(GENLEX_IS_SYMBOL)
 #  error GENLEX_IS_SYMBOL must be defined
 #endif
@@ -245,6 +909,35 @@
 #  error GENLEX_COMMENT_TOKEN must be defined when GENLEX_COMMENT_PAIRS is defined
 #endif 
 
+#if defined(GENLEX_COMMENT_PAIRS)
+#  define GENLEX_HAVE_COMMENTS          1
+#endif
+
+#if defined(GENLEX_LITERAL_PAIRS)
+#  define GENLEX_HAVE_LITERAL_PAIRS     1
+#endif
+
+#define GENLEX_FLOATS_ENABLED           1
+
+#if defined(GENLEX_DFA_HEADER)
+#  define GENLEX_MAY_BEGIN_COMMENT(ch)  (genlex_dfa_class[(ch)] & GENLEX_CLS_COMMENT)
+#  define GENLEX_MAY_BEGIN_PAIR(ch)     (genlex_dfa_class[(ch)] & GENLEX_CLS_PAIR)
+#else
+#  define GENLEX_MAY_BEGIN_COMMENT(ch)  1
+#  define GENLEX_MAY_BEGIN_PAIR(ch)     1
+#endif
+
+#if !defined(GENLEX_ESCAPES)
+#  define GENLEX_ESCAPES GENLEX_DEFAULT_ESCAPES
+#endif
+
+#define GENLEX_ESC_OP(ch)               (genlex_esc_table[(ch)])
+#endif /* GENLEX_CONFIG_RUNTIME */
+
+#if GENLEX_MODE_DEPTH && !GENLEX_CONFIG_RUNTIME
+#  error GENLEX_MODE_DEPTH requires GENLEX_CONFIG_RUNTIME
+#endif
+
 #if GENLEX_CONFIG_FLOATS
 #  if !defined(GENLEX_FLOAT_T)
 #    define GENLEX_FLOAT_T double
@@ -252,6 +945,33 @@
 #  if !defined(GENLEX_FLOAT_TOKEN)
 #    error GENLEX_FLOAT_TOKEN must be defined
 #  endif
+#elif GENLEX_CONFIG_DECIMAL
+#  error GENLEX_CONFIG_DECIMAL requires GENLEX_CONFIG_FLOATS
+#endif
+
+#if GENLEX_CONFIG_BLOBS
+#  if GENLEX_CONFIG_RUNTIME
+#    error GENLEX_CONFIG_BLOBS is not available with GENLEX_CONFIG_RUNTIME
+#  endif
+#  if !defined(GENLEX_BLOB_TOKEN)
+#    error GENLEX_BLOB_TOKEN must be defined
+#  endif
+#  if !defined(GENLEX_BLOB_HEX_PREFIX)
+#    define GENLEX_BLOB_HEX_PREFIX "x"
+#  endif
+#  if !defined(GENLEX_BLOB_BASE64_PREFIX)
+#    define GENLEX_BLOB_BASE64_PREFIX "b64"
+#  endif
+#  if !defined(GENLEX_BLOB_SSSE3)
+#    if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#      define GENLEX_BLOB_SSSE3 1
+#    else
+#      define GENLEX_BLOB_SSSE3 0
+#    endif
+#  endif
+#  if GENLEX_BLOB_SSSE3
+#    include <tmmintrin.h>
+#  endif
 #endif
 
 /* Default configuration options if not already defined */
@@ -266,65 +986,534 @@
 
 #define GENLEX_NUM_LITERALS  (sizeof(GENLEX_LITERALS)-1)
 
-enum gen_lexer_errors {
-  GENLEX_ERR_INVALID_CHAR        = -1,
-  GENLEX_ERR_BUFFER_OVERFLOW     = -2,
-  GENLEX_ERR_UNEXPECTED_EOF      = -3,
-  GENLEX_ERR_UNEXPECTED_EOL      = -4,
-  GENLEX_ERR_UNRECOGNIZED_ESCAPE = -5,
-  GENLEX_ERR_INTEGER_OVERFLOW    = -6,
-  GENLEX_ERR_FLOAT_OVERFLOW      = -7,
-  GENLEX_ERR_INVALID_INTEGER     = -8,
-  GENLEX_ERR_UNKNOWN_ERROR     = -100,
-  GENLEX_ERR_INVALID_STATE     = -101,
-  GENLEX_ERR_UNIMPLEMENTED    = -1000,  /* FIXME: should be removed after development */
+#if GENLEX_CONFIG_DECIMAL
+/* (-1)^neg * coef * 10^exp, see GENLEX_CONFIG_DECIMAL */
+struct gen_lexer_decimal {
+  unsigned long long coef;
+  int exp;
+  unsigned char neg;
+  unsigned char big;   /* too many digits: coef and exp are 0 */
 };
+#endif
 
-struct gen_lexer {
-  GENLEX_IO_T ctx;
-  size_t blen;
-  unsigned char buf[GENLEX_STRING_MAX];
-  unsigned int tok_line;
-  unsigned int tok_col;
-  unsigned int tok_off;
-
-  unsigned int off;
-  unsigned int line;
-  unsigned int col;
-  unsigned int prev_col;
+#if GENLEX_CONFIG_BLOBS
+/* The decoded bytes of a blob literal, at off in the blob arena */
+struct gen_lexer_blob {
+  size_t off;
+  size_t len;
+};
+#endif
 
-  union {
-    GENLEX_INT_T i;
+union gen_lexer_value {
+  GENLEX_INT_T i;
 #if GENLEX_CONFIG_FLOATS
-    GENLEX_FLOAT_T f;
+  GENLEX_FLOAT_T f;
+#endif
+#if GENLEX_CONFIG_DECIMAL
+  struct gen_lexer_decimal d;
+#endif
+#if GENLEX_CONFIG_BLOBS
+  struct gen_lexer_blob b;
 #endif
-  } tval;
 };
 
-struct gen_lexer_keyword {
-  const char *keyword;
-  int token;
+/* What the byte after a backslash stands for, see GENLEX_ESCAPES */
+enum {
+  GENLEX_ESC_ERROR = 0,  /* not an escape */
+  GENLEX_ESC_CHAR,       /* the byte arg */
+  GENLEX_ESC_HEX,        /* a byte in 1 to arg hex digits */
+  GENLEX_ESC_OCTAL,      /* a byte in octal, the escape byte and up to arg-1 more digits */
+  GENLEX_ESC_UNICODE,    /* a code point in exactly arg hex digits, stored as UTF-8 */
 };
 
-struct gen_lexer_literal_pair {
-  const unsigned char pair[2];
-  int token;
+struct gen_lexer_escape {
+  unsigned char ch;      /* the byte after the backslash */
+  unsigned char action;  /* GENLEX_ESC_* */
+  unsigned char arg;
 };
 
-/* Currently comment pairs are restricted to two character to keep our
- * look-ahead buffer only one character.  This handles many common
- * comment pairs.
- */
-struct gen_lexer_comment_pairs {
-  const unsigned char beg[2]; /* string that delimits the beginning of a comment */
-  const unsigned char end[2]; /* string that delimits the end of a comment */
-  /* TODO: optionally enable nested comments */
+/* An entry of the decode table an escape list compiles to */
+struct genlex_esc_op {
+  unsigned char action;
+  unsigned char arg;
 };
 
-/* Some common comment pairs as examples: */
+/* An entry of an escape list.  As a struct gen_lexer_escape here; the
+ * macro-configured decode table redefines it to index by ch.
+ */
+#define GENLEX_ESCAPE(ch,action,arg)  { (ch), (action), (arg) }
 
-/* C90 pairs of (slash-star, star-slash) */
-#define GENLEX_C90_COMMENTS { { "/*", "*/" } }
+/* Some common escape lists: */
+
+/* The lexer's escapes unless GENLEX_ESCAPES says otherwise */
+#define GENLEX_DEFAULT_ESCAPES { \
+  GENLEX_ESCAPE('n', GENLEX_ESC_CHAR, '\n'), GENLEX_ESCAPE('t', GENLEX_ESC_CHAR, '\t'), \
+  GENLEX_ESCAPE('r', GENLEX_ESC_CHAR, '\r'), GENLEX_ESCAPE('"', GENLEX_ESC_CHAR, '"'), \
+  GENLEX_ESCAPE('\\', GENLEX_ESC_CHAR, '\\'), \
+}
+
+/* C90, except that \x takes at most two digits */
+#define GENLEX_C90_ESCAPES { \
+  GENLEX_ESCAPE('a', GENLEX_ESC_CHAR, '\a'), GENLEX_ESCAPE('b', GENLEX_ESC_CHAR, '\b'), \
+  GENLEX_ESCAPE('f', GENLEX_ESC_CHAR, '\f'), GENLEX_ESCAPE('n', GENLEX_ESC_CHAR, '\n'), \
+  GENLEX_ESCAPE('r', GENLEX_ESC_CHAR, '\r'), GENLEX_ESCAPE('t', GENLEX_ESC_CHAR, '\t'), \
+  GENLEX_ESCAPE('v', GENLEX_ESC_CHAR, '\v'), GENLEX_ESCAPE('\\', GENLEX_ESC_CHAR, '\\'), \
+  GENLEX_ESCAPE('\'', GENLEX_ESC_CHAR, '\''), GENLEX_ESCAPE('"', GENLEX_ESC_CHAR, '"'), \
+  GENLEX_ESCAPE('?', GENLEX_ESC_CHAR, '?'), GENLEX_ESCAPE('x', GENLEX_ESC_HEX, 2), \
+  GENLEX_ESCAPE('0', GENLEX_ESC_OCTAL, 3), GENLEX_ESCAPE('1', GENLEX_ESC_OCTAL, 3), \
+  GENLEX_ESCAPE('2', GENLEX_ESC_OCTAL, 3), GENLEX_ESCAPE('3', GENLEX_ESC_OCTAL, 3), \
+  GENLEX_ESCAPE('4', GENLEX_ESC_OCTAL, 3), GENLEX_ESCAPE('5', GENLEX_ESC_OCTAL, 3), \
+  GENLEX_ESCAPE('6', GENLEX_ESC_OCTAL, 3), GENLEX_ESCAPE('7', GENLEX_ESC_OCTAL, 3), \
+}
+
+/* JSON: \uD83D\uDE00 is one code point */
+#define GENLEX_JSON_ESCAPES { \
+  GENLEX_ESCAPE('"', GENLEX_ESC_CHAR, '"'), GENLEX_ESCAPE('\\', GENLEX_ESC_CHAR, '\\'), \
+  GENLEX_ESCAPE('/', GENLEX_ESC_CHAR, '/'), GENLEX_ESCAPE('b', GENLEX_ESC_CHAR, '\b'), \
+  GENLEX_ESCAPE('f', GENLEX_ESC_CHAR, '\f'), GENLEX_ESCAPE('n', GENLEX_ESC_CHAR, '\n'), \
+  GENLEX_ESCAPE('r', GENLEX_ESC_CHAR, '\r'), GENLEX_ESCAPE('t', GENLEX_ESC_CHAR, '\t'), \
+  GENLEX_ESCAPE('u', GENLEX_ESC_UNICODE, 4), \
+}
+
+/* Byte classes in struct gen_lexer_tables and glexgen class tables */
+enum {
+  GENLEX_CLS_WS      = 0x01,  /* whitespace */
+  GENLEX_CLS_SYM0    = 0x02,  /* can start a symbol */
+  GENLEX_CLS_SYM     = 0x04,  /* can continue a symbol */
+  GENLEX_CLS_LITERAL = 0x08,  /* single-character literal */
+  GENLEX_CLS_PAIR    = 0x10,  /* first character of a literal pair */
+  GENLEX_CLS_COMMENT = 0x20,  /* first character of a comment opener */
+};
+
+#if GENLEX_CONFIG_KIND_TABLE
+/* Kinds of the first character of a token, for GENLEX_CONFIG_KIND_TABLE */
+enum {
+  GENLEX_KIND_INVALID,
+  GENLEX_KIND_WS,
+  GENLEX_KIND_COMMENT,
+  GENLEX_KIND_STRING,
+  GENLEX_KIND_CHAR,
+  GENLEX_KIND_PAIR,
+  GENLEX_KIND_LITERAL,
+  GENLEX_KIND_NUMBER,
+  GENLEX_KIND_SYMBOL,
+  GENLEX_KIND_NUM
+};
+
+#  if GENLEX_CONFIG_RUNTIME
+#    define GENLEX_KIND(ch)  (lexer->tab->kind[(ch)])
+#  else
+#    define GENLEX_KIND(ch)  (lexer->kind[(ch)])
+#  endif
+#endif
+
+/* ASCII letters in lowercase, for GENLEX_KEYWORDS_CASE_INSENSITIVE */
+#define GENLEX_FOLD(c)  ((c) | ((unsigned int)((c) - 'A') < 26u ? 0x20 : 0))
+
+/* GENLEX_FOLD() on eight bytes at once: a byte is A-Z if adding
+ * 0x80-'A' to its low seven bits carries into the top bit and adding
+ * 0x80-'Z'-1 doesn't, and its own top bit is clear.  No byte carries
+ * into the next.
+ */
+static inline unsigned long long genlex_fold_word(unsigned long long w)
+{
+  const unsigned long long ones = 0x0101010101010101ull;
+  unsigned long long low = w & (0x7f * ones);
+  unsigned long long upper =
+    ((low + (0x80 - 'A') * ones) ^ (low + (0x80 - 'Z' - 1) * ones)) & ~w & (0x80 * ones);
+
+  return w | (upper >> 2);
+}
+
+/* Compares len bytes of a and b, folding both */
+static inline int genlex_fold_eq(const unsigned char *a, const unsigned char *b, size_t len)
+{
+  unsigned long long wa, wb;
+
+  for (; len >= 8; a += 8, b += 8, len -= 8) {
+    memcpy(&wa, a, 8);
+    memcpy(&wb, b, 8);
+    if (genlex_fold_word(wa) != genlex_fold_word(wb)) { return 0; }
+  }
+  for (; len > 0; a++, b++, len--) {
+    if (GENLEX_FOLD(*a) != GENLEX_FOLD(*b)) { return 0; }
+  }
+  return 1;
+}
+
+#if GENLEX_CONFIG_RUNTIME
+struct gen_lexer_keyword;
+struct gen_lexer_literal_pair;
+struct gen_lexer_comment_pairs;
+
+/* Run-time lexical configuration, see gen_lexer_compile() */
+struct gen_lexer_config {
+  const char *literals;         /* characters returned as literal tokens */
+  const struct gen_lexer_literal_pair *pairs;
+  size_t npairs;
+  const struct gen_lexer_keyword *keywords;
+  size_t nkeywords;
+  const struct gen_lexer_comment_pairs *comments;
+  size_t ncomments;
+  const char *symbol_first;     /* characters that can start a symbol */
+  const char *symbol_rest;      /* characters allowed after the first */
+  const char *whitespace;       /* NULL for the isspace(3) set */
+
+  int id_token;
+  int string_token;
+  int int_token;
+  int float_token;              /* 0 if floats aren't parsed */
+  int comment_token;            /* 0 to skip comments */
+
+  const struct gen_lexer_escape *escapes;  /* NULL for GENLEX_DEFAULT_ESCAPES */
+  size_t nescapes;
+
+  int keywords_nocase;          /* see GENLEX_KEYWORDS_CASE_INSENSITIVE */
+
+  const char *raw_until;        /* non-NULL for a raw text mode */
+  int raw_token;                /* the text before raw_until */
+  int raw_until_token;          /* raw_until itself */
+};
+
+/* Handy sets for symbol_first and symbol_rest */
+#define GENLEX_ALPHA   "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+#define GENLEX_DIGITS  "0123456789"
+
+struct gen_lexer_rt_keyword {
+  const char *keyword;  /* NULL for an empty hash slot */
+  size_t len;
+  int token;
+};
+
+/* Compiled, immutable form of a struct gen_lexer_config */
+struct gen_lexer_tables {
+  unsigned char cls[256];
+
+  const struct gen_lexer_literal_pair *pairs;
+  size_t npairs;
+  const struct gen_lexer_comment_pairs *comments;
+  size_t ncomments;
+
+  const struct gen_lexer_rt_keyword *kwtab;  /* open-addressed hash table */
+  size_t kwmask;
+  int kwnocase;                              /* hashed and compared folded */
+
+  struct genlex_esc_op esc[256];
+
+#if GENLEX_CONFIG_KIND_TABLE
+  unsigned char kind[256];
+#endif
+
+  int id_token;
+  int string_token;
+  int int_token;
+  int float_token;
+  int comment_token;
+
+  const char *raw_until;  /* NULL unless this is a raw text mode */
+  size_t raw_len;
+  int raw_token;
+  int raw_until_token;
+};
+
+static inline int genlex_rt_is_symbol(const struct gen_lexer_tables *tab, int c, size_t pos)
+{
+  return (c >= 0) && (tab->cls[c] & ((pos == 0) ? GENLEX_CLS_SYM0 : GENLEX_CLS_SYM));
+}
+
+static size_t genlex_rt_hash(const unsigned char *s, size_t len)
+{
+  size_t h = 2166136261u;  /* FNV-1a */
+  while (len-- > 0) {
+    h = (h ^ *s++) * 16777619u;
+  }
+  return h;
+}
+
+/* genlex_rt_hash() of the symbol with its letters in lowercase */
+static size_t genlex_rt_hash_folded(const unsigned char *s, size_t len)
+{
+  size_t h = 2166136261u;
+  while (len-- > 0) {
+    h = (h ^ GENLEX_FOLD(*s)) * 16777619u;
+    s++;
+  }
+  return h;
+}
+#endif /* GENLEX_CONFIG_RUNTIME */
+
+#if GENLEX_CONFIG_STATS || GENLEX_CONFIG_TRACE
+/* Token kinds counted by gen_lexer_stats() and the tracer */
+enum {
+  GENLEX_STAT_LITERAL,
+  GENLEX_STAT_PAIR,
+  GENLEX_STAT_KEYWORD,
+  GENLEX_STAT_ID,
+  GENLEX_STAT_STRING,
+  GENLEX_STAT_INT,
+  GENLEX_STAT_FLOAT,
+  GENLEX_STAT_COMMENT,
+  GENLEX_STAT_ERROR,
+  GENLEX_STAT_NUM_KINDS
+};
+#endif
+
+#if GENLEX_CONFIG_STATS
+#define GENLEX_STAT_NUM_ERRORS 16  /* indexed by -error */
+
+struct gen_lexer_stats {
+  unsigned long tokens[GENLEX_STAT_NUM_KINDS];
+  unsigned long errors[GENLEX_STAT_NUM_ERRORS];
+
+  unsigned long ws_bytes;
+  unsigned long comment_bytes;   /* including skipped comments */
+  unsigned long string_bytes;
+  unsigned long symbol_bytes;    /* identifiers and keywords */
+  unsigned long number_bytes;
+
+  unsigned long comments_skipped;
+  unsigned long getc_calls;
+  unsigned long ungetc_calls;
+  unsigned long keyword_lookups;
+  unsigned long keyword_compares;
+  size_t buf_high_water;
+};
+
+#  define GENLEX_STAT(lx,stmt)  do { struct gen_lexer_stats *st_ = &(lx)->stats; stmt; } while (0)
+#else
+#  define GENLEX_STAT(lx,stmt)  do { } while (0)
+#endif
+
+#if GENLEX_CONFIG_TRACE
+#  if !defined(__GNUC__)
+#    error GENLEX_CONFIG_TRACE requires GCC or clang atomics
+#  endif
+#  if defined(GENLEX_TRACE_BEGIN) || defined(GENLEX_TRACE_END)
+#    error GENLEX_TRACE_BEGIN and GENLEX_TRACE_END are defined by GENLEX_CONFIG_TRACE
+#  endif
+
+#  if !defined(GENLEX_TRACE_RING)
+#    define GENLEX_TRACE_RING 1024
+#  endif
+#  if (GENLEX_TRACE_RING & (GENLEX_TRACE_RING-1)) != 0
+#    error GENLEX_TRACE_RING must be a power of two
+#  endif
+
+#  if !defined(GENLEX_TRACE_CYCLES)
+#    if defined(__x86_64__) || defined(__i386__)
+#      define GENLEX_TRACE_CYCLES()  (__builtin_ia32_rdtsc())
+#    elif defined(__aarch64__)
+#      define GENLEX_TRACE_CYCLES()  (genlex_trace_cntvct())
+static inline unsigned long long genlex_trace_cntvct(void)
+{
+  unsigned long long t;
+  __asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (t));
+  return t;
+}
+#    else
+#      include <time.h>
+#      define GENLEX_TRACE_CYCLES()  (genlex_trace_nsec())
+static inline unsigned long long genlex_trace_nsec(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+#    endif
+#  endif
+
+/* Bucket b > 0 of a histogram counts tokens of 2^(b-1) to 2^b - 1 cycles */
+#  define GENLEX_TRACE_BUCKETS 64
+
+struct gen_lexer_trace_event {
+  unsigned long long cycles;
+  GENLEX_POS_T off;   /* offset and length of the token */
+  unsigned int len;
+  int tok;
+  int kind;           /* GENLEX_STAT_* */
+};
+
+struct genlex_trace_slot {
+  unsigned long long seq;  /* odd while being written */
+  struct gen_lexer_trace_event ev;
+};
+
+struct gen_lexer_trace {
+  unsigned long long head;  /* number of events recorded */
+  struct genlex_trace_slot ring[GENLEX_TRACE_RING];
+
+  /* tokens and total cycles per kind and bucket */
+  unsigned long long hist[GENLEX_STAT_NUM_KINDS][GENLEX_TRACE_BUCKETS];
+  unsigned long long cycles[GENLEX_STAT_NUM_KINDS][GENLEX_TRACE_BUCKETS];
+};
+
+#  define GENLEX_TRACE_BEGIN(lx)     genlex_trace_begin(lx)
+#  define GENLEX_TRACE_END(lx,tok)   genlex_trace_end(lx,tok)
+#endif
+
+#if !defined(GENLEX_TRACE_BEGIN)
+#  define GENLEX_TRACE_BEGIN(lx)     do { } while (0)
+#endif
+#if !defined(GENLEX_TRACE_END)
+#  define GENLEX_TRACE_END(lx,tok)   do { } while (0)
+#endif
+
+#if GENLEX_CONFIG_POOL
+#  if GENLEX_LOOKAHEAD
+#    error GENLEX_CONFIG_POOL is not available with GENLEX_LOOKAHEAD
+#  endif
+
+/* Token buffers that lexers borrow, see gen_lexer_use_pool() */
+struct gen_lexer_pool {
+  void *free;          /* returned buffers, linked through their first bytes */
+  size_t nfree;
+  size_t max_free;
+  size_t nborrowed;    /* buffers held by lexers */
+};
+#endif
+
+#if GENLEX_CONFIG_RUNTIME
+/* How far a raw text mode is into its delimiter, see genlex_read_raw() */
+struct genlex_raw_state {
+  GENLEX_POS_T off;   /* start of the bytes that match raw_until so far */
+  GENLEX_POS_T line;
+  GENLEX_POS_T col;
+  size_t k;           /* bytes of it matched by the last token */
+  int owed;           /* end_token is the next token */
+  int end_token;
+};
+#endif
+
+/* Position of the lexer between two tokens, see gen_lexer_mark() */
+struct gen_lexer_mark {
+  GENLEX_POS_T off;
+  GENLEX_POS_T line;
+  GENLEX_POS_T col;
+#if GENLEX_CONFIG_RUNTIME
+  struct genlex_raw_state raw;
+#endif
+};
+
+#if GENLEX_LOOKAHEAD
+/* A token scanned ahead of the current one, with its own text */
+struct gen_lexer_slot {
+  int tok;
+  struct gen_lexer_mark end;  /* position after the token */
+  size_t blen;
+  GENLEX_POS_T tok_line;
+  GENLEX_POS_T tok_col;
+  GENLEX_POS_T tok_off;
+  union gen_lexer_value tval;
+  unsigned char text[GENLEX_STRING_MAX];
+};
+#endif
+
+struct gen_lexer {
+  GENLEX_IO_T ctx;
+#if GENLEX_CONFIG_RUNTIME
+  const struct gen_lexer_tables *tab;
+  struct genlex_raw_state raw;
+#  if GENLEX_MODE_DEPTH
+  const struct gen_lexer_tables *modes[GENLEX_MODE_DEPTH];  /* pushed modes */
+  unsigned int nmodes;
+#  endif
+#elif GENLEX_CONFIG_KIND_TABLE
+  unsigned char kind[256];  /* GENLEX_KIND_* of each character */
+#endif
+
+#if GENLEX_CONFIG_STATS
+  struct gen_lexer_stats stats;
+#endif
+#if GENLEX_CONFIG_TRACE
+  struct gen_lexer_trace *trace;
+  unsigned long long trace_start;
+#endif
+#if GENLEX_CONFIG_POOL
+  struct gen_lexer_pool *pool;
+#endif
+  size_t blen;
+#if GENLEX_LOOKAHEAD
+  unsigned char *buf;  /* text of the slot being scanned or consumed */
+#elif GENLEX_CONFIG_POOL
+  unsigned char *buf;  /* borrowed, NULL while no token needs one */
+#endif
+  GENLEX_POS_T tok_line;
+  GENLEX_POS_T tok_col;
+  GENLEX_POS_T tok_off;
+
+  GENLEX_POS_T off;
+  GENLEX_POS_T line;
+  GENLEX_POS_T col;
+  GENLEX_POS_T prev_col;
+
+  union gen_lexer_value tval;
+
+#if GENLEX_CONFIG_BLOBS
+  unsigned char *blob_buf;  /* see gen_lexer_blob_arena() */
+  size_t blob_cap;
+  size_t blob_used;
+#endif
+
+#if GENLEX_LOOKAHEAD
+  /* ring[cur] is the current token, followed by nahead peeked tokens */
+  struct gen_lexer_slot ring[GENLEX_LOOKAHEAD+1];
+  unsigned int cur;
+  unsigned int nahead;
+#endif
+
+#if !GENLEX_LOOKAHEAD && !GENLEX_CONFIG_POOL
+  /* last, so that the state above shares cache lines */
+  unsigned char buf[GENLEX_STRING_MAX];
+#endif
+};
+
+/* A scanned token, detached from the lexer.  Drivers that collect whole
+ * token streams (see glex_parallel.h) store these.  The token text is
+ * not kept: [off,end) is the span of input that produced the token.
+ */
+struct gen_lexer_token {
+  int tok;
+  GENLEX_POS_T off;   /* offset of the first byte of the token */
+  GENLEX_POS_T end;   /* offset just past the last byte scanned */
+  GENLEX_POS_T line;
+  GENLEX_POS_T col;
+  union gen_lexer_value val;
+};
+
+/* Growable array of token records.  The lexer itself only allocates
+ * token buffers with GENLEX_CONFIG_POOL; only drivers that collect whole
+ * token streams use this.
+ */
+struct gen_lexer_tokens {
+  struct gen_lexer_token *toks;
+  size_t len;
+  size_t cap;
+};
+
+struct gen_lexer_keyword {
+  const char *keyword;
+  int token;
+};
+
+struct gen_lexer_literal_pair {
+  const unsigned char pair[2];
+  int token;
+};
+
+/* Currently comment pairs are restricted to two character to keep our
+ * look-ahead buffer only one character.  This handles many common
+ * comment pairs.
+ */
+struct gen_lexer_comment_pairs {
+  const unsigned char beg[2]; /* string that delimits the beginning of a comment */
+  const unsigned char end[2]; /* string that delimits the end of a comment */
+  /* TODO: optionally enable nested comments */
+};
+
+/* Some common comment pairs as examples: */
+
+/* C90 pairs of (slash-star, star-slash) */
+#define GENLEX_C90_COMMENTS { { "/*", "*/" } }
 
 /* C99/C++ also includes (slash-slash, EOL) */
 #define GENLEX_C99_COMMENTS { { "/*", "*/" }, { "//", "\n" } }
@@ -332,6 +1521,7 @@ struct gen_lexer_comment_pairs {
 /* sh/ksh/bash use (pound,EOL) */
 #define GENLEX_SH_COMMENTS  { { "#", "\n" } }
 
+#if !GENLEX_CONFIG_RUNTIME
 static const unsigned char gen_lexer_literals[GENLEX_NUM_LITERALS] = GENLEX_LITERALS;
 static const struct gen_lexer_keyword gen_lexer_keywords[] = GENLEX_KEYWORDS;
 
@@ -347,29 +1537,120 @@ static const struct gen_lexer_literal_pair gen_lexer_literal_pairs[] = GENLEX_LI
 
 #define GENLEX_NUM_KEYWORDS  (sizeof(gen_lexer_keywords)/sizeof(gen_lexer_keywords[0]))
 
+/* GENLEX_ESCAPES by escape byte, only read after a backslash.  Each
+ * entry is a designated initializer, so the table is built by the
+ * compiler and the bytes no escape names are GENLEX_ESC_ERROR.
+ */
+#undef GENLEX_ESCAPE
+#define GENLEX_ESCAPE(ch,action,arg)  [(unsigned char)(ch)] = { (action), (arg) }
+static const struct genlex_esc_op genlex_esc_table[256] = GENLEX_ESCAPES;
+#undef GENLEX_ESCAPE
+#define GENLEX_ESCAPE(ch,action,arg)  { (ch), (action), (arg) }
+#endif /* !GENLEX_CONFIG_RUNTIME */
+
 /* Initializes the lexer structure with the IO context */
 static int gen_lexer_initialize(struct gen_lexer *lexer, GENLEX_IO_T ctx);
+static inline void gen_lexer_reset(struct gen_lexer *lexer, GENLEX_IO_T ctx);
 
 /* Returns the next token, 0 at the end of the stream, or -1 if an error
  * occurred
  */
 static int gen_lexer_next_token(struct gen_lexer *lexer);
-static unsigned int gen_lexer_token_line(struct gen_lexer *lexer);
-static unsigned int gen_lexer_token_col(struct gen_lexer *lexer);
+static GENLEX_POS_T gen_lexer_token_line(struct gen_lexer *lexer);
+static GENLEX_POS_T gen_lexer_token_col(struct gen_lexer *lexer);
 
 static const unsigned char *gen_lexer_token_string(struct gen_lexer *lexer, size_t *lenp);
 static GENLEX_INT_T gen_lexer_token_int_value(struct gen_lexer *lexer);
 
-#if GENLEX_CONFIG_FLOATS
+#if GENLEX_CONFIG_DECIMAL
+static struct gen_lexer_decimal gen_lexer_token_decimal_value(struct gen_lexer *lexer);
+#elif GENLEX_CONFIG_FLOATS
 static GENLEX_FLOAT_T gen_lexer_token_float_value(struct gen_lexer *lexer);
 #endif
 
+#if GENLEX_CONFIG_BLOBS
+static const unsigned char *gen_lexer_token_blob(struct gen_lexer *lexer, size_t *lenp);
+static inline void gen_lexer_blob_arena(struct gen_lexer *lexer, unsigned char *buf, size_t cap);
+static inline size_t gen_lexer_blob_arena_used(const struct gen_lexer *lexer);
+#endif
+
+#if defined(GENLEX_SEEK)
+static inline int gen_lexer_mark(struct gen_lexer *lexer, struct gen_lexer_mark *mark);
+static inline int gen_lexer_reset_to(struct gen_lexer *lexer, const struct gen_lexer_mark *mark);
+static inline void gen_lexer_release_mark(struct gen_lexer *lexer, const struct gen_lexer_mark *mark);
+#endif
+
+#if GENLEX_CONFIG_STATS
+static inline const struct gen_lexer_stats *gen_lexer_stats(const struct gen_lexer *lexer);
+#endif
+
+#if GENLEX_CONFIG_POOL
+static void gen_lexer_pool_init(struct gen_lexer_pool *pool, size_t max_free);
+static void gen_lexer_pool_free(struct gen_lexer_pool *pool);
+static inline void gen_lexer_use_pool(struct gen_lexer *lexer, struct gen_lexer_pool *pool);
+#endif
+
+#if GENLEX_CONFIG_TRACE
+static void gen_lexer_trace_init(struct gen_lexer_trace *tr);
+static inline void gen_lexer_trace_attach(struct gen_lexer *lexer, struct gen_lexer_trace *tr);
+static size_t gen_lexer_trace_events(const struct gen_lexer_trace *tr,
+    struct gen_lexer_trace_event *out, size_t max);
+static int gen_lexer_trace_dump(const struct gen_lexer_trace *tr, FILE *f);
+#endif
+
+#if GENLEX_CONFIG_RUNTIME
+static int gen_lexer_compile(struct gen_lexer_tables *tab, const struct gen_lexer_config *cfg);
+static void gen_lexer_tables_free(struct gen_lexer_tables *tab);
+static int gen_lexer_initialize_with(struct gen_lexer *lexer,
+    const struct gen_lexer_tables *tab, GENLEX_IO_T ctx);
+#endif
+
+#if GENLEX_MODE_DEPTH
+static inline int gen_lexer_push_mode(struct gen_lexer *lexer, const struct gen_lexer_tables *tab);
+static inline int gen_lexer_pop_mode(struct gen_lexer *lexer);
+static inline const struct gen_lexer_tables *gen_lexer_mode(const struct gen_lexer *lexer);
+#endif
+
+#if GENLEX_LOOKAHEAD
+static int gen_lexer_peek(struct gen_lexer *lexer, unsigned int k);
+static const unsigned char *gen_lexer_peek_string(struct gen_lexer *lexer, unsigned int k, size_t *lenp);
+static GENLEX_INT_T gen_lexer_peek_int_value(struct gen_lexer *lexer, unsigned int k);
+#  if GENLEX_CONFIG_DECIMAL
+static struct gen_lexer_decimal gen_lexer_peek_decimal_value(struct gen_lexer *lexer, unsigned int k);
+#  elif GENLEX_CONFIG_FLOATS
+static GENLEX_FLOAT_T gen_lexer_peek_float_value(struct gen_lexer *lexer, unsigned int k);
+#  endif
+#  if GENLEX_CONFIG_BLOBS
+static const unsigned char *gen_lexer_peek_blob(struct gen_lexer *lexer, unsigned int k, size_t *lenp);
+#  endif
+static int gen_lexer_advance(struct gen_lexer *lexer);
+#endif
+
+/* Copies the current token, as returned by gen_lexer_next_token(), into
+ * a detached token record.
+ */
+static inline void gen_lexer_token_record(struct gen_lexer *lexer, int tok, struct gen_lexer_token *rec);
+
+/* Skips the rest of a group after its open literal, up to and including
+ * the matching close literal.  Returns close, or an error.
+ */
+static inline int gen_lexer_skip_group(struct gen_lexer *lexer, int open, int close);
+
+/* Appends a token record to a token array, growing it as needed.
+ * Returns 1 on success and 0 if out of memory.
+ */
+static inline int gen_lexer_tokens_push(struct gen_lexer_tokens *toks, const struct gen_lexer_token *tok);
+
+/* Frees the storage of a token array */
+static inline void gen_lexer_tokens_free(struct gen_lexer_tokens *toks);
+
 
 /* Implementation */
 
 static inline int genlex_getc(struct gen_lexer *lexer)
 {
   int c = GENLEX_GETC(lexer->ctx);
+  GENLEX_STAT(lexer, st_->getc_calls++);
 #if !GENLEX_CONFIG_ONLY_OFFSET
   lexer->prev_col = lexer->col;
   if (c == '\n') {
@@ -386,6 +1667,7 @@ static inline int genlex_getc(struct gen_lexer *lexer)
 
 static inline void genlex_ungetc(int c, struct gen_lexer *lexer)
 {
+  GENLEX_STAT(lexer, st_->ungetc_calls++);
 #if !GENLEX_CONFIG_ONLY_OFFSET
   if (c == '\n') { lexer->line--; }
   lexer->col = lexer->prev_col;
@@ -396,82 +1678,623 @@ static inline void genlex_ungetc(int c, struct gen_lexer *lexer)
   }
 }
 
+#if GENLEX_CONFIG_MEMORY
+/* Moves the lexer past the bytes from the next one up to q, which were
+ * scanned straight from the buffer, and counts the lines passed over.
+ */
+static inline void genlex_pass_plain(struct gen_lexer *lexer, const unsigned char *q)
+{
+  struct gen_lexer_membuf *mb = lexer->ctx;
+  const unsigned char *p = mb->data + mb->pos;
+
+  if (q == p) { return; }
+
+#if !GENLEX_CONFIG_ONLY_OFFSET
+  {
+    const unsigned char *s = p, *nl;
+
+    while ((nl = (const unsigned char *)memchr(s, '\n', q - s)) != NULL) {
+      lexer->line++;
+      s = nl+1;
+    }
+    lexer->col = (s == p) ? lexer->col + (q - p) : (GENLEX_POS_T)(q - s);
+    lexer->prev_col = lexer->col;
+  }
+#endif
+  lexer->off += q - p;
+  mb->pos = q - mb->data;
+}
+#endif
+
+#if defined(GENLEX_DFA_HEADER)
+#  include GENLEX_DFA_HEADER
+#endif
+
+#if GENLEX_CONFIG_UTF8
+#  include "glex_xid.h"
+
+enum {
+  GENLEX_XID_START    = 0x01,
+  GENLEX_XID_CONTINUE = 0x02,
+};
+
+/* GENLEX_XID_* bits of a code point */
+static inline unsigned int genlex_xid(unsigned long cp)
+{
+  if (cp >= GENLEX_XID_LIMIT) { return 0; }
+  return (genlex_xid_blocks[genlex_xid_index[cp >> 8]][(cp & 0xff) >> 2] >> ((cp & 3) * 2)) & 3;
+}
+
+/* Bytes from 0x80 up start multibyte code points, which are left to
+ * genlex_read_xid()
+ */
+#  define GENLEX_IS_MULTIBYTE(ch)  ((ch) >= 0x80)
+#else
+#  define GENLEX_IS_MULTIBYTE(ch)  0
+#endif
+
+#if !GENLEX_CONFIG_KIND_TABLE
 static int genlex_skip_ws(struct gen_lexer *lexer)
 {
   int c;
 
+#if defined(GENLEX_DFA_HEADER)
+  while (c = genlex_getc(lexer),
+      (c != EOF) && (genlex_dfa_class[c] & GENLEX_CLS_WS)) {
+    continue;
+  }
+#else
   while (c = genlex_getc(lexer),
       (c != EOF) && GENLEX_IS_WHITESPACE(c)) {
     continue;
   }
+#endif
 
   return c;
 }
+#endif
 
-static int gen_lexer_initialize(struct gen_lexer *lexer, GENLEX_IO_T ctx)
-{
-  memset(lexer, 0, sizeof(*lexer));
-  lexer->ctx = ctx;
-  return 1;
-}
-
-static int gen_lexer_buf_add(struct gen_lexer *lexer, int ch)
+#if GENLEX_CONFIG_KIND_TABLE
+static unsigned char genlex_kind_of(int c, unsigned int cls)
 {
-  if (lexer->blen+1 >= sizeof(lexer->buf)) {
-    return 0;
-  }
-
-  lexer->buf[lexer->blen++] = ch;
-  return 1;
+  if (cls & GENLEX_CLS_WS)        { return GENLEX_KIND_WS; }
+  if (cls & GENLEX_CLS_COMMENT)   { return GENLEX_KIND_COMMENT; }
+  if (c == '"')                   { return GENLEX_KIND_STRING; }
+  if (c == '\'')                  { return GENLEX_KIND_CHAR; }
+  if (cls & GENLEX_CLS_PAIR)      { return GENLEX_KIND_PAIR; }
+  if (cls & GENLEX_CLS_LITERAL)   { return GENLEX_KIND_LITERAL; }
+  if (isnumber(c) || (c == '-'))  { return GENLEX_KIND_NUMBER; }
+  if (cls & GENLEX_CLS_SYM0)      { return GENLEX_KIND_SYMBOL; }
+  if (GENLEX_IS_MULTIBYTE(c))     { return GENLEX_KIND_SYMBOL; }
+  return GENLEX_KIND_INVALID;
 }
+#endif
 
-/* Shortcut macro that includes return-on-error behavior.
- *
- * This is mainly meant to do the default error handling that's almost
- * always done when using gen_lexer_buf_add
- */
-#define GENLEXER_BUF_ADD(lx, c) do { \
-  if (!gen_lexer_buf_add((lx),(c))) { \
-    return GENLEX_ERR_BUFFER_OVERFLOW; \
-  } } while(0)
-
-static int gen_lexer_next_char_escaped(struct gen_lexer *lexer)
+#if !GENLEX_CONFIG_RUNTIME && !defined(GENLEX_DFA_HEADER)
+/* GENLEX_CLS_* bits of c, as glexgen would tabulate them */
+static inline unsigned int genlex_class_of(int c)
 {
-  int c = genlex_getc(lexer);
+  unsigned int cls = 0, i;
 
-  if (c == EOF) {
-    return GENLEX_ERR_UNEXPECTED_EOF;
+  if (GENLEX_IS_WHITESPACE(c)) { cls |= GENLEX_CLS_WS; }
+  if (GENLEX_IS_SYMBOL(c, 0))  { cls |= GENLEX_CLS_SYM0; }
+  if ((c != 0) && memchr(gen_lexer_literals, c, sizeof(gen_lexer_literals))) {
+    cls |= GENLEX_CLS_LITERAL;
   }
-
-  /* FIXME: escape sequences should be somewhat configurable */
-  /* FIXME: this doesn't cover all of the ones recognized by C90 */
-  switch (c) {
-    case 'n': c = '\n'; break;
-    case 't': c = '\t'; break;
-    case 'r': c = '\r'; break;
-    case '"': c = '"'; break;
-    case '\\': break;
-    default: return GENLEX_ERR_UNRECOGNIZED_ESCAPE;
+#if defined(GENLEX_LITERAL_PAIRS)
+  for (i=0; i < GENLEX_NUM_LITERAL_PAIRS; i++) {
+    if (gen_lexer_literal_pairs[i].pair[0] == c) { cls |= GENLEX_CLS_PAIR; }
+  }
+#endif
+#if defined(GENLEX_COMMENT_PAIRS)
+  for (i=0; i < GENLEX_NUM_COMMENT_PAIRS; i++) {
+    if (gen_lexer_comments[i].beg[0] == c) { cls |= GENLEX_CLS_COMMENT; }
   }
+#endif
+  (void)i;
 
-  return c;
+  return cls;
 }
+#endif
 
-#if !GENLEX_CONFIG_ONLY_OFFSET
-static unsigned int gen_lexer_token_line(struct gen_lexer *lexer)
+#if GENLEX_CONFIG_POOL
+struct genlex_pool_buf {
+  struct genlex_pool_buf *next;
+};
+
+static void gen_lexer_pool_init(struct gen_lexer_pool *pool, size_t max_free)
 {
-  return lexer->tok_line;
+  pool->free = NULL;
+  pool->nfree = 0;
+  pool->max_free = max_free;
+  pool->nborrowed = 0;
 }
 
-static unsigned int gen_lexer_token_col(struct gen_lexer *lexer)
+static void gen_lexer_pool_free(struct gen_lexer_pool *pool)
 {
-  return lexer->tok_col;
+  while (pool->free != NULL) {
+    struct genlex_pool_buf *b = (struct genlex_pool_buf *)pool->free;
+    pool->free = b->next;
+    free(b);
+  }
+  pool->nfree = 0;
 }
-#endif
 
-static unsigned int gen_lexer_token_off(struct gen_lexer *lexer)
+static inline void gen_lexer_use_pool(struct gen_lexer *lexer, struct gen_lexer_pool *pool)
 {
-  return lexer->tok_off;
+  lexer->pool = pool;
+}
+
+static int genlex_buf_borrow(struct gen_lexer *lexer)
+{
+  struct gen_lexer_pool *pool = lexer->pool;
+
+  if ((pool != NULL) && (pool->free != NULL)) {
+    struct genlex_pool_buf *b = (struct genlex_pool_buf *)pool->free;
+    pool->free = b->next;
+    pool->nfree--;
+    lexer->buf = (unsigned char *)b;
+  } else if ((lexer->buf = (unsigned char *)malloc(GENLEX_STRING_MAX)) == NULL) {
+    return 0;
+  }
+
+  if (pool != NULL) { pool->nborrowed++; }
+  return 1;
+}
+
+static void genlex_buf_return(struct gen_lexer *lexer)
+{
+  struct gen_lexer_pool *pool = lexer->pool;
+
+  if (pool != NULL) {
+    pool->nborrowed--;
+    if (pool->nfree < pool->max_free) {
+      struct genlex_pool_buf *b = (struct genlex_pool_buf *)lexer->buf;
+      b->next = (struct genlex_pool_buf *)pool->free;
+      pool->free = b;
+      pool->nfree++;
+      lexer->buf = NULL;
+      return;
+    }
+  }
+
+  free(lexer->buf);
+  lexer->buf = NULL;
+}
+#endif
+
+static inline void gen_lexer_reset(struct gen_lexer *lexer, GENLEX_IO_T ctx)
+{
+  lexer->ctx = ctx;
+#if GENLEX_CONFIG_POOL
+  if (lexer->buf != NULL) { genlex_buf_return(lexer); }
+#endif
+#if GENLEX_CONFIG_STATS
+  memset(&lexer->stats, 0, sizeof(lexer->stats));
+#endif
+
+  lexer->blen = 0;
+  lexer->tok_line = 0;
+  lexer->tok_col = 0;
+  lexer->tok_off = 0;
+  lexer->off = 0;
+  lexer->line = 0;
+  lexer->col = 0;
+  lexer->prev_col = 0;
+  memset(&lexer->tval, 0, sizeof(lexer->tval));
+
+#if GENLEX_CONFIG_RUNTIME
+  lexer->raw.owed = 0;
+  lexer->raw.k = 0;
+#  if GENLEX_MODE_DEPTH
+  if (lexer->nmodes > 0) {
+    lexer->tab = lexer->modes[0];
+    lexer->nmodes = 0;
+  }
+#  endif
+#endif
+
+#if GENLEX_LOOKAHEAD
+  lexer->cur = 0;
+  lexer->nahead = 0;
+  memset(&lexer->ring[0], 0, offsetof(struct gen_lexer_slot, text));
+  lexer->buf = lexer->ring[0].text;
+#endif
+}
+
+#if GENLEX_CONFIG_RUNTIME
+/* Compiles an escape list into a decode table */
+static void genlex_esc_compile(struct genlex_esc_op *esc, const struct gen_lexer_escape *list, size_t n)
+{
+  size_t i;
+
+  memset(esc, 0, 256 * sizeof esc[0]);
+  for (i = 0; i < n; i++) {
+    esc[list[i].ch].action = list[i].action;
+    esc[list[i].ch].arg = list[i].arg;
+  }
+}
+#endif
+
+/* Only the state is set up: the token buffers are written before
+ * they're read, so they aren't cleared.
+ */
+static int gen_lexer_initialize(struct gen_lexer *lexer, GENLEX_IO_T ctx)
+{
+#if GENLEX_CONFIG_RUNTIME
+  lexer->tab = NULL;
+#endif
+#if GENLEX_MODE_DEPTH
+  lexer->nmodes = 0;
+#endif
+#if GENLEX_CONFIG_TRACE
+  lexer->trace = NULL;
+  lexer->trace_start = 0;
+#endif
+#if GENLEX_CONFIG_POOL
+  lexer->pool = NULL;
+  lexer->buf = NULL;
+#endif
+#if GENLEX_CONFIG_BLOBS
+  lexer->blob_buf = NULL;
+  lexer->blob_cap = 0;
+  lexer->blob_used = 0;
+#endif
+  gen_lexer_reset(lexer, ctx);
+
+#if GENLEX_CONFIG_KIND_TABLE && !GENLEX_CONFIG_RUNTIME
+  {
+    int c;
+    for (c = 0; c < 256; c++) {
+#  if defined(GENLEX_DFA_HEADER)
+      lexer->kind[c] = genlex_kind_of(c, genlex_dfa_class[c]);
+#  else
+      lexer->kind[c] = genlex_kind_of(c, genlex_class_of(c));
+#  endif
+    }
+  }
+#endif
+  return 1;
+}
+
+#if GENLEX_CONFIG_RUNTIME
+static void genlex_rt_mark(struct gen_lexer_tables *tab, const char *set, unsigned char cls)
+{
+  for (; *set != '\0'; set++) {
+    tab->cls[(unsigned char)*set] |= cls;
+  }
+}
+
+static int gen_lexer_compile(struct gen_lexer_tables *tab, const struct gen_lexer_config *cfg)
+{
+  static const struct gen_lexer_escape default_escapes[] = GENLEX_DEFAULT_ESCAPES;
+  struct gen_lexer_rt_keyword *kwtab;
+  size_t i, n;
+  int c;
+
+  memset(tab, 0, sizeof *tab);
+
+  if (cfg->whitespace != NULL) {
+    genlex_rt_mark(tab, cfg->whitespace, GENLEX_CLS_WS);
+  } else {
+    for (c = 0; c < 256; c++) {
+      if (isspace(c)) { tab->cls[c] |= GENLEX_CLS_WS; }
+    }
+  }
+
+  genlex_rt_mark(tab, cfg->literals ? cfg->literals : "", GENLEX_CLS_LITERAL);
+  genlex_rt_mark(tab, cfg->symbol_first ? cfg->symbol_first : "", GENLEX_CLS_SYM0);
+  genlex_rt_mark(tab, cfg->symbol_rest ? cfg->symbol_rest : "", GENLEX_CLS_SYM);
+
+  for (i = 0; i < cfg->npairs; i++) {
+    tab->cls[cfg->pairs[i].pair[0]] |= GENLEX_CLS_PAIR;
+  }
+
+  for (i = 0; i < cfg->ncomments; i++) {
+    tab->cls[cfg->comments[i].beg[0]] |= GENLEX_CLS_COMMENT;
+  }
+
+  tab->pairs = cfg->pairs;
+  tab->npairs = cfg->npairs;
+  tab->comments = cfg->comments;
+  tab->ncomments = cfg->ncomments;
+
+  if (cfg->escapes != NULL) {
+    genlex_esc_compile(tab->esc, cfg->escapes, cfg->nescapes);
+  } else {
+    genlex_esc_compile(tab->esc, default_escapes, sizeof default_escapes / sizeof default_escapes[0]);
+  }
+
+  tab->id_token = cfg->id_token;
+  tab->string_token = cfg->string_token;
+  tab->int_token = cfg->int_token;
+  tab->float_token = cfg->float_token;
+  tab->comment_token = cfg->comment_token;
+#if !GENLEX_CONFIG_FLOATS
+  tab->float_token = 0;
+#endif
+
+  if (cfg->raw_until != NULL) {
+    tab->raw_len = strlen(cfg->raw_until);
+    if ((tab->raw_len == 0) || (tab->raw_len >= GENLEX_STRING_MAX/2)) {
+      return GENLEX_ERR_INVALID_STATE;
+    }
+    tab->raw_until = cfg->raw_until;
+    tab->raw_token = cfg->raw_token;
+    tab->raw_until_token = cfg->raw_until_token;
+  }
+
+#if GENLEX_CONFIG_KIND_TABLE
+  for (c = 0; c < 256; c++) {
+    tab->kind[c] = genlex_kind_of(c, tab->cls[c]);
+  }
+#endif
+
+  if (cfg->nkeywords == 0) {
+    return 0;
+  }
+
+  /* keep the hash table at most half full */
+  for (n = 2; n < 2*cfg->nkeywords; n *= 2) {
+    continue;
+  }
+
+  kwtab = (struct gen_lexer_rt_keyword *)calloc(n, sizeof *kwtab);
+  if (kwtab == NULL) {
+    return GENLEX_ERR_NO_MEMORY;
+  }
+  tab->kwtab = kwtab;
+  tab->kwmask = n-1;
+
+  tab->kwnocase = cfg->keywords_nocase;
+
+  for (i = 0; i < cfg->nkeywords; i++) {
+    const char *kw = cfg->keywords[i].keyword;
+    size_t len = strlen(kw);
+    size_t h = (tab->kwnocase ? genlex_rt_hash_folded((const unsigned char *)kw, len) :
+                                genlex_rt_hash((const unsigned char *)kw, len)) & tab->kwmask;
+
+    while (kwtab[h].keyword != NULL) {
+      h = (h+1) & tab->kwmask;
+    }
+
+    kwtab[h].keyword = kw;
+    kwtab[h].len = len;
+    kwtab[h].token = cfg->keywords[i].token;
+  }
+
+  return 0;
+}
+
+static void gen_lexer_tables_free(struct gen_lexer_tables *tab)
+{
+  free((void *)tab->kwtab);
+  tab->kwtab = NULL;
+  tab->kwmask = 0;
+}
+
+static int gen_lexer_initialize_with(struct gen_lexer *lexer,
+    const struct gen_lexer_tables *tab, GENLEX_IO_T ctx)
+{
+  gen_lexer_initialize(lexer, ctx);
+  lexer->tab = tab;
+  return 1;
+}
+
+#if GENLEX_MODE_DEPTH
+static inline int gen_lexer_push_mode(struct gen_lexer *lexer, const struct gen_lexer_tables *tab)
+{
+  if (lexer->nmodes >= GENLEX_MODE_DEPTH) {
+    return GENLEX_ERR_INVALID_STATE;
+  }
+
+  lexer->modes[lexer->nmodes++] = lexer->tab;
+  lexer->tab = tab;
+  lexer->raw.k = 0;
+  return 0;
+}
+
+static inline int gen_lexer_pop_mode(struct gen_lexer *lexer)
+{
+  if (lexer->nmodes == 0) {
+    return GENLEX_ERR_INVALID_STATE;
+  }
+
+  lexer->tab = lexer->modes[--lexer->nmodes];
+  lexer->raw.k = 0;
+  return 0;
+}
+
+static inline const struct gen_lexer_tables *gen_lexer_mode(const struct gen_lexer *lexer)
+{
+  return lexer->tab;
+}
+#endif
+#endif /* GENLEX_CONFIG_RUNTIME */
+
+static int gen_lexer_buf_add(struct gen_lexer *lexer, int ch)
+{
+  if (lexer->blen+1 >= GENLEX_STRING_MAX) {
+    return 0;
+  }
+#if GENLEX_CONFIG_POOL
+  if ((lexer->buf == NULL) && !genlex_buf_borrow(lexer)) {
+    return 0;  /* gen_lexer_next_token() reports GENLEX_ERR_NO_MEMORY */
+  }
+#endif
+
+  lexer->buf[lexer->blen++] = ch;
+  GENLEX_STAT(lexer, if (lexer->blen > st_->buf_high_water) { st_->buf_high_water = lexer->blen; });
+  return 1;
+}
+
+/* Shortcut macro that includes return-on-error behavior.
+ *
+ * This is mainly meant to do the default error handling that's almost
+ * always done when using gen_lexer_buf_add
+ */
+#define GENLEXER_BUF_ADD(lx, c) do { \
+  if (!gen_lexer_buf_add((lx),(c))) { \
+    return GENLEX_ERR_BUFFER_OVERFLOW; \
+  } } while(0)
+
+/* Value of each hex digit, -1 for other bytes */
+static const signed char genlex_xdigit[256] = {
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+  -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+/* Code points decoded from GENLEX_ESC_UNICODE escapes are returned with
+ * this bit set, so that they go into the text as UTF-8
+ */
+#define GENLEX_ESC_CODEPOINT 0x1000000
+
+/* Reads digits of base (8 or 16) onto *vp, at least min and at most max
+ * of them.  Returns 0 or an error.
+ */
+static inline int genlex_esc_digits(struct gen_lexer *lexer, int base,
+    unsigned int min, unsigned int max, unsigned long *vp)
+{
+  unsigned long v = *vp;
+  unsigned int n;
+
+  for (n = 0; n < max; n++) {
+    int c = genlex_getc(lexer);
+    int d;
+
+    if (c == EOF) { return GENLEX_ERR_UNEXPECTED_EOF; }
+    d = genlex_xdigit[c];
+    if ((d < 0) || (d >= base)) {
+      genlex_ungetc(c, lexer);
+      break;
+    }
+    v = v*base + d;
+  }
+
+  *vp = v;
+  return (n < min) ? GENLEX_ERR_UNRECOGNIZED_ESCAPE : 0;
+}
+
+/* The code point of a GENLEX_ESC_UNICODE escape.  A high surrogate must
+ * be followed by the escape of a low one, and the pair is one code
+ * point.
+ */
+static int genlex_esc_unicode(struct gen_lexer *lexer, int esc, unsigned int ndigits)
+{
+  unsigned long cp = 0, lo = 0;
+  int err;
+
+  if ((err = genlex_esc_digits(lexer, 16, ndigits, ndigits, &cp)) != 0) { return err; }
+
+  if ((cp >= 0xd800) && (cp <= 0xdbff)) {
+    int c = genlex_getc(lexer);
+    if ((c == '\\') && ((c = genlex_getc(lexer)) == esc)) {
+      if ((err = genlex_esc_digits(lexer, 16, ndigits, ndigits, &lo)) != 0) { return err; }
+    }
+    if (c == EOF) { return GENLEX_ERR_UNEXPECTED_EOF; }
+    if ((lo < 0xdc00) || (lo > 0xdfff)) { return GENLEX_ERR_UNRECOGNIZED_ESCAPE; }
+    cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+  } else if (((cp >= 0xdc00) && (cp <= 0xdfff)) || (cp > 0x10ffff)) {
+    return GENLEX_ERR_UNRECOGNIZED_ESCAPE;
+  }
+
+  return (int)cp | GENLEX_ESC_CODEPOINT;
+}
+
+/* Decodes the escape sequence after a backslash through the GENLEX_ESC_OP
+ * table.  Returns the byte, a code point with GENLEX_ESC_CODEPOINT set,
+ * or an error.
+ */
+static int gen_lexer_next_char_escaped(struct gen_lexer *lexer)
+{
+  int c = genlex_getc(lexer);
+  struct genlex_esc_op op;
+  unsigned long v;
+  int err;
+
+  if (c == EOF) {
+    return GENLEX_ERR_UNEXPECTED_EOF;
+  }
+
+  op = GENLEX_ESC_OP(c);
+  switch (op.action) {
+    case GENLEX_ESC_CHAR:
+      return op.arg;
+
+    case GENLEX_ESC_HEX:
+      v = 0;
+      err = genlex_esc_digits(lexer, 16, 1, op.arg, &v);
+      break;
+
+    case GENLEX_ESC_OCTAL:
+      v = c - '0';
+      err = genlex_esc_digits(lexer, 8, 0, (op.arg > 0) ? op.arg - 1 : 0, &v);
+      break;
+
+    case GENLEX_ESC_UNICODE:
+      return genlex_esc_unicode(lexer, c, op.arg);
+
+    default:
+      return GENLEX_ERR_UNRECOGNIZED_ESCAPE;
+  }
+
+  if (err != 0) { return err; }
+  if (v > 0xff) { return GENLEX_ERR_UNRECOGNIZED_ESCAPE; }
+  return (int)v;
+}
+
+/* Adds a decoded escape to the buffer: a code point as UTF-8 */
+static int genlex_buf_add_escaped(struct gen_lexer *lexer, int c)
+{
+  unsigned long cp = c & ~GENLEX_ESC_CODEPOINT;
+
+  if (!(c & GENLEX_ESC_CODEPOINT) || (cp < 0x80)) {
+    return gen_lexer_buf_add(lexer, (int)cp);
+  }
+  if (cp < 0x800) {
+    return gen_lexer_buf_add(lexer, 0xc0 | (cp >> 6)) &&
+           gen_lexer_buf_add(lexer, 0x80 | (cp & 0x3f));
+  }
+  if (cp < 0x10000) {
+    return gen_lexer_buf_add(lexer, 0xe0 | (cp >> 12)) &&
+           gen_lexer_buf_add(lexer, 0x80 | ((cp >> 6) & 0x3f)) &&
+           gen_lexer_buf_add(lexer, 0x80 | (cp & 0x3f));
+  }
+  return gen_lexer_buf_add(lexer, 0xf0 | (cp >> 18)) &&
+         gen_lexer_buf_add(lexer, 0x80 | ((cp >> 12) & 0x3f)) &&
+         gen_lexer_buf_add(lexer, 0x80 | ((cp >> 6) & 0x3f)) &&
+         gen_lexer_buf_add(lexer, 0x80 | (cp & 0x3f));
+}
+
+#if !GENLEX_CONFIG_ONLY_OFFSET
+static GENLEX_POS_T gen_lexer_token_line(struct gen_lexer *lexer)
+{
+  return lexer->tok_line;
+}
+
+static GENLEX_POS_T gen_lexer_token_col(struct gen_lexer *lexer)
+{
+  return lexer->tok_col;
+}
+#endif
+
+static GENLEX_POS_T gen_lexer_token_off(struct gen_lexer *lexer)
+{
+  return lexer->tok_off;
 }
 
 static int gen_lexer_read_string(struct gen_lexer *lexer)
@@ -505,6 +2328,10 @@ static int gen_lexer_read_string(struct gen_lexer *lexer)
         if (!err) { err = c; }
         return err;
       }
+      if (!genlex_buf_add_escaped(lexer,c) && !err) {
+        err = GENLEX_ERR_BUFFER_OVERFLOW;
+      }
+      continue;
     }
 
     if (!gen_lexer_buf_add(lexer,c)) {
@@ -522,10 +2349,14 @@ static int gen_lexer_read_char(struct gen_lexer *lexer)
   if (c == '\\') {
     c = gen_lexer_next_char_escaped(lexer);
     if (c < 0) { return c; } /* error code */
+    if (!genlex_buf_add_escaped(lexer,c)) {
+      return GENLEX_ERR_BUFFER_OVERFLOW;
+    }
+    c &= ~GENLEX_ESC_CODEPOINT;
+  } else {
+    GENLEXER_BUF_ADD(lexer,c);
   }
 
-  GENLEXER_BUF_ADD(lexer,c);
-
   lexer->tval.i = c;
 
   c = genlex_getc(lexer);
@@ -540,332 +2371,1753 @@ static int gen_lexer_read_char(struct gen_lexer *lexer)
   return GENLEX_INT_TOKEN;
 }
 
-static int gen_lexer_read_num(struct gen_lexer *lexer, int c)
+#if GENLEX_CONFIG_BLOBS
+/* Value of each base64 digit, -1 for other bytes ('=' among them) */
+static const signed char genlex_b64digit[256] = {
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+  52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+  -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+  15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+  -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+  41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+/* Decodes the n digits at s, whole pairs of hex digits or groups of four
+ * base64 ones, to out.  Returns how many digits were decoded before the
+ * first group that isn't valid.
+ */
+static size_t genlex_blob_decode_scalar(int b64, const unsigned char *s, size_t n, unsigned char *out)
 {
-  /* TODO: optional C99 intmax_t support */
-  long value;
-  GENLEX_INT_T lval;
-  const char *s;
-  char *end;
-  int isfloat;
+  size_t i;
 
-  /* TODO: optional hexidecimal and octal support */
+  if (!b64) {
+    for (i = 0; i+2 <= n; i += 2) {
+      int hi = genlex_xdigit[s[i]], lo = genlex_xdigit[s[i+1]];
+      if ((hi | lo) < 0) { break; }
+      *out++ = (unsigned char)((hi << 4) | lo);
+    }
+    return i;
+  }
 
-  isfloat = 0;
-  do {
-    GENLEXER_BUF_ADD(lexer,c);
+  for (i = 0; i+4 <= n; i += 4) {
+    int a = genlex_b64digit[s[i]], b = genlex_b64digit[s[i+1]];
+    int c = genlex_b64digit[s[i+2]], d = genlex_b64digit[s[i+3]];
+    unsigned long v;
+
+    if ((a | b | c | d) < 0) { break; }
+    v = ((unsigned long)a << 18) | (b << 12) | (c << 6) | d;
+    out[0] = (unsigned char)(v >> 16);
+    out[1] = (unsigned char)(v >> 8);
+    out[2] = (unsigned char)v;
+    out += 3;
+  }
+  return i;
+}
 
-    c = genlex_getc(lexer);
-  } while (isnumber(c));
+#if GENLEX_BLOB_SSSE3
+/* The same, 16 digits at a time.  A block with anything but digits in it
+ * is left to the scalar code, which finds where the digits stop.
+ */
+__attribute__((target("ssse3")))
+static size_t genlex_blob_decode_ssse3(int b64, const unsigned char *s, size_t n, unsigned char *out)
+{
+  size_t i;
+
+  if (!b64) {
+    for (i = 0; i+16 <= n; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+      __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+      __m128i l = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+      __m128i is_d = _mm_and_si128(_mm_cmpgt_epi8(d, _mm_set1_epi8(-1)), _mm_cmplt_epi8(d, _mm_set1_epi8(10)));
+      __m128i is_l = _mm_and_si128(_mm_cmpgt_epi8(l, _mm_set1_epi8(-1)), _mm_cmplt_epi8(l, _mm_set1_epi8(6)));
+      __m128i x;
+
+      if (_mm_movemask_epi8(_mm_or_si128(is_d, is_l)) != 0xffff) { break; }
+
+      /* nibble values, then each pair as hi*16 + lo */
+      x = _mm_or_si128(_mm_and_si128(is_d, d),
+          _mm_and_si128(is_l, _mm_add_epi8(l, _mm_set1_epi8(10))));
+      x = _mm_maddubs_epi16(x, _mm_set1_epi16(0x0110));
+      _mm_storel_epi64((__m128i *)out, _mm_packus_epi16(x, x));
+      out += 8;
+    }
+    return i + genlex_blob_decode_scalar(0, s + i, n - i, out);
+  }
 
-#if GENLEX_CONFIG_FLOATS
-  /* check for decimal */
-  if (c == '.') {
-    isfloat = 1;
-    do {
-      GENLEXER_BUF_ADD(lexer,c);
-      c = genlex_getc(lexer);
-    } while (isnumber(c));
+  for (i = 0; i+16 <= n; i += 16) {
+    /* W. Mula's decoder: the nibbles of each byte are checked against
+     * two tables, and a third gives what to add to a digit's byte to
+     * get its value
+     */
+    const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                         0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                         0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                           0, 0, 0, 0, 0, 0, 0, 0);
+    __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+    __m128i hi = _mm_and_si128(_mm_srli_epi32(v, 4), _mm_set1_epi8(0x0f));
+    __m128i lo = _mm_and_si128(v, _mm_set1_epi8(0x0f));
+    __m128i bad = _mm_and_si128(_mm_shuffle_epi8(lut_lo, lo), _mm_shuffle_epi8(lut_hi, hi));
+    __m128i x;
+    unsigned char tmp[16];
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(bad, _mm_setzero_si128())) != 0xffff) { break; }
+
+    x = _mm_add_epi8(v, _mm_shuffle_epi8(lut_roll,
+          _mm_add_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')), hi)));
+
+    /* four 6 bit values to a 24 bit one, then its 3 bytes high first */
+    x = _mm_maddubs_epi16(x, _mm_set1_epi32(0x01400140));
+    x = _mm_madd_epi16(x, _mm_set1_epi32(0x00011000));
+    x = _mm_shuffle_epi8(x, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    _mm_storeu_si128((__m128i *)tmp, x);
+    memcpy(out, tmp, 12);
+    out += 12;
   }
+  return i + genlex_blob_decode_scalar(1, s + i, n - i, out);
+}
+#endif
 
-  /* check for exponent */
-  if ((c == 'e') || (c=='E')) {
-    isfloat = 1;
-    GENLEXER_BUF_ADD(lexer,c);
-    c = genlex_getc(lexer);
-    if ((c == '-') || (c == '+')) {
-      GENLEXER_BUF_ADD(lexer,c);
-      c = genlex_getc(lexer);
-    }
+/* Decodes the whole groups of digits at s[0..n) onto the blob arena.
+ * Returns 0 or an error.
+ */
+static int genlex_blob_body(struct gen_lexer *lexer, int b64, const unsigned char *s, size_t n)
+{
+  size_t len = b64 ? n/4*3 : n/2;
+  size_t done;
+
+  if (n == 0) { return 0; }
+  if (len > lexer->blob_cap - lexer->blob_used) { return GENLEX_ERR_BUFFER_OVERFLOW; }
+
+#if GENLEX_BLOB_SSSE3
+  if (__builtin_cpu_supports("ssse3")) {
+    done = genlex_blob_decode_ssse3(b64, s, n, lexer->blob_buf + lexer->blob_used);
+  } else
+#endif
+  done = genlex_blob_decode_scalar(b64, s, n, lexer->blob_buf + lexer->blob_used);
+
+  if (done < n) { return GENLEX_ERR_INVALID_BLOB; }
+  lexer->blob_used += len;
+  return 0;
+}
+
+/* Decodes the last m digits of a blob, at most one group and with the
+ * padding of base64, onto the blob arena.  Returns 0 or an error.
+ */
+static int genlex_blob_tail(struct gen_lexer *lexer, int b64, const unsigned char *s, size_t m)
+{
+  unsigned char grp[4] = { 'A', 'A', 'A', 'A' };
+  unsigned char out[3];
+  size_t k = m, len;
+
+  if (b64 && (m == 4) && (s[3] == '=')) {
+    k = (s[2] == '=') ? 2 : 3;
+  }
+  if ((m > (b64 ? 4u : 2u)) || (k == 1)) {
+    return GENLEX_ERR_INVALID_BLOB;
+  }
+
+  len = b64 ? ((k > 0) ? k-1 : 0) : k/2;
+  if (len == 0) { return 0; }
+
+  memcpy(grp, s, k);
+  if (genlex_blob_decode_scalar(b64, grp, b64 ? 4 : 2, out) == 0) {
+    return GENLEX_ERR_INVALID_BLOB;
+  }
+  if (len > lexer->blob_cap - lexer->blob_used) { return GENLEX_ERR_BUFFER_OVERFLOW; }
+  memcpy(lexer->blob_buf + lexer->blob_used, out, len);
+  lexer->blob_used += len;
+  return 0;
+}
+
+/* 0 if the symbol just read is GENLEX_BLOB_HEX_PREFIX, 1 if it is
+ * GENLEX_BLOB_BASE64_PREFIX, -1 otherwise
+ */
+static inline int genlex_blob_prefix(struct gen_lexer *lexer)
+{
+  if ((lexer->blen == sizeof(GENLEX_BLOB_HEX_PREFIX)-1) &&
+      (memcmp(lexer->buf, GENLEX_BLOB_HEX_PREFIX, lexer->blen) == 0)) {
+    return 0;
+  }
+  if ((lexer->blen == sizeof(GENLEX_BLOB_BASE64_PREFIX)-1) &&
+      (memcmp(lexer->buf, GENLEX_BLOB_BASE64_PREFIX, lexer->blen) == 0)) {
+    return 1;
+  }
+  return -1;
+}
+
+/* Reads the string of a blob literal, whose opening quote was the last
+ * byte read, into the blob arena.  Every group of digits but the last
+ * is decoded as soon as the next digit shows it isn't the last.
+ */
+static int genlex_read_blob(struct gen_lexer *lexer, int b64)
+{
+  size_t group = b64 ? 4 : 2;
+  size_t start = lexer->blob_used;
+  unsigned char grp[4];
+  size_t m = 0;
+  int err = 0;
+  int c;
+
+#if GENLEX_CONFIG_MEMORY
+  {
+    struct gen_lexer_membuf *mb = lexer->ctx;
+    const unsigned char *p = mb->data + mb->pos;
+    const unsigned char *q = (const unsigned char *)memchr(p, '"', mb->len - mb->pos);
+
+    /* a string that isn't closed on its line is left to the loop below,
+     * which finds the error where the lexer would
+     */
+    if ((q != NULL) && (memchr(p, '\n', q - p) == NULL)) {
+      size_t n = q - p;
+      size_t body = (n > 0) ? (n-1) / group * group : 0;
+
+      err = genlex_blob_body(lexer, b64, p, body);
+      if (!err) { err = genlex_blob_tail(lexer, b64, p + body, n - body); }
+      genlex_pass_plain(lexer, q);
+      genlex_getc(lexer);
+      goto done;
+    }
+  }
+#endif
+
+  for (;;) {
+    c = genlex_getc(lexer);
+    if (c == EOF) {
+      if (!err) { err = GENLEX_ERR_UNEXPECTED_EOF; }
+      break;
+    }
+    if (c == '\n') {
+      if (!err) { err = GENLEX_ERR_UNEXPECTED_EOL; }
+      break;
+    }
+    if (c == '"') {
+      if (!err) { err = genlex_blob_tail(lexer, b64, grp, m); }
+      break;
+    }
+
+    if (m == group) {
+      if (!err) { err = genlex_blob_body(lexer, b64, grp, m); }
+      m = 0;
+    }
+    grp[m++] = (unsigned char)c;
+  }
+
+#if GENLEX_CONFIG_MEMORY
+done:
+#endif
+  if (err) {
+    lexer->blob_used = start;
+    return err;
+  }
+
+  lexer->tval.b.off = start;
+  lexer->tval.b.len = lexer->blob_used - start;
+  return GENLEX_BLOB_TOKEN;
+}
+#endif
+
+#if GENLEX_CONFIG_FLOATS
+/* strtof(), strtod() or strtold(), whichever GENLEX_FLOAT_T is.  The
+ * preprocessor can't compare types, so this goes by their sizes.
+ */
+static inline GENLEX_FLOAT_T genlex_strtofloat(const char *s, char **end)
+{
+  if (sizeof(GENLEX_FLOAT_T) == sizeof(float))  { return strtof(s, end); }
+  if (sizeof(GENLEX_FLOAT_T) == sizeof(double)) { return strtod(s, end); }
+  return strtold(s, end);
+}
+#endif
+
+#if GENLEX_CONFIG_DECIMAL
+/* Reads the n bytes at s, [-]digits[.digits][(e|E)[+|-]digits] as
+ * gen_lexer_read_num() scans them, into d.  Returns 0, or
+ * GENLEX_ERR_INVALID_INTEGER if they aren't such a number.
+ */
+static int genlex_read_decimal(const unsigned char *s, size_t n, struct gen_lexer_decimal *d)
+{
+  const unsigned char *end = s + n;
+  unsigned long long coef = 0;
+  long exp = 0, x = 0;
+  int digits = 0, ndig = 0, big = 0;
+
+  memset(d, 0, sizeof *d);
+  if ((s < end) && (*s == '-')) { d->neg = 1; s++; }
+
+  for (; (s < end) && (*s >= '0') && (*s <= '9'); s++, ndig++) {
+    if ((coef == 0) && (*s == '0')) { continue; }
+    if (++digits > 19) { big = 1; }
+    coef = 10*coef + (*s - '0');
+  }
+
+  if ((s < end) && (*s == '.')) {
+    for (s++; (s < end) && (*s >= '0') && (*s <= '9'); s++, ndig++) {
+      exp--;
+      if ((coef == 0) && (*s == '0')) { continue; }
+      if (++digits > 19) { big = 1; }
+      coef = 10*coef + (*s - '0');
+    }
+  }
+  if (ndig == 0) { return GENLEX_ERR_INVALID_INTEGER; }
+
+  if ((s < end) && ((*s == 'e') || (*s == 'E'))) {
+    int eneg = 0, edig = 0;
+
+    s++;
+    if ((s < end) && ((*s == '-') || (*s == '+'))) { eneg = (*s++ == '-'); }
+    for (; (s < end) && (*s >= '0') && (*s <= '9'); s++) {
+      if ((x == 0) && (*s == '0')) { continue; }
+      if (++edig > 9) { big = 1; continue; }
+      x = 10*x + (*s - '0');
+    }
+    if ((s[-1] < '0') || (s[-1] > '9')) { return GENLEX_ERR_INVALID_INTEGER; }
+    exp += eneg ? -x : x;
+  }
+  if (s != end) { return GENLEX_ERR_INVALID_INTEGER; }
+
+  /* the exponent is at most 9 digits and the buffer is short, so this
+   * fits an int
+   */
+  if (!big) {
+    d->coef = coef;
+    d->exp = (int)exp;
+  }
+  d->big = (unsigned char)big;
+
+  return 0;
+}
+#endif
+
+static int gen_lexer_read_num(struct gen_lexer *lexer, int c)
+{
+  /* TODO: optional C99 intmax_t support */
+  long value;
+  unsigned long mag, lim;
+  GENLEX_INT_T lval;
+  const char *s;
+  int isfloat, neg;
+
+  /* TODO: optional hexidecimal and octal support */
+
+  isfloat = 0;
+  do {
+    GENLEXER_BUF_ADD(lexer,c);
+
+    c = genlex_getc(lexer);
+  } while (isnumber(c));
+
+#if GENLEX_CONFIG_FLOATS
+  /* check for decimal */
+  if ((c == '.') && GENLEX_FLOATS_ENABLED) {
+    isfloat = 1;
+    do {
+      GENLEXER_BUF_ADD(lexer,c);
+      c = genlex_getc(lexer);
+    } while (isnumber(c));
+  }
+
+  /* check for exponent */
+  if (((c == 'e') || (c=='E')) && GENLEX_FLOATS_ENABLED) {
+    isfloat = 1;
+    GENLEXER_BUF_ADD(lexer,c);
+    c = genlex_getc(lexer);
+    if ((c == '-') || (c == '+')) {
+      GENLEXER_BUF_ADD(lexer,c);
+      c = genlex_getc(lexer);
+    }
+
+    if (!isnumber(c)) {
+      return GENLEX_ERR_INVALID_CHAR;
+    }
+
+    do {
+      GENLEXER_BUF_ADD(lexer,c);
+      c = genlex_getc(lexer);
+    } while (isnumber(c));
+  }
+#endif
+
+  if (c != EOF) {
+    if (GENLEX_IS_SYMBOL(c,0) || GENLEX_IS_MULTIBYTE(c)) {
+      return GENLEX_ERR_INVALID_CHAR;
+    }
+
+    genlex_ungetc(c,lexer);
+  }
+
+  s = (const char*)gen_lexer_token_string(lexer,NULL);
+
+  if (isfloat) {
+#if GENLEX_CONFIG_DECIMAL
+    /* the scan lets through a sign or point with no digits, as in "-." */
+    int err = genlex_read_decimal((const unsigned char *)s, lexer->blen, &lexer->tval.d);
+    if (err != 0) { return err; }
+    return GENLEX_FLOAT_TOKEN;
+#elif GENLEX_CONFIG_FLOATS
+    GENLEX_FLOAT_T fvalue;
+    char *end;
+    int saved_errno, err;
+
+    /* strtod() reports range errors through errno, which belongs to the
+     * caller, so save and restore it around the conversion
+     */
+    saved_errno = errno;
+    errno = 0;
+
+    fvalue = genlex_strtofloat(s, &end);
+  err = errno;
+  errno = saved_errno;
+
+  /* The lexer only invokes this routine when there's numeric input, so
+   * *s should never be '\0', and we can just check if *end is not '\0'
+   */
+  if (*end != '\0') {
+    return GENLEX_ERR_INVALID_INTEGER;
+  }
+
+  if (err == ERANGE) {
+    return GENLEX_ERR_FLOAT_OVERFLOW;
+  }
+
+  if (err != 0) {
+    return GENLEX_ERR_UNKNOWN_ERROR;
+  }
+
+  lexer->tval.f = fvalue;
+
+  return GENLEX_FLOAT_TOKEN;
+
+#else
+  /* this should never be reached! */
+  return GENLEX_ERR_INVALID_STATE;
+#endif /* GENLEX_CONFIG_FLOATS */
+  }
+
+  /* TODO: optional suffix type support */
+
+  /* FIXME: use a fixed base 10 for now since we don't officially
+   * support hex or octal
+   */
+  /* Convert by hand rather than with strtol(), which reports overflow
+   * through errno: errno is state shared with the caller, and the
+   * buffer only ever holds an optional '-' and decimal digits anyway.
+   */
+  neg = (*s == '-');
+  if (neg) { s++; }
+
+  if (*s == '\0') {
+    return GENLEX_ERR_INVALID_INTEGER;
+  }
+
+  lim = neg ? (unsigned long)LONG_MAX + 1 : (unsigned long)LONG_MAX;
+  for (mag = 0; *s != '\0'; s++) {
+    unsigned int d = (unsigned char)*s - '0';
+    if (d > 9) {
+      return GENLEX_ERR_INVALID_INTEGER;
+    }
+
+    if (mag > (lim - d) / 10) {
+      return GENLEX_ERR_INTEGER_OVERFLOW;
+    }
+
+    mag = 10*mag + d;
+  }
+
+  if (!neg) {
+    value = (long)mag;
+  } else if (mag == 0) {
+    value = 0;
+  } else {
+    value = -(long)(mag - 1) - 1;
+  }
+
+  lval = value;
+
+  /* check that value fits in bounds of GENLEX_INT_T */
+  if ((long)lval != value) {
+    return GENLEX_ERR_INTEGER_OVERFLOW;
+  }
+
+  lexer->tval.i = lval;
+
+  return GENLEX_INT_TOKEN;
+}
+
+#if GENLEX_CONFIG_RUNTIME
+static int gen_lexer_lookup_keyword(struct gen_lexer *lexer)
+{
+  const struct gen_lexer_tables *tab = lexer->tab;
+  size_t i;
+
+  GENLEX_STAT(lexer, st_->keyword_lookups++);
+  if (tab->kwtab == NULL) { return -1; }
+
+  if (tab->kwnocase) {
+    for (i = genlex_rt_hash_folded(lexer->buf, lexer->blen) & tab->kwmask;
+        tab->kwtab[i].keyword != NULL; i = (i+1) & tab->kwmask) {
+      GENLEX_STAT(lexer, st_->keyword_compares++);
+      if ((tab->kwtab[i].len == lexer->blen) &&
+          genlex_fold_eq((const unsigned char *)tab->kwtab[i].keyword, lexer->buf, lexer->blen)) {
+        return tab->kwtab[i].token;
+      }
+    }
+    return -1;
+  }
+
+  for (i = genlex_rt_hash(lexer->buf, lexer->blen) & tab->kwmask;
+      tab->kwtab[i].keyword != NULL; i = (i+1) & tab->kwmask) {
+    GENLEX_STAT(lexer, st_->keyword_compares++);
+    if ((tab->kwtab[i].len == lexer->blen) &&
+        (memcmp(tab->kwtab[i].keyword, lexer->buf, lexer->blen) == 0)) {
+      return tab->kwtab[i].token;
+    }
+  }
+
+  return -1;
+}
+#elif defined(GENLEX_DFA_HEADER)
+static int gen_lexer_lookup_keyword(struct gen_lexer *lexer)
+{
+  GENLEX_STAT(lexer, st_->keyword_lookups++);
+  GENLEX_STAT(lexer, st_->keyword_compares++);  /* one pass over the symbol */
+  return genlex_dfa_keyword(lexer->buf, lexer->blen);
+}
+#else
+static int gen_lexer_lookup_keyword(struct gen_lexer *lexer)
+{
+  unsigned int i;
+  GENLEX_STAT(lexer, st_->keyword_lookups++);
+  for (i = 0; i < GENLEX_NUM_KEYWORDS; i++) {
+    GENLEX_STAT(lexer, st_->keyword_compares++);
+    lexer->buf[lexer->blen] = '\0';
+#if GENLEX_KEYWORDS_CASE_INSENSITIVE
+    {
+      const unsigned char *kw = (const unsigned char *)gen_lexer_keywords[i].keyword;
+      size_t k;
+
+      /* a byte at a time, as the keyword's length isn't known */
+      for (k = 0; (k < lexer->blen) && (GENLEX_FOLD(kw[k]) == GENLEX_FOLD(lexer->buf[k])); k++) {
+        continue;
+      }
+      if ((k == lexer->blen) && (kw[k] == '\0')) {
+        return gen_lexer_keywords[i].token;
+      }
+    }
+#else
+    if (strcmp((const char*)lexer->buf, gen_lexer_keywords[i].keyword) == 0) {
+      return gen_lexer_keywords[i].token;
+    }
+#endif
+  }
+
+  return -1;
+}
+#endif /* GENLEX_CONFIG_RUNTIME */
+
+#if GENLEX_CONFIG_UTF8
+/* Reads the rest of the UTF-8 sequence that starts with the byte c, and
+ * adds it to the symbol being read if the code point can be at its
+ * current position.  *tokp is the error that read_symbol keeps.
+ * Returns 0, GENLEX_ERR_INVALID_UTF8 or GENLEX_ERR_INVALID_CHAR.
+ */
+static int genlex_read_xid(struct gen_lexer *lexer, int c, int *tokp)
+{
+  unsigned char seq[4];
+  unsigned long cp;
+  int i, n;
+
+  if (c < 0xc2)      { return GENLEX_ERR_INVALID_UTF8; }  /* continuation or overlong */
+  else if (c < 0xe0) { n = 2; cp = c & 0x1f; }
+  else if (c < 0xf0) { n = 3; cp = c & 0x0f; }
+  else if (c < 0xf5) { n = 4; cp = c & 0x07; }
+  else               { return GENLEX_ERR_INVALID_UTF8; }
+
+  seq[0] = c;
+  for (i = 1; i < n; i++) {
+    c = genlex_getc(lexer);
+    if ((c == EOF) || ((c & 0xc0) != 0x80)) {
+      if (c != EOF) { genlex_ungetc(c,lexer); }
+      return GENLEX_ERR_INVALID_UTF8;
+    }
+    seq[i] = c;
+    cp = (cp << 6) | (c & 0x3f);
+  }
+
+  /* overlong forms, surrogates and code points past U+10FFFF */
+  if (((n == 3) && (cp < 0x800)) || ((n == 4) && (cp < 0x10000)) ||
+      ((cp >= 0xd800) && (cp <= 0xdfff)) || (cp > 0x10ffff)) {
+    return GENLEX_ERR_INVALID_UTF8;
+  }
+
+  if (!(genlex_xid(cp) & ((lexer->blen == 0) ? GENLEX_XID_START : GENLEX_XID_CONTINUE))) {
+    return GENLEX_ERR_INVALID_CHAR;
+  }
+
+  for (i = 0; (i < n) && (*tokp == 0); i++) {
+    if (!gen_lexer_buf_add(lexer, seq[i])) {
+      *tokp = GENLEX_ERR_BUFFER_OVERFLOW;
+    }
+  }
+  return 0;
+}
+#endif
+
+static int gen_lexer_read_symbol(struct gen_lexer *lexer, int c)
+{
+  int tok;
+
+  tok = 0;
+  do {
+#if GENLEX_CONFIG_UTF8
+    if (GENLEX_IS_MULTIBYTE(c)) {
+      int err = genlex_read_xid(lexer, c, &tok);
+      if (err != 0) { return err; }
+    } else
+#endif
+    if (tok == 0) {
+      if (!gen_lexer_buf_add(lexer, c)) {
+        tok = GENLEX_ERR_BUFFER_OVERFLOW;
+      }
+    }
+
+    c = genlex_getc(lexer);
+  } while (GENLEX_IS_SYMBOL(c, lexer->blen) || GENLEX_IS_MULTIBYTE(c));
+
+#if GENLEX_CONFIG_BLOBS
+  if ((c == '"') && (tok == 0)) {
+    int b64 = genlex_blob_prefix(lexer);
+    if (b64 >= 0) { return genlex_read_blob(lexer, b64); }
+  }
+#endif
+
+  if (c != EOF) {
+    genlex_ungetc(c,lexer);
+  }
+
+  if (tok != 0) {
+    return tok; /* error code */
+  }
+
+  tok = gen_lexer_lookup_keyword(lexer);
+  if (tok < 0) { tok = GENLEX_ID_TOKEN; }
+  return tok;
+}
+
+#if GENLEX_HAVE_COMMENTS
+static int gen_lexer_read_comment(struct gen_lexer *lexer, const unsigned char end[2])
+{
+
+  for(;;) {
+    int c, next;
+    c = genlex_getc(lexer);
+
+    if (c == EOF) {
+      return GENLEX_ERR_UNEXPECTED_EOF;
+    }
+
+    if (c != end[0]) {
+      GENLEXER_BUF_ADD(lexer,c);
+      continue;
+    }
+
+    if (!end[1]) {
+      return GENLEX_COMMENT_TOKEN;
+    }
+
+    next = genlex_getc(lexer);
+    if (next == end[1]) {
+      return GENLEX_COMMENT_TOKEN;
+    }
+
+    GENLEXER_BUF_ADD(lexer,c);
+    GENLEXER_BUF_ADD(lexer,next);
+  }
+}
+#elif !defined(GENLEX_COMMENT_TOKEN)
+#  define GENLEX_COMMENT_TOKEN  0
+#endif
+
+#define GENLEX_CONSUME_COMMENT(lx,end) do {      \
+    int tok = gen_lexer_read_comment(lexer,end); \
+    if (GENLEX_COMMENT_TOKEN) { return tok; }    \
+    GENLEX_STAT(lexer, st_->comments_skipped++;  \
+        st_->comment_bytes += lexer->off - lexer->tok_off); \
+    goto restart;                                \
+  } while (0)
+
+#if GENLEX_CONFIG_RUNTIME
+#  define GENLEX_IS_LITERAL(ch)  (lexer->tab->cls[(ch)] & GENLEX_CLS_LITERAL)
+#elif defined(GENLEX_DFA_HEADER)
+#  define GENLEX_IS_LITERAL(ch)  (genlex_dfa_class[(ch)] & GENLEX_CLS_LITERAL)
+#else
+#  define GENLEX_IS_LITERAL(ch)  \
+  (((ch) != 0) && memchr(gen_lexer_literals, (ch), sizeof(gen_lexer_literals)))
+#endif
+
+#if defined(GENLEX_DFA_HEADER)
+#  define GENLEX_IS_SYMBOL_START(ch)  \
+  ((genlex_dfa_class[(ch)] & GENLEX_CLS_SYM0) || GENLEX_IS_MULTIBYTE(ch))
+#else
+#  define GENLEX_IS_SYMBOL_START(ch)  (GENLEX_IS_SYMBOL((ch), 0) || GENLEX_IS_MULTIBYTE(ch))
+#endif
+
+#if GENLEX_HAVE_COMMENTS
+/* Reads the rest of a comment opener that starts with ch.  Returns the
+ * index of the comment in gen_lexer_comments, or -1 with the input left
+ * as it was.
+ */
+static int genlex_match_comment(struct gen_lexer *lexer, int ch)
+{
+#if defined(GENLEX_DFA_HEADER)
+  return genlex_dfa_comment(lexer, ch);
+#else
+  unsigned int i;
+  for (i=0; i < GENLEX_NUM_COMMENT_PAIRS; i++) {
+    int next;
+    if (ch != gen_lexer_comments[i].beg[0]) { continue; }
+
+    if (!gen_lexer_comments[i].beg[1]) {
+      return i;
+    }
+
+    next = genlex_getc(lexer);
+    if (next != gen_lexer_comments[i].beg[1]) {
+      genlex_ungetc(next,lexer);
+      continue;
+    }
+
+    return i;
+  }
+
+  return -1;
+#endif
+}
+#endif
+
+#if GENLEX_HAVE_LITERAL_PAIRS
+/* Reads the second character of a literal pair that starts with ch.
+ * Returns the token of the pair, an error, or 0 with the input left as
+ * it was.
+ */
+static int genlex_read_pair(struct gen_lexer *lexer, int ch)
+{
+  int tok = -1;
+  int c2;
+
+  c2 = genlex_getc(lexer);
+  if (c2 == EOF) { return 0; }
+
+#if defined(GENLEX_DFA_HEADER)
+  tok = genlex_dfa_pair(ch, c2);
+#else
+  {
+    unsigned int i;
+    for (i=0; i < GENLEX_NUM_LITERAL_PAIRS; i++) {
+      if ((gen_lexer_literal_pairs[i].pair[0] == ch) &&
+          (gen_lexer_literal_pairs[i].pair[1] == c2)) {
+        tok = gen_lexer_literal_pairs[i].token;
+        break;
+      }
+    }
+  }
+#endif
+
+  if (tok < 0) {
+    genlex_ungetc(c2,lexer);
+    return 0;
+  }
+
+  GENLEXER_BUF_ADD(lexer,ch);
+  GENLEXER_BUF_ADD(lexer,c2);
+  return tok;
+}
+#endif
+
+#if !GENLEX_CONFIG_KIND_TABLE
+static int genlex_next_token(struct gen_lexer *lexer)
+{
+  int ch;
+
+restart:
+  lexer->blen = 0;
+  ch = genlex_skip_ws(lexer);
+
+  if (ch == EOF) { return 0; }
+
+  lexer->tok_off = lexer->off-1;
+#if !GENLEX_CONFIG_ONLY_OFFSET
+  lexer->tok_line = lexer->line;
+  lexer->tok_col = lexer->col-1;
+#endif
+
+#if GENLEX_HAVE_COMMENTS
+  if (GENLEX_MAY_BEGIN_COMMENT(ch)) {
+    int i = genlex_match_comment(lexer, ch);
+    if (i >= 0) {
+      GENLEX_CONSUME_COMMENT(lexer,gen_lexer_comments[i].end);
+    }
+  }
+#else
+  if (0) { goto restart; } /* eliminate warnings */
+#endif
+
+  if (ch == '"') {
+    return gen_lexer_read_string(lexer);
+  }
+
+  /* TODO: optional single-quote strings */
+  if (ch == '\'') {
+    return gen_lexer_read_char(lexer);
+  }
+
+  /* check for literals and literal pairs before numbers so '-' can be
+   * returned as a literal symbol, or otherwised used to parse a number
+   */
+#if GENLEX_HAVE_LITERAL_PAIRS
+  if (GENLEX_MAY_BEGIN_PAIR(ch)) {
+    int tok = genlex_read_pair(lexer, ch);
+    if (tok != 0) { return tok; }
+  }
+#endif
+
+  if (GENLEX_IS_LITERAL(ch)) { return ch; }
+
+  if (isnumber(ch) || (ch == '-')) {
+    return gen_lexer_read_num(lexer, ch);
+  }
+
+  if (GENLEX_IS_SYMBOL_START(ch)) {
+    /* identifier or keyword */
+    return gen_lexer_read_symbol(lexer, ch);
+  }
+
+  return GENLEX_ERR_INVALID_CHAR;
+}
+#else /* GENLEX_CONFIG_KIND_TABLE */
+
+/* The same scan as above, but the kind of each whitespace character and
+ * of the first character of the token comes from one table lookup, and
+ * a switch on it replaces the chain of tests.  The cases are in the
+ * order of the tests above, and a case that turns out not to match
+ * falls through to the next test.
+ */
+static int genlex_next_token(struct gen_lexer *lexer)
+{
+  int ch;
+
+restart:
+  lexer->blen = 0;
+
+  do {
+    ch = genlex_getc(lexer);
+    if (ch == EOF) { return 0; }
+  } while (GENLEX_KIND(ch) == GENLEX_KIND_WS);
+
+  lexer->tok_off = lexer->off-1;
+#if !GENLEX_CONFIG_ONLY_OFFSET
+  lexer->tok_line = lexer->line;
+  lexer->tok_col = lexer->col-1;
+#endif
+
+  switch (GENLEX_KIND(ch)) {
+    case GENLEX_KIND_COMMENT:
+#if GENLEX_HAVE_COMMENTS
+      {
+        int i = genlex_match_comment(lexer, ch);
+        if (i >= 0) {
+          GENLEX_CONSUME_COMMENT(lexer,gen_lexer_comments[i].end);
+        }
+      }
+#else
+      if (0) { goto restart; } /* eliminate warnings */
+#endif
+      if (ch == '"')  { return gen_lexer_read_string(lexer); }
+      if (ch == '\'') { return gen_lexer_read_char(lexer); }
+      /* fall through */
+
+    case GENLEX_KIND_PAIR:
+#if GENLEX_HAVE_LITERAL_PAIRS
+      {
+        int tok = genlex_read_pair(lexer, ch);
+        if (tok != 0) { return tok; }
+      }
+#endif
+      if (GENLEX_IS_LITERAL(ch))        { return ch; }
+      if (isnumber(ch) || (ch == '-'))  { return gen_lexer_read_num(lexer, ch); }
+      if (GENLEX_IS_SYMBOL_START(ch))   { return gen_lexer_read_symbol(lexer, ch); }
+      return GENLEX_ERR_INVALID_CHAR;
+
+    case GENLEX_KIND_STRING:  return gen_lexer_read_string(lexer);
+    case GENLEX_KIND_CHAR:    return gen_lexer_read_char(lexer);
+    case GENLEX_KIND_LITERAL: return ch;
+    case GENLEX_KIND_NUMBER:  return gen_lexer_read_num(lexer, ch);
+    case GENLEX_KIND_SYMBOL:  return gen_lexer_read_symbol(lexer, ch);
+    default:                  return GENLEX_ERR_INVALID_CHAR;
+  }
+}
+#endif /* GENLEX_CONFIG_KIND_TABLE */
+
+#if GENLEX_CONFIG_STATS || GENLEX_CONFIG_TRACE
+/* GENLEX_STAT_* kind of the token just scanned */
+static int genlex_token_kind(struct gen_lexer *lexer, int tok)
+{
+  if (tok < 0) { return GENLEX_STAT_ERROR; }
+  if (tok == GENLEX_ID_TOKEN) { return GENLEX_STAT_ID; }
+  if (tok == GENLEX_STRING_TOKEN) { return GENLEX_STAT_STRING; }
+#if GENLEX_CONFIG_BLOBS
+  if (tok == GENLEX_BLOB_TOKEN) { return GENLEX_STAT_STRING; }
+#endif
+  if (tok == GENLEX_INT_TOKEN) { return GENLEX_STAT_INT; }
+#if GENLEX_CONFIG_FLOATS
+  if (GENLEX_FLOATS_ENABLED && (tok == GENLEX_FLOAT_TOKEN)) { return GENLEX_STAT_FLOAT; }
+#endif
+  if (GENLEX_COMMENT_TOKEN && (tok == GENLEX_COMMENT_TOKEN)) { return GENLEX_STAT_COMMENT; }
+  if (lexer->blen == 0) { return GENLEX_STAT_LITERAL; }
+  if (GENLEX_IS_SYMBOL_START(lexer->buf[0])) { return GENLEX_STAT_KEYWORD; }
+  return GENLEX_STAT_PAIR;
+}
+#endif
+
+#if GENLEX_CONFIG_STATS
+static void genlex_count_token(struct gen_lexer *lexer, int tok, GENLEX_POS_T start,
+    unsigned long skipped)
+{
+  struct gen_lexer_stats *st = &lexer->stats;
+  unsigned long len = lexer->off - lexer->tok_off;
+  int kind;
+
+  if (tok == 0) {
+    /* off also counts the EOF that ended the input */
+    st->ws_bytes += lexer->off - start - skipped - 1;
+    return;
+  }
+
+#if GENLEX_CONFIG_RUNTIME
+  /* a raw text mode reads its delimiter along with the text before it */
+  if (lexer->tok_off < start) { start = lexer->tok_off; }
+#endif
+
+  st->ws_bytes += lexer->tok_off - start - skipped;
+
+  kind = genlex_token_kind(lexer, tok);
+  switch (kind) {
+    case GENLEX_STAT_ERROR:
+      if (-tok < GENLEX_STAT_NUM_ERRORS) { st->errors[-tok]++; }
+      break;
+    case GENLEX_STAT_ID:
+    case GENLEX_STAT_KEYWORD:
+      st->symbol_bytes += len;
+      break;
+    case GENLEX_STAT_STRING:
+      st->string_bytes += len;
+      break;
+    case GENLEX_STAT_INT:
+    case GENLEX_STAT_FLOAT:
+      st->number_bytes += len;
+      break;
+    case GENLEX_STAT_COMMENT:
+      st->comment_bytes += len;
+      break;
+  }
+
+  st->tokens[kind]++;
+}
+
+static inline const struct gen_lexer_stats *gen_lexer_stats(const struct gen_lexer *lexer)
+{
+  return &lexer->stats;
+}
+#endif
+
+#if GENLEX_CONFIG_TRACE
+static const char *const genlex_trace_kind_names[GENLEX_STAT_NUM_KINDS] = {
+  "literal", "pair", "keyword", "id", "string", "int", "float", "comment", "error",
+};
+
+static void gen_lexer_trace_init(struct gen_lexer_trace *tr)
+{
+  memset(tr, 0, sizeof(*tr));
+}
+
+static inline void gen_lexer_trace_attach(struct gen_lexer *lexer, struct gen_lexer_trace *tr)
+{
+  lexer->trace = tr;
+}
+
+static inline void genlex_trace_begin(struct gen_lexer *lexer)
+{
+  if (lexer->trace != NULL) {
+    lexer->trace_start = GENLEX_TRACE_CYCLES();
+  }
+}
+
+static void genlex_trace_end(struct gen_lexer *lexer, int tok)
+{
+  struct gen_lexer_trace *tr = lexer->trace;
+  struct genlex_trace_slot *slot;
+  unsigned long long cycles, i;
+  int kind, b;
+
+  if ((tr == NULL) || (tok == 0)) { return; }
+
+  cycles = GENLEX_TRACE_CYCLES() - lexer->trace_start;
+  kind = genlex_token_kind(lexer, tok);
+  b = (cycles == 0) ? 0 : 64 - __builtin_clzll(cycles);
+  if (b >= GENLEX_TRACE_BUCKETS) { b = GENLEX_TRACE_BUCKETS-1; }
+
+  __atomic_fetch_add(&tr->hist[kind][b], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&tr->cycles[kind][b], cycles, __ATOMIC_RELAXED);
+
+  /* Each writer claims a slot and brackets its update with an odd and
+   * an even sequence number, so readers can tell a torn copy
+   */
+  i = __atomic_fetch_add(&tr->head, 1, __ATOMIC_RELAXED);
+  slot = &tr->ring[i & (GENLEX_TRACE_RING-1)];
+  __atomic_store_n(&slot->seq, 2*i+1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&slot->ev.cycles, cycles, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->ev.off, lexer->tok_off, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->ev.len, lexer->off - lexer->tok_off, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->ev.tok, tok, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->ev.kind, kind, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->seq, 2*i+2, __ATOMIC_RELEASE);
+}
+
+static size_t gen_lexer_trace_events(const struct gen_lexer_trace *tr,
+    struct gen_lexer_trace_event *out, size_t max)
+{
+  unsigned long long head = __atomic_load_n(&tr->head, __ATOMIC_ACQUIRE);
+  unsigned long long i;
+  size_t n = 0;
+
+  for (i = head; (i > 0) && (n < max) && (head - i < GENLEX_TRACE_RING); i--) {
+    const struct genlex_trace_slot *slot = &tr->ring[(i-1) & (GENLEX_TRACE_RING-1)];
+    unsigned long long seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    struct gen_lexer_trace_event ev;
+
+    if (seq != 2*i) { continue; }  /* not written yet, or overwritten */
+
+    ev.cycles = __atomic_load_n(&slot->ev.cycles, __ATOMIC_RELAXED);
+    ev.off = __atomic_load_n(&slot->ev.off, __ATOMIC_RELAXED);
+    ev.len = __atomic_load_n(&slot->ev.len, __ATOMIC_RELAXED);
+    ev.tok = __atomic_load_n(&slot->ev.tok, __ATOMIC_RELAXED);
+    ev.kind = __atomic_load_n(&slot->ev.kind, __ATOMIC_RELAXED);
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq) { continue; }
+
+    out[n++] = ev;
+  }
+
+  return n;
+}
+
+static int gen_lexer_trace_dump(const struct gen_lexer_trace *tr, FILE *f)
+{
+  int kind, b;
+
+  for (kind = 0; kind < GENLEX_STAT_NUM_KINDS; kind++) {
+    for (b = 0; b < GENLEX_TRACE_BUCKETS; b++) {
+      unsigned long long n = __atomic_load_n(&tr->hist[kind][b], __ATOMIC_RELAXED);
+      unsigned long long cycles = __atomic_load_n(&tr->cycles[kind][b], __ATOMIC_RELAXED);
+      unsigned long long lo = (b == 0) ? 0 : 1ull << (b-1);
+      unsigned long long hi = (b == 0) ? 0 : lo + (lo-1);
+
+      if (n == 0) { continue; }
+
+      /* a bucket of zero-cycle tokens still gets a frame */
+      fprintf(f, "gen_lexer_next_token;%s;%llu-%llu %llu\n",
+          genlex_trace_kind_names[kind], lo, hi, (cycles > 0) ? cycles : n);
+    }
+  }
+
+  return ferror(f) ? GENLEX_ERR_IO : 0;
+}
+#endif
+
+#if GENLEX_CONFIG_RUNTIME
+/* How much of raw_until is matched after c, which didn't continue a
+ * match of its first k bytes: the longest of its prefixes that ends the
+ * k bytes and c.  Delimiters are short, so each length is just tried.
+ */
+static size_t genlex_raw_rematch(const char *until, size_t k, int c)
+{
+  size_t j;
+
+  for (j = k; j > 0; j--) {
+    if (((unsigned char)until[j-1] == c) && (memcmp(until, until + k-j+1, j-1) == 0)) {
+      return j;
+    }
+  }
+  return 0;
+}
+
+/* Moves the start of a match past the first n bytes of raw_until */
+static void genlex_raw_pass(struct genlex_raw_state *m, const char *until, size_t n)
+{
+  size_t i;
+
+  m->off += n;
+#if !GENLEX_CONFIG_ONLY_OFFSET
+  for (i = 0; i < n; i++) {
+    if (until[i] == '\n') {
+      m->line++;
+      m->col = 0;
+    } else {
+      m->col++;
+    }
+  }
+#else
+  (void)until;
+  (void)i;
+#endif
+}
+
+/* Scans a token of a raw text mode: the text up to raw_until, which is
+ * owed to the next call as a token of its own.  lexer->raw follows the
+ * start of the bytes that match raw_until so far.
+ */
+static int genlex_read_raw(struct gen_lexer *lexer)
+{
+  const struct gen_lexer_tables *tab = lexer->tab;
+  const char *until = tab->raw_until;
+  size_t k, i;
+  int c;
+
+  lexer->blen = 0;
+
+  if (lexer->raw.owed) {
+    /* the delimiter was read along with the text before it */
+    lexer->raw.owed = 0;
+    lexer->tok_off = lexer->raw.off;
+#if !GENLEX_CONFIG_ONLY_OFFSET
+    lexer->tok_line = lexer->raw.line;
+    lexer->tok_col = lexer->raw.col;
+#endif
+    return lexer->raw.end_token;
+  }
+
+  /* a token that filled the buffer may have stopped partway into a match */
+  k = lexer->raw.k;
+  lexer->raw.k = 0;
+  if (k == 0) {
+    lexer->raw.off = lexer->off;
+    lexer->raw.line = lexer->line;
+    lexer->raw.col = lexer->col;
+  }
+  lexer->tok_off = lexer->raw.off;
+#if !GENLEX_CONFIG_ONLY_OFFSET
+  lexer->tok_line = lexer->raw.line;
+  lexer->tok_col = lexer->raw.col;
+#endif
+
+  for (;;) {
+    if (lexer->blen + tab->raw_len >= GENLEX_STRING_MAX-1) {
+      /* the text goes on in the next token */
+      lexer->raw.k = k;
+      return tab->raw_token;
+    }
+
+#if GENLEX_CONFIG_MEMORY
+    if (k == 0) {
+      struct gen_lexer_membuf *mb = lexer->ctx;
+      const unsigned char *p = mb->data + mb->pos;
+      const unsigned char *q;
+      size_t n = mb->len - mb->pos;
+      size_t room = GENLEX_STRING_MAX-1 - tab->raw_len - lexer->blen;
+
+      if (n > room) { n = room; }
+      q = (const unsigned char *)memchr(p, until[0], n);
+      if (q == NULL) { q = p + n; }
+
+      if (q > p) {
+#  if GENLEX_CONFIG_POOL
+        if ((lexer->buf == NULL) && !genlex_buf_borrow(lexer)) { return GENLEX_ERR_BUFFER_OVERFLOW; }
+#  endif
+        memcpy(lexer->buf + lexer->blen, p, q - p);
+        lexer->blen += q - p;
+        GENLEX_STAT(lexer, if (lexer->blen > st_->buf_high_water) { st_->buf_high_water = lexer->blen; });
+        genlex_pass_plain(lexer, q);
+        continue;
+      }
+    }
+#endif
+
+    c = genlex_getc(lexer);
+    if (c == EOF) {
+      /* a partial match is text after all */
+      for (i = 0; i < k; i++) { GENLEXER_BUF_ADD(lexer, until[i]); }
+      return (lexer->blen > 0) ? tab->raw_token : 0;
+    }
+
+    if (c == (unsigned char)until[k]) {
+      if (k == 0) {
+        lexer->raw.off = lexer->off-1;
+#if !GENLEX_CONFIG_ONLY_OFFSET
+        lexer->raw.line = (c == '\n') ? lexer->line-1 : lexer->line;
+        lexer->raw.col = lexer->prev_col;
+#endif
+      }
+      if (++k == tab->raw_len) { break; }
+      continue;
+    }
+
+    if (k > 0) {
+      /* the bytes that the match moves past are text */
+      size_t j = genlex_raw_rematch(until, k, c);
+      for (i = 0; i < k+1-j; i++) {
+        GENLEXER_BUF_ADD(lexer, (i < k) ? (unsigned char)until[i] : c);
+      }
+      if (j > 0) { genlex_raw_pass(&lexer->raw, until, k+1-j); }
+      k = j;
+      continue;
+    }
+
+    GENLEXER_BUF_ADD(lexer, c);
+  }
+
+  if (lexer->blen == 0) {
+    return tab->raw_until_token;
+  }
+
+  lexer->raw.owed = 1;
+  lexer->raw.end_token = tab->raw_until_token;
+  return tab->raw_token;
+}
+#endif
+
+static int gen_lexer_next_token(struct gen_lexer *lexer)
+{
+  int tok;
+#if GENLEX_CONFIG_STATS
+  GENLEX_POS_T start = lexer->off;
+  unsigned long skipped = lexer->stats.comment_bytes;
+#endif
+
+  GENLEX_TRACE_BEGIN(lexer);
+#if GENLEX_CONFIG_RUNTIME
+  if ((lexer->tab->raw_until != NULL) || lexer->raw.owed) {
+    tok = genlex_read_raw(lexer);
+  } else
+#endif
+  tok = genlex_next_token(lexer);
+  GENLEX_TRACE_END(lexer, tok);
+
+#if GENLEX_CONFIG_POOL
+  if (lexer->buf == NULL) {
+    /* the buffer was never there to overflow */
+    if ((tok == GENLEX_ERR_BUFFER_OVERFLOW) && (lexer->blen == 0)) { tok = GENLEX_ERR_NO_MEMORY; }
+  } else if ((lexer->blen == 0) || (tok == 0)) {
+    genlex_buf_return(lexer);
+  }
+#endif
+
+#if GENLEX_CONFIG_STATS
+  genlex_count_token(lexer, tok, start, lexer->stats.comment_bytes - skipped);
+#endif
+  return tok;
+}
+
+static const unsigned char *gen_lexer_token_string(struct gen_lexer *lexer, size_t *lenp)
+{
+#if GENLEX_CONFIG_POOL
+  if (lexer->buf == NULL) {
+    if (lenp) { *lenp = 0; }
+    return (const unsigned char *)"";
+  }
+#endif
+  if (lexer->blen < GENLEX_STRING_MAX) {
+    lexer->buf[lexer->blen] = '\0';
+  }
+  if (lenp) { *lenp = lexer->blen; }
+  return lexer->buf;
+}
+
+static GENLEX_INT_T gen_lexer_token_int_value(struct gen_lexer *lexer)
+{
+  return lexer->tval.i;
+}
+
+#if GENLEX_CONFIG_DECIMAL
+static struct gen_lexer_decimal gen_lexer_token_decimal_value(struct gen_lexer *lexer)
+{
+  return lexer->tval.d;
+}
+#elif GENLEX_CONFIG_FLOATS
+static GENLEX_FLOAT_T gen_lexer_token_float_value(struct gen_lexer *lexer)
+{
+  return lexer->tval.f;
+}
+#endif
+
+#if GENLEX_CONFIG_BLOBS
+static const unsigned char *gen_lexer_token_blob(struct gen_lexer *lexer, size_t *lenp)
+{
+  if (lenp != NULL) { *lenp = lexer->tval.b.len; }
+  return (lexer->blob_buf != NULL) ? lexer->blob_buf + lexer->tval.b.off : NULL;
+}
 
-    if (!isnumber(c)) {
-      return GENLEX_ERR_INVALID_CHAR;
-    }
+static inline void gen_lexer_blob_arena(struct gen_lexer *lexer, unsigned char *buf, size_t cap)
+{
+  lexer->blob_buf = buf;
+  lexer->blob_cap = cap;
+  lexer->blob_used = 0;
+}
 
-    do {
-      GENLEXER_BUF_ADD(lexer,c);
-      c = genlex_getc(lexer);
-    } while (isnumber(c));
-  }
+static inline size_t gen_lexer_blob_arena_used(const struct gen_lexer *lexer)
+{
+  return lexer->blob_used;
+}
 #endif
 
-  if (c != EOF) {
-    if (GENLEX_IS_SYMBOL(c,0)) {
-      return GENLEX_ERR_INVALID_CHAR;
-    }
-
-    genlex_ungetc(c,lexer);
-  }
+static inline void gen_lexer_token_record(struct gen_lexer *lexer, int tok, struct gen_lexer_token *rec)
+{
+  rec->tok  = tok;
+  rec->off  = lexer->tok_off;
+#if GENLEX_LOOKAHEAD
+  /* with tokens peeked, the input has been read past this one */
+  rec->end  = (lexer->nahead > 0) ? lexer->ring[lexer->cur].end.off : lexer->off;
+#else
+  rec->end  = lexer->off;
+#endif
+  rec->line = lexer->tok_line;
+  rec->col  = lexer->tok_col;
+  rec->val  = lexer->tval;
+}
 
-  errno = 0;
-  s = (const char*)gen_lexer_token_string(lexer,NULL);
+#if GENLEX_LOOKAHEAD
+static unsigned int genlex_slot(struct gen_lexer *lexer, unsigned int k)
+{
+  return (lexer->cur + 1 + k) % (GENLEX_LOOKAHEAD+1);
+}
 
-  if (isfloat) {
-#if GENLEX_CONFIG_FLOATS
-    GENLEX_FLOAT_T fvalue;
+/* Makes the lexer's token fields refer to slot s */
+static void genlex_load_slot(struct gen_lexer *lexer, unsigned int s)
+{
+  struct gen_lexer_slot *slot = &lexer->ring[s];
+
+  lexer->buf = slot->text;
+  lexer->blen = slot->blen;
+  lexer->tok_line = slot->tok_line;
+  lexer->tok_col = slot->tok_col;
+  lexer->tok_off = slot->tok_off;
+  lexer->tval = slot->tval;
+}
 
-#if   GENLEX_FLOAT_T == float
-    fvalue = strtof(s, &end);
-#elif GENLEX_FLOAT_T == double
-    fvalue = strtod(s, &end);
-#else
-    /* unknown, so default to long double */
-    fvalue = strtold(s, &end);
+/* Scans tokens until k tokens are buffered ahead of the current one.
+ * The scanner writes straight into each slot's text buffer.
+ */
+static void genlex_fill(struct gen_lexer *lexer, unsigned int k)
+{
+  if (lexer->nahead >= k) { return; }
+
+  while (lexer->nahead < k) {
+    struct gen_lexer_slot *slot = &lexer->ring[genlex_slot(lexer, lexer->nahead)];
+
+    lexer->buf = slot->text;
+    slot->tok = gen_lexer_next_token(lexer);
+    slot->blen = lexer->blen;
+    slot->tok_line = lexer->tok_line;
+    slot->tok_col = lexer->tok_col;
+    slot->tok_off = lexer->tok_off;
+    slot->tval = lexer->tval;
+    slot->end.off = lexer->off;
+    slot->end.line = lexer->line;
+    slot->end.col = lexer->col;
+#if GENLEX_CONFIG_RUNTIME
+    slot->end.raw = lexer->raw;
 #endif
-  /* The lexer only invokes this routine when there's numeric input, so
-   * *s should never be '\0', and we can just check if *end is not '\0'
-   */
-  if (*end != '\0') {
-    return GENLEX_ERR_INVALID_INTEGER;
+    lexer->nahead++;
   }
 
-  if (errno == ERANGE) {
-    return GENLEX_ERR_FLOAT_OVERFLOW;
-  }
+  genlex_load_slot(lexer, lexer->cur);
+}
 
-  if (errno != 0) {
-    return GENLEX_ERR_UNKNOWN_ERROR;
+static int gen_lexer_peek(struct gen_lexer *lexer, unsigned int k)
+{
+  if (k >= GENLEX_LOOKAHEAD) {
+    return GENLEX_ERR_INVALID_STATE;
   }
 
-  lexer->tval.f = fvalue;
+  genlex_fill(lexer, k+1);
+  return lexer->ring[genlex_slot(lexer, k)].tok;
+}
 
-  return GENLEX_FLOAT_TOKEN;
+static const unsigned char *gen_lexer_peek_string(struct gen_lexer *lexer, unsigned int k, size_t *lenp)
+{
+  struct gen_lexer_slot *slot;
 
-#else
-  /* this should never be reached! */
-  return GENLEX_ERR_INVALID_STATE;
-#endif /* GENLEX_CONFIG_FLOATS */
+  if (k >= GENLEX_LOOKAHEAD) {
+    if (lenp) { *lenp = 0; }
+    return NULL;
   }
 
-  /* TODO: optional suffix type support */
-
-  /* FIXME: use a fixed base 10 for now since we don't officially
-   * support hex or octal
-   */
-  /* use gen_lexer_token_string() because it null-terminates the buffer */
-  value = strtol(s, &end, 10);
+  genlex_fill(lexer, k+1);
+  slot = &lexer->ring[genlex_slot(lexer, k)];
+  if (slot->blen < GENLEX_STRING_MAX) {
+    slot->text[slot->blen] = '\0';
+  }
+  if (lenp) { *lenp = slot->blen; }
+  return slot->text;
+}
 
-  /* The lexer only invokes this routine when there's numeric input, so
-   * *s should never be '\0', and we can just check if *end is not '\0'
-   */
-  if (*end != '\0') {
-    return GENLEX_ERR_INVALID_INTEGER;
+static GENLEX_INT_T gen_lexer_peek_int_value(struct gen_lexer *lexer, unsigned int k)
+{
+  if (k >= GENLEX_LOOKAHEAD) {
+    return 0;
   }
 
-  if ((value == 0) && (errno != 0)) {
-    if (errno == ERANGE) {
-      return GENLEX_ERR_INTEGER_OVERFLOW;
-    }
+  genlex_fill(lexer, k+1);
+  return lexer->ring[genlex_slot(lexer, k)].tval.i;
+}
 
-    if (errno == EINVAL) {
-      return GENLEX_ERR_INVALID_INTEGER;
-    }
+#  if GENLEX_CONFIG_DECIMAL
+static struct gen_lexer_decimal gen_lexer_peek_decimal_value(struct gen_lexer *lexer, unsigned int k)
+{
+  static const struct gen_lexer_decimal zero;
 
-    return GENLEX_ERR_UNKNOWN_ERROR;
+  if (k >= GENLEX_LOOKAHEAD) {
+    return zero;
   }
 
-  lval = value;
-
-  /* check that value fits in bounds of GENLEX_INT_T */
-  if ((long)lval != value) {
-    return GENLEX_ERR_INTEGER_OVERFLOW;
+  genlex_fill(lexer, k+1);
+  return lexer->ring[genlex_slot(lexer, k)].tval.d;
+}
+#  elif GENLEX_CONFIG_FLOATS
+static GENLEX_FLOAT_T gen_lexer_peek_float_value(struct gen_lexer *lexer, unsigned int k)
+{
+  if (k >= GENLEX_LOOKAHEAD) {
+    return 0;
   }
 
-  lexer->tval.i = lval;
-
-  return GENLEX_INT_TOKEN;
+  genlex_fill(lexer, k+1);
+  return lexer->ring[genlex_slot(lexer, k)].tval.f;
 }
+#  endif
 
-static int gen_lexer_lookup_keyword(struct gen_lexer *lexer)
+#  if GENLEX_CONFIG_BLOBS
+static const unsigned char *gen_lexer_peek_blob(struct gen_lexer *lexer, unsigned int k, size_t *lenp)
 {
-  unsigned int i;
-  for (i = 0; i < GENLEX_NUM_KEYWORDS; i++) {
-    lexer->buf[lexer->blen] = '\0';
-    if (strcmp((const char*)lexer->buf, gen_lexer_keywords[i].keyword) == 0) {
-      return gen_lexer_keywords[i].token;
-    }
+  struct gen_lexer_slot *slot;
+
+  if (k >= GENLEX_LOOKAHEAD) {
+    if (lenp) { *lenp = 0; }
+    return NULL;
   }
 
-  return -1;
+  genlex_fill(lexer, k+1);
+  slot = &lexer->ring[genlex_slot(lexer, k)];
+  if (lenp) { *lenp = slot->tval.b.len; }
+  return (lexer->blob_buf != NULL) ? lexer->blob_buf + slot->tval.b.off : NULL;
 }
+#  endif
 
-static int gen_lexer_read_symbol(struct gen_lexer *lexer, int c)
+static int gen_lexer_advance(struct gen_lexer *lexer)
 {
-  int tok;
+  genlex_fill(lexer, 1);
 
-  tok = 0;
-  do {
-    if (tok == 0) {
-      if (!gen_lexer_buf_add(lexer, c)) {
-        tok = GENLEX_ERR_BUFFER_OVERFLOW;
-      }
-    }
+  lexer->cur = genlex_slot(lexer, 0);
+  lexer->nahead--;
+  genlex_load_slot(lexer, lexer->cur);
 
-    c = genlex_getc(lexer);
-  } while (GENLEX_IS_SYMBOL(c, lexer->blen));
+  return lexer->ring[lexer->cur].tok;
+}
+#endif /* GENLEX_LOOKAHEAD */
 
-  if (c != EOF) {
-    genlex_ungetc(c,lexer);
-  }
+/* Non-zero if c begins one of the comment pairs.  Unlike
+ * GENLEX_MAY_BEGIN_COMMENT this is exact in every configuration, so a
+ * skip only stops where a comment can really start.
+ */
+static inline int genlex_is_comment_start(struct gen_lexer *lexer, int c)
+{
+#if !GENLEX_HAVE_COMMENTS
+  (void)lexer;
+  (void)c;
+  return 0;
+#elif GENLEX_CONFIG_RUNTIME || defined(GENLEX_DFA_HEADER)
+  return GENLEX_MAY_BEGIN_COMMENT(c) != 0;
+#else
+  unsigned int i;
 
-  if (tok != 0) {
-    return tok; /* error code */
+  (void)lexer;
+  for (i = 0; i < GENLEX_NUM_COMMENT_PAIRS; i++) {
+    if (gen_lexer_comments[i].beg[0] == c) { return 1; }
   }
-
-  /* TODO: implement optional trie-table search */
-
-  tok = gen_lexer_lookup_keyword(lexer);
-  if (tok < 0) { tok = GENLEX_ID_TOKEN; }
-  return tok;
+  return 0;
+#endif
 }
 
-#if defined(GENLEX_COMMENT_PAIRS)
-static int gen_lexer_read_comment(struct gen_lexer *lexer, const unsigned char end[2])
+#if GENLEX_HAVE_COMMENTS
+/* gen_lexer_read_comment() without the text */
+static inline int genlex_skip_comment(struct gen_lexer *lexer, const unsigned char end[2])
 {
-
   for(;;) {
-    int c, next;
-    c = genlex_getc(lexer);
+    int c = genlex_getc(lexer);
 
     if (c == EOF) {
       return GENLEX_ERR_UNEXPECTED_EOF;
     }
 
     if (c != end[0]) {
-      GENLEXER_BUF_ADD(lexer,c);
       continue;
     }
 
-    if (!end[1]) {
-      return GENLEX_COMMENT_TOKEN;
+    if (!end[1] || (genlex_getc(lexer) == end[1])) {
+      return 0;
     }
+  }
+}
+#endif
 
-    next = genlex_getc(lexer);
-    if (next == end[1]) {
-      return GENLEX_COMMENT_TOKEN;
+/* gen_lexer_read_string() without the text */
+static inline int genlex_skip_string(struct gen_lexer *lexer)
+{
+  for(;;) {
+    int c = genlex_getc(lexer);
+
+    if (c == EOF)  { return GENLEX_ERR_UNEXPECTED_EOF; }
+    if (c == '\n') { return GENLEX_ERR_UNEXPECTED_EOL; }
+    if (c == '"')  { return 0; }
+
+    if (c == '\\') {
+      c = gen_lexer_next_char_escaped(lexer);
+      if (c < 0) { return c; } /* error code */
     }
+  }
+}
 
-    GENLEXER_BUF_ADD(lexer,c);
-    GENLEXER_BUF_ADD(lexer,next);
+/* gen_lexer_read_char() without the text */
+static inline int genlex_skip_char(struct gen_lexer *lexer)
+{
+  int c;
+
+  c = genlex_getc(lexer);
+  if (c == '\\') {
+    c = gen_lexer_next_char_escaped(lexer);
+    if (c < 0) { return c; } /* error code */
   }
+
+  c = genlex_getc(lexer);
+  if (c == EOF)  { return GENLEX_ERR_UNEXPECTED_EOF; }
+  if (c != '\'') { return GENLEX_ERR_INVALID_CHAR; }
+  return 0;
 }
-#elif !defined(GENLEX_COMMENT_TOKEN)
-#  define GENLEX_COMMENT_TOKEN  0
-#endif
 
-#define GENLEX_CONSUME_COMMENT(lx,end) do {      \
-    int tok = gen_lexer_read_comment(lexer,end); \
-    if (GENLEX_COMMENT_TOKEN) { return tok; }    \
-    goto restart;                                \
-  } while (0)
+#if GENLEX_CONFIG_MEMORY
+/* Moves past every byte that can't change the state of a skip, straight
+ * through the buffer.
+ */
+static inline void genlex_skip_plain(struct gen_lexer *lexer, int open, int close)
+{
+  struct gen_lexer_membuf *mb = lexer->ctx;
+  const unsigned char *q = mb->data + mb->pos;
+  const unsigned char *end = mb->data + mb->len;
 
-static int gen_lexer_next_token(struct gen_lexer *lexer)
+  while ((q < end) && (*q != open) && (*q != close) && (*q != '"') &&
+      (*q != '\'') && !genlex_is_comment_start(lexer, *q)) {
+    q++;
+  }
+
+  genlex_pass_plain(lexer, q);
+}
+#endif
+
+static inline int gen_lexer_skip_group(struct gen_lexer *lexer, int open, int close)
 {
-  int ch;
-  const unsigned char *lit;
+  unsigned long depth = 1;
+  int c, err;
 
-restart:
-  lexer->blen = 0;
-  ch = genlex_skip_ws(lexer);
+#if GENLEX_LOOKAHEAD
+  /* tokens already scanned ahead are consumed as tokens */
+  while (lexer->nahead > 0) {
+    int tok = gen_lexer_advance(lexer);
 
-  if (ch == EOF) { return 0; }
+    if (tok <= 0) {
+      return (tok < 0) ? tok : GENLEX_ERR_UNEXPECTED_EOF;
+    }
+
+    if (tok == open) {
+      depth++;
+    } else if ((tok == close) && (--depth == 0)) {
+      return close;
+    }
+  }
+#endif
+
+  for (;;) {
+#if GENLEX_CONFIG_MEMORY
+    genlex_skip_plain(lexer, open, close);
+#endif
+    c = genlex_getc(lexer);
+    if (c == EOF) { return GENLEX_ERR_UNEXPECTED_EOF; }
+
+    err = 0;
+#if GENLEX_HAVE_COMMENTS
+    if (genlex_is_comment_start(lexer, c)) {
+      int i = genlex_match_comment(lexer, c);
+      if (i >= 0) {
+        if ((err = genlex_skip_comment(lexer, gen_lexer_comments[i].end)) < 0) { return err; }
+        continue;
+      }
+    }
+#endif
+
+    if (c == '"') {
+      err = genlex_skip_string(lexer);
+    } else if (c == '\'') {
+      err = genlex_skip_char(lexer);
+    } else if (c == open) {
+      depth++;
+    } else if ((c == close) && (--depth == 0)) {
+      break;
+    }
 
+    if (err < 0) { return err; }
+  }
+
+  /* the close literal becomes the current token */
+  lexer->blen = 0;
   lexer->tok_off = lexer->off-1;
 #if !GENLEX_CONFIG_ONLY_OFFSET
   lexer->tok_line = lexer->line;
   lexer->tok_col = lexer->col-1;
 #endif
-
-#if defined(GENLEX_COMMENT_PAIRS)
+#if GENLEX_CONFIG_POOL
+  if (lexer->buf != NULL) { genlex_buf_return(lexer); }
+#endif
+#if GENLEX_LOOKAHEAD
   {
-    unsigned int i;
-    for (i=0; i < GENLEX_NUM_COMMENT_PAIRS; i++) {
-      int next;
-      if (ch != gen_lexer_comments[i].beg[0]) { continue; }
-
-      if (!gen_lexer_comments[i].beg[1]) {
-        GENLEX_CONSUME_COMMENT(lexer,gen_lexer_comments[i].end);
-      }
+    struct gen_lexer_slot *slot = &lexer->ring[lexer->cur];
+    slot->tok = close;
+    slot->blen = 0;
+    slot->tok_line = lexer->tok_line;
+    slot->tok_col = lexer->tok_col;
+    slot->tok_off = lexer->tok_off;
+    slot->end.off = lexer->off;
+    slot->end.line = lexer->line;
+    slot->end.col = lexer->col;
+#if GENLEX_CONFIG_RUNTIME
+    slot->end.raw = lexer->raw;
+#endif
+  }
+#endif
 
-      next = genlex_getc(lexer);
-      if (next != gen_lexer_comments[i].beg[1]) {
-        genlex_ungetc(next,lexer);
-        continue;
-      }
+  return close;
+}
 
-      GENLEX_CONSUME_COMMENT(lexer,gen_lexer_comments[i].end);
-    }
-  }
+#if defined(GENLEX_SEEK)
+static inline int gen_lexer_mark(struct gen_lexer *lexer, struct gen_lexer_mark *mark)
+{
+#if GENLEX_LOOKAHEAD
+  *mark = lexer->ring[lexer->cur].end;
 #else
-  if (0) { goto restart; } /* eliminate warnings */
+  mark->off = lexer->off;
+  mark->line = lexer->line;
+  mark->col = lexer->col;
+#  if GENLEX_CONFIG_RUNTIME
+  mark->raw = lexer->raw;
+#  endif
 #endif
 
-  if (ch == '"') {
-    return gen_lexer_read_string(lexer);
-  }
+#if GENLEX_CONFIG_STREAM
+  {
+    struct gen_lexer_stream *st = lexer->ctx;
+    size_t i;
 
-  /* TODO: optional single-quote strings */
-  if (ch == '\'') {
-    return gen_lexer_read_char(lexer);
-  }
+    if (mark->off < st->start) {
+      return GENLEX_ERR_INVALID_STATE;
+    }
 
-  /* check for literals and literal pairs before numbers so '-' can be
-   * returned as a literal symbol, or otherwised used to parse a number
-   */
-#if defined(GENLEX_LITERAL_PAIRS)
-  {
-    unsigned int i;
-    int c2;
-    c2 = genlex_getc(lexer);
-    if (c2 != EOF) {
-      for (i=0; i < GENLEX_NUM_LITERAL_PAIRS; i++) {
-        if ((gen_lexer_literal_pairs[i].pair[0] == ch) &&
-            (gen_lexer_literal_pairs[i].pair[1] == c2)) {
-          GENLEXER_BUF_ADD(lexer,ch);
-          GENLEXER_BUF_ADD(lexer,c2);
-          return gen_lexer_literal_pairs[i].token;
-        }
-      }
-      genlex_ungetc(c2,lexer);
+    if (st->npins == st->pincap) {
+      size_t cap = (st->pincap > 0) ? 2*st->pincap : 8;
+      GENLEX_POS_T *p = (GENLEX_POS_T *)realloc(st->pins, cap * sizeof *p);
+      if (p == NULL) { return GENLEX_ERR_NO_MEMORY; }
+      st->pins = p;
+      st->pincap = cap;
     }
+
+    /* marks are mostly taken moving forward, so search from the end */
+    for (i = st->npins; (i > 0) && (st->pins[i-1] > mark->off); i--) {}
+    memmove(st->pins + i + 1, st->pins + i, (st->npins - i) * sizeof st->pins[0]);
+    st->pins[i] = mark->off;
+    st->npins++;
   }
 #endif
 
-  lit = memchr(gen_lexer_literals, ch, sizeof(gen_lexer_literals));
-  if (lit && *lit) { return ch; }
+  return 0;
+}
 
-  if (isnumber(ch) || (ch == '-')) {
-    return gen_lexer_read_num(lexer, ch);
+static inline int gen_lexer_reset_to(struct gen_lexer *lexer, const struct gen_lexer_mark *mark)
+{
+  if (GENLEX_SEEK(lexer->ctx, mark->off) != 0) {
+    return GENLEX_ERR_INVALID_STATE;
   }
 
-  if (GENLEX_IS_SYMBOL(ch, 0)) {
-    /* identifier or keyword */
-    return gen_lexer_read_symbol(lexer, ch);
-  }
+  lexer->off = mark->off;
+  lexer->line = mark->line;
+  lexer->col = mark->col;
+  lexer->prev_col = mark->col;
+#if GENLEX_CONFIG_RUNTIME
+  lexer->raw = mark->raw;
+#endif
 
-  return GENLEX_ERR_INVALID_CHAR;
+#if GENLEX_LOOKAHEAD
+  lexer->nahead = 0;
+  lexer->ring[lexer->cur].end = *mark;
+#endif
+
+  return 0;
 }
 
-static const unsigned char *gen_lexer_token_string(struct gen_lexer *lexer, size_t *lenp)
+static inline void gen_lexer_release_mark(struct gen_lexer *lexer, const struct gen_lexer_mark *mark)
 {
-  if (lexer->blen < sizeof(lexer->buf)) {
-    lexer->buf[lexer->blen] = '\0';
+#if GENLEX_CONFIG_STREAM
+  /* drop one entry for the mark's offset; the oldest left is the pin */
+  struct gen_lexer_stream *st = lexer->ctx;
+  size_t i;
+
+  for (i = st->npins; (i > 0) && (st->pins[i-1] != mark->off); i--) {}
+  if (i > 0) {
+    memmove(st->pins + i - 1, st->pins + i, (st->npins - i) * sizeof st->pins[0]);
+    st->npins--;
   }
-  if (lenp) { *lenp = lexer->blen; }
-  return lexer->buf;
+#endif
+  (void)lexer;
+  (void)mark;
 }
+#endif /* GENLEX_SEEK */
 
-static GENLEX_INT_T gen_lexer_token_int_value(struct gen_lexer *lexer)
+static inline int gen_lexer_tokens_push(struct gen_lexer_tokens *toks, const struct gen_lexer_token *tok)
 {
-  return lexer->tval.i;
+  if (toks->len >= toks->cap) {
+    size_t ncap = toks->cap ? 2*toks->cap : 256;
+    struct gen_lexer_token *p = (struct gen_lexer_token *)realloc(toks->toks, ncap * sizeof *p);
+    if (p == NULL) { return 0; }
+    toks->toks = p;
+    toks->cap = ncap;
+  }
+
+  toks->toks[toks->len++] = *tok;
+  return 1;
 }
 
-#if GENLEX_CONFIG_FLOATS
-static GENLEX_FLOAT_T gen_lexer_token_float_value(struct gen_lexer *lexer)
+static inline void gen_lexer_tokens_free(struct gen_lexer_tokens *toks)
 {
-  return lexer->tval.f;
+  free(toks->toks);
+  toks->toks = NULL;
+  toks->len = toks->cap = 0;
 }
-#endif
 
 #endif /* GLEX_H */
 
@@ -0,0 +1,439 @@
+#ifndef GLEX_HPP
+#define GLEX_HPP
+
+/* C++17 interface to GenLexer.
+ *
+ * The lexical configuration is a type rather than a set of macros:
+ *
+ *   struct my_config : glex::config {
+ *     static constexpr std::string_view literals = "(){};=";
+ *     static constexpr glex::keyword keywords[] = { { "if", 1100 }, { "else", 1101 } };
+ *     static constexpr glex::pair pairs[] = { { "==", 512 } };
+ *     static constexpr glex::comment comments[] = { { "//", "\n" }, { "#", "\n" } };
+ *     static constexpr glex::escape escapes[] = GENLEX_C90_ESCAPES;
+ *   };
+ *
+ *   for (const glex::token &t : glex::lexer<my_config>(text)) { ... }
+ *
+ * Members left out keep the defaults of glex::config.  Each config type
+ * is compiled once, at compile time, into the same struct
+ * gen_lexer_tables that gen_lexer_compile() builds, so glex.h is used in
+ * its GENLEX_CONFIG_RUNTIME and GENLEX_CONFIG_MEMORY mode: one copy of
+ * the lexer serves every config type in the program.  glex.hpp sets
+ * those two itself, and GENLEX_CONFIG_FLOATS and GENLEX_STRING_MAX
+ * unless they are already defined; include it instead of glex.h.
+ *
+ *   template <class Config> class glex::lexer;
+ *
+ *     explicit lexer(std::string_view input);
+ *
+ *       Lexes input, which must outlive the lexer.  Lexers can be moved
+ *       but not copied.
+ *
+ *     glex::token next();
+ *
+ *       Scans the next token.  token.text is the span of input that
+ *       produced it (quotes, escapes and all), so it stays valid as long
+ *       as the input does.  At the end of the input, token.kind is 0;
+ *       on an error it is the GENLEX_ERR_* code.
+ *
+ *     std::string_view value() const;
+ *     GENLEX_INT_T int_value() const;
+ *     GENLEX_FLOAT_T float_value() const;
+ *     struct gen_lexer_decimal decimal_value() const;
+ *
+ *       The decoded text (the contents of a string, without escapes) and
+ *       the numeric value of the last token, as gen_lexer_token_string()
+ *       and friends return them.  The text is only valid until the next
+ *       call to next().
+ *
+ *     int skip_group(int open, int close);
+ *
+ *       gen_lexer_skip_group() on this lexer.
+ *
+ *     void reset(std::string_view input);
+ *
+ *       Restarts the lexer on new input.
+ *
+ *     iterator begin();
+ *     iterator end();
+ *
+ *       Input iterators over the remaining tokens, for range-for and
+ *       single-pass algorithms.  An error token is the last token
+ *       produced.
+ *
+ *     struct gen_lexer *c_lexer();
+ *
+ *       The underlying lexer, for the rest of the glex.h API.
+ *
+ * Scanning a token neither allocates nor makes an indirect call.
+ */
+
+#if defined(GLEX_H) && !(GENLEX_CONFIG_RUNTIME && GENLEX_CONFIG_MEMORY)
+#  error glex.hpp needs glex.h with GENLEX_CONFIG_RUNTIME and GENLEX_CONFIG_MEMORY
+#endif
+
+#if defined(GENLEX_LOOKAHEAD) || GENLEX_CONFIG_POOL
+#  error glex.hpp does not support GENLEX_LOOKAHEAD or GENLEX_CONFIG_POOL
+#endif
+
+#if !defined(GLEX_H)
+#  if !defined(GENLEX_CONFIG_RUNTIME)
+#    define GENLEX_CONFIG_RUNTIME 1
+#  endif
+#  if !defined(GENLEX_CONFIG_MEMORY)
+#    define GENLEX_CONFIG_MEMORY 1
+#  endif
+#  if !defined(GENLEX_CONFIG_FLOATS)
+#    define GENLEX_CONFIG_FLOATS 1
+#  endif
+#  if !defined(GENLEX_STRING_MAX)
+#    define GENLEX_STRING_MAX 1024
+#  endif
+#endif
+
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <iterator>
+#include <string_view>
+#include <utility>
+
+/* not every function of glex.h is used by every program */
+#if defined(__GNUC__)
+#  pragma GCC diagnostic push
+#  pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+
+#include "glex.h"
+
+#if defined(__GNUC__)
+#  pragma GCC diagnostic pop
+#endif
+
+namespace glex {
+
+struct keyword {
+  std::string_view text;
+  int token;
+};
+
+/* A two-character literal */
+struct pair {
+  std::string_view text;
+  int token;
+};
+
+/* Delimiters of one or two characters */
+struct comment {
+  std::string_view beg;
+  std::string_view end;
+};
+
+/* An entry of GENLEX_ESCAPES */
+using escape = gen_lexer_escape;
+
+/* Defaults for config types to derive from */
+struct config {
+  static constexpr std::string_view literals = "";
+  static constexpr std::string_view symbol_first = GENLEX_ALPHA "_";
+  static constexpr std::string_view symbol_rest = GENLEX_ALPHA "_" GENLEX_DIGITS;
+  static constexpr std::string_view whitespace = " \t\n\v\f\r";
+
+  static constexpr std::array<keyword, 0> keywords = {};
+  static constexpr std::array<pair, 0> pairs = {};
+  static constexpr std::array<comment, 0> comments = {};
+  static constexpr std::array<escape, 0> escapes = {};  /* empty for GENLEX_DEFAULT_ESCAPES */
+  static constexpr bool keywords_nocase = false;        /* GENLEX_KEYWORDS_CASE_INSENSITIVE */
+
+  static constexpr int id_token = 1024;
+  static constexpr int string_token = 1025;
+  static constexpr int int_token = 1026;
+  static constexpr int float_token = 1027;  /* 0 if floats aren't parsed */
+  static constexpr int comment_token = 0;   /* 0 to skip comments */
+};
+
+struct token {
+  int kind;                /* token, 0 at the end, or GENLEX_ERR_* */
+  std::string_view text;   /* span of input */
+  GENLEX_POS_T off;
+  GENLEX_POS_T line;
+  GENLEX_POS_T col;
+
+  explicit operator bool() const { return kind > 0; }
+};
+
+namespace detail {
+
+/* The arrays a config type compiles to, and its struct gen_lexer_tables */
+template <class C>
+struct tables {
+  static constexpr std::size_t nkeywords = std::size(C::keywords);
+  static constexpr std::size_t npairs = std::size(C::pairs);
+  static constexpr std::size_t ncomments = std::size(C::comments);
+
+  /* as in gen_lexer_compile(): at most half full */
+  static constexpr std::size_t kwsize()
+  {
+    std::size_t n = 2;
+    while (n < 2*nkeywords) { n *= 2; }
+    return n;
+  }
+
+  /* genlex_rt_hash(), or genlex_rt_hash_folded() */
+  static constexpr std::size_t hash(std::string_view s)
+  {
+    std::size_t h = 2166136261u;
+    for (char c : s) {
+      unsigned int u = (unsigned char)c;
+      h = (h ^ (C::keywords_nocase ? GENLEX_FOLD(u) : u)) * 16777619u;
+    }
+    return h;
+  }
+
+  static constexpr bool valid()
+  {
+    for (const pair &p : C::pairs) {
+      if (p.text.size() != 2) { return false; }
+    }
+    for (const comment &c : C::comments) {
+      if ((c.beg.size() < 1) || (c.beg.size() > 2)) { return false; }
+      if ((c.end.size() < 1) || (c.end.size() > 2)) { return false; }
+    }
+    return true;
+  }
+
+  static_assert(valid(), "pairs must be two characters, comment delimiters one or two");
+
+  static constexpr unsigned char at(std::string_view s, std::size_t i)
+  {
+    return (i < s.size()) ? (unsigned char)s[i] : 0;
+  }
+
+  static constexpr std::array<gen_lexer_rt_keyword, kwsize()> make_kwtab()
+  {
+    std::array<gen_lexer_rt_keyword, kwsize()> tab = {};
+
+    for (const keyword &kw : C::keywords) {
+      std::size_t h = hash(kw.text) & (kwsize()-1);
+      while (tab[h].keyword != nullptr) {
+        h = (h+1) & (kwsize()-1);
+      }
+      tab[h].keyword = kw.text.data();
+      tab[h].len = kw.text.size();
+      tab[h].token = kw.token;
+    }
+    return tab;
+  }
+
+  template <std::size_t... I>
+  static constexpr std::array<gen_lexer_literal_pair, npairs> make_pairs(std::index_sequence<I...>)
+  {
+    return { { { { at(C::pairs[I].text, 0), at(C::pairs[I].text, 1) }, C::pairs[I].token }... } };
+  }
+
+  template <std::size_t... I>
+  static constexpr std::array<gen_lexer_comment_pairs, ncomments> make_comments(std::index_sequence<I...>)
+  {
+    return { { { { at(C::comments[I].beg, 0), at(C::comments[I].beg, 1) },
+                 { at(C::comments[I].end, 0), at(C::comments[I].end, 1) } }... } };
+  }
+
+#if GENLEX_CONFIG_KIND_TABLE
+  /* genlex_kind_of() */
+  static constexpr unsigned char kind_of(int c, unsigned int cls)
+  {
+    if (cls & GENLEX_CLS_WS)                          { return GENLEX_KIND_WS; }
+    if (cls & GENLEX_CLS_COMMENT)                     { return GENLEX_KIND_COMMENT; }
+    if (c == '"')                                     { return GENLEX_KIND_STRING; }
+    if (c == '\'')                                    { return GENLEX_KIND_CHAR; }
+    if (cls & GENLEX_CLS_PAIR)                        { return GENLEX_KIND_PAIR; }
+    if (cls & GENLEX_CLS_LITERAL)                     { return GENLEX_KIND_LITERAL; }
+    if (((c >= '0') && (c <= '9')) || (c == '-'))     { return GENLEX_KIND_NUMBER; }
+    if (cls & GENLEX_CLS_SYM0)                        { return GENLEX_KIND_SYMBOL; }
+    if (GENLEX_IS_MULTIBYTE(c))                       { return GENLEX_KIND_SYMBOL; }
+    return GENLEX_KIND_INVALID;
+  }
+#endif
+
+  static constexpr escape default_escapes[] = GENLEX_DEFAULT_ESCAPES;
+  static constexpr std::array<gen_lexer_rt_keyword, kwsize()> kwtab = make_kwtab();
+  static constexpr std::array<gen_lexer_literal_pair, npairs> pairs =
+    make_pairs(std::make_index_sequence<npairs>());
+  static constexpr std::array<gen_lexer_comment_pairs, ncomments> comments =
+    make_comments(std::make_index_sequence<ncomments>());
+
+  /* gen_lexer_compile() */
+  static constexpr gen_lexer_tables make()
+  {
+    gen_lexer_tables tab = {};
+
+    for (char c : C::whitespace)   { tab.cls[(unsigned char)c] |= GENLEX_CLS_WS; }
+    for (char c : C::literals)     { tab.cls[(unsigned char)c] |= GENLEX_CLS_LITERAL; }
+    for (char c : C::symbol_first) { tab.cls[(unsigned char)c] |= GENLEX_CLS_SYM0; }
+    for (char c : C::symbol_rest)  { tab.cls[(unsigned char)c] |= GENLEX_CLS_SYM; }
+    for (const pair &p : C::pairs) {
+      tab.cls[(unsigned char)p.text[0]] |= GENLEX_CLS_PAIR;
+    }
+    for (const comment &c : C::comments) {
+      tab.cls[(unsigned char)c.beg[0]] |= GENLEX_CLS_COMMENT;
+    }
+
+    tab.pairs = pairs.data();
+    tab.npairs = npairs;
+    tab.comments = comments.data();
+    tab.ncomments = ncomments;
+    tab.kwtab = (nkeywords > 0) ? kwtab.data() : nullptr;
+    tab.kwmask = (nkeywords > 0) ? kwsize()-1 : 0;
+    tab.kwnocase = C::keywords_nocase;
+
+    /* genlex_esc_compile() */
+    if (std::size(C::escapes) > 0) {
+      for (const escape &e : C::escapes) {
+        tab.esc[e.ch] = { e.action, e.arg };
+      }
+    } else {
+      for (const escape &e : default_escapes) {
+        tab.esc[e.ch] = { e.action, e.arg };
+      }
+    }
+
+#if GENLEX_CONFIG_KIND_TABLE
+    for (int c = 0; c < 256; c++) {
+      tab.kind[c] = kind_of(c, tab.cls[c]);
+    }
+#endif
+
+    tab.id_token = C::id_token;
+    tab.string_token = C::string_token;
+    tab.int_token = C::int_token;
+    tab.float_token = GENLEX_CONFIG_FLOATS ? C::float_token : 0;
+    tab.comment_token = C::comment_token;
+    return tab;
+  }
+
+  static constexpr gen_lexer_tables value = make();
+};
+
+} /* namespace detail */
+
+template <class Config>
+class lexer {
+public:
+  class iterator;
+
+  explicit lexer(std::string_view input) noexcept
+    : mb_{ (const unsigned char *)input.data(), input.size(), 0 }
+  {
+    gen_lexer_initialize_with(&lx_, &detail::tables<Config>::value, &mb_);
+  }
+
+  lexer(lexer &&other) noexcept
+    : mb_(other.mb_), lx_(other.lx_)
+  {
+    lx_.ctx = &mb_;
+  }
+
+  lexer &operator=(lexer &&other) noexcept
+  {
+    mb_ = other.mb_;
+    lx_ = other.lx_;
+    lx_.ctx = &mb_;
+    return *this;
+  }
+
+  lexer(const lexer &) = delete;
+  lexer &operator=(const lexer &) = delete;
+
+  void reset(std::string_view input) noexcept
+  {
+    mb_.data = (const unsigned char *)input.data();
+    mb_.len = input.size();
+    mb_.pos = 0;
+    gen_lexer_reset(&lx_, &mb_);
+  }
+
+  token next() noexcept
+  {
+    int kind = gen_lexer_next_token(&lx_);
+    /* off counts an EOF read */
+    GENLEX_POS_T end = (lx_.off < mb_.len) ? lx_.off : (GENLEX_POS_T)mb_.len;
+
+    if (kind == 0) {
+      return { 0, { (const char *)mb_.data + end, 0 }, end, lx_.line, lx_.col };
+    }
+    return { kind, { (const char *)mb_.data + lx_.tok_off, (std::size_t)(end - lx_.tok_off) },
+             lx_.tok_off, lx_.tok_line, lx_.tok_col };
+  }
+
+  std::string_view value() const noexcept
+  {
+    return { (const char *)lx_.buf, lx_.blen };
+  }
+
+  GENLEX_INT_T int_value() const noexcept { return lx_.tval.i; }
+
+#if GENLEX_CONFIG_DECIMAL
+  struct gen_lexer_decimal decimal_value() const noexcept { return lx_.tval.d; }
+#elif GENLEX_CONFIG_FLOATS
+  GENLEX_FLOAT_T float_value() const noexcept { return lx_.tval.f; }
+#endif
+
+  int skip_group(int open, int close) noexcept
+  {
+    return gen_lexer_skip_group(&lx_, open, close);
+  }
+
+  struct gen_lexer *c_lexer() noexcept { return &lx_; }
+
+  iterator begin() { return iterator(this); }
+  iterator end() { return iterator(); }
+
+private:
+  struct gen_lexer_membuf mb_;
+  struct gen_lexer lx_;
+};
+
+template <class Config>
+class lexer<Config>::iterator {
+public:
+  using iterator_category = std::input_iterator_tag;
+  using value_type = token;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const token *;
+  using reference = const token &;
+
+  iterator() noexcept : lx_(nullptr), tok_() {}
+
+  explicit iterator(lexer *lx) noexcept : lx_(lx), tok_()
+  {
+    ++*this;
+  }
+
+  reference operator*() const noexcept { return tok_; }
+  pointer operator->() const noexcept { return &tok_; }
+
+  iterator &operator++() noexcept
+  {
+    if (tok_.kind < 0) {
+      lx_ = nullptr;
+      return *this;
+    }
+    tok_ = lx_->next();
+    if (tok_.kind == 0) { lx_ = nullptr; }
+    return *this;
+  }
+
+  void operator++(int) noexcept { ++*this; }
+
+  bool operator==(const iterator &other) const noexcept { return lx_ == other.lx_; }
+  bool operator!=(const iterator &other) const noexcept { return lx_ != other.lx_; }
+
+private:
+  lexer *lx_;
+  token tok_;
+};
+
+} /* namespace glex */
+
+#endif /* GLEX_HPP */
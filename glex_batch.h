@@ -0,0 +1,334 @@
+#ifndef GLEX_BATCH_H
+#define GLEX_BATCH_H
+
+/* Batch driver for GenLexer: lexes many files concurrently.
+ *
+ * This is meant to be #include'd after glex.h, which must be configured
+ * with GENLEX_CONFIG_MEMORY and without GENLEX_CONFIG_RUNTIME.  Link
+ * with -lpthread.
+ *
+ *   static int gen_lexer_batch_lex(const char *const *paths, size_t npaths,
+ *       unsigned int nthreads, gen_lexer_batch_fn fn, void *arg);
+ *
+ *     Lexes each file in paths[0..npaths) on a pool of nthreads
+ *     threads and calls fn once per file with the file's tokens.
+ *     Returns 0 once every file has been delivered, the first non-zero
+ *     value returned by fn (which stops the batch), or
+ *     GENLEX_ERR_NO_MEMORY if the pool couldn't be set up.
+ *
+ *   typedef int (*gen_lexer_batch_fn)(void *arg, const struct gen_lexer_batch_file *file);
+ *
+ *     Called from the worker threads, so it must be safe to call
+ *     concurrently for different files.  file and everything it points
+ *     to is only valid for the duration of the call.
+ *
+ * Each worker owns its own struct gen_lexer, read buffer and token
+ * array, which are reused from file to file.  The lexer keeps no state
+ * outside of struct gen_lexer, only const tables, so workers share
+ * nothing but the queue.
+ *
+ * The files are dealt out to the workers in contiguous runs.  A worker
+ * that runs out of files steals the second half of the remaining run of
+ * another worker, so a few large files don't leave the other workers
+ * idle.
+ */
+
+#if !defined(GLEX_H)
+#  error glex_batch.h must be included after glex.h
+#endif
+
+#if !GENLEX_CONFIG_MEMORY
+#  error glex_batch.h requires GENLEX_CONFIG_MEMORY
+#endif
+
+/* the workers' lexers have no blob arena to decode into */
+#if GENLEX_CONFIG_BLOBS
+#  error glex_batch.h does not support GENLEX_CONFIG_BLOBS
+#endif
+
+/* the workers' lexers are set up by gen_lexer_initialize(), with no
+ * tables to lex by
+ */
+#if GENLEX_CONFIG_RUNTIME
+#  error glex_batch.h does not support GENLEX_CONFIG_RUNTIME
+#endif
+
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+struct gen_lexer_batch_file {
+  size_t index;                       /* index into paths */
+  const char *path;
+  int err;                            /* 0 or GENLEX_ERR_IO / GENLEX_ERR_NO_MEMORY */
+  unsigned int worker;                /* which worker lexed the file */
+  const unsigned char *data;          /* file contents, for token text */
+  size_t len;
+  const struct gen_lexer_token *toks; /* tokens, in order */
+  size_t ntoks;
+};
+
+typedef int (*gen_lexer_batch_fn)(void *arg, const struct gen_lexer_batch_file *file);
+
+static int gen_lexer_batch_lex(const char *const *paths, size_t npaths,
+    unsigned int nthreads, gen_lexer_batch_fn fn, void *arg);
+
+
+/* Implementation */
+
+/* The files still owned by one worker: paths[lo..hi).  Padded so that
+ * workers popping from their own queue don't share cache lines.
+ */
+struct genlex_batch_queue {
+  pthread_mutex_t lock;
+  size_t lo;
+  size_t hi;
+  char pad[64];
+};
+
+struct genlex_batch_pool {
+  const char *const *paths;
+  gen_lexer_batch_fn fn;
+  void *arg;
+
+  unsigned int nworkers;
+  struct genlex_batch_queue *queues;
+
+  pthread_mutex_t stop_lock;
+  int stop;
+};
+
+struct genlex_batch_worker {
+  struct genlex_batch_pool *pool;
+  unsigned int id;
+
+  struct gen_lexer lexer;
+  unsigned char *data;
+  size_t cap;
+  struct gen_lexer_tokens toks;
+};
+
+static int genlex_batch_pop(struct genlex_batch_queue *q, size_t *ip)
+{
+  int ok;
+
+  pthread_mutex_lock(&q->lock);
+  ok = (q->lo < q->hi);
+  if (ok) { *ip = q->lo++; }
+  pthread_mutex_unlock(&q->lock);
+
+  return ok;
+}
+
+/* Moves the back half of another worker's files to worker w */
+static int genlex_batch_steal(struct genlex_batch_pool *pool, unsigned int w)
+{
+  unsigned int k;
+
+  for (k=1; k < pool->nworkers; k++) {
+    struct genlex_batch_queue *victim = &pool->queues[(w+k) % pool->nworkers];
+    size_t lo, hi;
+
+    pthread_mutex_lock(&victim->lock);
+    hi = victim->hi;
+    lo = victim->lo + (hi - victim->lo)/2;
+    if (lo < hi) { victim->hi = lo; }
+    pthread_mutex_unlock(&victim->lock);
+
+    if (lo < hi) {
+      struct genlex_batch_queue *q = &pool->queues[w];
+      pthread_mutex_lock(&q->lock);
+      q->lo = lo;
+      q->hi = hi;
+      pthread_mutex_unlock(&q->lock);
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+static int genlex_batch_read(struct genlex_batch_worker *wk, const char *path, size_t *lenp)
+{
+  struct stat st;
+  size_t len;
+  int fd, err = 0;
+
+  if ((fd = open(path, O_RDONLY)) < 0) {
+    return GENLEX_ERR_IO;
+  }
+
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return GENLEX_ERR_IO;
+  }
+
+  /* offsets are GENLEX_POS_T */
+  if ((unsigned long long)st.st_size > (GENLEX_POS_T)-1 - 1) {
+    close(fd);
+    return GENLEX_ERR_BUFFER_OVERFLOW;
+  }
+
+  if ((size_t)st.st_size > wk->cap) {
+    unsigned char *p = realloc(wk->data, st.st_size);
+    if (p == NULL) {
+      close(fd);
+      return GENLEX_ERR_NO_MEMORY;
+    }
+    wk->data = p;
+    wk->cap = st.st_size;
+  }
+
+  for (len = 0; len < (size_t)st.st_size; ) {
+    ssize_t n = read(fd, wk->data + len, st.st_size - len);
+    if (n < 0) {
+      err = GENLEX_ERR_IO;
+      break;
+    }
+    if (n == 0) { break; }  /* file shrank */
+    len += n;
+  }
+
+  close(fd);
+  *lenp = len;
+  return err;
+}
+
+static int genlex_batch_file(struct genlex_batch_worker *wk, size_t i)
+{
+  struct genlex_batch_pool *pool = wk->pool;
+  struct gen_lexer_batch_file file;
+  struct gen_lexer_membuf mb;
+  int tok;
+
+  memset(&file, 0, sizeof file);
+  file.index = i;
+  file.path = pool->paths[i];
+  file.worker = wk->id;
+
+  wk->toks.len = 0;
+  file.err = genlex_batch_read(wk, file.path, &file.len);
+  if (file.err == 0) {
+    mb.data = wk->data;
+    mb.len = file.len;
+    mb.pos = 0;
+    gen_lexer_initialize(&wk->lexer, &mb);
+
+    while ((tok = gen_lexer_next_token(&wk->lexer)) != 0) {
+      struct gen_lexer_token rec;
+      gen_lexer_token_record(&wk->lexer, tok, &rec);
+      if (!gen_lexer_tokens_push(&wk->toks, &rec)) {
+        file.err = GENLEX_ERR_NO_MEMORY;
+        break;
+      }
+    }
+
+    file.data = wk->data;
+    file.toks = wk->toks.toks;
+    file.ntoks = wk->toks.len;
+  }
+
+  return pool->fn(pool->arg, &file);
+}
+
+static int genlex_batch_stopped(struct genlex_batch_pool *pool, int ret)
+{
+  int stop;
+
+  pthread_mutex_lock(&pool->stop_lock);
+  if ((ret != 0) && (pool->stop == 0)) { pool->stop = ret; }
+  stop = pool->stop;
+  pthread_mutex_unlock(&pool->stop_lock);
+
+  return stop;
+}
+
+static void *genlex_batch_worker(void *arg)
+{
+  struct genlex_batch_worker *wk = arg;
+  struct genlex_batch_pool *pool = wk->pool;
+
+  for (;;) {
+    size_t i;
+
+    if (!genlex_batch_pop(&pool->queues[wk->id], &i)) {
+      if (!genlex_batch_steal(pool, wk->id)) { break; }
+      continue;
+    }
+
+    if (genlex_batch_stopped(pool, genlex_batch_file(wk, i))) {
+      break;
+    }
+  }
+
+  return NULL;
+}
+
+static int gen_lexer_batch_lex(const char *const *paths, size_t npaths,
+    unsigned int nthreads, gen_lexer_batch_fn fn, void *arg)
+{
+  struct genlex_batch_pool pool;
+  struct genlex_batch_worker *workers;
+  pthread_t *tids;
+  unsigned int k;
+
+  if (nthreads == 0) { nthreads = 1; }
+  if (nthreads > npaths) { nthreads = (npaths > 0) ? npaths : 1; }
+
+  memset(&pool, 0, sizeof pool);
+  pool.paths = paths;
+  pool.fn = fn;
+  pool.arg = arg;
+  pool.nworkers = nthreads;
+  pthread_mutex_init(&pool.stop_lock, NULL);
+
+  pool.queues = calloc(nthreads, sizeof *pool.queues);
+  workers = calloc(nthreads, sizeof *workers);
+  tids = calloc(nthreads, sizeof *tids);
+  if ((pool.queues == NULL) || (workers == NULL) || (tids == NULL)) {
+    free(pool.queues);
+    free(workers);
+    free(tids);
+    pthread_mutex_destroy(&pool.stop_lock);
+    return GENLEX_ERR_NO_MEMORY;
+  }
+
+  for (k=0; k < nthreads; k++) {
+    pthread_mutex_init(&pool.queues[k].lock, NULL);
+    pool.queues[k].lo = (npaths * k) / nthreads;
+    pool.queues[k].hi = (npaths * (k+1)) / nthreads;
+
+    workers[k].pool = &pool;
+    workers[k].id = k;
+  }
+
+  /* the calling thread is worker 0 */
+  for (k=1; k < nthreads; k++) {
+    if (pthread_create(&tids[k], NULL, genlex_batch_worker, &workers[k]) != 0) {
+      tids[k] = pthread_self();
+    }
+  }
+  genlex_batch_worker(&workers[0]);
+
+  for (k=1; k < nthreads; k++) {
+    if (!pthread_equal(tids[k], pthread_self())) {
+      pthread_join(tids[k], NULL);
+    }
+  }
+
+  for (k=0; k < nthreads; k++) {
+    pthread_mutex_destroy(&pool.queues[k].lock);
+    free(workers[k].data);
+    gen_lexer_tokens_free(&workers[k].toks);
+  }
+
+  free(pool.queues);
+  free(workers);
+  free(tids);
+  pthread_mutex_destroy(&pool.stop_lock);
+
+  return pool.stop;
+}
+
+#endif /* GLEX_BATCH_H */
@@ -0,0 +1,472 @@
+/* glex_bench: measures GenLexer throughput on each corpus, for each
+ * variant (input backend and configuration) built into the binary.
+ *
+ *   glex_bench [-j] [-t seconds] [-d dir] [-v variant] [-c corpus]
+ *
+ *     Prints one line per (variant, corpus): tab-separated values after
+ *     a header line, or with -j one JSON object per line.  Each
+ *     measurement repeats the lexing for at least -t seconds (default
+ *     0.25).  -v and -c restrict the run to variants and corpora whose
+ *     names contain the given string.  Corpora are read from dir
+ *     (default "bench").
+ *
+ *   glex_bench -g dir
+ *
+ *     Writes the corpora to dir.  The checked-in corpora in bench/ come
+ *     from this, so they only need to be regenerated when the generator
+ *     changes.
+ *
+ * Columns: variant, backend, engine, floats, comments, pairs, keywords,
+ * corpus, bytes, tokens, errors, iterations, seconds, mb_per_s,
+ * tokens_per_s and cycles_per_byte.  Cycles are time-stamp counter
+ * cycles, which run at a fixed rate on current x86 processors; they are
+ * reported as NA (null) where no such counter is available.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <x86intrin.h>
+#  define GLEX_BENCH_HAVE_TSC 1
+#endif
+
+#include "glex_bench.h"
+
+#define BENCH_CORPUS_SIZE (64*1024)
+
+extern const struct glex_bench_variant glex_bench_memory_full;
+extern const struct glex_bench_variant glex_bench_bytestream_full;
+extern const struct glex_bench_variant glex_bench_stdio_full;
+extern const struct glex_bench_variant glex_bench_stream_full;
+extern const struct glex_bench_variant glex_bench_memory_nofloats;
+extern const struct glex_bench_variant glex_bench_memory_nocomments;
+extern const struct glex_bench_variant glex_bench_memory_nopairs;
+extern const struct glex_bench_variant glex_bench_memory_kw0;
+extern const struct glex_bench_variant glex_bench_memory_kw64;
+extern const struct glex_bench_variant glex_bench_memory_dfa;
+extern const struct glex_bench_variant glex_bench_memory_kinds;
+extern const struct glex_bench_variant glex_bench_memory_runtime;
+extern const struct glex_bench_variant glex_bench_memory_stats;
+extern const struct glex_bench_variant glex_bench_memory_index;
+extern const struct glex_bench_variant glex_bench_memory_cxx;
+extern const struct glex_bench_variant glex_bench_memory_utf8;
+extern const struct glex_bench_variant glex_bench_memory_pipeline;
+extern const struct glex_bench_variant glex_bench_memory_packed;
+extern const struct glex_bench_variant glex_bench_memory_run;
+
+static const struct glex_bench_variant *const bench_variants[] = {
+  &glex_bench_memory_full,
+  &glex_bench_bytestream_full,
+  &glex_bench_stdio_full,
+  &glex_bench_stream_full,
+  &glex_bench_memory_nofloats,
+  &glex_bench_memory_nocomments,
+  &glex_bench_memory_nopairs,
+  &glex_bench_memory_kw0,
+  &glex_bench_memory_kw64,
+  &glex_bench_memory_dfa,
+  &glex_bench_memory_kinds,
+  &glex_bench_memory_runtime,
+  &glex_bench_memory_stats,
+  &glex_bench_memory_index,
+  &glex_bench_memory_cxx,
+  &glex_bench_memory_utf8,
+  &glex_bench_memory_pipeline,
+  &glex_bench_memory_packed,
+  &glex_bench_memory_run,
+};
+
+#define BENCH_NUM_VARIANTS (sizeof bench_variants / sizeof bench_variants[0])
+
+
+/* Corpus generation */
+
+struct bench_buf {
+  char *data;
+  size_t len;
+  size_t cap;
+  unsigned int seed;
+};
+
+static unsigned int bench_rand(struct bench_buf *b, unsigned int n)
+{
+  b->seed = b->seed * 1103515245u + 12345u;
+  return ((b->seed >> 16) & 0x7fff) % n;
+}
+
+static void bench_puts(struct bench_buf *b, const char *s)
+{
+  size_t n = strlen(s);
+
+  if (b->len + n > b->cap) { n = b->cap - b->len; }
+  memcpy(b->data + b->len, s, n);
+  b->len += n;
+}
+
+static void bench_printf(struct bench_buf *b, const char *fmt, ...)
+{
+  char tmp[512];
+  va_list ap;
+
+  va_start(ap, fmt);
+  vsnprintf(tmp, sizeof tmp, fmt, ap);
+  va_end(ap);
+  bench_puts(b, tmp);
+}
+
+static const char *const bench_words[] = {
+  "alpha", "beta", "gamma", "delta", "value", "count", "index", "buffer",
+  "next", "prev", "node", "item", "result", "status", "offset", "length",
+  "name", "size", "data", "key", "left", "right", "total", "limit",
+};
+
+#define BENCH_WORD(b) (bench_words[bench_rand((b), sizeof bench_words / sizeof bench_words[0])])
+
+static void bench_gen_json(struct bench_buf *b)
+{
+  bench_puts(b, "[\n");
+  while (b->len + 512 < b->cap) {
+    bench_printf(b, "  { \"%s\": %u, \"%s_%u\": \"%s %s\", \"ratio\": %u.%02u,\n",
+        BENCH_WORD(b), bench_rand(b, 100000), BENCH_WORD(b), bench_rand(b, 100),
+        BENCH_WORD(b), BENCH_WORD(b), bench_rand(b, 1000), bench_rand(b, 100));
+    bench_printf(b, "    \"flags\": [ true, false, %s ], \"child\": { \"id\": %u, \"tag\": \"%s\" } },\n",
+        bench_rand(b, 2) ? "true" : "false", bench_rand(b, 1u << 20), BENCH_WORD(b));
+  }
+  bench_puts(b, "  {}\n]\n");
+}
+
+static void bench_gen_c(struct bench_buf *b)
+{
+  unsigned int fn = 0;
+
+  while (b->len + 768 < b->cap) {
+    const char *x = BENCH_WORD(b), *y = BENCH_WORD(b);
+
+    bench_printf(b, "/* %s: updates the %s */\n", x, y);
+    bench_printf(b, "int %s_%u(struct %s *%s, int n)\n{\n", x, fn++, y, y);
+    bench_printf(b, "  int i, %s = 0;\n\n", x);
+    bench_printf(b, "  for (i = 0; i < n; i++) {\n");
+    bench_printf(b, "    if ((%s->%s[i] >= %u) && (%s != %u)) {\n", y, BENCH_WORD(b),
+        bench_rand(b, 1000), x, bench_rand(b, 10));
+    bench_printf(b, "      %s += %s->%s[i] << %u; // shift\n", x, y, BENCH_WORD(b), bench_rand(b, 8));
+    bench_printf(b, "    } else {\n      %s -= %u;\n    }\n  }\n\n", x, bench_rand(b, 100));
+    bench_printf(b, "  while (%s > %u || %s == %u) {\n    %s--;\n  }\n\n", x, bench_rand(b, 99),
+        x, bench_rand(b, 9), x);
+    bench_printf(b, "  printf(\"%s=%%d\\n\", %s);\n  return %s * %u.%u;\n}\n\n", x, x, x,
+        bench_rand(b, 10), bench_rand(b, 10));
+  }
+}
+
+static void bench_gen_toml(struct bench_buf *b)
+{
+  unsigned int sec = 0;
+
+  while (b->len + 512 < b->cap) {
+    bench_printf(b, "# %s settings\n[%s_%u]\n", BENCH_WORD(b), BENCH_WORD(b), sec++);
+    bench_printf(b, "%s = \"%s-%s\"\n", BENCH_WORD(b), BENCH_WORD(b), BENCH_WORD(b));
+    bench_printf(b, "%s = %u\n", BENCH_WORD(b), bench_rand(b, 65536));
+    bench_printf(b, "%s = %u.%u\n", BENCH_WORD(b), bench_rand(b, 100), bench_rand(b, 1000));
+    bench_printf(b, "enabled = %s   # toggled by %s\n", bench_rand(b, 2) ? "true" : "false",
+        BENCH_WORD(b));
+    bench_printf(b, "%s = [ %u, %u, %u ]\n\n", BENCH_WORD(b), bench_rand(b, 10),
+        bench_rand(b, 100), bench_rand(b, 1000));
+  }
+}
+
+static void bench_gen_numeric(struct bench_buf *b)
+{
+  unsigned int col = 0;
+
+  while (b->len + 64 < b->cap) {
+    switch (bench_rand(b, 4)) {
+      case 0: bench_printf(b, "%u", bench_rand(b, 10)); break;
+      case 1: bench_printf(b, "%u", bench_rand(b, 32768) * 1000u + bench_rand(b, 1000)); break;
+      case 2: bench_printf(b, "%u.%u", bench_rand(b, 1000), bench_rand(b, 100000)); break;
+      case 3: bench_printf(b, "%u.%ue%u", bench_rand(b, 10), bench_rand(b, 1000), bench_rand(b, 30)); break;
+    }
+    bench_puts(b, (++col % 12 == 0) ? "\n" : ", ");
+  }
+  bench_puts(b, "\n");
+}
+
+static void bench_gen_comments(struct bench_buf *b)
+{
+  while (b->len + 512 < b->cap) {
+    unsigned int i, n = 4 + bench_rand(b, 12);
+
+    bench_puts(b, "/*\n");
+    for (i = 0; i < n; i++) {
+      bench_printf(b, " * %s %s %s, %s; %s (%s) %s.\n", BENCH_WORD(b), BENCH_WORD(b),
+          BENCH_WORD(b), BENCH_WORD(b), BENCH_WORD(b), BENCH_WORD(b), BENCH_WORD(b));
+    }
+    bench_puts(b, " */\n");
+    bench_printf(b, "%s = %u; // %s %s %s\n", BENCH_WORD(b), bench_rand(b, 100),
+        BENCH_WORD(b), BENCH_WORD(b), BENCH_WORD(b));
+    bench_printf(b, "# %s %s %s %s\n\n", BENCH_WORD(b), BENCH_WORD(b), BENCH_WORD(b), BENCH_WORD(b));
+  }
+}
+
+static void bench_gen_strings(struct bench_buf *b)
+{
+  while (b->len + 4096 < b->cap) {
+    unsigned int i, n = 16 + bench_rand(b, 300);
+
+    bench_printf(b, "%s = \"", BENCH_WORD(b));
+    for (i = 0; i < n; i++) {
+      switch (bench_rand(b, 16)) {
+        case 0: bench_puts(b, "\\n"); break;
+        case 1: bench_puts(b, "\\t"); break;
+        case 2: bench_puts(b, "\\\""); break;
+        case 3: bench_puts(b, "\\\\"); break;
+        default:
+          bench_puts(b, BENCH_WORD(b));
+          bench_puts(b, " ");
+          break;
+      }
+    }
+    bench_puts(b, "\";\n");
+  }
+}
+
+static const char *const bench_intl_words[] = {
+  "größe", "länge", "naïve", "café", "πλάτος", "ύψος", "имя", "значение",
+  "名前", "長さ", "値", "数量", "이름", "크기", "नाम", "مقدار",
+};
+
+#define BENCH_INTL_WORD(b) \
+  (bench_intl_words[bench_rand((b), sizeof bench_intl_words / sizeof bench_intl_words[0])])
+
+/* The toml corpus with every other name in UTF-8 */
+static void bench_gen_unicode(struct bench_buf *b)
+{
+  unsigned int sec = 0;
+
+  while (b->len + 512 < b->cap) {
+    bench_printf(b, "# %s settings\n[%s_%u]\n", BENCH_INTL_WORD(b), BENCH_INTL_WORD(b), sec++);
+    bench_printf(b, "%s = \"%s-%s\"\n", BENCH_INTL_WORD(b), BENCH_INTL_WORD(b), BENCH_WORD(b));
+    bench_printf(b, "%s = %u\n", BENCH_WORD(b), bench_rand(b, 65536));
+    bench_printf(b, "%s_%s = %u.%u\n", BENCH_INTL_WORD(b), BENCH_WORD(b), bench_rand(b, 100),
+        bench_rand(b, 1000));
+    bench_printf(b, "enabled = %s   # toggled by %s\n", bench_rand(b, 2) ? "true" : "false",
+        BENCH_INTL_WORD(b));
+    bench_printf(b, "%s = [ %u, %u, %u ]\n\n", BENCH_INTL_WORD(b), bench_rand(b, 10),
+        bench_rand(b, 100), bench_rand(b, 1000));
+  }
+}
+
+static const struct {
+  const char *name;
+  void (*gen)(struct bench_buf *b);
+} bench_corpora[] = {
+  { "json",     bench_gen_json },
+  { "c",        bench_gen_c },
+  { "toml",     bench_gen_toml },
+  { "numeric",  bench_gen_numeric },
+  { "comments", bench_gen_comments },
+  { "strings",  bench_gen_strings },
+  { "unicode",  bench_gen_unicode },
+};
+
+#define BENCH_NUM_CORPORA (sizeof bench_corpora / sizeof bench_corpora[0])
+
+static int bench_generate(const char *dir)
+{
+  static char data[BENCH_CORPUS_SIZE];
+  unsigned int i;
+
+  for (i = 0; i < BENCH_NUM_CORPORA; i++) {
+    struct bench_buf b = { data, 0, sizeof data, 1 };
+    char path[1024];
+    FILE *f;
+
+    bench_corpora[i].gen(&b);
+
+    snprintf(path, sizeof path, "%s/%s.txt", dir, bench_corpora[i].name);
+    if ((f = fopen(path, "wb")) == NULL) {
+      perror(path);
+      return EXIT_FAILURE;
+    }
+    fwrite(b.data, 1, b.len, f);
+    if (fclose(f) != 0) {
+      perror(path);
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+/* Measurement */
+
+static double bench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static unsigned long long bench_cycles(void)
+{
+#if GLEX_BENCH_HAVE_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static int bench_load(struct glex_bench_input *in, const char *dir, const char *name)
+{
+  static char path[BENCH_NUM_CORPORA][1024];
+  static unsigned int npaths;
+  unsigned char *data;
+  long len;
+  FILE *f;
+
+  snprintf(path[npaths], sizeof path[npaths], "%s/%s.txt", dir, name);
+  if ((f = fopen(path[npaths], "rb")) == NULL) {
+    perror(path[npaths]);
+    return 0;
+  }
+
+  fseek(f, 0, SEEK_END);
+  len = ftell(f);
+  rewind(f);
+
+  if ((len < 0) || ((data = malloc(len ? len : 1)) == NULL) ||
+      (fread(data, 1, len, f) != (size_t)len)) {
+    fprintf(stderr, "%s: can't read corpus\n", path[npaths]);
+    fclose(f);
+    return 0;
+  }
+  fclose(f);
+
+  in->name = name;
+  in->path = path[npaths++];
+  in->data = data;
+  in->len = len;
+  return 1;
+}
+
+static int bench_measure(const struct glex_bench_variant *v, const struct glex_bench_input *in,
+    double min_secs, int json)
+{
+  struct glex_bench_count count;
+  unsigned long long c0, c1;
+  unsigned long iters = 0;
+  double t0, t1;
+  double secs, mbps, tps;
+
+  /* warm up, and count the tokens */
+  if (v->run(in, &count) != 0) {
+    fprintf(stderr, "%s: can't run on %s\n", v->name, in->name);
+    return 0;
+  }
+
+  t0 = bench_now();
+  c0 = bench_cycles();
+  do {
+    struct glex_bench_count c;
+    v->run(in, &c);
+    iters++;
+    t1 = bench_now();
+  } while (t1 - t0 < min_secs);
+  c1 = bench_cycles();
+
+  secs = t1 - t0;
+  mbps = (double)in->len * iters / secs / 1e6;
+  tps = (double)count.tokens * iters / secs;
+
+  if (json) {
+    printf("{\"variant\":\"%s\",\"backend\":\"%s\",\"engine\":\"%s\","
+        "\"floats\":%d,\"comments\":%d,\"pairs\":%d,\"keywords\":%d,"
+        "\"corpus\":\"%s\",\"bytes\":%lu,\"tokens\":%lu,\"errors\":%lu,"
+        "\"iterations\":%lu,\"seconds\":%.6f,\"mb_per_s\":%.2f,\"tokens_per_s\":%.0f,",
+        v->name, v->backend, v->engine, v->floats, v->comments, v->pairs, v->keywords,
+        in->name, (unsigned long)in->len, (unsigned long)count.tokens,
+        (unsigned long)count.errors, iters, secs, mbps, tps);
+#if GLEX_BENCH_HAVE_TSC
+    printf("\"cycles_per_byte\":%.3f}\n", (double)(c1 - c0) / ((double)in->len * iters));
+#else
+    printf("\"cycles_per_byte\":null}\n");
+#endif
+  } else {
+    printf("%s\t%s\t%s\t%d\t%d\t%d\t%d\t%s\t%lu\t%lu\t%lu\t%lu\t%.6f\t%.2f\t%.0f\t",
+        v->name, v->backend, v->engine, v->floats, v->comments, v->pairs, v->keywords,
+        in->name, (unsigned long)in->len, (unsigned long)count.tokens,
+        (unsigned long)count.errors, iters, secs, mbps, tps);
+#if GLEX_BENCH_HAVE_TSC
+    printf("%.3f\n", (double)(c1 - c0) / ((double)in->len * iters));
+#else
+    printf("NA\n");
+#endif
+  }
+  (void)c0;
+  (void)c1;
+
+  fflush(stdout);
+  return 1;
+}
+
+static void usage(const char *prog)
+{
+  fprintf(stderr, "usage: %s [-j] [-t seconds] [-d dir] [-v variant] [-c corpus]\n"
+      "       %s -g dir\n", prog, prog);
+}
+
+int main(int argc, char **argv)
+{
+  struct glex_bench_input inputs[BENCH_NUM_CORPORA];
+  const char *dir = "bench", *vfilter = NULL, *cfilter = NULL;
+  double min_secs = 0.25;
+  int json = 0, i;
+  unsigned int v, c, ninputs = 0;
+
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-j") == 0) {
+      json = 1;
+    } else if ((strcmp(argv[i], "-g") == 0) && (i+1 < argc)) {
+      return bench_generate(argv[i+1]);
+    } else if ((strcmp(argv[i], "-t") == 0) && (i+1 < argc)) {
+      min_secs = atof(argv[++i]);
+    } else if ((strcmp(argv[i], "-d") == 0) && (i+1 < argc)) {
+      dir = argv[++i];
+    } else if ((strcmp(argv[i], "-v") == 0) && (i+1 < argc)) {
+      vfilter = argv[++i];
+    } else if ((strcmp(argv[i], "-c") == 0) && (i+1 < argc)) {
+      cfilter = argv[++i];
+    } else {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  for (c = 0; c < BENCH_NUM_CORPORA; c++) {
+    if (cfilter && !strstr(bench_corpora[c].name, cfilter)) { continue; }
+    if (!bench_load(&inputs[ninputs], dir, bench_corpora[c].name)) {
+      return EXIT_FAILURE;
+    }
+    ninputs++;
+  }
+
+  if (!json) {
+    printf("variant\tbackend\tengine\tfloats\tcomments\tpairs\tkeywords\tcorpus\tbytes\t"
+        "tokens\terrors\titerations\tseconds\tmb_per_s\ttokens_per_s\tcycles_per_byte\n");
+  }
+
+  for (v = 0; v < BENCH_NUM_VARIANTS; v++) {
+    if (vfilter && !strstr(bench_variants[v]->name, vfilter)) { continue; }
+    for (c = 0; c < ninputs; c++) {
+      if (!bench_measure(bench_variants[v], &inputs[c], min_secs, json)) {
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,48 @@
+#ifndef GLEX_BENCH_H
+#define GLEX_BENCH_H
+
+/* glex_bench: throughput of GenLexer across input backends and
+ * configurations.
+ *
+ * Since glex.h is configured at compile time, every combination that is
+ * measured is its own translation unit: glex_bench_lexer.c compiled with
+ * a different set of -D options (see the Makefile).  Each exports a
+ * struct glex_bench_variant that glex_bench.c runs over every corpus.
+ */
+
+#include <stddef.h>
+
+/* Input backends */
+#define GLEX_BENCH_IO_MEMORY      1  /* GENLEX_CONFIG_MEMORY */
+#define GLEX_BENCH_IO_BYTESTREAM  2  /* user GENLEX_GETC over a byte array */
+#define GLEX_BENCH_IO_STDIO       3  /* getc() on a FILE * */
+#define GLEX_BENCH_IO_STREAM      4  /* GENLEX_CONFIG_STREAM */
+
+struct glex_bench_input {
+  const char *name;            /* corpus name */
+  const char *path;            /* file the corpus was read from */
+  const unsigned char *data;
+  size_t len;
+};
+
+struct glex_bench_count {
+  size_t tokens;
+  size_t errors;
+};
+
+struct glex_bench_variant {
+  const char *name;
+  const char *backend;
+  const char *engine;          /* macro, dfa, kinds, runtime, ... */
+  int floats;
+  int comments;
+  int pairs;
+  int keywords;
+
+  /* Lexes the whole input once.  Returns 0, or -1 if the input couldn't
+   * be set up.
+   */
+  int (*run)(const struct glex_bench_input *in, struct glex_bench_count *count);
+};
+
+#endif /* GLEX_BENCH_H */
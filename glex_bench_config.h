@@ -0,0 +1,182 @@
+#ifndef GLEX_BENCH_CONFIG_H
+#define GLEX_BENCH_CONFIG_H
+
+/* Lexer configuration measured by glex_bench.  The defaults give the
+ * full configuration on the memory backend; the Makefile builds the other
+ * variants by overriding the knobs below.  glexgen is built against the
+ * defaults for the dfa variant.
+ */
+
+#include <stdio.h>
+#include <ctype.h>
+
+#include "glex_bench.h"
+
+#if !defined(GLEX_BENCH_IO)
+#  define GLEX_BENCH_IO GLEX_BENCH_IO_MEMORY
+#endif
+
+#if !defined(GLEX_BENCH_FLOATS)
+#  define GLEX_BENCH_FLOATS 1
+#endif
+
+#if !defined(GLEX_BENCH_COMMENTS)
+#  define GLEX_BENCH_COMMENTS 1
+#endif
+
+#if !defined(GLEX_BENCH_PAIRS)
+#  define GLEX_BENCH_PAIRS 1
+#endif
+
+/* Lex through glex_index.h instead of gen_lexer_next_token() */
+#if !defined(GLEX_BENCH_INDEX)
+#  define GLEX_BENCH_INDEX 0
+#endif
+
+/* Lex on a glex_pipeline.h producer thread and count on this one */
+#if !defined(GLEX_BENCH_PIPELINE)
+#  define GLEX_BENCH_PIPELINE 0
+#endif
+
+/* Pack the tokens with glex_packed.h, then decode them to count */
+#if !defined(GLEX_BENCH_PACKED)
+#  define GLEX_BENCH_PACKED 0
+#endif
+
+/* Count the tokens in gen_lexer_run() handlers (glex_run.h) */
+#if !defined(GLEX_BENCH_RUN)
+#  define GLEX_BENCH_RUN 0
+#endif
+
+/* Accept UTF-8 identifiers (GENLEX_CONFIG_UTF8) */
+#if !defined(GLEX_BENCH_UTF8)
+#  define GLEX_BENCH_UTF8 0
+#endif
+
+/* Number of keywords: 0, 8 or 64 */
+#if !defined(GLEX_BENCH_KEYWORDS)
+#  define GLEX_BENCH_KEYWORDS 8
+#endif
+
+/* Lexical configuration, shared with the runtime variant */
+
+#define GLEX_BENCH_LITERALS  "(){}[];,.:=+-*/%<>!&|^~?#"
+
+#define GLEX_BENCH_ID_TOKEN      1024
+#define GLEX_BENCH_STRING_TOKEN  1025
+#define GLEX_BENCH_INT_TOKEN     1026
+#define GLEX_BENCH_FLOAT_TOKEN   1027
+#define GLEX_BENCH_COMMENT_TOKEN 1028
+
+#define GLEX_BENCH_PAIR_LIST {                    \
+  { "==", 512 }, { "!=", 513 }, { "<=", 514 },   \
+  { ">=", 515 }, { "&&", 516 }, { "||", 517 },   \
+  { "++", 518 }, { "--", 519 }, { "->", 520 },   \
+  { "+=", 521 }, { "-=", 522 }, { "<<", 523 },   \
+  { ">>", 524 },                                 \
+}
+
+#define GLEX_BENCH_COMMENT_LIST { { "/*", "*/" }, { "//", "\n" }, { "#", "\n" } }
+
+#define GLEX_BENCH_KEYWORDS_8                                       \
+  { "if", 1100 }, { "else", 1101 }, { "while", 1102 },             \
+  { "for", 1103 }, { "return", 1104 }, { "int", 1105 },            \
+  { "true", 1106 }, { "false", 1107 },
+
+#define GLEX_BENCH_KEYWORDS_64                                      \
+  GLEX_BENCH_KEYWORDS_8                                             \
+  { "auto", 1108 }, { "break", 1109 }, { "case", 1110 },           \
+  { "char", 1111 }, { "const", 1112 }, { "continue", 1113 },       \
+  { "default", 1114 }, { "do", 1115 }, { "double", 1116 },         \
+  { "enum", 1117 }, { "extern", 1118 }, { "float", 1119 },         \
+  { "goto", 1120 }, { "inline", 1121 }, { "long", 1122 },          \
+  { "register", 1123 }, { "restrict", 1124 }, { "short", 1125 },   \
+  { "signed", 1126 }, { "sizeof", 1127 }, { "static", 1128 },      \
+  { "struct", 1129 }, { "switch", 1130 }, { "typedef", 1131 },     \
+  { "union", 1132 }, { "unsigned", 1133 }, { "void", 1134 },       \
+  { "volatile", 1135 }, { "null", 1136 }, { "nil", 1137 },         \
+  { "and", 1138 }, { "or", 1139 }, { "not", 1140 },                \
+  { "in", 1141 }, { "is", 1142 }, { "let", 1143 },                 \
+  { "var", 1144 }, { "fn", 1145 }, { "func", 1146 },               \
+  { "def", 1147 }, { "class", 1148 }, { "import", 1149 },          \
+  { "from", 1150 }, { "as", 1151 }, { "try", 1152 },               \
+  { "catch", 1153 }, { "throw", 1154 }, { "new", 1155 },           \
+  { "this", 1156 }, { "self", 1157 }, { "yield", 1158 },           \
+  { "async", 1159 }, { "await", 1160 }, { "match", 1161 },         \
+  { "loop", 1162 }, { "pub", 1163 },
+
+#if GLEX_BENCH_KEYWORDS == 0
+#  define GLEX_BENCH_KEYWORD_LIST {}
+#elif GLEX_BENCH_KEYWORDS == 8
+#  define GLEX_BENCH_KEYWORD_LIST { GLEX_BENCH_KEYWORDS_8 }
+#elif GLEX_BENCH_KEYWORDS == 64
+#  define GLEX_BENCH_KEYWORD_LIST { GLEX_BENCH_KEYWORDS_64 }
+#else
+#  error GLEX_BENCH_KEYWORDS must be 0, 8 or 64
+#endif
+
+/* Long enough for the long-string corpus */
+#define GENLEX_STRING_MAX 4096
+
+#if GLEX_BENCH_FLOATS
+#  define GENLEX_CONFIG_FLOATS 1
+#endif
+
+#if GLEX_BENCH_UTF8
+#  define GENLEX_CONFIG_UTF8 1
+#endif
+
+#if GLEX_BENCH_IO == GLEX_BENCH_IO_MEMORY
+#  define GENLEX_CONFIG_MEMORY 1
+#elif GLEX_BENCH_IO == GLEX_BENCH_IO_STREAM
+#  define GENLEX_CONFIG_STREAM 1
+#elif GLEX_BENCH_IO == GLEX_BENCH_IO_STDIO
+#  define GENLEX_GETC(ctx) (getc(ctx))
+#  define GENLEX_UNGETC(ch,ctx) (ungetc(ch,ctx))
+#elif GLEX_BENCH_IO == GLEX_BENCH_IO_BYTESTREAM
+struct glex_bench_bytes {
+  const unsigned char *data;
+  size_t len;
+  size_t pos;
+};
+
+static int glex_bench_bytes_getc(struct glex_bench_bytes *b)
+{
+  if (b->pos >= b->len) { return -1; }
+  return b->data[b->pos++];
+}
+
+static void glex_bench_bytes_ungetc(int c, struct glex_bench_bytes *b)
+{
+  if (b->pos > 0) { b->pos--; }
+}
+
+#  define GENLEX_IO_T struct glex_bench_bytes *
+#  define GENLEX_GETC(ctx) (glex_bench_bytes_getc(ctx))
+#  define GENLEX_UNGETC(ch,ctx) (glex_bench_bytes_ungetc(ch,ctx))
+#endif
+
+#if GLEX_BENCH_RUNTIME
+#  define GENLEX_CONFIG_RUNTIME 1
+#else
+#  define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isdigit(ch)))
+#  define GENLEX_LITERALS     GLEX_BENCH_LITERALS
+
+#  define GENLEX_ID_TOKEN     GLEX_BENCH_ID_TOKEN
+#  define GENLEX_STRING_TOKEN GLEX_BENCH_STRING_TOKEN
+#  define GENLEX_INT_TOKEN    GLEX_BENCH_INT_TOKEN
+#  define GENLEX_FLOAT_TOKEN  GLEX_BENCH_FLOAT_TOKEN
+
+#  define GENLEX_KEYWORDS     GLEX_BENCH_KEYWORD_LIST
+
+#  if GLEX_BENCH_PAIRS
+#    define GENLEX_LITERAL_PAIRS GLEX_BENCH_PAIR_LIST
+#  endif
+
+#  if GLEX_BENCH_COMMENTS
+#    define GENLEX_COMMENT_PAIRS GLEX_BENCH_COMMENT_LIST
+#    define GENLEX_COMMENT_TOKEN GLEX_BENCH_COMMENT_TOKEN
+#  endif
+#endif
+
+#endif /* GLEX_BENCH_CONFIG_H */
@@ -0,0 +1,55 @@
+/* glex_bench_cxx.cpp: the glex_bench variant for glex.hpp, over the
+ * configuration of the memory_full variant.
+ */
+
+#include <cstdlib>
+#include <cstdio>
+
+#define GLEX_BENCH_RUNTIME 1
+#include "glex_bench_config.h"
+#include "glex.hpp"
+
+/* glex_bench_config.h lists, as a config type */
+struct bench_config : glex::config {
+  static constexpr std::string_view literals = GLEX_BENCH_LITERALS;
+  static constexpr glex::keyword keywords[] = { GLEX_BENCH_KEYWORDS_8 };
+  static constexpr glex::pair pairs[] = GLEX_BENCH_PAIR_LIST;
+  static constexpr glex::comment comments[] = GLEX_BENCH_COMMENT_LIST;
+
+  static constexpr int id_token = GLEX_BENCH_ID_TOKEN;
+  static constexpr int string_token = GLEX_BENCH_STRING_TOKEN;
+  static constexpr int int_token = GLEX_BENCH_INT_TOKEN;
+  static constexpr int float_token = GLEX_BENCH_FLOAT_TOKEN;
+  static constexpr int comment_token = GLEX_BENCH_COMMENT_TOKEN;
+};
+
+static int bench_run(const struct glex_bench_input *in, struct glex_bench_count *count)
+{
+  glex::lexer<bench_config> lx({ (const char *)in->data, in->len });
+  GENLEX_POS_T last_off = (GENLEX_POS_T)-1;
+  glex::token t;
+
+  count->tokens = 0;
+  count->errors = 0;
+
+  while ((t = lx.next()).kind != 0) {
+    count->tokens++;
+    if (t.kind < 0) {
+      count->errors++;
+
+      /* don't spin on an error that consumes nothing */
+      if (lx.c_lexer()->off == last_off) { break; }
+      last_off = lx.c_lexer()->off;
+    }
+  }
+
+  return 0;
+}
+
+extern "C" const struct glex_bench_variant glex_bench_memory_cxx = {
+  "memory_cxx",
+  "memory",
+  "cxx",
+  1, 1, 1, 8,
+  bench_run,
+};
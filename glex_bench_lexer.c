@@ -0,0 +1,279 @@
+/* glex_bench_lexer.c: one glex_bench variant.  Compiled once per
+ * variant, with GLEX_BENCH_VARIANT naming the exported variant and the
+ * GLEX_BENCH_* knobs of glex_bench_config.h selecting what it measures.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#include "glex_bench_config.h"
+#include "glex.h"
+
+#if GLEX_BENCH_INDEX
+#  include "glex_index.h"
+#endif
+
+#if GLEX_BENCH_PIPELINE
+#  include "glex_pipeline.h"
+#endif
+
+#if GLEX_BENCH_PACKED
+#  include "glex_packed.h"
+#endif
+
+#if !defined(GLEX_BENCH_VARIANT) || !defined(GLEX_BENCH_NAME)
+#  error GLEX_BENCH_VARIANT and GLEX_BENCH_NAME must be defined
+#endif
+
+#if GLEX_BENCH_INDEX
+#  define GLEX_BENCH_ENGINE "index"
+#elif GLEX_BENCH_PIPELINE
+#  define GLEX_BENCH_ENGINE "pipeline"
+#elif GLEX_BENCH_PACKED
+#  define GLEX_BENCH_ENGINE "packed"
+#elif GLEX_BENCH_RUN
+#  define GLEX_BENCH_ENGINE "run"
+#elif GLEX_BENCH_RUNTIME
+#  define GLEX_BENCH_ENGINE "runtime"
+#elif defined(GENLEX_DFA_HEADER)
+#  define GLEX_BENCH_ENGINE "dfa"
+#elif GENLEX_CONFIG_KIND_TABLE
+#  define GLEX_BENCH_ENGINE "kinds"
+#else
+#  define GLEX_BENCH_ENGINE "macro"
+#endif
+
+#if GLEX_BENCH_IO == GLEX_BENCH_IO_MEMORY
+#  define GLEX_BENCH_BACKEND "memory"
+#elif GLEX_BENCH_IO == GLEX_BENCH_IO_BYTESTREAM
+#  define GLEX_BENCH_BACKEND "bytestream"
+#elif GLEX_BENCH_IO == GLEX_BENCH_IO_STDIO
+#  define GLEX_BENCH_BACKEND "stdio"
+#elif GLEX_BENCH_IO == GLEX_BENCH_IO_STREAM
+#  define GLEX_BENCH_BACKEND "stream"
+#endif
+
+#if GLEX_BENCH_RUNTIME
+static const struct gen_lexer_keyword bench_keywords[] = GLEX_BENCH_KEYWORD_LIST;
+static const struct gen_lexer_literal_pair bench_pairs[] = GLEX_BENCH_PAIR_LIST;
+static const struct gen_lexer_comment_pairs bench_comments[] = GLEX_BENCH_COMMENT_LIST;
+
+static const struct gen_lexer_config bench_config = {
+  GLEX_BENCH_LITERALS,
+  bench_pairs, GLEX_BENCH_PAIRS ? sizeof bench_pairs / sizeof bench_pairs[0] : 0,
+  bench_keywords, sizeof bench_keywords / sizeof bench_keywords[0],
+  bench_comments, GLEX_BENCH_COMMENTS ? sizeof bench_comments / sizeof bench_comments[0] : 0,
+  GENLEX_ALPHA "_", GENLEX_ALPHA "_" GENLEX_DIGITS, NULL,
+  GLEX_BENCH_ID_TOKEN, GLEX_BENCH_STRING_TOKEN, GLEX_BENCH_INT_TOKEN,
+  GLEX_BENCH_FLOATS ? GLEX_BENCH_FLOAT_TOKEN : 0,
+  GLEX_BENCH_COMMENTS ? GLEX_BENCH_COMMENT_TOKEN : 0,
+};
+
+/* compiled on first use, outside of the timed region */
+static struct gen_lexer_tables bench_tables;
+static int bench_tables_ready;
+#endif
+
+#if GLEX_BENCH_IO == GLEX_BENCH_IO_STREAM
+struct bench_reader {
+  const unsigned char *data;
+  size_t len;
+  size_t pos;
+};
+
+static size_t bench_read(void *arg, unsigned char *dst, size_t n)
+{
+  struct bench_reader *r = arg;
+
+  if (n > r->len - r->pos) { n = r->len - r->pos; }
+  memcpy(dst, r->data + r->pos, n);
+  r->pos += n;
+  return n;
+}
+#endif
+
+#if GLEX_BENCH_PIPELINE
+/* The pipeline ends at the first error, so errors is 0 or 1 */
+static int bench_lex(struct gen_lexer *lexer, struct glex_bench_count *count)
+{
+  struct gen_lexer_pipeline pl;
+  const struct gen_lexer_pipeline_token *t;
+  int tok;
+
+  count->tokens = 0;
+  count->errors = 0;
+
+  if (gen_lexer_pipeline_start(&pl, lexer) != 0) { return -1; }
+  while ((tok = gen_lexer_pipeline_next(&pl, &t)) != 0) {
+    count->tokens++;
+    if (tok < 0) {
+      count->errors++;
+      break;
+    }
+  }
+  gen_lexer_pipeline_finish(&pl);
+
+  return 0;
+}
+#elif GLEX_BENCH_PACKED
+/* both directions are timed; the stream's storage is reused */
+static struct gen_lexer_packed bench_packed;
+
+static int bench_lex(struct gen_lexer *lexer, struct glex_bench_count *count)
+{
+  struct gen_lexer_packed_iter it;
+  struct gen_lexer_token rec;
+
+  count->tokens = 0;
+  count->errors = 0;
+
+  gen_lexer_packed_clear(&bench_packed);
+  if (gen_lexer_packed_lex(&bench_packed, lexer) != 0) { return -1; }
+
+  gen_lexer_packed_seek(&bench_packed, &it, 0);
+  while (gen_lexer_packed_next(&it, &rec)) {
+    count->tokens++;
+    if (rec.tok < 0) { count->errors++; }
+  }
+
+  return 0;
+}
+#elif GLEX_BENCH_RUN
+struct bench_run_count {
+  struct glex_bench_count *count;
+  GENLEX_POS_T last_off;
+};
+
+static inline int bench_on_error(struct gen_lexer *lexer, struct bench_run_count *rc)
+{
+  rc->count->tokens++;
+  rc->count->errors++;
+
+  /* don't spin on an error that consumes nothing */
+  if (lexer->off == rc->last_off) { return 1; }
+  rc->last_off = lexer->off;
+  return 0;
+}
+
+#define GENLEX_ON_TOKEN(ctx,tok)  ((ctx)->count->tokens++, 0)
+#define GENLEX_ON_ERROR(ctx,err)  bench_on_error(lexer, (ctx))
+#define GENLEX_RUN_CTX_T struct bench_run_count *
+#include "glex_run.h"
+
+static int bench_lex(struct gen_lexer *lexer, struct glex_bench_count *count)
+{
+  struct bench_run_count rc;
+
+  count->tokens = 0;
+  count->errors = 0;
+  rc.count = count;
+  rc.last_off = (GENLEX_POS_T)-1;
+  gen_lexer_run(lexer, &rc);
+
+  return 0;
+}
+#else
+static int bench_lex(struct gen_lexer *lexer, struct glex_bench_count *count)
+{
+  GENLEX_POS_T last_off = (GENLEX_POS_T)-1;
+  int tok;
+
+  count->tokens = 0;
+  count->errors = 0;
+
+  while ((tok = gen_lexer_next_token(lexer)) != 0) {
+    count->tokens++;
+    if (tok < 0) {
+      count->errors++;
+
+      /* don't spin on an error that consumes nothing */
+      if (lexer->off == last_off) { break; }
+      last_off = lexer->off;
+    }
+  }
+
+  return 0;
+}
+#endif
+
+#if GLEX_BENCH_INDEX
+/* both stages are timed; the bitmaps and token array are reused */
+static struct gen_lexer_index bench_index;
+static struct gen_lexer_tokens bench_toks;
+
+static int bench_run(const struct glex_bench_input *in, struct glex_bench_count *count)
+{
+  size_t i;
+
+  bench_toks.len = 0;
+  if ((gen_lexer_index_build(&bench_index, in->data, in->len) != 0) ||
+      (gen_lexer_index_lex(&bench_index, &bench_toks) != 0)) {
+    return -1;
+  }
+
+  count->tokens = bench_toks.len;
+  count->errors = 0;
+  for (i = 0; i < bench_toks.len; i++) {
+    if (bench_toks.toks[i].tok < 0) { count->errors++; }
+  }
+
+  return 0;
+}
+#else
+static int bench_run(const struct glex_bench_input *in, struct glex_bench_count *count)
+{
+  struct gen_lexer lexer;
+  int ret;
+
+#if GLEX_BENCH_RUNTIME
+  if (!bench_tables_ready) {
+    if (gen_lexer_compile(&bench_tables, &bench_config) != 0) { return -1; }
+    bench_tables_ready = 1;
+  }
+#  define bench_initialize(lx,ctx) gen_lexer_initialize_with((lx), &bench_tables, (ctx))
+#else
+#  define bench_initialize(lx,ctx) gen_lexer_initialize((lx), (ctx))
+#endif
+
+#if GLEX_BENCH_IO == GLEX_BENCH_IO_MEMORY
+  struct gen_lexer_membuf mb = { in->data, in->len, 0 };
+
+  bench_initialize(&lexer, &mb);
+  ret = bench_lex(&lexer, count);
+#elif GLEX_BENCH_IO == GLEX_BENCH_IO_BYTESTREAM
+  struct glex_bench_bytes bytes = { in->data, in->len, 0 };
+
+  bench_initialize(&lexer, &bytes);
+  ret = bench_lex(&lexer, count);
+#elif GLEX_BENCH_IO == GLEX_BENCH_IO_STDIO
+  FILE *f = fopen(in->path, "rb");
+
+  if (f == NULL) { return -1; }
+  bench_initialize(&lexer, f);
+  ret = bench_lex(&lexer, count);
+  fclose(f);
+#elif GLEX_BENCH_IO == GLEX_BENCH_IO_STREAM
+  struct bench_reader rd = { in->data, in->len, 0 };
+  struct gen_lexer_stream st;
+
+  if (!gen_lexer_stream_init(&st, bench_read, &rd, 4096)) { return -1; }
+  bench_initialize(&lexer, &st);
+  ret = bench_lex(&lexer, count);
+  gen_lexer_stream_free(&st);
+#endif
+
+  return ret;
+}
+#endif /* GLEX_BENCH_INDEX */
+
+const struct glex_bench_variant GLEX_BENCH_VARIANT = {
+  GLEX_BENCH_NAME,
+  GLEX_BENCH_BACKEND,
+  GLEX_BENCH_ENGINE,
+  GLEX_BENCH_FLOATS,
+  GLEX_BENCH_COMMENTS,
+  GLEX_BENCH_PAIRS,
+  GLEX_BENCH_KEYWORDS,
+  bench_run,
+};
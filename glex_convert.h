@@ -0,0 +1,320 @@
+#ifndef GLEX_CONVERT_H
+#define GLEX_CONVERT_H
+
+/* Batch conversion of numeric tokens for GenLexer.
+ *
+ * This is meant to be #include'd after glex.h, in any mode.
+ *
+ *   static size_t gen_lexer_convert_numbers(const unsigned char *data, size_t len,
+ *       const struct gen_lexer_token *toks, size_t n,
+ *       union gen_lexer_value *vals, int *errs);
+ *
+ *     Converts the text of each of toks[0..n), data[off..end), as
+ *     gen_lexer_next_token() converts an integer or float token, into
+ *     vals[i], and sets errs[i] to 0.  Only off and end of the tokens
+ *     are used (end is clamped to len, as the lexer counts a read of
+ *     the end of the input), so the spans may come from a token array,
+ *     a packed stream or anywhere else.  A span with a '.', 'e' or 'E'
+ *     is a float with GENLEX_CONFIG_FLOATS (a decimal with
+ *     GENLEX_CONFIG_DECIMAL), and anything else an integer.  If the
+ *     lexer would have returned an error for the text instead, errs[i]
+ *     is that error (GENLEX_ERR_INVALID_INTEGER,
+ *     GENLEX_ERR_INTEGER_OVERFLOW, GENLEX_ERR_FLOAT_OVERFLOW, or
+ *     GENLEX_ERR_BUFFER_OVERFLOW for spans of GENLEX_STRING_MAX bytes or
+ *     more) and vals[i] is 0.  Returns the number of spans without an
+ *     error.
+ *
+ * How it works:
+ *
+ * Digits are converted eight at a time: eight bytes are loaded into a
+ * 64-bit word, checked to all be digits with two masks, and combined in
+ * three multiplies, pairs into 2-digit values, those into 4-digit ones
+ * and those into the 8-digit result.  A run of fewer than eight digits
+ * is loaded with the bytes before it and those are masked to '0', so
+ * numbers of any length up to eight take the same path with no loop
+ * over their digits; only the first word of a span that starts within
+ * eight bytes of data is copied out first.  Integers of up to 19
+ * digits, which covers every value of a 64-bit long, take at most three
+ * words.
+ *
+ * Floats whose digits fit in 2^53 and whose decimal exponent is at most
+ * 22 either way are exact as a double, and so are converted by one
+ * multiply or divide by an exact power of ten, which rounds correctly.
+ * This needs GENLEX_FLOAT_T to be double and floating point evaluated
+ * in its own precision (FLT_EVAL_METHOD 0).  Other floats go through
+ * strtod(), as in the lexer.
+ */
+
+#if !defined(GLEX_H)
+#  error glex_convert.h must be included after glex.h
+#endif
+
+#include <float.h>
+
+#if defined(FLT_EVAL_METHOD) && (FLT_EVAL_METHOD == 0)
+#  define GENLEX_CONVERT_FAST_FLOATS 1
+#else
+#  define GENLEX_CONVERT_FAST_FLOATS 0
+#endif
+
+static size_t gen_lexer_convert_numbers(const unsigned char *data, size_t len,
+    const struct gen_lexer_token *toks, size_t n,
+    union gen_lexer_value *vals, int *errs);
+
+
+/* Implementation */
+
+#define GENLEX_CONVERT_ONES  0x0101010101010101ull
+
+/* Converts the k (1 to 8) digits at p.  Returns 0 if one of them isn't
+ * a digit.
+ */
+static inline int genlex_convert_word(const unsigned char *data, const unsigned char *p,
+    size_t k, unsigned long long *vp)
+{
+  unsigned long long w;
+
+  if ((size_t)(p - data) + k >= 8) {
+    memcpy(&w, p + k - 8, 8);  /* the eight bytes that end with the run */
+  } else {
+    unsigned char b[8];
+    memset(b, '0', 8);
+    memcpy(b + 8 - k, p, k);
+    memcpy(&w, b, 8);
+  }
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+  w = __builtin_bswap64(w);
+#endif
+
+  /* the first byte is the lowest; the ones before the run become '0' */
+  if (k < 8) {
+    unsigned long long keep = ~0ull << (8 * (8 - k));
+    w = (w & keep) | ('0' * GENLEX_CONVERT_ONES & ~keep);
+  }
+
+  /* 0x30-0x39 only: a high nibble of 3, and no carry out of the low
+   * nibble when 6 is added
+   */
+  if (((w & (0xf0 * GENLEX_CONVERT_ONES)) |
+       (((w + 0x06 * GENLEX_CONVERT_ONES) & (0xf0 * GENLEX_CONVERT_ONES)) >> 4)) !=
+      0x33 * GENLEX_CONVERT_ONES) {
+    return 0;
+  }
+
+  w = ((w & (0x0f * GENLEX_CONVERT_ONES)) * (10*256 + 1)) >> 8;
+  w = ((w & 0x00ff00ff00ff00ffull) * (100*65536 + 1)) >> 16;
+  *vp = (((w & 0x0000ffff0000ffffull) * (10000ull*4294967296ull + 1)) >> 32) & 0xffffffffull;
+  return 1;
+}
+
+/* Converts the k (1 to 19) digits at p */
+static inline int genlex_convert_digits(const unsigned char *data, const unsigned char *p,
+    size_t k, unsigned long long *vp)
+{
+  unsigned long long v = 0, w;
+  size_t head = k % 8;
+
+  if (head > 0) {
+    if (!genlex_convert_word(data, p, head, &v)) { return 0; }
+    p += head;
+    k -= head;
+  }
+  for (; k > 0; p += 8, k -= 8) {
+    if (!genlex_convert_word(data, p, 8, &w)) { return 0; }
+    v = v * 100000000ull + w;
+  }
+
+  *vp = v;
+  return 1;
+}
+
+static int genlex_convert_int(const unsigned char *data, const unsigned char *p, size_t k,
+    GENLEX_INT_T *vp)
+{
+  unsigned long long mag;
+  unsigned long lim;
+  long value;
+  size_t i;
+  int neg;
+
+  neg = (k > 0) && (*p == '-');
+  if (neg) { p++; k--; }
+  if (k == 0) { return GENLEX_ERR_INVALID_INTEGER; }
+
+  /* leading zeros don't count towards the 19 digits */
+  for (i = 0; (i+1 < k) && (p[i] == '0'); i++) {
+    continue;
+  }
+  p += i;
+  k -= i;
+
+  if (k > 19) {
+    for (i = 0; i < k; i++) {
+      if ((p[i] < '0') || (p[i] > '9')) { return GENLEX_ERR_INVALID_INTEGER; }
+    }
+    return GENLEX_ERR_INTEGER_OVERFLOW;
+  }
+
+  if (!genlex_convert_digits(data, p, k, &mag)) { return GENLEX_ERR_INVALID_INTEGER; }
+
+  lim = neg ? (unsigned long)LONG_MAX + 1 : (unsigned long)LONG_MAX;
+  if (mag > lim) { return GENLEX_ERR_INTEGER_OVERFLOW; }
+
+  if (!neg) {
+    value = (long)mag;
+  } else if (mag == 0) {
+    value = 0;
+  } else {
+    value = -(long)(mag - 1) - 1;
+  }
+
+  /* as in gen_lexer_read_num(): the value must fit GENLEX_INT_T */
+  *vp = (GENLEX_INT_T)value;
+  if ((long)*vp != value) { return GENLEX_ERR_INTEGER_OVERFLOW; }
+
+  return 0;
+}
+
+#if GENLEX_CONFIG_FLOATS && !GENLEX_CONFIG_DECIMAL
+/* The conversion of gen_lexer_read_num() */
+static int genlex_convert_strtod(const unsigned char *p, size_t k, GENLEX_FLOAT_T *vp)
+{
+  char s[GENLEX_STRING_MAX];
+  char *end;
+  int saved_errno, err;
+
+  memcpy(s, p, k);
+  s[k] = '\0';
+
+  saved_errno = errno;
+  errno = 0;
+  *vp = genlex_strtofloat(s, &end);
+  err = errno;
+  errno = saved_errno;
+
+  if ((k == 0) || (*end != '\0')) { return GENLEX_ERR_INVALID_INTEGER; }
+  if (err == ERANGE)              { return GENLEX_ERR_FLOAT_OVERFLOW; }
+  if (err != 0)                   { return GENLEX_ERR_UNKNOWN_ERROR; }
+  return 0;
+}
+
+static int genlex_convert_float(const unsigned char *data, const unsigned char *p, size_t k,
+    GENLEX_FLOAT_T *vp)
+{
+#if GENLEX_CONVERT_FAST_FLOATS
+  static const double pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+  };
+  const unsigned char *q = p, *e = p + k, *ip, *fp = NULL;
+  unsigned long long m, f;
+  size_t ni, nf = 0;
+  long exp10 = 0;
+  int neg;
+
+  if (sizeof(GENLEX_FLOAT_T) != sizeof(double)) { return genlex_convert_strtod(p, k, vp); }
+
+  neg = (q < e) && (*q == '-');
+  if (neg) { q++; }
+
+  for (ip = q; (q < e) && (*q >= '0') && (*q <= '9'); q++) {
+    continue;
+  }
+  ni = q - ip;
+
+  if ((q < e) && (*q == '.')) {
+    for (fp = ++q; (q < e) && (*q >= '0') && (*q <= '9'); q++) {
+      continue;
+    }
+    nf = q - fp;
+  }
+
+  if ((q < e) && ((*q == 'e') || (*q == 'E'))) {
+    int eneg = 0;
+
+    q++;
+    if ((q < e) && ((*q == '-') || (*q == '+'))) { eneg = (*q++ == '-'); }
+    if ((q == e) || (e - q > 3)) { return genlex_convert_strtod(p, k, vp); }
+    for (; (q < e) && (*q >= '0') && (*q <= '9'); q++) {
+      exp10 = 10*exp10 + (*q - '0');
+    }
+    if (eneg) { exp10 = -exp10; }
+  }
+
+  /* anything unusual is left to strtod() */
+  if ((q != e) || (ni == 0) || (ni + nf > 19)) { return genlex_convert_strtod(p, k, vp); }
+
+  if (!genlex_convert_digits(data, ip, ni, &m)) { return genlex_convert_strtod(p, k, vp); }
+  if (nf > 0) {
+    static const unsigned long long scale[] = {
+      1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+      100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull,
+      10000000000000ull, 100000000000000ull, 1000000000000000ull,
+      10000000000000000ull, 100000000000000000ull, 1000000000000000000ull,
+    };
+    if (!genlex_convert_digits(data, fp, nf, &f)) { return genlex_convert_strtod(p, k, vp); }
+    m = m * scale[nf] + f;
+    exp10 -= (long)nf;
+  }
+
+  if ((m > (1ull << 53)) || (exp10 < -22) || (exp10 > 22)) {
+    return genlex_convert_strtod(p, k, vp);
+  }
+
+  {
+    double d = (double)m;
+    d = (exp10 < 0) ? d / pow10[-exp10] : d * pow10[exp10];
+    *vp = (GENLEX_FLOAT_T)(neg ? -d : d);
+  }
+  return 0;
+#else
+  (void)data;
+  return genlex_convert_strtod(p, k, vp);
+#endif
+}
+#endif /* GENLEX_CONFIG_FLOATS && !GENLEX_CONFIG_DECIMAL */
+
+static size_t gen_lexer_convert_numbers(const unsigned char *data, size_t len,
+    const struct gen_lexer_token *toks, size_t n,
+    union gen_lexer_value *vals, int *errs)
+{
+  size_t i, ok = 0;
+
+  for (i = 0; i < n; i++) {
+    size_t off = toks[i].off, end = toks[i].end;
+    const unsigned char *p;
+    size_t k;
+    int err;
+
+    if (end > len) { end = len; }
+    if (off > end) { off = end; }
+    p = data + off;
+    k = end - off;
+
+    memset(&vals[i], 0, sizeof vals[i]);
+    if (k >= GENLEX_STRING_MAX) {
+      err = GENLEX_ERR_BUFFER_OVERFLOW;
+    }
+#if GENLEX_CONFIG_FLOATS
+    else if ((memchr(p, '.', k) != NULL) || (memchr(p, 'e', k) != NULL) ||
+             (memchr(p, 'E', k) != NULL)) {
+#  if GENLEX_CONFIG_DECIMAL
+      err = genlex_read_decimal(p, k, &vals[i].d);
+#  else
+      err = genlex_convert_float(data, p, k, &vals[i].f);
+#  endif
+    }
+#endif
+    else {
+      err = genlex_convert_int(data, p, k, &vals[i].i);
+    }
+
+    if (err != 0) { memset(&vals[i], 0, sizeof vals[i]); }
+    errs[i] = err;
+    ok += (err == 0);
+  }
+
+  return ok;
+}
+
+#endif /* GLEX_CONVERT_H */
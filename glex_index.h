@@ -0,0 +1,507 @@
+#ifndef GLEX_INDEX_H
+#define GLEX_INDEX_H
+
+/* Two-stage driver for GenLexer: indexes a memory-resident input with
+ * bitmaps, then lexes it by walking the bitmaps.
+ *
+ * This is meant to be #include'd after glex.h, which must be configured
+ * with GENLEX_CONFIG_MEMORY.
+ *
+ *   static void gen_lexer_index_init(struct gen_lexer_index *idx);
+ *   static void gen_lexer_index_free(struct gen_lexer_index *idx);
+ *
+ *     An index holds the bitmaps of one input.  It can be rebuilt for
+ *     any number of inputs; the bitmaps are reallocated only when an
+ *     input is larger than any before it.
+ *
+ *   static int gen_lexer_index_build(struct gen_lexer_index *idx,
+ *       const unsigned char *data, size_t len);
+ *
+ *     Stage 1: classifies every byte of data[0..len), 64 at a time, into
+ *     one bit per byte in each of the GENLEX_INDEX_* bitmaps.  Returns 0
+ *     or GENLEX_ERR_NO_MEMORY.  data must outlive the index.
+ *
+ *   static int gen_lexer_index_lex(const struct gen_lexer_index *idx,
+ *       struct gen_lexer_tokens *out);
+ *
+ *     Stage 2: appends every token of the indexed input to out.  The
+ *     result is identical to calling gen_lexer_next_token() on the whole
+ *     input until it returns 0, as with gen_lexer_parallel_lex().
+ *     Returns 0 or GENLEX_ERR_NO_MEMORY.
+ *
+ * How it works:
+ *
+ * Stage 1 builds five bitmaps: whitespace, symbol characters, and the
+ * '"', '\\' and '\n' bytes.  The classes come from the lexer
+ * configuration (GENLEX_IS_WHITESPACE and GENLEX_IS_SYMBOL); with SSSE3,
+ * each is looked up 16 bytes at a time from two nibble tables built from
+ * the configuration, and the fixed bytes are compared directly.
+ * Otherwise the bytes are classified through a 256 entry table and the
+ * bitmaps gathered 8 bytes at a time.  On x86 the SSSE3 code is chosen
+ * at run time.
+ *
+ * Stage 2 finds each token start by skipping to the next clear
+ * whitespace bit.  Single-character literals, strings without escapes
+ * and symbols are then finished from the bitmaps alone: a string ends
+ * at the next quote if that comes before any backslash or newline, and a
+ * symbol at the next clear symbol bit.  Lines and columns come from the
+ * newline bitmap.  Every other token (numbers, comments, literal pairs,
+ * character literals, escapes, symbols with GENLEX_CONFIG_UTF8 code
+ * points and errors) is handed to the serial lexer, positioned at the
+ * token.
+ *
+ * The index doesn't pair quotes ahead of time, as a JSON parser can:
+ * quotes inside comments and character literals, and strings that end
+ * at an error, don't pair up, so stage 2 decides which quotes open
+ * strings as it goes.
+ *
+ * GENLEX_IS_SYMBOL(ch,pos) must give the same answer for every pos > 0.
+ *
+ * Optional configuration:
+ *
+ * GENLEX_INDEX_SSSE3
+ *
+ *      #define to 0 to build stage 1 without SSSE3 on x86.
+ */
+
+#if !defined(GLEX_H)
+#  error glex_index.h must be included after glex.h
+#endif
+
+#if !GENLEX_CONFIG_MEMORY
+#  error glex_index.h requires GENLEX_CONFIG_MEMORY
+#endif
+
+#if GENLEX_CONFIG_RUNTIME || GENLEX_CONFIG_POOL || GENLEX_CONFIG_BLOBS
+#  error glex_index.h does not support GENLEX_CONFIG_RUNTIME, GENLEX_CONFIG_POOL or GENLEX_CONFIG_BLOBS
+#endif
+
+#if !defined(GENLEX_INDEX_SSSE3)
+#  if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#    define GENLEX_INDEX_SSSE3 1
+#  else
+#    define GENLEX_INDEX_SSSE3 0
+#  endif
+#endif
+
+#if GENLEX_INDEX_SSSE3
+#  include <tmmintrin.h>
+#endif
+
+/* Bitmaps of a 64 byte block, in the order they're stored */
+enum {
+  GENLEX_INDEX_WS,
+  GENLEX_INDEX_SYMBOL,
+  GENLEX_INDEX_QUOTE,
+  GENLEX_INDEX_BACKSLASH,
+  GENLEX_INDEX_NEWLINE,
+  GENLEX_INDEX_NUM
+};
+
+/* Tokens that stage 2 finishes by itself */
+enum {
+  GENLEX_INDEX_FAST_NONE,
+  GENLEX_INDEX_FAST_STRING,
+  GENLEX_INDEX_FAST_LITERAL,
+  GENLEX_INDEX_FAST_SYMBOL
+};
+
+struct gen_lexer_index {
+  const unsigned char *data;
+  size_t len;
+  size_t nblocks;
+  size_t cap;                /* blocks allocated */
+  unsigned long long *bits;  /* GENLEX_INDEX_NUM bitmaps per block */
+
+  /* classes of each byte: bit k is set if the byte belongs to bitmap k */
+  unsigned char cls[256];
+  unsigned char fast[256];   /* GENLEX_INDEX_FAST_* of a token's first byte */
+#if GENLEX_INDEX_SSSE3
+  unsigned char nib[GENLEX_INDEX_NUM][2][16];
+#endif
+};
+
+static void gen_lexer_index_init(struct gen_lexer_index *idx);
+static void gen_lexer_index_free(struct gen_lexer_index *idx);
+static int gen_lexer_index_build(struct gen_lexer_index *idx,
+    const unsigned char *data, size_t len);
+static int gen_lexer_index_lex(const struct gen_lexer_index *idx,
+    struct gen_lexer_tokens *out);
+
+
+/* Implementation */
+
+#if defined(__GNUC__)
+#  define genlex_index_ctz(x)       (__builtin_ctzll(x))
+#  define genlex_index_popcount(x)  (__builtin_popcountll(x))
+#  define genlex_index_clz(x)       (__builtin_clzll(x))
+#else
+static int genlex_index_ctz(unsigned long long x)
+{
+  int n = 0;
+  while (!(x & 1)) { x >>= 1; n++; }
+  return n;
+}
+
+static int genlex_index_popcount(unsigned long long x)
+{
+  int n = 0;
+  for (; x != 0; x &= x-1) { n++; }
+  return n;
+}
+
+static int genlex_index_clz(unsigned long long x)
+{
+  int n = 0;
+  while (!(x & (1ull << 63))) { x <<= 1; n++; }
+  return n;
+}
+#endif
+
+static void gen_lexer_index_init(struct gen_lexer_index *idx)
+{
+  idx->data = NULL;
+  idx->len = 0;
+  idx->nblocks = 0;
+  idx->cap = 0;
+  idx->bits = NULL;
+}
+
+static void gen_lexer_index_free(struct gen_lexer_index *idx)
+{
+  free(idx->bits);
+  gen_lexer_index_init(idx);
+}
+
+static void genlex_index_classes(struct gen_lexer_index *idx)
+{
+  int c;
+
+#if GENLEX_INDEX_SSSE3
+  memset(idx->nib, 0, sizeof(idx->nib));
+#endif
+
+  for (c = 0; c < 256; c++) {
+#if defined(GENLEX_DFA_HEADER)
+    unsigned int lcls = genlex_dfa_class[c];
+#else
+    unsigned int lcls = genlex_class_of(c);
+#endif
+    unsigned char cls = 0;
+
+    /* the serial lexer's tests, in its order: comments come first, and
+     * numbers before symbols
+     */
+    idx->fast[c] = GENLEX_INDEX_FAST_NONE;
+    if ((lcls & (GENLEX_CLS_WS | GENLEX_CLS_COMMENT)) || (c == '\'')) {
+      /* scanned by the lexer */
+    } else if (c == '"') {
+      idx->fast[c] = GENLEX_INDEX_FAST_STRING;
+    } else if (lcls & GENLEX_CLS_PAIR) {
+      /* scanned by the lexer */
+    } else if (lcls & GENLEX_CLS_LITERAL) {
+      idx->fast[c] = GENLEX_INDEX_FAST_LITERAL;
+    } else if (isnumber(c) || (c == '-')) {
+      /* scanned by the lexer */
+    } else if (lcls & GENLEX_CLS_SYM0) {
+      idx->fast[c] = GENLEX_INDEX_FAST_SYMBOL;
+    }
+
+    if (GENLEX_IS_WHITESPACE(c)) { cls |= 1 << GENLEX_INDEX_WS; }
+    if (GENLEX_IS_SYMBOL(c, 1))  { cls |= 1 << GENLEX_INDEX_SYMBOL; }
+    if (c == '"')                { cls |= 1 << GENLEX_INDEX_QUOTE; }
+    if (c == '\\')               { cls |= 1 << GENLEX_INDEX_BACKSLASH; }
+    if (c == '\n')               { cls |= 1 << GENLEX_INDEX_NEWLINE; }
+    idx->cls[c] = cls;
+
+#if GENLEX_INDEX_SSSE3
+    /* nib[k][h>>3][lo] has bit (h&7) set if byte (h<<4)|lo is in class k */
+    {
+      int k;
+      for (k = 0; k < GENLEX_INDEX_NUM; k++) {
+        if (cls & (1 << k)) {
+          idx->nib[k][c >> 7][c & 15] |= 1 << ((c >> 4) & 7);
+        }
+      }
+    }
+#endif
+  }
+}
+
+/* Gathers bit k of each of the 8 bytes of x into an 8 bit mask */
+static inline unsigned long long genlex_index_gather(unsigned long long x, int k)
+{
+  return (((x >> k) & 0x0101010101010101ull) * 0x0102040810204080ull) >> 56;
+}
+
+static void genlex_index_block_scalar(const struct gen_lexer_index *idx,
+    const unsigned char *p, unsigned long long *bits)
+{
+  unsigned char cls[64];
+  int i, k;
+
+  for (i = 0; i < 64; i++) {
+    cls[i] = idx->cls[p[i]];
+  }
+
+  for (k = 0; k < GENLEX_INDEX_NUM; k++) {
+    bits[k] = 0;
+  }
+
+  for (i = 0; i < 64; i += 8) {
+    unsigned long long x;
+    memcpy(&x, cls + i, 8);
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    x = __builtin_bswap64(x);
+#endif
+    for (k = 0; k < GENLEX_INDEX_NUM; k++) {
+      bits[k] |= genlex_index_gather(x, k) << i;
+    }
+  }
+}
+
+#if GENLEX_INDEX_SSSE3
+__attribute__((target("ssse3")))
+static inline unsigned int genlex_index_lookup16(const struct gen_lexer_index *idx,
+    int k, __m128i lo, __m128i high_half, __m128i bit)
+{
+  __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)idx->nib[k][0]), lo);
+  __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)idx->nib[k][1]), lo);
+  __m128i sel = _mm_or_si128(_mm_and_si128(high_half, b), _mm_andnot_si128(high_half, a));
+
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(sel, bit), bit));
+}
+
+__attribute__((target("ssse3")))
+static void genlex_index_block_ssse3(const struct gen_lexer_index *idx,
+    const unsigned char *p, unsigned long long *bits)
+{
+  const __m128i bit_of = _mm_setr_epi8(1,2,4,8,16,32,64,-128, 1,2,4,8,16,32,64,-128);
+  int i, k;
+
+  for (k = 0; k < GENLEX_INDEX_NUM; k++) {
+    bits[k] = 0;
+  }
+
+  for (i = 0; i < 64; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+    __m128i lo = _mm_and_si128(v, _mm_set1_epi8(0x0f));
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f));
+    __m128i high_half = _mm_cmpgt_epi8(hi, _mm_set1_epi8(7));
+    __m128i bit = _mm_shuffle_epi8(bit_of, hi);
+
+    bits[GENLEX_INDEX_WS] |= (unsigned long long)
+        genlex_index_lookup16(idx, GENLEX_INDEX_WS, lo, high_half, bit) << i;
+    bits[GENLEX_INDEX_SYMBOL] |= (unsigned long long)
+        genlex_index_lookup16(idx, GENLEX_INDEX_SYMBOL, lo, high_half, bit) << i;
+    bits[GENLEX_INDEX_QUOTE] |= (unsigned long long)(unsigned int)
+        _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))) << i;
+    bits[GENLEX_INDEX_BACKSLASH] |= (unsigned long long)(unsigned int)
+        _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))) << i;
+    bits[GENLEX_INDEX_NEWLINE] |= (unsigned long long)(unsigned int)
+        _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))) << i;
+  }
+}
+#endif
+
+static int gen_lexer_index_build(struct gen_lexer_index *idx,
+    const unsigned char *data, size_t len)
+{
+  void (*block)(const struct gen_lexer_index *, const unsigned char *, unsigned long long *);
+  size_t nblocks = (len + 63) / 64, b;
+
+  if (nblocks > idx->cap) {
+    unsigned long long *bits = realloc(idx->bits, nblocks * GENLEX_INDEX_NUM * sizeof(*bits));
+    if (bits == NULL) { return GENLEX_ERR_NO_MEMORY; }
+    idx->bits = bits;
+    idx->cap = nblocks;
+  }
+
+  idx->data = data;
+  idx->len = len;
+  idx->nblocks = nblocks;
+  genlex_index_classes(idx);
+
+  block = genlex_index_block_scalar;
+#if GENLEX_INDEX_SSSE3
+  if (__builtin_cpu_supports("ssse3")) { block = genlex_index_block_ssse3; }
+#endif
+
+  for (b = 0; b+1 < nblocks; b++) {
+    block(idx, data + 64*b, idx->bits + GENLEX_INDEX_NUM*b);
+  }
+
+  /* the last block is padded with bytes outside every class */
+  if (nblocks > 0) {
+    unsigned char tail[64];
+    unsigned long long *bits = idx->bits + GENLEX_INDEX_NUM*b;
+    size_t n = len - 64*b;
+    int k;
+
+    memcpy(tail, data + 64*b, n);
+    memset(tail + n, 0, 64 - n);
+    block(idx, tail, bits);
+    if (n < 64) {
+      for (k = 0; k < GENLEX_INDEX_NUM; k++) {
+        bits[k] &= (1ull << n) - 1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+/* Offset of the first byte at or after off whose bit in bitmap k is
+ * want, or idx->len if there isn't one
+ */
+static size_t genlex_index_next(const struct gen_lexer_index *idx, int k, int want, size_t off)
+{
+  size_t b = off / 64;
+  unsigned long long flip = want ? 0 : ~0ull;
+  unsigned long long m;
+
+  if (off >= idx->len) { return idx->len; }
+
+  m = (idx->bits[GENLEX_INDEX_NUM*b + k] ^ flip) & (~0ull << (off % 64));
+  while (m == 0) {
+    if (++b >= idx->nblocks) { return idx->len; }
+    m = idx->bits[GENLEX_INDEX_NUM*b + k] ^ flip;
+  }
+
+  off = 64*b + genlex_index_ctz(m);
+  return (off < idx->len) ? off : idx->len;
+}
+
+/* Non-zero if any byte in [from, to) is in class k */
+static int genlex_index_any(const struct gen_lexer_index *idx, int k, size_t from, size_t to)
+{
+  size_t b;
+
+  for (b = from / 64; 64*b < to; b++) {
+    unsigned long long m = idx->bits[GENLEX_INDEX_NUM*b + k];
+
+    if (from > 64*b)   { m &= ~0ull << (from % 64); }
+    if (to < 64*(b+1)) { m &= (1ull << (to % 64)) - 1; }
+    if (m != 0) { return 1; }
+  }
+
+  return 0;
+}
+
+/* Line bookkeeping of stage 2: line is the line at offset at, which
+ * starts at line_start
+ */
+struct genlex_index_pos {
+  size_t at;
+  GENLEX_POS_T line;
+  size_t line_start;
+};
+
+static void genlex_index_advance(const struct gen_lexer_index *idx,
+    struct genlex_index_pos *pos, size_t to)
+{
+  size_t b;
+
+  if (to > idx->len) { to = idx->len; }
+
+  for (b = pos->at / 64; (b < idx->nblocks) && (64*b < to); b++) {
+    unsigned long long m = idx->bits[GENLEX_INDEX_NUM*b + GENLEX_INDEX_NEWLINE];
+
+    if (pos->at > 64*b) { m &= ~0ull << (pos->at % 64); }
+    if (to < 64*(b+1))  { m &= (1ull << (to % 64)) - 1; }
+    if (m != 0) {
+      pos->line += genlex_index_popcount(m);
+      pos->line_start = 64*b + (63 - genlex_index_clz(m)) + 1;
+    }
+  }
+
+  if (to > pos->at) { pos->at = to; }
+}
+
+static int gen_lexer_index_lex(const struct gen_lexer_index *idx,
+    struct gen_lexer_tokens *out)
+{
+  const unsigned char *data = idx->data;
+  const size_t len = idx->len;
+  struct gen_lexer_membuf mb = { data, len, 0 };
+  struct gen_lexer lexer;
+  struct genlex_index_pos pos = { 0, 0, 0 };
+  struct gen_lexer_token rec;
+  size_t p = 0;
+
+  gen_lexer_initialize(&lexer, &mb);
+
+  for (;;) {
+    size_t end = 0;
+    int tok = 0;
+    int c;
+
+    p = genlex_index_next(idx, GENLEX_INDEX_WS, 0, p);
+    if (p >= len) { break; }
+    genlex_index_advance(idx, &pos, p);
+
+    c = data[p];
+    if (idx->fast[c] == GENLEX_INDEX_FAST_STRING) {
+      size_t q = genlex_index_next(idx, GENLEX_INDEX_QUOTE, 1, p+1);
+
+      if ((q < len) && (q - p - 1 <= GENLEX_STRING_MAX-2) &&
+          !genlex_index_any(idx, GENLEX_INDEX_BACKSLASH, p+1, q) &&
+          !genlex_index_any(idx, GENLEX_INDEX_NEWLINE, p+1, q)) {
+        tok = GENLEX_STRING_TOKEN;
+        end = q+1;
+      }
+    } else if ((idx->fast[c] == GENLEX_INDEX_FAST_LITERAL) && (p+1 < len)) {
+      /* the lexer looks for a pair after the last literal too, and counts
+       * the EOF it reads
+       */
+      tok = c;
+      end = p+1;
+    } else if (idx->fast[c] == GENLEX_INDEX_FAST_SYMBOL) {
+      size_t e = genlex_index_next(idx, GENLEX_INDEX_SYMBOL, 0, p+1);
+
+      /* a symbol that runs into the end of the input is left to the lexer,
+       * which counts the EOF it reads as part of the token, and so is one
+       * that runs into a multibyte code point
+       */
+      if ((e < len) && !GENLEX_IS_MULTIBYTE(data[e]) && (e - p <= GENLEX_STRING_MAX-2)) {
+        memcpy(lexer.buf, data+p, e-p);
+        lexer.blen = e-p;
+        tok = gen_lexer_lookup_keyword(&lexer);
+        if (tok < 0) { tok = GENLEX_ID_TOKEN; }
+        end = e;
+      }
+    }
+
+    if (tok != 0) {
+      rec.tok = tok;
+      rec.off = p;
+      rec.end = end;
+      rec.line = pos.line;
+      rec.col = p - pos.line_start;
+      rec.val = lexer.tval;
+    } else {
+      /* everything else is scanned by the serial lexer */
+      mb.pos = p;
+      lexer.off = p;
+#if !GENLEX_CONFIG_ONLY_OFFSET
+      lexer.line = pos.line;
+      lexer.col = p - pos.line_start;
+      lexer.prev_col = lexer.col;
+#endif
+
+      tok = gen_lexer_next_token(&lexer);
+      if (tok == 0) { break; }
+      gen_lexer_token_record(&lexer, tok, &rec);
+      end = lexer.off;
+    }
+
+    if (!gen_lexer_tokens_push(out, &rec)) {
+      return GENLEX_ERR_NO_MEMORY;
+    }
+    p = end;
+  }
+
+  return 0;
+}
+
+#endif /* GLEX_INDEX_H */
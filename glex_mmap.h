@@ -0,0 +1,127 @@
+#ifndef GLEX_MMAP_H
+#define GLEX_MMAP_H
+
+/* Mapped-file input for GenLexer, in bounded memory.
+ *
+ * This is meant to be #include'd after glex.h, which must be configured
+ * with GENLEX_CONFIG_MEMORY (and GENLEX_CONFIG_POS64 for files of 4 GiB
+ * and more).  POSIX only.
+ *
+ *   static int gen_lexer_mmap_open(struct gen_lexer_mmap *m, const char *path, size_t window);
+ *
+ *     Maps the file at path read-only and sets up m->mb, which is the
+ *     IO context to pass to gen_lexer_initialize().  Returns 0,
+ *     GENLEX_ERR_IO, or GENLEX_ERR_BUFFER_OVERFLOW if the file's
+ *     offsets don't fit in GENLEX_POS_T.
+ *
+ *   static void gen_lexer_mmap_release(struct gen_lexer_mmap *m, GENLEX_POS_T off);
+ *
+ *     Tells the kernel that the pages wholly before off won't be read
+ *     again, once off is at least window bytes past the last release.
+ *     Cheap enough to call after every token, with off the start of the
+ *     token (or of the oldest live mark).  The pages are read back in
+ *     from the file if the lexer does seek back over them.
+ *
+ *   static void gen_lexer_mmap_close(struct gen_lexer_mmap *m);
+ *
+ *     Unmaps the file.
+ *
+ * The whole file is mapped at once, so the address space has to hold
+ * it, but only the pages between the last release and the lexer's
+ * position stay resident: the lexer runs in O(window) memory, no matter
+ * how large the file is.
+ */
+
+#if !defined(GLEX_H)
+#  error glex_mmap.h must be included after glex.h
+#endif
+
+#if !GENLEX_CONFIG_MEMORY
+#  error glex_mmap.h requires GENLEX_CONFIG_MEMORY
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+struct gen_lexer_mmap {
+  struct gen_lexer_membuf mb;  /* IO context for gen_lexer_initialize() */
+  void *base;
+  size_t len;
+  size_t window;
+  size_t released;             /* pages before this have been dropped */
+  size_t pagesize;
+};
+
+static int gen_lexer_mmap_open(struct gen_lexer_mmap *m, const char *path, size_t window);
+static void gen_lexer_mmap_release(struct gen_lexer_mmap *m, GENLEX_POS_T off);
+static void gen_lexer_mmap_close(struct gen_lexer_mmap *m);
+
+
+/* Implementation */
+
+static int gen_lexer_mmap_open(struct gen_lexer_mmap *m, const char *path, size_t window)
+{
+  struct stat st;
+  int fd;
+
+  memset(m, 0, sizeof *m);
+  m->pagesize = sysconf(_SC_PAGESIZE);
+  m->window = (window > m->pagesize) ? window : m->pagesize;
+
+  if ((fd = open(path, O_RDONLY)) < 0) {
+    return GENLEX_ERR_IO;
+  }
+
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return GENLEX_ERR_IO;
+  }
+
+  /* offsets are GENLEX_POS_T, and the mapping needs a size_t */
+  if (((unsigned long long)st.st_size > (GENLEX_POS_T)-1 - 1) ||
+      ((unsigned long long)st.st_size > (size_t)-1)) {
+    close(fd);
+    return GENLEX_ERR_BUFFER_OVERFLOW;
+  }
+
+  /* mmap() won't map an empty file */
+  if (st.st_size > 0) {
+    m->base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (m->base == MAP_FAILED) {
+      m->base = NULL;
+      close(fd);
+      return GENLEX_ERR_IO;
+    }
+    m->len = st.st_size;
+    madvise(m->base, m->len, MADV_SEQUENTIAL);
+  }
+
+  close(fd);
+  m->mb.data = m->base;
+  m->mb.len = m->len;
+  m->mb.pos = 0;
+  return 0;
+}
+
+static void gen_lexer_mmap_release(struct gen_lexer_mmap *m, GENLEX_POS_T off)
+{
+  size_t upto;
+
+  if ((off > m->len) || (off < m->released + m->window)) { return; }
+
+  upto = off - off % m->pagesize;
+  madvise((unsigned char *)m->base + m->released, upto - m->released, MADV_DONTNEED);
+  m->released = upto;
+}
+
+static void gen_lexer_mmap_close(struct gen_lexer_mmap *m)
+{
+  if (m->base != NULL) {
+    munmap(m->base, m->len);
+  }
+  memset(m, 0, sizeof *m);
+}
+
+#endif /* GLEX_MMAP_H */
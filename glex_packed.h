@@ -0,0 +1,461 @@
+#ifndef GLEX_PACKED_H
+#define GLEX_PACKED_H
+
+/* Packed token streams for GenLexer: whole token streams kept in memory
+ * for multi-pass tools, in a few bytes per token.
+ *
+ * This is meant to be #include'd after glex.h, in any I/O mode.
+ *
+ *   static void gen_lexer_packed_init(struct gen_lexer_packed *pk);
+ *   static void gen_lexer_packed_free(struct gen_lexer_packed *pk);
+ *
+ *     Starts an empty stream, and frees a stream's storage.
+ *
+ *   static void gen_lexer_packed_clear(struct gen_lexer_packed *pk);
+ *
+ *     Empties a stream, keeping its storage for the next one.
+ *
+ *   static int gen_lexer_packed_push(struct gen_lexer_packed *pk, struct gen_lexer *lexer, int tok);
+ *
+ *     Appends tok, the token lexer just returned, as
+ *     gen_lexer_token_record() would record it.  Tokens must be pushed
+ *     in input order, from one lexer.  Returns 0, or
+ *     GENLEX_ERR_NO_MEMORY, in which case the stream is unchanged.
+ *
+ *   static int gen_lexer_packed_lex(struct gen_lexer_packed *pk, struct gen_lexer *lexer);
+ *
+ *     Pushes every token until gen_lexer_next_token() returns 0,
+ *     including error tokens.  Returns 0 or GENLEX_ERR_NO_MEMORY.
+ *
+ *   static size_t gen_lexer_packed_count(const struct gen_lexer_packed *pk);
+ *   static size_t gen_lexer_packed_bytes(const struct gen_lexer_packed *pk);
+ *
+ *     Number of tokens in the stream, and the bytes of storage they
+ *     take (excluding unused capacity and struct gen_lexer_packed).
+ *
+ *   static void gen_lexer_packed_seek(const struct gen_lexer_packed *pk,
+ *       struct gen_lexer_packed_iter *it, size_t i);
+ *
+ *     Positions an iterator at token i (or at the end, if i is past
+ *     it).  Seeking decodes at most GENLEX_PACKED_BLOCK-1 tokens.
+ *
+ *   static int gen_lexer_packed_next(struct gen_lexer_packed_iter *it, struct gen_lexer_token *rec);
+ *
+ *     Decodes the token at the iterator into rec and moves past it.
+ *     Returns 1, or 0 at the end of the stream.  rec is what
+ *     gen_lexer_token_record() gave when the token was pushed, except
+ *     that val is only kept for integer and float tokens (and is 0 for
+ *     the others).
+ *
+ * Encoding:
+ *
+ * Each token is a kind byte, a span byte and, for integers and floats,
+ * its value.  The kind byte indexes a table of the distinct token values
+ * in the stream (255 escapes to a varint, once 255 are taken).  The
+ * span byte holds the gap from the end of the previous token, if it is
+ * at most 2, and the length, if it is under 64; 0xff escapes to
+ * varints of both.  Integer values are zigzag varints, floats are
+ * stored as they are, and the decimals of GENLEX_CONFIG_DECIMAL are a
+ * byte of neg and big and varints of coef and (zigzag) exp.
+ *
+ * Lines and columns are not stored per token.  The line index holds an
+ * entry for each line that a token starts on, after the first: the
+ * number of lines and the bytes since the previous entry.  A token's
+ * line is that of the last entry that starts at or before it, and its
+ * column is its distance from that start.
+ *
+ * Every GENLEX_PACKED_BLOCK tokens, a block records where the token and
+ * the line index are, and the decoder state at that point, so a seek
+ * starts at the nearest block before the token.
+ *
+ * Optional configuration:
+ *
+ * GENLEX_PACKED_BLOCK
+ *
+ *      Tokens per block.  Defaults to 128.
+ */
+
+#if !defined(GLEX_H)
+#  error glex_packed.h must be included after glex.h
+#endif
+
+#if !defined(GENLEX_PACKED_BLOCK)
+#  define GENLEX_PACKED_BLOCK 128
+#endif
+
+/* What follows a token's span */
+enum {
+  GENLEX_PACKED_VAL_NONE,
+  GENLEX_PACKED_VAL_INT,
+  GENLEX_PACKED_VAL_FLOAT,
+};
+
+struct genlex_packed_kind {
+  int tok;
+  int val;  /* GENLEX_PACKED_VAL_* */
+};
+
+/* Decoder state before a token */
+struct genlex_packed_state {
+  size_t pos;          /* of the token in bytes */
+  size_t lpos;         /* of the next entry in lines */
+  GENLEX_POS_T end;    /* of the previous token */
+  GENLEX_POS_T line;   /* line and offset of the current line entry */
+  GENLEX_POS_T start;
+};
+
+struct gen_lexer_packed {
+  unsigned char *bytes;   /* tokens */
+  size_t len;
+  size_t cap;
+
+  unsigned char *lines;   /* line index */
+  size_t llen;
+  size_t lcap;
+
+  struct genlex_packed_state *blocks;
+  size_t nblocks;
+  size_t bcap;
+
+  struct genlex_packed_kind kinds[255];
+  unsigned int nkinds;
+  unsigned char recent[256];  /* last kind seen for each low byte of tok */
+
+  size_t ntoks;
+  struct genlex_packed_state last;  /* encoder state after the last token */
+};
+
+struct gen_lexer_packed_iter {
+  const struct gen_lexer_packed *pk;
+  size_t i;
+  struct genlex_packed_state st;
+  GENLEX_POS_T nline;   /* next line entry */
+  GENLEX_POS_T nstart;  /* (GENLEX_POS_T)-1 if there is none */
+};
+
+static void gen_lexer_packed_init(struct gen_lexer_packed *pk);
+static void gen_lexer_packed_free(struct gen_lexer_packed *pk);
+static void gen_lexer_packed_clear(struct gen_lexer_packed *pk);
+static int gen_lexer_packed_push(struct gen_lexer_packed *pk, struct gen_lexer *lexer, int tok);
+static int gen_lexer_packed_lex(struct gen_lexer_packed *pk, struct gen_lexer *lexer);
+static inline size_t gen_lexer_packed_count(const struct gen_lexer_packed *pk);
+static inline size_t gen_lexer_packed_bytes(const struct gen_lexer_packed *pk);
+static void gen_lexer_packed_seek(const struct gen_lexer_packed *pk,
+    struct gen_lexer_packed_iter *it, size_t i);
+static inline int gen_lexer_packed_next(struct gen_lexer_packed_iter *it, struct gen_lexer_token *rec);
+
+
+/* Implementation */
+
+/* Longest encoding of a token and of a line entry */
+#define GENLEX_PACKED_MAX_TOKEN  (1 + 10 + 1 + 1 + 10 + 10 + 21)
+#define GENLEX_PACKED_MAX_LINE   (2*10)
+
+#define GENLEX_PACKED_ZIGZAG(v)    (((unsigned long long)(v) << 1) ^ (unsigned long long)-(long long)((unsigned long long)(v) >> 63))
+#define GENLEX_PACKED_UNZIGZAG(u)  ((long long)((u) >> 1) ^ -(long long)((u) & 1))
+
+static inline unsigned char *genlex_packed_put(unsigned char *p, unsigned long long v)
+{
+  while (v >= 0x80) {
+    *p++ = (unsigned char)(v | 0x80);
+    v >>= 7;
+  }
+  *p++ = (unsigned char)v;
+  return p;
+}
+
+static inline const unsigned char *genlex_packed_get(const unsigned char *p, unsigned long long *vp)
+{
+  unsigned long long v = *p & 0x7f;
+  unsigned int shift = 7;
+
+  while (*p++ & 0x80) {
+    v |= (unsigned long long)(*p & 0x7f) << shift;
+    shift += 7;
+  }
+  *vp = v;
+  return p;
+}
+
+static int genlex_packed_reserve(unsigned char **bufp, size_t *capp, size_t len, size_t n)
+{
+  if (*capp - len < n) {
+    size_t ncap = *capp ? 2 * *capp : 4096;
+    unsigned char *p;
+
+    while (ncap - len < n) { ncap *= 2; }
+    p = (unsigned char *)realloc(*bufp, ncap);
+    if (p == NULL) { return 0; }
+    *bufp = p;
+    *capp = ncap;
+  }
+  return 1;
+}
+
+static void gen_lexer_packed_init(struct gen_lexer_packed *pk)
+{
+  memset(pk, 0, sizeof *pk);
+}
+
+static void gen_lexer_packed_free(struct gen_lexer_packed *pk)
+{
+  free(pk->bytes);
+  free(pk->lines);
+  free(pk->blocks);
+  gen_lexer_packed_init(pk);
+}
+
+static void gen_lexer_packed_clear(struct gen_lexer_packed *pk)
+{
+  pk->len = 0;
+  pk->llen = 0;
+  pk->nblocks = 0;
+  pk->nkinds = 0;
+  pk->ntoks = 0;
+  memset(&pk->last, 0, sizeof pk->last);
+}
+
+/* Index of tok in the kind table, or 255 if the table is full */
+static inline unsigned int genlex_packed_kind(struct gen_lexer_packed *pk, int tok, int val)
+{
+  unsigned char *r = &pk->recent[tok & 0xff];
+  unsigned int k = *r;
+
+  if (k < pk->nkinds && pk->kinds[k].tok == tok) { return k; }
+
+  for (k = 0; k < pk->nkinds; k++) {
+    if (pk->kinds[k].tok == tok) { break; }
+  }
+  if (k == pk->nkinds && k < 255) {
+    pk->kinds[k].tok = tok;
+    pk->kinds[k].val = val;
+    pk->nkinds++;
+  }
+  *r = (unsigned char)k;
+  return k;
+}
+
+static int gen_lexer_packed_push(struct gen_lexer_packed *pk, struct gen_lexer *lexer, int tok)
+{
+  struct gen_lexer_token rec;
+  struct genlex_packed_state *st = &pk->last;
+  unsigned char *p;
+  GENLEX_POS_T len;
+  unsigned int k;
+  int val = GENLEX_PACKED_VAL_NONE;
+
+  gen_lexer_token_record(lexer, tok, &rec);
+  len = rec.end - rec.off;
+
+  if (tok == GENLEX_INT_TOKEN) {
+    val = GENLEX_PACKED_VAL_INT;
+  }
+#if GENLEX_CONFIG_FLOATS
+  else if (GENLEX_FLOATS_ENABLED && (tok == GENLEX_FLOAT_TOKEN)) {
+    val = GENLEX_PACKED_VAL_FLOAT;
+  }
+#endif
+
+  if (!genlex_packed_reserve(&pk->bytes, &pk->cap, pk->len, GENLEX_PACKED_MAX_TOKEN) ||
+      !genlex_packed_reserve(&pk->lines, &pk->lcap, pk->llen, GENLEX_PACKED_MAX_LINE)) {
+    return GENLEX_ERR_NO_MEMORY;
+  }
+
+  if ((pk->ntoks % GENLEX_PACKED_BLOCK) == 0) {
+    if (pk->nblocks >= pk->bcap) {
+      size_t ncap = pk->bcap ? 2*pk->bcap : 64;
+      struct genlex_packed_state *b =
+        (struct genlex_packed_state *)realloc(pk->blocks, ncap * sizeof *b);
+      if (b == NULL) { return GENLEX_ERR_NO_MEMORY; }
+      pk->blocks = b;
+      pk->bcap = ncap;
+    }
+    st->pos = pk->len;
+    st->lpos = pk->llen;
+    pk->blocks[pk->nblocks++] = *st;
+  }
+
+  /* kinds come from a lexer, so only the first 255 need to be seen */
+  k = genlex_packed_kind(pk, tok, val);
+  p = pk->bytes + pk->len;
+  *p++ = (unsigned char)k;
+  if (k == 255) {
+    p = genlex_packed_put(p, GENLEX_PACKED_ZIGZAG((long long)tok));
+    *p++ = (unsigned char)val;
+  }
+
+  if ((rec.off >= st->end) && (rec.off - st->end <= 2) && (len < 64)) {
+    *p++ = (unsigned char)(((rec.off - st->end) << 6) | len);
+  } else {
+    *p++ = 0xff;
+    p = genlex_packed_put(p, GENLEX_PACKED_ZIGZAG((long long)rec.off - (long long)st->end));
+    p = genlex_packed_put(p, len);
+  }
+
+  if (val == GENLEX_PACKED_VAL_INT) {
+    p = genlex_packed_put(p, GENLEX_PACKED_ZIGZAG((long long)rec.val.i));
+  }
+#if GENLEX_CONFIG_DECIMAL
+  else if (val == GENLEX_PACKED_VAL_FLOAT) {
+    *p++ = (unsigned char)(rec.val.d.neg | (rec.val.d.big << 1));
+    p = genlex_packed_put(p, rec.val.d.coef);
+    p = genlex_packed_put(p, GENLEX_PACKED_ZIGZAG((long long)rec.val.d.exp));
+  }
+#elif GENLEX_CONFIG_FLOATS
+  else if (val == GENLEX_PACKED_VAL_FLOAT) {
+    memcpy(p, &rec.val.f, sizeof rec.val.f);
+    p += sizeof rec.val.f;
+  }
+#endif
+  pk->len = p - pk->bytes;
+
+  if (rec.line != st->line) {
+    GENLEX_POS_T start = rec.off - rec.col;
+
+    p = pk->lines + pk->llen;
+    p = genlex_packed_put(p, rec.line - st->line);
+    p = genlex_packed_put(p, start - st->start);
+    pk->llen = p - pk->lines;
+    st->line = rec.line;
+    st->start = start;
+  }
+
+  st->end = rec.end;
+  pk->ntoks++;
+  return 0;
+}
+
+static int gen_lexer_packed_lex(struct gen_lexer_packed *pk, struct gen_lexer *lexer)
+{
+  int tok, err;
+
+  while ((tok = gen_lexer_next_token(lexer)) != 0) {
+    if ((err = gen_lexer_packed_push(pk, lexer, tok)) != 0) { return err; }
+  }
+  return 0;
+}
+
+static inline size_t gen_lexer_packed_count(const struct gen_lexer_packed *pk)
+{
+  return pk->ntoks;
+}
+
+static inline size_t gen_lexer_packed_bytes(const struct gen_lexer_packed *pk)
+{
+  return pk->len + pk->llen + pk->nblocks * sizeof pk->blocks[0];
+}
+
+/* Reads the line entry at it->st.lpos, if there is one */
+static inline void genlex_packed_peek_line(struct gen_lexer_packed_iter *it)
+{
+  const struct gen_lexer_packed *pk = it->pk;
+  unsigned long long dline, dstart;
+  const unsigned char *p;
+
+  if (it->st.lpos >= pk->llen) {
+    it->nstart = (GENLEX_POS_T)-1;
+    return;
+  }
+
+  p = genlex_packed_get(pk->lines + it->st.lpos, &dline);
+  p = genlex_packed_get(p, &dstart);
+  it->st.lpos = p - pk->lines;
+  it->nline = it->st.line + (GENLEX_POS_T)dline;
+  it->nstart = it->st.start + (GENLEX_POS_T)dstart;
+}
+
+static void gen_lexer_packed_seek(const struct gen_lexer_packed *pk,
+    struct gen_lexer_packed_iter *it, size_t i)
+{
+  struct gen_lexer_token rec;
+
+  it->pk = pk;
+  if (i >= pk->ntoks) {
+    /* an iterator at the end, whose state is never read */
+    it->i = pk->ntoks;
+    memset(&it->st, 0, sizeof it->st);
+    it->nline = 0;
+    it->nstart = (GENLEX_POS_T)-1;
+    return;
+  }
+
+  it->i = i - (i % GENLEX_PACKED_BLOCK);
+  it->st = pk->blocks[i / GENLEX_PACKED_BLOCK];
+  genlex_packed_peek_line(it);
+
+  while (it->i < i) {
+    gen_lexer_packed_next(it, &rec);
+  }
+}
+
+static inline int gen_lexer_packed_next(struct gen_lexer_packed_iter *it, struct gen_lexer_token *rec)
+{
+  const struct gen_lexer_packed *pk = it->pk;
+  const unsigned char *p;
+  unsigned long long v;
+  GENLEX_POS_T off, len;
+  unsigned int k, s;
+  int val;
+
+  if (it->i >= pk->ntoks) { return 0; }
+
+  p = pk->bytes + it->st.pos;
+  k = *p++;
+  if (k < 255) {
+    rec->tok = pk->kinds[k].tok;
+    val = pk->kinds[k].val;
+  } else {
+    p = genlex_packed_get(p, &v);
+    rec->tok = (int)GENLEX_PACKED_UNZIGZAG(v);
+    val = *p++;
+  }
+
+  s = *p++;
+  if (s != 0xff) {
+    off = it->st.end + (s >> 6);
+    len = s & 0x3f;
+  } else {
+    p = genlex_packed_get(p, &v);
+    off = (GENLEX_POS_T)((long long)it->st.end + GENLEX_PACKED_UNZIGZAG(v));
+    p = genlex_packed_get(p, &v);
+    len = (GENLEX_POS_T)v;
+  }
+
+  memset(&rec->val, 0, sizeof rec->val);
+  if (val == GENLEX_PACKED_VAL_INT) {
+    p = genlex_packed_get(p, &v);
+    rec->val.i = (GENLEX_INT_T)GENLEX_PACKED_UNZIGZAG(v);
+  }
+#if GENLEX_CONFIG_DECIMAL
+  else if (val == GENLEX_PACKED_VAL_FLOAT) {
+    rec->val.d.neg = *p & 1;
+    rec->val.d.big = *p++ >> 1;
+    p = genlex_packed_get(p, &rec->val.d.coef);
+    p = genlex_packed_get(p, &v);
+    rec->val.d.exp = (int)GENLEX_PACKED_UNZIGZAG(v);
+  }
+#elif GENLEX_CONFIG_FLOATS
+  else if (val == GENLEX_PACKED_VAL_FLOAT) {
+    memcpy(&rec->val.f, p, sizeof rec->val.f);
+    p += sizeof rec->val.f;
+  }
+#endif
+
+  while (it->nstart <= off) {
+    it->st.line = it->nline;
+    it->st.start = it->nstart;
+    genlex_packed_peek_line(it);
+  }
+
+  rec->off = off;
+  rec->end = off + len;
+  rec->line = it->st.line;
+  rec->col = off - it->st.start;
+
+  it->st.end = rec->end;
+  it->st.pos = p - pk->bytes;
+  it->i++;
+  return 1;
+}
+
+#endif /* GLEX_PACKED_H */
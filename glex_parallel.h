@@ -0,0 +1,435 @@
+#ifndef GLEX_PARALLEL_H
+#define GLEX_PARALLEL_H
+
+/* Parallel driver for GenLexer: lexes a single memory-resident input on
+ * several threads.
+ *
+ * This is meant to be #include'd after glex.h, which must be configured
+ * with GENLEX_CONFIG_MEMORY and without GENLEX_CONFIG_RUNTIME or
+ * GENLEX_CONFIG_POOL.  Link with -lpthread.
+ *
+ *   static int gen_lexer_parallel_lex(const unsigned char *data, size_t len,
+ *       unsigned int nthreads, struct gen_lexer_tokens *out);
+ *
+ *     Lexes data[0..len) and appends every token to out.  The result is
+ *     identical to calling gen_lexer_next_token() on the whole input
+ *     until it returns 0, including error tokens, offsets, lines and
+ *     columns.  Returns 0 on success or a negative error code
+ *     (GENLEX_ERR_NO_MEMORY), in which case out is left unchanged.
+ *
+ * How it works:
+ *
+ * The input is split into one chunk per thread.  A thread doesn't know
+ * what state the lexer is in at the start of its chunk, so it scans the
+ * chunk once for every state the lexer can plausibly be in there:
+ * between tokens (the "ground" run), inside a string, and inside each
+ * of the comment pairs.  Each run records the tokens it sees and the
+ * offsets where it was between tokens (its sync points).  A run that
+ * scans past the end of its chunk finishes the token it is in, so every
+ * token belongs to the chunk it starts in.
+ *
+ * The lexer is always in the same state between tokens, so once the
+ * runs are done, the chunks are stitched in order: the serial lexer
+ * would resume at the end of the previous chunk's last token, and the
+ * first run that has a sync point at that offset gives exactly the
+ * serial tokens from there on.  Speculative runs stop as soon as they
+ * reach one of the ground run's sync points.  If no run has the offset
+ * (the chunk started inside a character literal, say), the chunk is
+ * rescanned serially from there until it meets a ground sync point.
+ *
+ * Threads count lines relative to the start of their run.  Stitching
+ * rebases them using the newline count of each chunk.
+ *
+ * Optional configuration:
+ *
+ * GENLEX_PARALLEL_MIN_CHUNK
+ *
+ *      Smallest chunk worth handing to a thread.  Inputs smaller than
+ *      nthreads*GENLEX_PARALLEL_MIN_CHUNK use fewer threads.  Defaults
+ *      to 64 KiB.
+ */
+
+#if !defined(GLEX_H)
+#  error glex_parallel.h must be included after glex.h
+#endif
+
+#if !GENLEX_CONFIG_MEMORY
+#  error glex_parallel.h requires GENLEX_CONFIG_MEMORY
+#endif
+
+/* the workers' lexers have no blob arena to decode into */
+#if GENLEX_CONFIG_BLOBS
+#  error glex_parallel.h does not support GENLEX_CONFIG_BLOBS
+#endif
+
+/* the workers' lexers are set up by gen_lexer_initialize(), with no
+ * tables to lex by
+ */
+#if GENLEX_CONFIG_RUNTIME
+#  error glex_parallel.h does not support GENLEX_CONFIG_RUNTIME
+#endif
+
+/* a speculative run that stops partway would keep its pooled buffer */
+#if GENLEX_CONFIG_POOL
+#  error glex_parallel.h does not support GENLEX_CONFIG_POOL
+#endif
+
+#include <pthread.h>
+
+#if !defined(GENLEX_PARALLEL_MIN_CHUNK)
+#  define GENLEX_PARALLEL_MIN_CHUNK (64*1024)
+#endif
+
+static int gen_lexer_parallel_lex(const unsigned char *data, size_t len,
+    unsigned int nthreads, struct gen_lexer_tokens *out);
+
+
+/* Implementation */
+
+#define GENLEX_PAR_NO_JOIN ((size_t)-1)
+
+/* Hypotheses for the lexer state at the start of a chunk */
+enum {
+  GENLEX_PAR_IN_STRING = 0,
+#if defined(GENLEX_COMMENT_PAIRS)
+  GENLEX_PAR_IN_COMMENT,
+  GENLEX_PAR_NUM_ALT = GENLEX_PAR_IN_COMMENT + GENLEX_NUM_COMMENT_PAIRS
+#else
+  GENLEX_PAR_NUM_ALT
+#endif
+};
+
+/* One scan of a chunk.  The sync points of a run are start and the end
+ * of each of its tokens.  Lines and columns are relative to the offset
+ * the run started scanning at.
+ */
+struct genlex_par_run {
+  struct gen_lexer_tokens toks;
+  GENLEX_POS_T start;  /* first sync point */
+  GENLEX_POS_T stop;   /* last sync point */
+  size_t join;         /* ground sync point this run converged on */
+};
+
+struct genlex_par_chunk {
+  const unsigned char *data;
+  size_t len;
+  GENLEX_POS_T beg;
+  GENLEX_POS_T end;
+  size_t nlines;
+  int err;
+
+  struct genlex_par_run ground;
+  struct genlex_par_run alt[GENLEX_PAR_NUM_ALT];
+};
+
+static GENLEX_POS_T genlex_par_sync(const struct genlex_par_run *run, size_t i)
+{
+  return (i == 0) ? run->start : run->toks.toks[i-1].end;
+}
+
+static size_t genlex_par_nsync(const struct genlex_par_run *run)
+{
+  return run->toks.len + 1;
+}
+
+/* Returns the index of the sync point at off, or GENLEX_PAR_NO_JOIN */
+static size_t genlex_par_find_sync(const struct genlex_par_run *run, GENLEX_POS_T off)
+{
+  size_t lo = 0, hi = genlex_par_nsync(run);
+
+  while (lo < hi) {
+    size_t mid = lo + (hi-lo)/2;
+    GENLEX_POS_T s = genlex_par_sync(run, mid);
+    if (s == off) { return mid; }
+    if (s < off) { lo = mid+1; } else { hi = mid; }
+  }
+
+  return GENLEX_PAR_NO_JOIN;
+}
+
+static void genlex_par_position(struct gen_lexer *lexer, struct gen_lexer_membuf *mb,
+    const unsigned char *data, size_t len, GENLEX_POS_T off)
+{
+  mb->data = data;
+  mb->len = len;
+  mb->pos = off;
+  gen_lexer_initialize(lexer, mb);
+  lexer->off = off;
+}
+
+/* Scans tokens from the lexer's position until it is between tokens at
+ * or past end.  If ground is given, stops early when the run reaches
+ * one of the ground run's sync points.
+ */
+static int genlex_par_scan(struct gen_lexer *lexer, struct genlex_par_run *run,
+    GENLEX_POS_T end, const struct genlex_par_run *ground)
+{
+  size_t gi = 0;
+
+  run->join = GENLEX_PAR_NO_JOIN;
+  for (;;) {
+    struct gen_lexer_token rec;
+    int tok;
+
+    if (ground != NULL) {
+      size_t ng = genlex_par_nsync(ground);
+      while ((gi < ng) && (genlex_par_sync(ground,gi) < lexer->off)) { gi++; }
+      if ((gi < ng) && (genlex_par_sync(ground,gi) == lexer->off)) {
+        run->join = gi;
+        break;
+      }
+    }
+
+    if (lexer->off >= end) { break; }
+
+    tok = gen_lexer_next_token(lexer);
+    if (tok == 0) { break; }
+
+    gen_lexer_token_record(lexer, tok, &rec);
+    if (!gen_lexer_tokens_push(&run->toks, &rec)) {
+      return GENLEX_ERR_NO_MEMORY;
+    }
+  }
+
+  run->stop = lexer->off;
+  return 0;
+}
+
+static void *genlex_par_worker(void *arg)
+{
+  struct genlex_par_chunk *ch = arg;
+  struct gen_lexer lexer;
+  struct gen_lexer_membuf mb;
+  const unsigned char *p, *e;
+  unsigned int i;
+
+  for (p = ch->data + ch->beg, e = ch->data + ch->end;
+      (p = memchr(p, '\n', e-p)) != NULL; p++) {
+    ch->nlines++;
+  }
+
+  genlex_par_position(&lexer, &mb, ch->data, ch->len, ch->beg);
+  ch->ground.start = ch->beg;
+  ch->err = genlex_par_scan(&lexer, &ch->ground, ch->end, NULL);
+
+  /* the first chunk always starts between tokens */
+  if (ch->beg == 0) { return NULL; }
+
+  for (i=0; (ch->err == 0) && (i < GENLEX_PAR_NUM_ALT); i++) {
+    struct genlex_par_run *run = &ch->alt[i];
+
+    genlex_par_position(&lexer, &mb, ch->data, ch->len, ch->beg);
+    if (i == GENLEX_PAR_IN_STRING) {
+      gen_lexer_read_string(&lexer);
+    }
+#if defined(GENLEX_COMMENT_PAIRS)
+    else {
+      gen_lexer_read_comment(&lexer, gen_lexer_comments[i-GENLEX_PAR_IN_COMMENT].end);
+    }
+#endif
+
+    run->start = lexer.off;
+    ch->err = genlex_par_scan(&lexer, run, ch->end, &ch->ground);
+  }
+
+  return NULL;
+}
+
+/* Line and column of the byte at off, given the line of the byte at beg */
+static void genlex_par_base(const unsigned char *data, GENLEX_POS_T beg, size_t beg_line,
+    GENLEX_POS_T off, size_t *linep, GENLEX_POS_T *colp)
+{
+  const unsigned char *p, *e;
+  GENLEX_POS_T ls;
+
+  for (p = data + beg, e = data + off;
+      (p = memchr(p, '\n', e-p)) != NULL; p++) {
+    beg_line++;
+  }
+
+  for (ls = off; (ls > 0) && (data[ls-1] != '\n'); ls--) {
+    continue;
+  }
+
+  *linep = beg_line;
+  *colp = off - ls;
+}
+
+/* Appends toks[from..] of run to out, rebasing lines and columns */
+static int genlex_par_emit(struct gen_lexer_tokens *out, const struct genlex_par_run *run,
+    size_t from, size_t base_line, GENLEX_POS_T base_col)
+{
+  size_t i;
+
+  for (i=from; i < run->toks.len; i++) {
+    struct gen_lexer_token rec = run->toks.toks[i];
+    if (rec.line == 0) { rec.col += base_col; }
+    rec.line += base_line;
+    if (!gen_lexer_tokens_push(out, &rec)) {
+      return GENLEX_ERR_NO_MEMORY;
+    }
+  }
+
+  return 0;
+}
+
+static int genlex_par_stitch(struct genlex_par_chunk *chunks, unsigned int nchunks,
+    const unsigned char *data, size_t len, struct gen_lexer_tokens *out)
+{
+  unsigned int k;
+  GENLEX_POS_T resume = 0;
+  size_t line0 = 0;  /* line number of chunks[k].beg */
+
+  for (k=0; k < nchunks; line0 += chunks[k].nlines, k++) {
+    struct genlex_par_chunk *ch = &chunks[k];
+    const struct genlex_par_run *run = NULL;
+    size_t from = GENLEX_PAR_NO_JOIN;
+    size_t base_line;
+    GENLEX_POS_T base_col;
+    unsigned int i;
+    int err;
+
+    if (resume >= ch->end) { continue; }
+
+    genlex_par_base(data, ch->beg, line0, ch->beg, &base_line, &base_col);
+
+    from = genlex_par_find_sync(&ch->ground, resume);
+    if (from != GENLEX_PAR_NO_JOIN) {
+      run = &ch->ground;
+    }
+
+    for (i=0; (run == NULL) && (k > 0) && (i < GENLEX_PAR_NUM_ALT); i++) {
+      from = genlex_par_find_sync(&ch->alt[i], resume);
+      if (from != GENLEX_PAR_NO_JOIN) {
+        run = &ch->alt[i];
+      }
+    }
+
+    if (run == NULL) {
+      /* no run was ever between tokens at resume: scan serially until
+       * we meet the ground run
+       */
+      struct genlex_par_run serial;
+      struct gen_lexer lexer;
+      struct gen_lexer_membuf mb;
+      size_t sline;
+      GENLEX_POS_T scol;
+
+      memset(&serial, 0, sizeof serial);
+      genlex_par_position(&lexer, &mb, data, len, resume);
+      serial.start = resume;
+      err = genlex_par_scan(&lexer, &serial, ch->end, &ch->ground);
+
+      genlex_par_base(data, ch->beg, line0, resume, &sline, &scol);
+      if (err == 0) {
+        err = genlex_par_emit(out, &serial, 0, sline, scol);
+      }
+      gen_lexer_tokens_free(&serial.toks);
+      if (err != 0) { return err; }
+
+      if (serial.join == GENLEX_PAR_NO_JOIN) {
+        resume = serial.stop;
+        continue;
+      }
+
+      run = &ch->ground;
+      from = serial.join;
+    }
+
+    if ((err = genlex_par_emit(out, run, from, base_line, base_col)) != 0) {
+      return err;
+    }
+
+    if (run->join != GENLEX_PAR_NO_JOIN) {
+      if ((err = genlex_par_emit(out, &ch->ground, run->join, base_line, base_col)) != 0) {
+        return err;
+      }
+      run = &ch->ground;
+    }
+
+    resume = run->stop;
+  }
+
+  return 0;
+}
+
+static int gen_lexer_parallel_lex(const unsigned char *data, size_t len,
+    unsigned int nthreads, struct gen_lexer_tokens *out)
+{
+  struct genlex_par_chunk *chunks;
+  pthread_t *tids;
+  unsigned int nchunks, k;
+  size_t nstart = out->len;
+  size_t csz;
+  int err = 0;
+
+  if (nthreads == 0) { nthreads = 1; }
+
+  /* offsets are GENLEX_POS_T */
+  if (len > (size_t)(GENLEX_POS_T)-1 - 1) {
+    return GENLEX_ERR_BUFFER_OVERFLOW;
+  }
+
+  nchunks = nthreads;
+  if (len / GENLEX_PARALLEL_MIN_CHUNK < nchunks) {
+    nchunks = len / GENLEX_PARALLEL_MIN_CHUNK;
+    if (nchunks == 0) { nchunks = 1; }
+  }
+
+  chunks = calloc(nchunks, sizeof *chunks);
+  tids = calloc(nchunks, sizeof *tids);
+  if ((chunks == NULL) || (tids == NULL)) {
+    free(chunks);
+    free(tids);
+    return GENLEX_ERR_NO_MEMORY;
+  }
+
+  csz = len / nchunks;
+  for (k=0; k < nchunks; k++) {
+    chunks[k].data = data;
+    chunks[k].len  = len;
+    chunks[k].beg  = k * csz;
+    chunks[k].end  = (k+1 < nchunks) ? (k+1) * csz : len;
+  }
+
+  /* the calling thread takes the first chunk */
+  for (k=1; k < nchunks; k++) {
+    if (pthread_create(&tids[k], NULL, genlex_par_worker, &chunks[k]) != 0) {
+      genlex_par_worker(&chunks[k]);
+      tids[k] = pthread_self();
+    }
+  }
+  genlex_par_worker(&chunks[0]);
+
+  for (k=1; k < nchunks; k++) {
+    if (!pthread_equal(tids[k], pthread_self())) {
+      pthread_join(tids[k], NULL);
+    }
+  }
+
+  for (k=0; k < nchunks; k++) {
+    if (chunks[k].err != 0) { err = chunks[k].err; }
+  }
+
+  if (err == 0) {
+    err = genlex_par_stitch(chunks, nchunks, data, len, out);
+  }
+
+  for (k=0; k < nchunks; k++) {
+    unsigned int i;
+    gen_lexer_tokens_free(&chunks[k].ground.toks);
+    for (i=0; i < GENLEX_PAR_NUM_ALT; i++) {
+      gen_lexer_tokens_free(&chunks[k].alt[i].toks);
+    }
+  }
+  free(chunks);
+  free(tids);
+
+  if (err != 0) {
+    out->len = nstart;
+  }
+
+  return err;
+}
+
+#endif /* GLEX_PARALLEL_H */
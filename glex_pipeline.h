@@ -0,0 +1,293 @@
+#ifndef GLEX_PIPELINE_H
+#define GLEX_PIPELINE_H
+
+/* Pipelined driver for GenLexer: lexes on a thread of its own while the
+ * caller parses.
+ *
+ * This is meant to be #include'd after glex.h, in any I/O mode.  Link
+ * with -lpthread.
+ *
+ *   static int gen_lexer_pipeline_start(struct gen_lexer_pipeline *pl, struct gen_lexer *lexer);
+ *
+ *     Starts a producer thread that calls gen_lexer_next_token() on
+ *     lexer until it returns 0 or an error, and hands the tokens over
+ *     in batches.  lexer must be initialized and must not be touched
+ *     again until gen_lexer_pipeline_finish().  Returns 0, or
+ *     GENLEX_ERR_NO_MEMORY if the ring or the thread couldn't be set up.
+ *
+ *   static int gen_lexer_pipeline_next(struct gen_lexer_pipeline *pl,
+ *       const struct gen_lexer_pipeline_token **tp);
+ *
+ *     Returns the next token and points *tp at its record, waiting for
+ *     the producer if it is behind.  The last token is 0 or the first
+ *     error, and is returned again by every call after it.  The record
+ *     and its text stay valid until the next call.
+ *
+ *   static const struct gen_lexer_pipeline_batch *gen_lexer_pipeline_pop(struct gen_lexer_pipeline *pl);
+ *   static void gen_lexer_pipeline_release(struct gen_lexer_pipeline *pl);
+ *
+ *     The same tokens a batch at a time, for callers that need to keep
+ *     tokens longer.  gen_lexer_pipeline_pop() waits for the next batch,
+ *     or returns NULL once the batch marked last has been popped.  A
+ *     popped batch stays valid until gen_lexer_pipeline_release() gives
+ *     the oldest popped batch back to the producer, so up to
+ *     GENLEX_PIPELINE_SLOTS batches can be held at once.  Don't mix
+ *     these with gen_lexer_pipeline_next().
+ *
+ *   static void gen_lexer_pipeline_finish(struct gen_lexer_pipeline *pl);
+ *
+ *     Stops the producer, even if the input hasn't been lexed to the
+ *     end, waits for it and frees the ring.  lexer is then the caller's
+ *     again, positioned after the last token the producer read.
+ *
+ * The ring is a single-producer, single-consumer queue of
+ * GENLEX_PIPELINE_SLOTS batches that is allocated once.  The producer
+ * only writes the count of batches published and the consumer only
+ * the count of batches released, each on its own cache line, and each
+ * side keeps a stale copy of the other's count so that it only reads
+ * the shared line when the copy says it has to wait.  A side that has
+ * to wait spins for a while and then yields its CPU; a full ring is
+ * what holds a producer back from an input the parser can't keep up
+ * with.
+ *
+ * Each batch carries a copy of the text of its tokens, so that text
+ * outlives the lexer's buffer and works the same over streams.
+ *
+ * Optional configuration:
+ *
+ * GENLEX_PIPELINE_BATCH
+ *
+ *      Tokens per batch.  Defaults to 256.
+ *
+ * GENLEX_PIPELINE_TEXT
+ *
+ *      Bytes of token text per batch.  A batch is published early if
+ *      the next token's text might not fit.  Defaults to room for 16
+ *      bytes per token plus one token of GENLEX_STRING_MAX bytes.
+ *
+ * GENLEX_PIPELINE_SLOTS
+ *
+ *      Batches in the ring.  Defaults to 8.
+ *
+ * GENLEX_PIPELINE_SPIN
+ *
+ *      How many times a waiting side polls before it starts yielding.
+ *      Defaults to 1024.  With only one CPU online, the other side
+ *      can't make progress while this one spins, so it yields at once.
+ */
+
+#if !defined(GLEX_H)
+#  error glex_pipeline.h must be included after glex.h
+#endif
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#if !defined(GENLEX_PIPELINE_BATCH)
+#  define GENLEX_PIPELINE_BATCH 256
+#endif
+
+#if !defined(GENLEX_PIPELINE_TEXT)
+#  define GENLEX_PIPELINE_TEXT (16*GENLEX_PIPELINE_BATCH + GENLEX_STRING_MAX + 1)
+#endif
+
+#if !defined(GENLEX_PIPELINE_SLOTS)
+#  define GENLEX_PIPELINE_SLOTS 8
+#endif
+
+#if !defined(GENLEX_PIPELINE_SPIN)
+#  define GENLEX_PIPELINE_SPIN 1024
+#endif
+
+#if GENLEX_PIPELINE_TEXT <= GENLEX_STRING_MAX
+#  error GENLEX_PIPELINE_TEXT must be larger than GENLEX_STRING_MAX
+#endif
+
+struct gen_lexer_pipeline_token {
+  struct gen_lexer_token rec;
+  const unsigned char *text;  /* gen_lexer_token_string(), null-terminated */
+  size_t len;
+};
+
+struct gen_lexer_pipeline_batch {
+  size_t len;   /* tokens in toks, at least 1 */
+  int last;     /* toks[len-1] is 0 or an error, and no batch follows */
+  struct gen_lexer_pipeline_token toks[GENLEX_PIPELINE_BATCH];
+  unsigned char text[GENLEX_PIPELINE_TEXT];
+};
+
+struct gen_lexer_pipeline {
+  /* written by the producer */
+  unsigned long head;   /* batches published */
+  char pad0[64];
+
+  /* written by the consumer */
+  unsigned long tail;   /* batches released */
+  int stop;
+  char pad1[64];
+
+  /* producer only */
+  struct gen_lexer *lexer;
+  unsigned long prod_tail;   /* last tail seen */
+  char pad2[64];
+
+  /* consumer only */
+  unsigned long popped;
+  unsigned long cons_head;   /* last head seen */
+  int ended;                 /* the last batch has been popped */
+  const struct gen_lexer_pipeline_batch *cur;
+  size_t pos;
+
+  struct gen_lexer_pipeline_batch *slots;
+  unsigned int spin;         /* GENLEX_PIPELINE_SPIN, or 0 on one CPU */
+  pthread_t tid;
+};
+
+static int gen_lexer_pipeline_start(struct gen_lexer_pipeline *pl, struct gen_lexer *lexer);
+static inline int gen_lexer_pipeline_next(struct gen_lexer_pipeline *pl,
+    const struct gen_lexer_pipeline_token **tp);
+static const struct gen_lexer_pipeline_batch *gen_lexer_pipeline_pop(struct gen_lexer_pipeline *pl);
+static void gen_lexer_pipeline_release(struct gen_lexer_pipeline *pl);
+static void gen_lexer_pipeline_finish(struct gen_lexer_pipeline *pl);
+
+
+/* Implementation */
+
+static inline void genlex_pipe_wait(const struct gen_lexer_pipeline *pl, unsigned int *spins)
+{
+  if (*spins < pl->spin) {
+    (*spins)++;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+  } else {
+    sched_yield();
+  }
+}
+
+/* Waits until slot head is free.  Returns 0 if the consumer has stopped. */
+static int genlex_pipe_wait_room(struct gen_lexer_pipeline *pl, unsigned long head)
+{
+  unsigned int spins = 0;
+
+  while (head - pl->prod_tail >= GENLEX_PIPELINE_SLOTS) {
+    if (__atomic_load_n(&pl->stop, __ATOMIC_RELAXED)) { return 0; }
+    pl->prod_tail = __atomic_load_n(&pl->tail, __ATOMIC_ACQUIRE);
+    if (head - pl->prod_tail >= GENLEX_PIPELINE_SLOTS) { genlex_pipe_wait(pl, &spins); }
+  }
+
+  return !__atomic_load_n(&pl->stop, __ATOMIC_RELAXED);
+}
+
+static void *genlex_pipe_producer(void *arg)
+{
+  struct gen_lexer_pipeline *pl = (struct gen_lexer_pipeline *)arg;
+  struct gen_lexer *lexer = pl->lexer;
+  unsigned long head = 0;
+  int tok;
+
+  do {
+    struct gen_lexer_pipeline_batch *b;
+    size_t tlen = 0;
+
+    if (!genlex_pipe_wait_room(pl, head)) { break; }
+    b = &pl->slots[head % GENLEX_PIPELINE_SLOTS];
+    b->len = 0;
+
+    do {
+      struct gen_lexer_pipeline_token *t = &b->toks[b->len++];
+      const unsigned char *s;
+      size_t len;
+
+      tok = gen_lexer_next_token(lexer);
+      gen_lexer_token_record(lexer, tok, &t->rec);
+      s = gen_lexer_token_string(lexer, &len);
+      memcpy(b->text + tlen, s, len);
+      b->text[tlen + len] = '\0';
+      t->text = b->text + tlen;
+      t->len = len;
+      tlen += len + 1;
+    } while (tok > 0 && b->len < GENLEX_PIPELINE_BATCH &&
+             tlen + GENLEX_STRING_MAX + 1 <= GENLEX_PIPELINE_TEXT);
+
+    b->last = (tok <= 0);
+    __atomic_store_n(&pl->head, ++head, __ATOMIC_RELEASE);
+  } while (tok > 0);
+
+  return NULL;
+}
+
+static int gen_lexer_pipeline_start(struct gen_lexer_pipeline *pl, struct gen_lexer *lexer)
+{
+  memset(pl, 0, sizeof *pl);
+  pl->lexer = lexer;
+  pl->spin = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? GENLEX_PIPELINE_SPIN : 0;
+
+  pl->slots = (struct gen_lexer_pipeline_batch *)malloc(GENLEX_PIPELINE_SLOTS * sizeof pl->slots[0]);
+  if (pl->slots == NULL) { return GENLEX_ERR_NO_MEMORY; }
+
+  if (pthread_create(&pl->tid, NULL, genlex_pipe_producer, pl) != 0) {
+    free(pl->slots);
+    pl->slots = NULL;
+    return GENLEX_ERR_NO_MEMORY;
+  }
+
+  return 0;
+}
+
+static const struct gen_lexer_pipeline_batch *gen_lexer_pipeline_pop(struct gen_lexer_pipeline *pl)
+{
+  const struct gen_lexer_pipeline_batch *b;
+  unsigned int spins = 0;
+
+  if (pl->ended) { return NULL; }
+
+  while (pl->popped == pl->cons_head) {
+    pl->cons_head = __atomic_load_n(&pl->head, __ATOMIC_ACQUIRE);
+    if (pl->popped == pl->cons_head) { genlex_pipe_wait(pl, &spins); }
+  }
+
+  b = &pl->slots[pl->popped % GENLEX_PIPELINE_SLOTS];
+  pl->popped++;
+  pl->ended = b->last;
+
+  return b;
+}
+
+static void gen_lexer_pipeline_release(struct gen_lexer_pipeline *pl)
+{
+  __atomic_store_n(&pl->tail, pl->tail + 1, __ATOMIC_RELEASE);
+}
+
+static inline int gen_lexer_pipeline_next(struct gen_lexer_pipeline *pl,
+    const struct gen_lexer_pipeline_token **tp)
+{
+  const struct gen_lexer_pipeline_batch *b = pl->cur;
+
+  if (b == NULL || (pl->pos == b->len && !b->last)) {
+    if (b != NULL) { gen_lexer_pipeline_release(pl); }
+    b = pl->cur = gen_lexer_pipeline_pop(pl);
+    pl->pos = 0;
+  }
+
+  /* the end of the last batch stays put */
+  if (pl->pos < b->len) { pl->pos++; }
+  *tp = &b->toks[pl->pos-1];
+
+  return (*tp)->rec.tok;
+}
+
+static void gen_lexer_pipeline_finish(struct gen_lexer_pipeline *pl)
+{
+  if (pl->slots == NULL) { return; }
+
+  __atomic_store_n(&pl->stop, 1, __ATOMIC_RELAXED);
+  pthread_join(pl->tid, NULL);
+
+  free(pl->slots);
+  pl->slots = NULL;
+  pl->cur = NULL;
+}
+
+#endif /* GLEX_PIPELINE_H */
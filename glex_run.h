@@ -0,0 +1,213 @@
+/* Callback driver for GenLexer: hands each token to a handler for its
+ * class, instead of returning it.
+ *
+ * This is meant to be #include'd after glex.h, in any mode, and after
+ * whatever the handlers call.  It defines one driver each time it is
+ * included, so a file can have drivers with different handlers:
+ *
+ *   static int gen_lexer_run(struct gen_lexer *lexer, GENLEX_RUN_CTX_T ctx);
+ *
+ *     Scans tokens with gen_lexer_next_token() and passes each one to
+ *     the handler for its class, until the end of the input or until a
+ *     handler returns non-zero.  Returns 0 at the end of the input, or
+ *     what the handler returned.  A stopped driver can be called again
+ *     to carry on after the token it stopped on.
+ *
+ * The handlers are macros, #define'd before the #include, that expand
+ * to an int: 0 to go on to the next token and anything else to stop.
+ * Because they are macros, or calls of static inline functions, they
+ * are compiled into the driver's loop, so a filter or transcoder pays
+ * no call and no switch on the token of its own per token.  The lexer
+ * is in scope in them as lexer, for gen_lexer_token_line() and the
+ * like.  Any that aren't defined fall back to GENLEX_ON_TOKEN.
+ *
+ * GENLEX_ON_IDENT(ctx,s,len), GENLEX_ON_STRING(ctx,s,len),
+ * GENLEX_ON_COMMENT(ctx,s,len)
+ *
+ *      Identifiers, strings and comments, with the text of the token
+ *      as gen_lexer_token_string() gives it.  The text is only
+ *      terminated for the classes that have a handler.
+ *
+ * GENLEX_ON_INT(ctx,v), GENLEX_ON_FLOAT(ctx,v)
+ *
+ *      Integers and character literals, and floats, with their values
+ *      (a struct gen_lexer_decimal with GENLEX_CONFIG_DECIMAL).
+ *
+ * GENLEX_ON_BLOB(ctx,p,len)
+ *
+ *      Blob literals (GENLEX_CONFIG_BLOBS), with their decoded bytes as
+ *      gen_lexer_token_blob() gives them.
+ *
+ * GENLEX_ON_RAW(ctx,s,len)
+ *
+ *      Text from a raw text mode (GENLEX_CONFIG_RUNTIME), its raw_token,
+ *      with the text as gen_lexer_token_string() gives it.
+ *
+ * GENLEX_ON_KEYWORD(ctx,tok), GENLEX_ON_LITERAL(ctx,tok)
+ *
+ *      Keywords, and literals and literal pairs, with their tokens.  A
+ *      raw text mode's raw_until_token counts as a literal.
+ *
+ * GENLEX_ON_ERROR(ctx,err)
+ *
+ *      Errors.  Defaults to err, which stops the driver and returns the
+ *      error; a handler that returns 0 lexes on past it.  Handlers that
+ *      stop the driver themselves should return positive values to
+ *      tell themselves apart from errors.
+ *
+ * GENLEX_ON_TOKEN(ctx,tok)
+ *
+ *      Every other token.  Defaults to 0.
+ *
+ * GENLEX_RUN_NAME
+ *
+ *      Name of the driver.  Defaults to gen_lexer_run.
+ *
+ * GENLEX_RUN_CTX_T
+ *
+ *      Type of the handlers' context.  Defaults to void *.
+ *
+ * The handler macros, GENLEX_RUN_NAME and GENLEX_RUN_CTX_T are
+ * #undef'd at the end of this file, ready for the next driver.
+ */
+
+#if !defined(GLEX_H)
+#  error glex_run.h must be included after glex.h
+#endif
+
+#if !defined(GENLEX_RUN_NAME)
+#  define GENLEX_RUN_NAME gen_lexer_run
+#endif
+
+#if !defined(GENLEX_RUN_CTX_T)
+#  define GENLEX_RUN_CTX_T void *
+#endif
+
+#if !defined(GENLEX_ON_TOKEN)
+#  define GENLEX_ON_TOKEN(ctx,tok) 0
+#endif
+
+#if !defined(GENLEX_ON_ERROR)
+#  define GENLEX_ON_ERROR(ctx,err) (err)
+#endif
+
+static int GENLEX_RUN_NAME(struct gen_lexer *lexer, GENLEX_RUN_CTX_T ctx)
+{
+  int tok, ret;
+
+  for (;;) {
+    tok = gen_lexer_next_token(lexer);
+
+    if (tok <= 0) {
+      if (tok == 0) { return 0; }
+      ret = GENLEX_ON_ERROR(ctx, tok);
+    }
+#if GENLEX_CONFIG_RUNTIME
+    /* raw text may start like a symbol, and its other fields are unset */
+    else if (tok == lexer->tab->raw_token) {
+#  if defined(GENLEX_ON_RAW)
+      size_t len;
+      const unsigned char *s = gen_lexer_token_string(lexer, &len);
+      ret = GENLEX_ON_RAW(ctx, s, len);
+      (void)s; (void)len;
+#  else
+      ret = GENLEX_ON_TOKEN(ctx, tok);
+#  endif
+    } else if (tok == lexer->tab->raw_until_token) {
+#  if defined(GENLEX_ON_LITERAL)
+      ret = GENLEX_ON_LITERAL(ctx, tok);
+#  else
+      ret = GENLEX_ON_TOKEN(ctx, tok);
+#  endif
+    }
+#endif
+    else if (tok == GENLEX_ID_TOKEN) {
+#if defined(GENLEX_ON_IDENT)
+      size_t len;
+      const unsigned char *s = gen_lexer_token_string(lexer, &len);
+      ret = GENLEX_ON_IDENT(ctx, s, len);
+      (void)s; (void)len;  /* a handler may not need them */
+#else
+      ret = GENLEX_ON_TOKEN(ctx, tok);
+#endif
+    } else if (tok == GENLEX_STRING_TOKEN) {
+#if defined(GENLEX_ON_STRING)
+      size_t len;
+      const unsigned char *s = gen_lexer_token_string(lexer, &len);
+      ret = GENLEX_ON_STRING(ctx, s, len);
+      (void)s; (void)len;
+#else
+      ret = GENLEX_ON_TOKEN(ctx, tok);
+#endif
+    } else if (tok == GENLEX_INT_TOKEN) {
+#if defined(GENLEX_ON_INT)
+      ret = GENLEX_ON_INT(ctx, gen_lexer_token_int_value(lexer));
+#else
+      ret = GENLEX_ON_TOKEN(ctx, tok);
+#endif
+    }
+#if GENLEX_CONFIG_FLOATS
+    else if (GENLEX_FLOATS_ENABLED && (tok == GENLEX_FLOAT_TOKEN)) {
+#  if defined(GENLEX_ON_FLOAT) && GENLEX_CONFIG_DECIMAL
+      ret = GENLEX_ON_FLOAT(ctx, gen_lexer_token_decimal_value(lexer));
+#  elif defined(GENLEX_ON_FLOAT)
+      ret = GENLEX_ON_FLOAT(ctx, gen_lexer_token_float_value(lexer));
+#  else
+      ret = GENLEX_ON_TOKEN(ctx, tok);
+#  endif
+    }
+#endif
+#if GENLEX_CONFIG_BLOBS
+    else if (tok == GENLEX_BLOB_TOKEN) {
+      /* its text is the prefix, which would pass for a keyword below */
+#  if defined(GENLEX_ON_BLOB)
+      size_t len;
+      const unsigned char *p = gen_lexer_token_blob(lexer, &len);
+      ret = GENLEX_ON_BLOB(ctx, p, len);
+      (void)p; (void)len;
+#  else
+      ret = GENLEX_ON_TOKEN(ctx, tok);
+#  endif
+    }
+#endif
+    else if (GENLEX_COMMENT_TOKEN && (tok == GENLEX_COMMENT_TOKEN)) {
+#if defined(GENLEX_ON_COMMENT)
+      size_t len;
+      const unsigned char *s = gen_lexer_token_string(lexer, &len);
+      ret = GENLEX_ON_COMMENT(ctx, s, len);
+      (void)s; (void)len;
+#else
+      ret = GENLEX_ON_TOKEN(ctx, tok);
+#endif
+    } else if ((lexer->blen > 0) && GENLEX_IS_SYMBOL_START(lexer->buf[0])) {
+      /* a literal has no text, and a literal pair isn't a symbol */
+#if defined(GENLEX_ON_KEYWORD)
+      ret = GENLEX_ON_KEYWORD(ctx, tok);
+#else
+      ret = GENLEX_ON_TOKEN(ctx, tok);
+#endif
+    } else {
+#if defined(GENLEX_ON_LITERAL)
+      ret = GENLEX_ON_LITERAL(ctx, tok);
+#else
+      ret = GENLEX_ON_TOKEN(ctx, tok);
+#endif
+    }
+
+    if (ret != 0) { return ret; }
+  }
+}
+
+#undef GENLEX_RUN_NAME
+#undef GENLEX_RUN_CTX_T
+#undef GENLEX_ON_IDENT
+#undef GENLEX_ON_STRING
+#undef GENLEX_ON_COMMENT
+#undef GENLEX_ON_INT
+#undef GENLEX_ON_FLOAT
+#undef GENLEX_ON_BLOB
+#undef GENLEX_ON_RAW
+#undef GENLEX_ON_KEYWORD
+#undef GENLEX_ON_LITERAL
+#undef GENLEX_ON_ERROR
+#undef GENLEX_ON_TOKEN
@@ -0,0 +1,150 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+#define GENLEX_CONFIG_MEMORY 1
+
+#define GENLEX_STRING_MAX 64
+
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS "()=;+-*/"
+
+#define GENLEX_ID_TOKEN     1024
+#define GENLEX_STRING_TOKEN 1025
+#define GENLEX_INT_TOKEN    1026
+
+#define KW_IF    1027
+#define KW_WHILE 1028
+
+#define GENLEX_KEYWORDS { \
+  { "if"   , KW_IF    }, \
+  { "while", KW_WHILE }, \
+}
+
+#include "glex.h"
+#include "glex_batch.h"
+
+#define BATCH_NFILES 40
+
+struct batch_result {
+  int seen;
+  int err;
+  size_t ntoks;
+  long sum;       /* sum of the integer tokens */
+  int last_tok;
+};
+
+static int batch_collect(void *arg, const struct gen_lexer_batch_file *file)
+{
+  struct batch_result *res = arg;
+  struct batch_result *r = &res[file->index];
+  size_t i;
+
+  r->seen++;
+  r->err = file->err;
+  r->ntoks = file->ntoks;
+  for (i=0; i < file->ntoks; i++) {
+    if (file->toks[i].tok == GENLEX_INT_TOKEN) {
+      r->sum += file->toks[i].val.i;
+    }
+    r->last_tok = file->toks[i].tok;
+  }
+
+  return 0;
+}
+
+static int batch_stop_at_first(void *arg, const struct gen_lexer_batch_file *file)
+{
+  int *count = arg;
+  __sync_fetch_and_add(count, 1);
+  return 42;
+}
+
+/* File i holds i+1 copies of "x = <i> + (i*2);", and file 0 is large so
+ * that the other workers have to steal
+ */
+static int batch_write_files(char paths[][32], size_t n)
+{
+  size_t i;
+  int j;
+
+  for (i=0; i < n; i++) {
+    FILE *f;
+    int reps = (i == 0) ? 20000 : (int)i+1;
+    int fd;
+
+    strcpy(paths[i], "/tmp/glex_batch_XXXXXX");
+    if ((fd = mkstemp(paths[i])) < 0) { return 0; }
+    if ((f = fdopen(fd, "w")) == NULL) { return 0; }
+
+    for (j=0; j < reps; j++) {
+      fprintf(f, "x = %d + (%d);\n", (int)i, (int)i*2);
+    }
+    fclose(f);
+  }
+
+  return 1;
+}
+
+DEFTEST( batch_lexes_every_file )
+{
+  static char paths[BATCH_NFILES+1][32];
+  const char *pp[BATCH_NFILES+1];
+  struct batch_result res[BATCH_NFILES+1];
+  unsigned int nthreads;
+  size_t i;
+
+  EXPECT( 1, batch_write_files(paths, BATCH_NFILES) );
+  strcpy(paths[BATCH_NFILES], "/tmp/glex_batch_does_not_exist");
+  for (i=0; i <= BATCH_NFILES; i++) { pp[i] = paths[i]; }
+
+  for (nthreads=1; nthreads <= 8; nthreads++) {
+    memset(res, 0, sizeof res);
+    EXPECT( 0, gen_lexer_batch_lex(pp, BATCH_NFILES+1, nthreads, batch_collect, res) );
+
+    for (i=0; i < BATCH_NFILES; i++) {
+      long reps = (i == 0) ? 20000 : (long)i+1;
+      EXPECT( 1, res[i].seen );
+      EXPECT( 0, res[i].err );
+      EXPECT( (int)(8*reps), (int)res[i].ntoks );
+      EXPECT( (int)(3*i*reps), (int)res[i].sum );
+      EXPECT( ';', res[i].last_tok );
+    }
+
+    EXPECT( 1, res[BATCH_NFILES].seen );
+    EXPECT( GENLEX_ERR_IO, res[BATCH_NFILES].err );
+  }
+
+  for (i=0; i < BATCH_NFILES; i++) { unlink(paths[i]); }
+}
+
+DEFTEST( batch_callback_stops_batch )
+{
+  static char paths[BATCH_NFILES][32];
+  const char *pp[BATCH_NFILES];
+  int count = 0;
+  size_t i;
+
+  EXPECT( 1, batch_write_files(paths, BATCH_NFILES) );
+  for (i=0; i < BATCH_NFILES; i++) { pp[i] = paths[i]; }
+
+  EXPECT( 42, gen_lexer_batch_lex(pp, BATCH_NFILES, 4, batch_stop_at_first, &count) );
+  /* each worker finishes at most the file it is on */
+  EXPECT( 1, (count >= 1) && (count <= 4) );
+
+  for (i=0; i < BATCH_NFILES; i++) { unlink(paths[i]); }
+}
+
+void run_tests_batch(void)
+{
+  (void)gen_lexer_token_line;
+  (void)gen_lexer_token_col;
+  (void)gen_lexer_token_off;
+  (void)gen_lexer_token_int_value;
+
+  RUNTEST( batch_lexes_every_file );
+  RUNTEST( batch_callback_stops_batch );
+}
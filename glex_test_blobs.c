@@ -0,0 +1,300 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+/* Built twice: over memory, where blobs are decoded straight from the
+ * buffer, and as glex_test_blobs_stream.o over the stream backend, where
+ * they are read a byte at a time
+ */
+#if GLEX_TEST_BLOBS_STREAM
+#  define GENLEX_CONFIG_STREAM 1
+#else
+#  define GENLEX_CONFIG_MEMORY 1
+#endif
+
+/* small, so that blobs are longer than any token text */
+#define GENLEX_STRING_MAX 32
+
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS "(),;="
+
+#define GENLEX_ID_TOKEN     1024
+#define GENLEX_STRING_TOKEN 1025
+#define GENLEX_INT_TOKEN    1026
+#define GENLEX_BLOB_TOKEN   1027
+
+#define GENLEX_KEYWORDS {}
+
+#define GENLEX_CONFIG_BLOBS 1
+
+#include "glex.h"
+
+struct blob_input {
+#if GLEX_TEST_BLOBS_STREAM
+  struct gen_lexer_stream st;
+  const char *s;
+  size_t len, pos;
+#else
+  struct gen_lexer_membuf mb;
+#endif
+};
+
+#if GLEX_TEST_BLOBS_STREAM
+static size_t blob_read(void *arg, unsigned char *dst, size_t n)
+{
+  struct blob_input *in = arg;
+
+  if (n > 5) { n = 5; }
+  if (n > in->len - in->pos) { n = in->len - in->pos; }
+  memcpy(dst, in->s + in->pos, n);
+  in->pos += n;
+  return n;
+}
+#endif
+
+static void blob_open(struct gen_lexer *lexer, struct blob_input *in, const char *s)
+{
+#if GLEX_TEST_BLOBS_STREAM
+  in->s = s;
+  in->len = strlen(s);
+  in->pos = 0;
+  gen_lexer_stream_init(&in->st, blob_read, in, 16);
+  gen_lexer_initialize(lexer, &in->st);
+#else
+  in->mb.data = (const unsigned char *)s;
+  in->mb.len = strlen(s);
+  in->mb.pos = 0;
+  gen_lexer_initialize(lexer, &in->mb);
+#endif
+}
+
+static void blob_close(struct blob_input *in)
+{
+#if GLEX_TEST_BLOBS_STREAM
+  gen_lexer_stream_free(&in->st);
+#else
+  (void)in;
+#endif
+}
+
+/* Writes the literal of the n bytes at p into out */
+static void blob_literal(char *out, const unsigned char *p, size_t n, int b64, int pad)
+{
+  static const char b64digits[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  static const char hexdigits[2][17] = { "0123456789abcdef", "0123456789ABCDEF" };
+  size_t i;
+
+  if (!b64) {
+    *out++ = 'x';
+    *out++ = '"';
+    for (i = 0; i < n; i++) {
+      /* both cases of hex digit */
+      *out++ = hexdigits[i & 1][p[i] >> 4];
+      *out++ = hexdigits[i & 1][p[i] & 15];
+    }
+  } else {
+    memcpy(out, "b64\"", 4);
+    out += 4;
+    for (i = 0; i < n; i += 3) {
+      unsigned long v = (unsigned long)p[i] << 16;
+      if (i+1 < n) { v |= p[i+1] << 8; }
+      if (i+2 < n) { v |= p[i+2]; }
+      *out++ = b64digits[(v >> 18) & 63];
+      *out++ = b64digits[(v >> 12) & 63];
+      if (i+1 < n)  { *out++ = b64digits[(v >> 6) & 63]; }
+      else if (pad) { *out++ = '='; }
+      if (i+2 < n)  { *out++ = b64digits[v & 63]; }
+      else if (pad) { *out++ = '='; }
+    }
+  }
+  *out++ = '"';
+  *out = '\0';
+}
+
+/* Every length up to past a few SIMD blocks, each encoding */
+DEFTEST( blobs_roundtrip )
+{
+  static unsigned char bytes[100], arena[128];
+  static char text[256];
+  struct blob_input in;
+  struct gen_lexer lexer;
+  const unsigned char *p;
+  size_t n, len, i;
+  int enc;
+
+  for (i = 0; i < sizeof bytes; i++) {
+    bytes[i] = (unsigned char)(i*151 + 7);
+  }
+
+  for (enc = 0; enc < 3; enc++) {
+    for (n = 0; n < sizeof bytes; n++) {
+      blob_literal(text, bytes, n, enc > 0, enc == 1);
+      blob_open(&lexer, &in, text);
+      gen_lexer_blob_arena(&lexer, arena, sizeof arena);
+
+      EXPECT( GENLEX_BLOB_TOKEN, gen_lexer_next_token(&lexer) );
+      p = gen_lexer_token_blob(&lexer, &len);
+      EXPECT( n, len );
+      EXPECT( 1, (p == arena) && (memcmp(p, bytes, n) == 0) );
+      EXPECT( 0, gen_lexer_next_token(&lexer) );
+      blob_close(&in);
+    }
+  }
+}
+
+DEFTEST( blobs_tokens )
+{
+  static const char text[] =
+    "key = x\"00FF\", b64\"aGk=\";\n"
+    "x \"00\" xy\"00\" b64\"\" b64\"AAE\" x";
+  unsigned char arena[16];
+  struct blob_input in;
+  struct gen_lexer lexer;
+  const unsigned char *p;
+  size_t len;
+
+  blob_open(&lexer, &in, text);
+  gen_lexer_blob_arena(&lexer, arena, sizeof arena);
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( '=', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_BLOB_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "x", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( 6, gen_lexer_token_off(&lexer) );
+  p = gen_lexer_token_blob(&lexer, &len);
+  EXPECT( 2, len );
+  EXPECT( 1, (p[0] == 0x00) && (p[1] == 0xff) );
+
+  EXPECT( ',', gen_lexer_next_token(&lexer) );
+  EXPECT( 13, gen_lexer_token_col(&lexer) );
+  EXPECT( GENLEX_BLOB_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "b64", gen_lexer_token_string(&lexer, NULL) );
+  p = gen_lexer_token_blob(&lexer, &len);
+  EXPECT( 2, len );
+  EXPECT( 1, memcmp(p, "hi", 2) == 0 );
+  EXPECT( ';', gen_lexer_next_token(&lexer) );
+
+  /* a prefix must run right into the quote */
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 1, gen_lexer_token_line(&lexer) );
+  EXPECT( GENLEX_STRING_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "xy", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( GENLEX_STRING_TOKEN, gen_lexer_next_token(&lexer) );
+
+  EXPECT( GENLEX_BLOB_TOKEN, gen_lexer_next_token(&lexer) );
+  gen_lexer_token_blob(&lexer, &len);
+  EXPECT( 0, len );
+  EXPECT( GENLEX_BLOB_TOKEN, gen_lexer_next_token(&lexer) );
+  p = gen_lexer_token_blob(&lexer, &len);
+  EXPECT( 2, len );
+  EXPECT( 1, (p[0] == 0x00) && (p[1] == 0x01) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+
+  /* each blob follows the last in the arena */
+  EXPECT( 6, gen_lexer_blob_arena_used(&lexer) );
+  EXPECT( 1, memcmp(arena, "\x00\xffhi\x00\x01", 6) == 0 );
+  blob_close(&in);
+}
+
+DEFTEST( blobs_errors )
+{
+  static const struct {
+    const char *s;
+    int err;
+  } cases[] = {
+    { "x\"abc\"",        GENLEX_ERR_INVALID_BLOB },
+    { "x\"0g\"",         GENLEX_ERR_INVALID_BLOB },
+    { "x\"00 11\"",      GENLEX_ERR_INVALID_BLOB },
+    { "x\"000102030405060708zz0a0b0c0d0e0f1011121314151617\"", GENLEX_ERR_INVALID_BLOB },
+    { "b64\"A\"",        GENLEX_ERR_INVALID_BLOB },
+    { "b64\"AA=\"",      GENLEX_ERR_INVALID_BLOB },
+    { "b64\"A===\"",     GENLEX_ERR_INVALID_BLOB },
+    { "b64\"AA==AAAA\"", GENLEX_ERR_INVALID_BLOB },
+    { "b64\"AAAAA-AAAAAAAAAAAAAAAAAA\"", GENLEX_ERR_INVALID_BLOB },
+    { "x\"0011",         GENLEX_ERR_UNEXPECTED_EOF },
+    { "b64\"AAAA\n\"",   GENLEX_ERR_UNEXPECTED_EOL },
+    { "x\"00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff00\"",
+      GENLEX_ERR_BUFFER_OVERFLOW },
+    { "b64\"AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA\"", GENLEX_ERR_BUFFER_OVERFLOW },
+  };
+  unsigned char arena[32];
+  struct blob_input in;
+  struct gen_lexer lexer;
+  size_t i;
+
+  for (i = 0; i < sizeof cases / sizeof cases[0]; i++) {
+    blob_open(&lexer, &in, cases[i].s);
+    gen_lexer_blob_arena(&lexer, arena, sizeof arena);
+    EXPECT( cases[i].err, gen_lexer_next_token(&lexer) );
+    EXPECT( 0, gen_lexer_blob_arena_used(&lexer) );
+    blob_close(&in);
+  }
+
+  /* the literal is consumed, and takes nothing from the arena */
+  blob_open(&lexer, &in, "x\"0x\" x\"0102\"");
+  gen_lexer_blob_arena(&lexer, arena, sizeof arena);
+  EXPECT( GENLEX_ERR_INVALID_BLOB, gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_BLOB_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 1, gen_lexer_token_blob(&lexer, NULL) == arena );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+  blob_close(&in);
+
+  /* no arena, no room */
+  blob_open(&lexer, &in, "x\"00\" x\"\"");
+  EXPECT( GENLEX_ERR_BUFFER_OVERFLOW, gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_BLOB_TOKEN, gen_lexer_next_token(&lexer) );
+  blob_close(&in);
+}
+
+/* Sums the bytes of each blob, and counts what glex_run.h calls keywords */
+struct blob_sums {
+  unsigned long sum;
+  int blobs, keywords;
+};
+
+static int blob_sum(struct blob_sums *bs, const unsigned char *p, size_t len)
+{
+  size_t i;
+
+  for (i = 0; i < len; i++) { bs->sum += p[i]; }
+  bs->blobs++;
+  return 0;
+}
+
+#define GENLEX_ON_BLOB(ctx,p,len)   blob_sum((ctx), (p), (len))
+#define GENLEX_ON_KEYWORD(ctx,tok)  ((ctx)->keywords++, 0)
+#define GENLEX_RUN_CTX_T struct blob_sums *
+#include "glex_run.h"
+
+DEFTEST( blobs_run )
+{
+  unsigned char arena[16];
+  struct blob_sums bs = { 0, 0, 0 };
+  struct blob_input in;
+  struct gen_lexer lexer;
+
+  blob_open(&lexer, &in, "k = x\"0102\", b64\"/w==\"; x");
+  gen_lexer_blob_arena(&lexer, arena, sizeof arena);
+  EXPECT( 0, gen_lexer_run(&lexer, &bs) );
+  EXPECT( 2, bs.blobs );
+  EXPECT( 0x102, bs.sum );
+  EXPECT( 0, bs.keywords );
+  blob_close(&in);
+}
+
+void run_tests_blobs(void)
+{
+  (void)gen_lexer_token_int_value;
+
+  RUNTEST( blobs_roundtrip );
+  RUNTEST( blobs_tokens );
+  RUNTEST( blobs_errors );
+  RUNTEST( blobs_run );
+}
@@ -0,0 +1,207 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+#define GENLEX_CONFIG_MEMORY 1
+
+#define GENLEX_STRING_MAX 64
+
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS ",;"
+
+#define GENLEX_ID_TOKEN     1024
+#define GENLEX_STRING_TOKEN 1025
+#define GENLEX_INT_TOKEN    1026
+#define GENLEX_FLOAT_TOKEN  1027
+
+#define GENLEX_KEYWORDS {}
+
+#define GENLEX_INT_T long
+#define GENLEX_CONFIG_FLOATS 1
+
+#include "glex.h"
+#include "glex_convert.h"
+
+#define CONV_COUNT 20000
+
+/* Appends a run of n random digits */
+static size_t conv_digits(char *s, int n)
+{
+  int i;
+
+  for (i=0; i < n; i++) {
+    s[i] = '0' + rand() % 10;
+  }
+  return n;
+}
+
+/* Numbers of every length up to past what a long holds, with and without
+ * signs, leading zeros, fractions and exponents
+ */
+static char *conv_text(int count, size_t *lenp)
+{
+  size_t cap = (size_t)count * 48, len = 0;
+  char *text = malloc(cap);
+  int i;
+
+  for (i=0; i < count; i++) {
+    int shape = rand() % 8;
+
+    if (rand() % 3 == 0) { text[len++] = '-'; }
+    if (shape == 0) { len += conv_digits(text + len, 1 + rand() % 3); text[len-1] = '0'; }
+    len += conv_digits(text + len, 1 + rand() % ((shape < 4) ? 22 : 12));
+
+    if (shape >= 4) {
+      text[len++] = '.';
+      len += conv_digits(text + len, rand() % 12);
+    }
+    if (shape >= 6) {
+      text[len++] = (rand() % 2) ? 'e' : 'E';
+      if (rand() % 2) { text[len++] = (rand() % 2) ? '-' : '+'; }
+      len += conv_digits(text + len, 1 + rand() % ((shape == 6) ? 2 : 3));
+    }
+
+    text[len++] = (i % 10 == 9) ? '\n' : ',';
+  }
+  *lenp = len;
+
+  return text;
+}
+
+/* The batch conversion agrees with the lexer's, values and errors */
+DEFTEST( convert_matches_lexer )
+{
+  struct gen_lexer_membuf mb;
+  struct gen_lexer lexer;
+  struct gen_lexer_token *toks;
+  union gen_lexer_value *want, *vals;
+  int *wanterr, *errs;
+  size_t len, n = 0, ok = 0, i, bad = 0, nerr = 0;
+  char *text;
+  int tok;
+
+  srand(46);
+  text = conv_text(CONV_COUNT, &len);
+  toks = malloc(CONV_COUNT * sizeof toks[0]);
+  want = malloc(CONV_COUNT * sizeof want[0]);
+  vals = malloc(CONV_COUNT * sizeof vals[0]);
+  wanterr = malloc(CONV_COUNT * sizeof wanterr[0]);
+  errs = malloc(CONV_COUNT * sizeof errs[0]);
+
+  mb.data = (const unsigned char *)text; mb.len = len; mb.pos = 0;
+  gen_lexer_initialize(&lexer, &mb);
+  while ((tok = gen_lexer_next_token(&lexer)) != 0) {
+    if (tok == ',') { continue; }
+
+    toks[n].off = gen_lexer_token_off(&lexer);
+    toks[n].end = lexer.off;
+    memset(&want[n], 0, sizeof want[n]);
+    wanterr[n] = 0;
+    if (tok < 0) {
+      wanterr[n] = tok;
+      nerr++;
+    } else if (tok == GENLEX_INT_TOKEN) {
+      want[n].i = gen_lexer_token_int_value(&lexer);
+    } else {
+      want[n].f = gen_lexer_token_float_value(&lexer);
+    }
+
+    ok += (tok > 0);
+    n++;
+  }
+  EXPECT( CONV_COUNT, n );
+  EXPECT( 1, nerr > 0 && nerr < n/4 );
+
+  EXPECT( ok, gen_lexer_convert_numbers((const unsigned char *)text, len, toks, n, vals, errs) );
+  for (i=0; i < n; i++) {
+    if (errs[i] != wanterr[i] || memcmp(&vals[i], &want[i], sizeof vals[i]) != 0) {
+      if (bad++ < 5) {
+        printf("\n  %.*s: %d %d", (int)(toks[i].end - toks[i].off), text + toks[i].off,
+            errs[i], wanterr[i]);
+      }
+    }
+  }
+  EXPECT( 0, bad );
+
+  free(errs); free(wanterr); free(vals); free(want); free(toks);
+  free(text);
+}
+
+DEFTEST( convert_edges )
+{
+  static const struct {
+    const char *s;
+    int err;
+    long i;
+  } cases[] = {
+    { "0", 0, 0 },
+    { "-0", 0, 0 },
+    { "7", 0, 7 },
+    { "12345678", 0, 12345678 },
+    { "123456789", 0, 123456789 },
+    { "0000000000000000000000001", 0, 1 },
+    { "9223372036854775807", 0, 9223372036854775807L },
+    { "-9223372036854775808", 0, -9223372036854775807L - 1 },
+    { "9223372036854775808", GENLEX_ERR_INTEGER_OVERFLOW, 0 },
+    { "-9223372036854775809", GENLEX_ERR_INTEGER_OVERFLOW, 0 },
+    { "99999999999999999999", GENLEX_ERR_INTEGER_OVERFLOW, 0 },
+    { "-", GENLEX_ERR_INVALID_INTEGER, 0 },
+    { "12a4", GENLEX_ERR_INVALID_INTEGER, 0 },
+    { "1:", GENLEX_ERR_INVALID_INTEGER, 0 },
+    { "/9", GENLEX_ERR_INVALID_INTEGER, 0 },
+  };
+  struct gen_lexer_token t;
+  union gen_lexer_value v;
+  size_t i;
+  int err;
+
+  for (i=0; i < sizeof cases / sizeof cases[0]; i++) {
+    const char *s = cases[i].s;
+
+    /* at the start of the input, and well into it */
+    char buf[64];
+    memset(buf, ' ', 16);
+    strcpy(buf + 16, s);
+
+    t.off = 0; t.end = strlen(s);
+    EXPECT( (cases[i].err == 0), gen_lexer_convert_numbers((const unsigned char *)s, t.end, &t, 1, &v, &err) );
+    EXPECT( cases[i].err, err );
+    EXPECT( 1, v.i == cases[i].i );
+
+    t.off = 16; t.end = 16 + strlen(s) + 1;  /* the lexer's end counts the EOF */
+    gen_lexer_convert_numbers((const unsigned char *)buf, strlen(buf), &t, 1, &v, &err);
+    EXPECT( cases[i].err, err );
+    EXPECT( 1, v.i == cases[i].i );
+  }
+
+  /* floats, exact and not */
+  t.off = 0;
+  t.end = 6;
+  gen_lexer_convert_numbers((const unsigned char *)"-2.5e3,", 7, &t, 1, &v, &err);
+  EXPECT( 0, err );
+  EXPECT( 1, v.f == -2500.0 );
+  t.end = 3;
+  gen_lexer_convert_numbers((const unsigned char *)"0.1", 3, &t, 1, &v, &err);
+  EXPECT( 1, v.f == 0.1 );
+  t.end = 6;
+  gen_lexer_convert_numbers((const unsigned char *)"1e-400", 6, &t, 1, &v, &err);
+  EXPECT( GENLEX_ERR_FLOAT_OVERFLOW, err );
+  t.end = 5;
+  gen_lexer_convert_numbers((const unsigned char *)"1e300", 5, &t, 1, &v, &err);
+  EXPECT( 0, err );
+  EXPECT( 1, v.f == 1e300 );
+}
+
+void run_tests_convert(void)
+{
+  (void)gen_lexer_token_string;
+  (void)gen_lexer_token_line;
+  (void)gen_lexer_token_col;
+
+  RUNTEST( convert_matches_lexer );
+  RUNTEST( convert_edges );
+}
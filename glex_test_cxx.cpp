@@ -0,0 +1,223 @@
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <string_view>
+#include <utility>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+#define GENLEX_STRING_MAX 64
+
+#include "glex.hpp"
+
+enum {
+  CX_ID = 1024, CX_STRING, CX_INT, CX_FLOAT, CX_COMMENT,
+  CX_IF, CX_WHILE, CX_RETURN, CX_EQ, CX_AND,
+};
+
+/* The C-like dialect of glex_test_runtime.c */
+struct c_dialect : glex::config {
+  static constexpr std::string_view literals = "(){}=;+-*/<>&";
+  static constexpr glex::keyword keywords[] = {
+    { "if", CX_IF }, { "while", CX_WHILE }, { "return", CX_RETURN },
+  };
+  static constexpr glex::pair pairs[] = { { "==", CX_EQ }, { "&&", CX_AND } };
+  static constexpr glex::comment comments[] = { { "/*", "*/" }, { "//", "\n" } };
+
+  static constexpr int id_token = CX_ID;
+  static constexpr int string_token = CX_STRING;
+  static constexpr int int_token = CX_INT;
+  static constexpr int float_token = CX_FLOAT;
+  static constexpr int comment_token = CX_COMMENT;
+};
+
+/* c_dialect with SQL-style keywords */
+struct c_nocase : c_dialect {
+  static constexpr bool keywords_nocase = true;
+};
+
+/* Only the defaults: symbols, numbers and strings */
+struct bare : glex::config {};
+
+/* the tables are built by the compiler */
+static_assert(glex::detail::tables<c_dialect>::value.kwmask == 7, "");
+static_assert(glex::detail::tables<c_dialect>::value.cls['&'] ==
+              (GENLEX_CLS_LITERAL | GENLEX_CLS_PAIR), "");
+static_assert(glex::detail::tables<bare>::value.kwtab == nullptr, "");
+
+DEFTEST( cxx_tokens_and_spans )
+{
+  std::string_view text = "while (x == 2.5) { /* loop */ y = \"a\\tb\"; }\n  return 7;";
+  glex::lexer<c_dialect> lx(text);
+  glex::token t;
+
+  t = lx.next();
+  EXPECT( CX_WHILE, t.kind );
+  EXPECT( 1, t.text == "while" );
+  EXPECT( '(', lx.next().kind );
+  t = lx.next();
+  EXPECT( CX_ID, t.kind );
+  EXPECT( 7, t.off );
+  EXPECT( 1, lx.value() == "x" );
+  EXPECT( CX_EQ, lx.next().kind );
+  t = lx.next();
+  EXPECT( CX_FLOAT, t.kind );
+  EXPECT( 1, t.text == "2.5" );
+  EXPECT( 1, lx.float_value() == 2.5 );
+  EXPECT( ')', lx.next().kind );
+  EXPECT( '{', lx.next().kind );
+
+  t = lx.next();
+  EXPECT( CX_COMMENT, t.kind );
+  EXPECT( 1, t.text == "/* loop */" );
+  EXPECT( CX_ID, lx.next().kind );
+  EXPECT( '=', lx.next().kind );
+
+  /* the span keeps the quotes and escapes; the value is decoded */
+  t = lx.next();
+  EXPECT( CX_STRING, t.kind );
+  EXPECT( 1, t.text == "\"a\\tb\"" );
+  EXPECT( 1, lx.value() == "a\tb" );
+  EXPECT( ';', lx.next().kind );
+  EXPECT( '}', lx.next().kind );
+
+  t = lx.next();
+  EXPECT( CX_RETURN, t.kind );
+  EXPECT( 1, t.line );
+  EXPECT( 2, t.col );
+  t = lx.next();
+  EXPECT( CX_INT, t.kind );
+  EXPECT( 7, lx.int_value() );
+  EXPECT( ';', lx.next().kind );
+
+  t = lx.next();
+  EXPECT( 0, t.kind );
+  EXPECT( 1, t.off == text.size() );
+  EXPECT( 1, t.text.empty() );
+  EXPECT( 0, (bool)t );
+}
+
+/* The compiled tables lex like the ones gen_lexer_compile() builds */
+DEFTEST( cxx_matches_runtime_tables )
+{
+  static const struct gen_lexer_keyword kws[] = {
+    { "if", CX_IF }, { "while", CX_WHILE }, { "return", CX_RETURN },
+  };
+  static const struct gen_lexer_literal_pair prs[] = { { { '=', '=' }, CX_EQ }, { { '&', '&' }, CX_AND } };
+  static const struct gen_lexer_comment_pairs cms[] = {
+    { { '/', '*' }, { '*', '/' } }, { { '/', '/' }, { '\n', 0 } },
+  };
+  struct gen_lexer_config cfg = {
+    "(){}=;+-*/<>&", prs, 2, kws, 3, cms, 2,
+    GENLEX_ALPHA "_", GENLEX_ALPHA "_" GENLEX_DIGITS, " \t\n\v\f\r",
+    CX_ID, CX_STRING, CX_INT, CX_FLOAT, CX_COMMENT,
+  };
+  const struct gen_lexer_tables &ct = glex::detail::tables<c_dialect>::value;
+  static const char text[] =
+    "if(a&&b){return x==-12;}// c\n/* d\n */ while \"s\\n\" 'q' 1e3 ifx @";
+  struct gen_lexer_membuf mb = { (const unsigned char *)text, sizeof text - 1, 0 };
+  struct gen_lexer_tables tab;
+  struct gen_lexer clx;
+  glex::lexer<c_dialect> lx(text);
+  size_t i;
+  int tok;
+
+  EXPECT( 0, gen_lexer_compile(&tab, &cfg) );
+  EXPECT( 0, memcmp(tab.cls, ct.cls, sizeof tab.cls) );
+  EXPECT( 1, tab.kwmask == ct.kwmask );
+  for (i = 0; i <= tab.kwmask; i++) {
+    EXPECT( tab.kwtab[i].keyword == NULL, ct.kwtab[i].keyword == nullptr );
+    EXPECT( tab.kwtab[i].token, ct.kwtab[i].token );
+  }
+
+  gen_lexer_initialize_with(&clx, &tab, &mb);
+  do {
+    glex::token t = lx.next();
+    tok = gen_lexer_next_token(&clx);
+    EXPECT( tok, t.kind );
+    EXPECT( 1, t.off == ((tok != 0) ? clx.tok_off : sizeof text - 1) );
+  } while (tok > 0);
+  EXPECT( GENLEX_ERR_INVALID_CHAR, tok );
+
+  gen_lexer_tables_free(&tab);
+}
+
+DEFTEST( cxx_range_and_move )
+{
+  std::string_view text = "a b 1 \"c\" d";
+  glex::lexer<bare> lx(text);
+  std::string_view expect[] = { "a", "b", "1", "\"c\"", "d" };
+  size_t n = 0;
+
+  for (const glex::token &t : lx) {
+    EXPECT( 1, n < 5 );
+    EXPECT( 1, t.text == expect[n] );
+    n++;
+  }
+  EXPECT( 5, n );
+  EXPECT( 0, lx.next().kind );
+
+  /* a moved lexer carries on where the other one was */
+  lx.reset(text);
+  EXPECT( CX_ID, lx.next().kind );
+  glex::lexer<bare> moved(std::move(lx));
+  EXPECT( 1, moved.next().text == "b" );
+  EXPECT( 3, std::distance(moved.begin(), moved.end()) );
+
+  glex::lexer<bare> other("x");
+  other = std::move(moved);
+  other.reset("p q");
+  EXPECT( 2, std::count_if(other.begin(), other.end(),
+                           [](const glex::token &t) { return t.kind == CX_ID; }) );
+
+  /* an error is the last token of a range */
+  glex::lexer<bare> bad("a ; b");
+  n = 0;
+  for (const glex::token &t : bad) {
+    EXPECT( (n == 0) ? (int)CX_ID : (int)GENLEX_ERR_INVALID_CHAR, t.kind );
+    n++;
+  }
+  EXPECT( 2, n );
+}
+
+DEFTEST( cxx_skip_group )
+{
+  glex::lexer<c_dialect> lx("f { a { \"}\" } /* } */ } ;");
+  glex::token t;
+
+  EXPECT( CX_ID, lx.next().kind );
+  EXPECT( '{', lx.next().kind );
+  EXPECT( '}', lx.skip_group('{', '}') );
+  t = lx.next();
+  EXPECT( ';', t.kind );
+  EXPECT( 24, t.off );
+  EXPECT( 1, lx.c_lexer()->tab == &glex::detail::tables<c_dialect>::value );
+}
+
+DEFTEST( cxx_keywords_nocase )
+{
+  glex::lexer<c_nocase> lx("WHILE While while If");
+  glex::lexer<c_dialect> exact("WHILE while");
+  glex::token t;
+
+  t = lx.next();
+  EXPECT( CX_WHILE, t.kind );
+  EXPECT( 1, t.text == "WHILE" );
+  EXPECT( CX_WHILE, lx.next().kind );
+  EXPECT( CX_WHILE, lx.next().kind );
+  EXPECT( CX_IF, lx.next().kind );
+  EXPECT( 0, lx.next().kind );
+
+  EXPECT( CX_ID, exact.next().kind );
+  EXPECT( CX_WHILE, exact.next().kind );
+}
+
+extern "C" void run_tests_cxx(void)
+{
+  RUNTEST( cxx_tokens_and_spans );
+  RUNTEST( cxx_matches_runtime_tables );
+  RUNTEST( cxx_range_and_move );
+  RUNTEST( cxx_skip_group );
+  RUNTEST( cxx_keywords_nocase );
+}
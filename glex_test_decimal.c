@@ -0,0 +1,152 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+#define GENLEX_CONFIG_MEMORY 1
+
+#define GENLEX_STRING_MAX 64
+
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS "(),;"
+
+#define GENLEX_ID_TOKEN     1024
+#define GENLEX_STRING_TOKEN 1025
+#define GENLEX_INT_TOKEN    1026
+#define GENLEX_FLOAT_TOKEN  1027
+
+#define GENLEX_KEYWORDS {}
+
+#define GENLEX_CONFIG_FLOATS  1
+#define GENLEX_CONFIG_DECIMAL 1
+
+#include "glex.h"
+#include "glex_packed.h"
+#include "glex_convert.h"
+
+/* Lexes s, which must be a single token, and returns it */
+static int dec_lex(const char *s, struct gen_lexer *lexer, struct gen_lexer_membuf *mb)
+{
+  mb->data = (const unsigned char *)s;
+  mb->len = strlen(s);
+  mb->pos = 0;
+  gen_lexer_initialize(lexer, mb);
+  return gen_lexer_next_token(lexer);
+}
+
+static const struct {
+  const char *s;
+  unsigned long long coef;
+  int exp;
+  int neg;
+  int big;
+} dec_cases[] = {
+  { "1.50",        150ull,  -2, 0, 0 },
+  { "0.1",         1ull,    -1, 0, 0 },
+  { "-0.05",       5ull,    -2, 1, 0 },
+  { "1.5e3",       15ull,    2, 0, 0 },
+  { "2E-7",        2ull,    -7, 0, 0 },
+  { "7e+0",        7ull,     0, 0, 0 },
+  { "0.000",       0ull,    -3, 0, 0 },
+  { "-0.0",        0ull,    -1, 1, 0 },
+  { "1e0000000001", 1ull,    1, 0, 0 },
+  { "0000000000000000000001.25", 125ull, -2, 0, 0 },
+  { "9999999999999999999.",  9999999999999999999ull, 0, 0, 0 },
+  { "18446744073709551615.0", 0ull, 0, 0, 1 },
+  { "-0.12345678901234567890", 0ull, 0, 1, 1 },
+  { "1e1234567890", 0ull,    0, 0, 1 },
+  { "1.25e-999999999", 125ull, -1000000001, 0, 0 },
+};
+
+DEFTEST( decimal_values )
+{
+  struct gen_lexer_membuf mb;
+  struct gen_lexer lexer;
+  struct gen_lexer_decimal d;
+  size_t i;
+
+  for (i = 0; i < sizeof dec_cases / sizeof dec_cases[0]; i++) {
+    EXPECT( GENLEX_FLOAT_TOKEN, dec_lex(dec_cases[i].s, &lexer, &mb) );
+    d = gen_lexer_token_decimal_value(&lexer);
+    EXPECT( 1, d.coef == dec_cases[i].coef );
+    EXPECT( dec_cases[i].exp, d.exp );
+    EXPECT( dec_cases[i].neg, d.neg );
+    EXPECT( dec_cases[i].big, d.big );
+
+    /* the text is there for big ones */
+    EXPECT_STR( dec_cases[i].s, (const char *)gen_lexer_token_string(&lexer, NULL) );
+  }
+
+  /* integers are as they were */
+  EXPECT( GENLEX_INT_TOKEN, dec_lex("-42", &lexer, &mb) );
+  EXPECT( -42, gen_lexer_token_int_value(&lexer) );
+
+  EXPECT( GENLEX_ERR_INVALID_CHAR, dec_lex("1.5e", &lexer, &mb) );
+  EXPECT( GENLEX_ERR_INVALID_CHAR, dec_lex("1.5x", &lexer, &mb) );
+
+  /* no digits, as with strtod() */
+  EXPECT( GENLEX_ERR_INVALID_INTEGER, dec_lex("-.", &lexer, &mb) );
+  EXPECT( GENLEX_ERR_INVALID_INTEGER, dec_lex("-e5", &lexer, &mb) );
+  EXPECT( GENLEX_ERR_INVALID_INTEGER, dec_lex("-.e3", &lexer, &mb) );
+}
+
+/* Records, packed streams and batch conversion carry decimals too */
+DEFTEST( decimal_packed_and_convert )
+{
+  static const char text[] = "(1.50, -2e-3, 18446744073709551615.0, 7; 0.1)";
+  struct gen_lexer_membuf mb = { (const unsigned char *)text, sizeof text - 1, 0 };
+  struct gen_lexer lexer;
+  struct gen_lexer_packed pk;
+  struct gen_lexer_packed_iter it;
+  struct gen_lexer_token rec, nums[8];
+  union gen_lexer_value vals[8];
+  int errs[8];
+  size_t n = 0, i;
+
+  gen_lexer_initialize(&lexer, &mb);
+  gen_lexer_packed_init(&pk);
+  EXPECT( 0, gen_lexer_packed_lex(&pk, &lexer) );
+
+  gen_lexer_packed_seek(&pk, &it, 0);
+  while (gen_lexer_packed_next(&it, &rec)) {
+    if ((rec.tok == GENLEX_FLOAT_TOKEN) || (rec.tok == GENLEX_INT_TOKEN)) { nums[n++] = rec; }
+  }
+  gen_lexer_packed_free(&pk);
+  EXPECT( 5, n );
+
+  EXPECT( 1, nums[0].val.d.coef == 150 );
+  EXPECT( -2, nums[0].val.d.exp );
+  EXPECT( 1, nums[1].val.d.coef == 2 && nums[1].val.d.neg );
+  EXPECT( -3, nums[1].val.d.exp );
+  EXPECT( 1, nums[2].val.d.big );
+  EXPECT( 7, nums[3].val.i );
+  EXPECT( -1, nums[4].val.d.exp );
+
+  EXPECT( 5, gen_lexer_convert_numbers((const unsigned char *)text, sizeof text - 1,
+        nums, n, vals, errs) );
+  for (i = 0; i < n; i++) {
+    EXPECT( 0, errs[i] );
+    if (nums[i].tok == GENLEX_INT_TOKEN) {
+      EXPECT( nums[i].val.i, vals[i].i );
+      continue;
+    }
+    EXPECT( 1, vals[i].d.coef == nums[i].val.d.coef );
+    EXPECT( nums[i].val.d.exp, vals[i].d.exp );
+    EXPECT( nums[i].val.d.neg, vals[i].d.neg );
+    EXPECT( nums[i].val.d.big, vals[i].d.big );
+  }
+}
+
+void run_tests_decimal(void)
+{
+  (void)gen_lexer_token_off;
+  (void)gen_lexer_token_line;
+  (void)gen_lexer_token_col;
+  (void)gen_lexer_packed_clear;
+
+  RUNTEST( decimal_values );
+  RUNTEST( decimal_packed_and_convert );
+}
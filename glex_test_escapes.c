@@ -0,0 +1,117 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+#define GENLEX_CONFIG_MEMORY 1
+
+#define GENLEX_STRING_MAX 64
+
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS "()=;,"
+
+#define GENLEX_ID_TOKEN     1024
+#define GENLEX_STRING_TOKEN 1025
+#define GENLEX_INT_TOKEN    1026
+
+#define GENLEX_KEYWORDS {}
+
+#define GENLEX_ESCAPES GENLEX_C90_ESCAPES
+
+#include "glex.h"
+
+#define MEMBUF(s) { (const unsigned char *)(s), sizeof(s)-1, 0 }
+
+/* Lexes s, which must be a single token, and returns it */
+static int esc_lex(const char *s, struct gen_lexer *lexer, struct gen_lexer_membuf *mb)
+{
+  mb->data = (const unsigned char *)s;
+  mb->len = strlen(s);
+  mb->pos = 0;
+  gen_lexer_initialize(lexer, mb);
+  return gen_lexer_next_token(lexer);
+}
+
+DEFTEST( escapes_c90_strings )
+{
+  struct gen_lexer_membuf mb;
+  struct gen_lexer lexer;
+  const unsigned char *s;
+  size_t len;
+
+  EXPECT( GENLEX_STRING_TOKEN, esc_lex( "\"\\a\\b\\f\\v\\'\\?\\\"\\\\\"", &lexer, &mb ) );
+  EXPECT_STR( "\a\b\f\v'?\"\\", (const char *)gen_lexer_token_string(&lexer, NULL) );
+
+  /* one to two hex digits, one to three octal digits */
+  EXPECT( GENLEX_STRING_TOKEN, esc_lex( "\"\\x41\\x4g\\1234\\101\\7x\"", &lexer, &mb ) );
+  EXPECT_STR( "A\x04gS4A\007x", (const char *)gen_lexer_token_string(&lexer, NULL) );
+
+  /* \0 is a byte like any other */
+  EXPECT( GENLEX_STRING_TOKEN, esc_lex( "\"a\\0b\\000\"", &lexer, &mb ) );
+  s = gen_lexer_token_string(&lexer, &len);
+  EXPECT( 4, len );
+  EXPECT( 0, memcmp(s, "a\0b\0", 4) );
+}
+
+DEFTEST( escapes_c90_chars )
+{
+  struct gen_lexer_membuf mb;
+  struct gen_lexer lexer;
+
+  EXPECT( GENLEX_INT_TOKEN, esc_lex( "'\\x7f'", &lexer, &mb ) );
+  EXPECT( 0x7f, gen_lexer_token_int_value(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, esc_lex( "'\\377'", &lexer, &mb ) );
+  EXPECT( 0xff, gen_lexer_token_int_value(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, esc_lex( "'\\''", &lexer, &mb ) );
+  EXPECT( '\'', gen_lexer_token_int_value(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, esc_lex( "'\\0'", &lexer, &mb ) );
+  EXPECT( 0, gen_lexer_token_int_value(&lexer) );
+}
+
+DEFTEST( escapes_c90_errors )
+{
+  static const char *const bad[] = {
+    "\"\\q\"",      /* not in the list */
+    "\"\\u00e9\"",  /* not in C90 */
+    "\"\\xg\"",     /* no digits */
+    "\"\\400\"",    /* too large for a byte */
+    "'\\8'",
+  };
+  struct gen_lexer_membuf mb;
+  struct gen_lexer lexer;
+  size_t i;
+
+  for (i = 0; i < sizeof bad / sizeof bad[0]; i++) {
+    EXPECT( GENLEX_ERR_UNRECOGNIZED_ESCAPE, esc_lex(bad[i], &lexer, &mb) );
+  }
+
+  EXPECT( GENLEX_ERR_UNEXPECTED_EOF, esc_lex( "\"\\x4", &lexer, &mb ) );
+  EXPECT( GENLEX_ERR_UNEXPECTED_EOF, esc_lex( "\"\\", &lexer, &mb ) );
+}
+
+DEFTEST( escapes_positions )
+{
+  struct gen_lexer_membuf mb = MEMBUF( "\"\\x41\\101\" x" );
+  struct gen_lexer lexer;
+
+  /* the digits are consumed, and the byte after them isn't */
+  gen_lexer_initialize(&lexer, &mb);
+  EXPECT( GENLEX_STRING_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "AA", (const char *)gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 11, gen_lexer_token_off(&lexer) );
+  EXPECT( 0, gen_lexer_token_line(&lexer) );
+  EXPECT( 11, gen_lexer_token_col(&lexer) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+}
+
+void run_tests_escapes(void)
+{
+  RUNTEST( escapes_c90_strings );
+  RUNTEST( escapes_c90_chars );
+  RUNTEST( escapes_c90_errors );
+  RUNTEST( escapes_positions );
+}
@@ -0,0 +1,231 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+#define GENLEX_CONFIG_MEMORY 1
+
+#define GENLEX_STRING_MAX 64
+
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS "(){}=;+-*/,.<"
+
+#define GENLEX_ID_TOKEN      1024
+#define GENLEX_STRING_TOKEN  1025
+#define GENLEX_INT_TOKEN     1026
+#define GENLEX_COMMENT_TOKEN 1027
+#define GENLEX_FLOAT_TOKEN   1028
+
+#define KW_IF    1029
+#define KW_WHILE 1030
+
+#define LIT_EQ 512
+#define LIT_LE 513
+
+#define GENLEX_LITERAL_PAIRS { \
+  { "==", LIT_EQ },            \
+  { "<=", LIT_LE },            \
+}
+
+#define GENLEX_KEYWORDS { \
+  { "if"   , KW_IF    }, \
+  { "while", KW_WHILE }, \
+}
+
+#define GENLEX_COMMENT_PAIRS GENLEX_C99_COMMENTS
+#define GENLEX_CONFIG_FLOATS 1
+
+#include "glex.h"
+#include "glex_index.h"
+
+static void index_serial(const unsigned char *data, size_t len, struct gen_lexer_tokens *out)
+{
+  struct gen_lexer lexer;
+  struct gen_lexer_membuf mb = { data, len, 0 };
+  struct gen_lexer_token rec;
+  int tok;
+
+  gen_lexer_initialize(&lexer, &mb);
+  while ((tok = gen_lexer_next_token(&lexer)) != 0) {
+    gen_lexer_token_record(&lexer, tok, &rec);
+    gen_lexer_tokens_push(out, &rec);
+  }
+}
+
+static int index_same_token(const struct gen_lexer_token *a, const struct gen_lexer_token *b)
+{
+  if ((a->tok != b->tok) || (a->off != b->off) || (a->end != b->end) ||
+      (a->line != b->line) || (a->col != b->col)) {
+    return 0;
+  }
+
+  if (a->tok == GENLEX_FLOAT_TOKEN) {
+    return a->val.f == b->val.f;
+  }
+
+  if (a->tok == GENLEX_INT_TOKEN) {
+    return a->val.i == b->val.i;
+  }
+
+  return 1;
+}
+
+/* Lexes data both ways, returns 1 if the tokens are the same */
+static int index_check(struct gen_lexer_index *idx, const char *data, size_t len)
+{
+  struct gen_lexer_tokens serial = { NULL, 0, 0 };
+  struct gen_lexer_tokens indexed = { NULL, 0, 0 };
+  int ok = 1;
+  size_t i;
+
+  index_serial((const unsigned char *)data, len, &serial);
+  if ((gen_lexer_index_build(idx, (const unsigned char *)data, len) != 0) ||
+      (gen_lexer_index_lex(idx, &indexed) != 0) || (serial.len != indexed.len)) {
+    ok = 0;
+  }
+  for (i=0; ok && (i < serial.len); i++) {
+    ok = index_same_token(&serial.toks[i], &indexed.toks[i]);
+  }
+
+  gen_lexer_tokens_free(&serial);
+  gen_lexer_tokens_free(&indexed);
+  return ok;
+}
+
+static const char *index_inputs[] = {
+  "",
+  "   \n\t  \n",
+  "while (x == 3.25e1) { y = \"a /* not */ comment\"; }\n",
+  "/* a \"quoted\" comment\n   over // two lines */\n",
+  "if (foo_bar) { s = \"escaped \\\" quote // too\"; } // line \"comment\n",
+  "  n = -17 + 'c' * '\\n' - x;\n",
+  "z = @ 12q;\n",
+  "x = \"unterminated\n y = 2;",
+  "x = \"unterminated at the end",
+  "a <= b < c, d <e",
+  "ends_in_a_symbol",
+  "ends_in_a_keyword while",
+  "a_symbol_that_is_much_longer_than_the_sixty_four_byte_buffer_of_the_lexer = 1;",
+  "s = \"a string that is much longer than the sixty four byte buffer of the lexer\";",
+  "\x80\xff caf\xc3\xa9 \x01;",
+  "abc\"def\"ghi\n\n\n   \"\" 'x' 1.5.2",
+};
+
+DEFTEST( index_matches_serial )
+{
+  struct gen_lexer_index idx;
+  size_t i;
+
+  gen_lexer_index_init(&idx);
+  for (i=0; i < sizeof index_inputs / sizeof index_inputs[0]; i++) {
+    EXPECT( 1, index_check(&idx, index_inputs[i], strlen(index_inputs[i])) );
+  }
+  gen_lexer_index_free(&idx);
+}
+
+DEFTEST( index_matches_serial_on_noise )
+{
+  static const char alphabet[] = "ab_19 \n\t\"\\'/*=<+-.e;(){}#@\x80";
+  static char buf[400];
+  struct gen_lexer_index idx;
+  unsigned int seed = 1;
+  int n, failures = 0;
+
+  gen_lexer_index_init(&idx);
+  for (n = 0; n < 2000; n++) {
+    size_t len, i;
+
+    seed = seed * 1103515245u + 12345u;
+    len = (seed >> 8) % sizeof buf;
+    for (i=0; i < len; i++) {
+      seed = seed * 1103515245u + 12345u;
+      buf[i] = alphabet[(seed >> 16) % (sizeof alphabet - 1)];
+    }
+
+    if (!index_check(&idx, buf, len)) { failures++; }
+  }
+  gen_lexer_index_free(&idx);
+
+  EXPECT( 0, failures );
+}
+
+DEFTEST( index_bitmaps )
+{
+  static char buf[200];
+  struct gen_lexer_index idx;
+  size_t i;
+
+  for (i=0; i < sizeof buf; i++) {
+    buf[i] = (i % 7 == 0) ? ' ' : (i % 11 == 0) ? '\n' : (i % 13 == 0) ? '"' : 'x';
+  }
+
+  gen_lexer_index_init(&idx);
+  EXPECT( 0, gen_lexer_index_build(&idx, (const unsigned char *)buf, sizeof buf) );
+  EXPECT( 4, idx.nblocks );
+
+  for (i=0; i < sizeof buf; i++) {
+    unsigned long long *bits = idx.bits + GENLEX_INDEX_NUM*(i/64);
+    unsigned long long bit = 1ull << (i%64);
+
+    EXPECT( isspace((unsigned char)buf[i]) != 0, (bits[GENLEX_INDEX_WS] & bit) != 0 );
+    EXPECT( buf[i] == 'x', (bits[GENLEX_INDEX_SYMBOL] & bit) != 0 );
+    EXPECT( buf[i] == '"', (bits[GENLEX_INDEX_QUOTE] & bit) != 0 );
+    EXPECT( buf[i] == '\n', (bits[GENLEX_INDEX_NEWLINE] & bit) != 0 );
+  }
+
+  /* nothing past the end of the input */
+  EXPECT( 0, idx.bits[GENLEX_INDEX_NUM*3 + GENLEX_INDEX_SYMBOL] >> (sizeof buf % 64) );
+
+  gen_lexer_index_free(&idx);
+}
+
+#if GENLEX_INDEX_SSSE3
+DEFTEST( index_ssse3_matches_scalar )
+{
+  unsigned char block[64] = {0};
+  unsigned long long a[GENLEX_INDEX_NUM], b[GENLEX_INDEX_NUM];
+  struct gen_lexer_index idx;
+  unsigned int seed = 7;
+  int n, i, k;
+
+  if (!__builtin_cpu_supports("ssse3")) { return; }
+
+  gen_lexer_index_init(&idx);
+  EXPECT( 0, gen_lexer_index_build(&idx, block, 0) );
+
+  for (n = 0; n < 200; n++) {
+    for (i = 0; i < 64; i++) {
+      seed = seed * 1103515245u + 12345u;
+      block[i] = (unsigned char)(seed >> 16);
+    }
+
+    genlex_index_block_scalar(&idx, block, a);
+    genlex_index_block_ssse3(&idx, block, b);
+    for (k = 0; k < GENLEX_INDEX_NUM; k++) {
+      EXPECT( 1, a[k] == b[k] );
+    }
+  }
+
+  gen_lexer_index_free(&idx);
+}
+#endif
+
+void run_tests_index(void)
+{
+  (void)gen_lexer_token_string;
+  (void)gen_lexer_token_line;
+  (void)gen_lexer_token_col;
+  (void)gen_lexer_token_off;
+  (void)gen_lexer_token_int_value;
+  (void)gen_lexer_token_float_value;
+
+  RUNTEST( index_matches_serial );
+  RUNTEST( index_matches_serial_on_noise );
+  RUNTEST( index_bitmaps );
+#if GENLEX_INDEX_SSSE3
+  RUNTEST( index_ssse3_matches_scalar );
+#endif
+}
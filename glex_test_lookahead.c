@@ -0,0 +1,210 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#define GLEX_TEST_BYTESTREAM 1
+#include "glex_tests.h"
+
+#define GENLEX_GETC(ctx) (bytestream_getc(ctx))
+#define GENLEX_UNGETC(ch,ctx) (bytestream_ungetc(ch,ctx))
+
+#define GENLEX_STRING_MAX 64
+#define GENLEX_LOOKAHEAD  3
+
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS "()=;+-*/"
+
+#define GENLEX_ID_TOKEN     1024
+#define GENLEX_STRING_TOKEN 1025
+#define GENLEX_INT_TOKEN    1026
+
+#define KW_IF    1027
+#define KW_WHILE 1028
+
+#define GENLEX_CONFIG_FLOATS 1
+#define GENLEX_FLOAT_TOKEN   1029
+
+#define GENLEX_KEYWORDS { \
+  { "if"   , KW_IF    }, \
+  { "while", KW_WHILE }, \
+}
+
+#include "glex.h"
+
+DEFTEST( peek_does_not_consume )
+{
+  struct bytestream s = BYTESTREAM( "foo = \"bar\" + 32;" );
+  struct gen_lexer lexer;
+
+  gen_lexer_initialize(&lexer, &s);
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_peek(&lexer, 0) );
+  EXPECT( '=', gen_lexer_peek(&lexer, 1) );
+  EXPECT( GENLEX_STRING_TOKEN, gen_lexer_peek(&lexer, 2) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_peek(&lexer, 0) );
+  EXPECT_STR( "foo", gen_lexer_peek_string(&lexer, 0, NULL) );
+  EXPECT_STR( "bar", gen_lexer_peek_string(&lexer, 2, NULL) );
+
+  EXPECT( GENLEX_ERR_INVALID_STATE, gen_lexer_peek(&lexer, 3) );
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT_STR( "foo", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( 0, gen_lexer_token_off(&lexer) );
+
+  /* peeking further doesn't disturb the current token */
+  EXPECT( '+', gen_lexer_peek(&lexer, 2) );
+  EXPECT_STR( "foo", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( 0, gen_lexer_token_off(&lexer) );
+
+  EXPECT( '=', gen_lexer_advance(&lexer) );
+  EXPECT( 4, gen_lexer_token_off(&lexer) );
+
+  EXPECT( GENLEX_STRING_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT_STR( "bar", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( 6, gen_lexer_token_off(&lexer) );
+
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_peek(&lexer, 1) );
+  EXPECT( 32, gen_lexer_peek_int_value(&lexer, 1) );
+  EXPECT_STR( "32", gen_lexer_peek_string(&lexer, 1, NULL) );
+  EXPECT_STR( "bar", gen_lexer_token_string(&lexer, NULL) );
+
+  EXPECT( '+', gen_lexer_advance(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT( 32, gen_lexer_token_int_value(&lexer) );
+  EXPECT( 14, gen_lexer_token_off(&lexer) );
+  EXPECT( 0, gen_lexer_token_line(&lexer) );
+  EXPECT( 14, gen_lexer_token_col(&lexer) );
+
+  EXPECT( ';', gen_lexer_advance(&lexer) );
+  EXPECT( 0, gen_lexer_peek(&lexer, 2) );
+  EXPECT( 0, gen_lexer_advance(&lexer) );
+  EXPECT( 0, gen_lexer_advance(&lexer) );
+}
+
+DEFTEST( peeked_text_is_not_overwritten )
+{
+  struct bytestream s = BYTESTREAM( "alpha beta gamma delta epsilon" );
+  struct gen_lexer lexer;
+  const unsigned char *a, *b, *c;
+
+  gen_lexer_initialize(&lexer, &s);
+
+  a = gen_lexer_peek_string(&lexer, 0, NULL);
+  b = gen_lexer_peek_string(&lexer, 1, NULL);
+  c = gen_lexer_peek_string(&lexer, 2, NULL);
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT( 1, a == gen_lexer_token_string(&lexer, NULL) );
+
+  /* scanning "delta" must not reuse the buffers of the current token or
+   * of the tokens still ahead of it
+   */
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_peek(&lexer, 2) );
+  EXPECT_STR( "alpha", a );
+  EXPECT_STR( "beta", b );
+  EXPECT_STR( "gamma", c );
+  EXPECT_STR( "delta", gen_lexer_peek_string(&lexer, 2, NULL) );
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT_STR( "beta", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT_STR( "delta", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT_STR( "epsilon", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( 0, gen_lexer_advance(&lexer) );
+}
+
+DEFTEST( reset_drops_peeked_tokens )
+{
+  struct bytestream s1 = BYTESTREAM( "a b c" );
+  struct bytestream s2 = BYTESTREAM( "x = 1;" );
+  struct gen_lexer lexer;
+
+  gen_lexer_initialize(&lexer, &s1);
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_peek(&lexer, 1) );
+
+  gen_lexer_reset(&lexer, &s2);
+  EXPECT( 0, gen_lexer_token_off(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_peek(&lexer, 0) );
+  EXPECT( '=', gen_lexer_peek(&lexer, 1) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT_STR( "x", gen_lexer_token_string(&lexer,NULL) );
+  EXPECT( '=', gen_lexer_advance(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT( 1, gen_lexer_token_int_value(&lexer) );
+  EXPECT( ';', gen_lexer_advance(&lexer) );
+  EXPECT( 0, gen_lexer_advance(&lexer) );
+}
+
+DEFTEST( skip_group_after_peek )
+{
+  struct bytestream s = BYTESTREAM( "f ( a ( b ) \")\" ) ; g ( ( ) ) + 1" );
+  struct gen_lexer lexer;
+
+  gen_lexer_initialize(&lexer, &s);
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT( '(', gen_lexer_advance(&lexer) );
+  EXPECT( '(', gen_lexer_peek(&lexer, 1) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_peek(&lexer, 2) );
+
+  /* the peeked tokens are counted, then the rest is scanned */
+  EXPECT( ')', gen_lexer_skip_group(&lexer, '(', ')') );
+  EXPECT( 16, gen_lexer_token_off(&lexer) );
+  EXPECT( ';', gen_lexer_peek(&lexer, 0) );
+  EXPECT( ';', gen_lexer_advance(&lexer) );
+  EXPECT( 18, gen_lexer_token_off(&lexer) );
+
+  /* the group ends within the peeked tokens */
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT( '(', gen_lexer_advance(&lexer) );
+  EXPECT( ')', gen_lexer_peek(&lexer, 2) );
+  EXPECT( ')', gen_lexer_skip_group(&lexer, '(', ')') );
+  EXPECT( 28, gen_lexer_token_off(&lexer) );
+  EXPECT( '+', gen_lexer_advance(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT( 0, gen_lexer_advance(&lexer) );
+}
+
+DEFTEST( peeked_values_and_records )
+{
+  struct bytestream s = BYTESTREAM( "width = 2.5 * 40;" );
+  struct gen_lexer lexer;
+  struct gen_lexer_token rec;
+
+  gen_lexer_initialize(&lexer, &s);
+
+  EXPECT( GENLEX_FLOAT_TOKEN, gen_lexer_peek(&lexer, 2) );
+  EXPECT( 1, gen_lexer_peek_float_value(&lexer, 2) == 2.5 );
+  EXPECT( 0, gen_lexer_peek_float_value(&lexer, 3) );
+
+  /* the record ends at its own token, not at the last one peeked */
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_advance(&lexer) );
+  gen_lexer_token_record(&lexer, GENLEX_ID_TOKEN, &rec);
+  EXPECT( 0, rec.off );
+  EXPECT( 5, rec.end );
+
+  EXPECT( '=', gen_lexer_advance(&lexer) );
+  EXPECT( GENLEX_FLOAT_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_peek(&lexer, 1) );
+  gen_lexer_token_record(&lexer, GENLEX_FLOAT_TOKEN, &rec);
+  EXPECT( 8, rec.off );
+  EXPECT( 11, rec.end );
+  EXPECT( 1, rec.val.f == 2.5 );
+  EXPECT( 1, gen_lexer_token_float_value(&lexer) == 2.5 );
+
+  EXPECT( '*', gen_lexer_advance(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_advance(&lexer) );
+  gen_lexer_token_record(&lexer, GENLEX_INT_TOKEN, &rec);
+  EXPECT( 16, rec.end );
+}
+
+void run_tests_lookahead(void)
+{
+  RUNTEST( peek_does_not_consume );
+  RUNTEST( peeked_text_is_not_overwritten );
+  RUNTEST( reset_drops_peeked_tokens );
+  RUNTEST( skip_group_after_peek );
+  RUNTEST( peeked_values_and_records );
+}
@@ -0,0 +1,81 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+#define GENLEX_CONFIG_MEMORY 1
+
+#define GENLEX_STRING_MAX 64
+#define GENLEX_LOOKAHEAD  2
+
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS "()=;+-*/<>,"
+
+#define GENLEX_ID_TOKEN     1024
+#define GENLEX_STRING_TOKEN 1025
+#define GENLEX_INT_TOKEN    1026
+
+#define GENLEX_KEYWORDS {}
+
+#include "glex.h"
+
+#define MEMBUF(s) { (const unsigned char *)(s), sizeof(s)-1, 0 }
+
+DEFTEST( mark_and_reset_in_memory )
+{
+  struct gen_lexer_membuf mb = MEMBUF( "a < b,\n  c > (d);" );
+  struct gen_lexer lexer;
+  struct gen_lexer_mark mark;
+
+  gen_lexer_initialize(&lexer, &mb);
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT( 0, gen_lexer_mark(&lexer, &mark) );
+
+  /* speculatively parse "a < b , c > (" as a generic */
+  EXPECT( '<', gen_lexer_advance(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT( ',', gen_lexer_advance(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT_STR( "c", gen_lexer_token_string(&lexer,NULL) );
+  EXPECT( 1, gen_lexer_token_line(&lexer) );
+  EXPECT( '>', gen_lexer_peek(&lexer, 0) );
+  EXPECT( '(', gen_lexer_peek(&lexer, 1) );
+
+  /* ... and back out with tokens still peeked */
+  EXPECT( 0, gen_lexer_reset_to(&lexer, &mark) );
+
+  EXPECT( '<', gen_lexer_peek(&lexer, 0) );
+  EXPECT( '<', gen_lexer_advance(&lexer) );
+  EXPECT( 2, gen_lexer_token_off(&lexer) );
+  EXPECT( 0, gen_lexer_token_line(&lexer) );
+  EXPECT( 2, gen_lexer_token_col(&lexer) );
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT_STR( "b", gen_lexer_token_string(&lexer,NULL) );
+  EXPECT( ',', gen_lexer_advance(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT( 9, gen_lexer_token_off(&lexer) );
+  EXPECT( 1, gen_lexer_token_line(&lexer) );
+  EXPECT( 2, gen_lexer_token_col(&lexer) );
+  EXPECT( '>', gen_lexer_advance(&lexer) );
+  EXPECT( '(', gen_lexer_advance(&lexer) );
+
+  gen_lexer_release_mark(&lexer, &mark);
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_advance(&lexer) );
+  EXPECT( ')', gen_lexer_advance(&lexer) );
+  EXPECT( ';', gen_lexer_advance(&lexer) );
+  EXPECT( 0, gen_lexer_advance(&lexer) );
+}
+
+void run_tests_mark(void)
+{
+  (void)gen_lexer_token_int_value;
+  (void)gen_lexer_peek_int_value;
+  (void)gen_lexer_peek_string;
+
+  RUNTEST( mark_and_reset_in_memory );
+}
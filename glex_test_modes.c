@@ -0,0 +1,377 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+/* Built twice: over memory, where raw text is copied straight from the
+ * buffer, and as glex_test_modes_stream.o over the stream backend, where
+ * it is read a byte at a time
+ */
+#if GLEX_TEST_MODES_STREAM
+#  define GENLEX_CONFIG_STREAM 1
+#else
+#  define GENLEX_CONFIG_MEMORY 1
+#endif
+#define GENLEX_CONFIG_RUNTIME 1
+#define GENLEX_MODE_DEPTH     2
+
+/* small, so that long raw text is split */
+#define GENLEX_STRING_MAX 16
+
+#include "glex.h"
+
+enum {
+  M_ID = 1024, M_STRING, M_INT,
+  M_TEXT, M_OPEN, M_CLOSE, M_IF, M_END,
+};
+
+/* Text with {{ ... }} code islands */
+static const struct gen_lexer_config text_mode = {
+  NULL, NULL, 0, NULL, 0, NULL, 0, NULL, NULL, NULL,
+  0, 0, 0, 0, 0,
+  NULL, 0, 0,
+  "{{", M_TEXT, M_OPEN,
+};
+
+static const struct gen_lexer_keyword code_keywords[] = {
+  { "if", M_IF },
+};
+static const struct gen_lexer_literal_pair code_pairs[] = {
+  { "}}", M_CLOSE },
+};
+
+static const struct gen_lexer_config code_mode = {
+  "|.",
+  code_pairs, sizeof code_pairs / sizeof code_pairs[0],
+  code_keywords, sizeof code_keywords / sizeof code_keywords[0],
+  NULL, 0,
+  GENLEX_ALPHA "_", GENLEX_ALPHA "_" GENLEX_DIGITS, NULL,
+  M_ID, M_STRING, M_INT, 0, 0,
+};
+
+/* CDATA, whose delimiter overlaps itself */
+static const struct gen_lexer_config cdata_mode = {
+  NULL, NULL, 0, NULL, 0, NULL, 0, NULL, NULL, NULL,
+  0, 0, 0, 0, 0,
+  NULL, 0, 0,
+  "]]>", M_TEXT, M_END,
+};
+
+/* A heredoc body, ended by EOF on a line of its own */
+static const struct gen_lexer_config heredoc_mode = {
+  NULL, NULL, 0, NULL, 0, NULL, 0, NULL, NULL, NULL,
+  0, 0, 0, 0, 0,
+  NULL, 0, 0,
+  "\nEOF", M_TEXT, M_END,
+};
+
+struct modes_input {
+#if GLEX_TEST_MODES_STREAM
+  struct gen_lexer_stream st;
+  const char *s;
+  size_t len, pos;
+#else
+  struct gen_lexer_membuf mb;
+#endif
+};
+
+#if GLEX_TEST_MODES_STREAM
+/* a few bytes per read, so raw text straddles refills */
+static size_t modes_read(void *arg, unsigned char *dst, size_t n)
+{
+  struct modes_input *in = arg;
+
+  if (n > 3) { n = 3; }
+  if (n > in->len - in->pos) { n = in->len - in->pos; }
+  memcpy(dst, in->s + in->pos, n);
+  in->pos += n;
+  return n;
+}
+#endif
+
+static void modes_open(struct gen_lexer *lexer, struct modes_input *in,
+    const struct gen_lexer_tables *tab, const char *s)
+{
+#if GLEX_TEST_MODES_STREAM
+  in->s = s;
+  in->len = strlen(s);
+  in->pos = 0;
+  gen_lexer_stream_init(&in->st, modes_read, in, 8);
+  gen_lexer_initialize_with(lexer, tab, &in->st);
+#else
+  in->mb.data = (const unsigned char *)s;
+  in->mb.len = strlen(s);
+  in->mb.pos = 0;
+  gen_lexer_initialize_with(lexer, tab, &in->mb);
+#endif
+}
+
+static void modes_close(struct modes_input *in)
+{
+#if GLEX_TEST_MODES_STREAM
+  gen_lexer_stream_free(&in->st);
+#else
+  (void)in;
+#endif
+}
+
+DEFTEST( modes_template )
+{
+  struct gen_lexer_tables text, code;
+  struct modes_input in;
+  struct gen_lexer lexer;
+
+  EXPECT( 0, gen_lexer_compile(&text, &text_mode) );
+  EXPECT( 0, gen_lexer_compile(&code, &code_mode) );
+  modes_open(&lexer, &in, &text, "Hi {{ name|up }}, {x}\n{{if}}!");
+
+  EXPECT( M_TEXT, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "Hi ", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( M_OPEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 3, gen_lexer_token_off(&lexer) );
+  EXPECT( 3, gen_lexer_token_col(&lexer) );
+
+  EXPECT( 0, gen_lexer_push_mode(&lexer, &code) );
+  EXPECT( 1, gen_lexer_mode(&lexer) == &code );
+  EXPECT( M_ID, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "name", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( '|', gen_lexer_next_token(&lexer) );
+  EXPECT( M_ID, gen_lexer_next_token(&lexer) );
+  EXPECT( M_CLOSE, gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_pop_mode(&lexer) );
+
+  /* single braces and newlines are text */
+  EXPECT( M_TEXT, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( ", {x}\n", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( 16, gen_lexer_token_off(&lexer) );
+  EXPECT( M_OPEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 1, gen_lexer_token_line(&lexer) );
+  EXPECT( 0, gen_lexer_token_col(&lexer) );
+
+  EXPECT( 0, gen_lexer_push_mode(&lexer, &code) );
+  EXPECT( M_IF, gen_lexer_next_token(&lexer) );
+  EXPECT( M_CLOSE, gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_pop_mode(&lexer) );
+  EXPECT( M_TEXT, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "!", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+
+  /* the stack is bounded both ways */
+  EXPECT( GENLEX_ERR_INVALID_STATE, gen_lexer_pop_mode(&lexer) );
+  EXPECT( 0, gen_lexer_push_mode(&lexer, &code) );
+  EXPECT( 0, gen_lexer_push_mode(&lexer, &text) );
+  EXPECT( GENLEX_ERR_INVALID_STATE, gen_lexer_push_mode(&lexer, &code) );
+
+  modes_close(&in);
+  gen_lexer_tables_free(&code);
+  gen_lexer_tables_free(&text);
+}
+
+/* Lexes s in tab's raw mode into "TEXT:...|END|..." */
+static const char *modes_raw(const struct gen_lexer_tables *tab, const char *s)
+{
+  static char out[256];
+  struct modes_input in;
+  struct gen_lexer lexer;
+  size_t n = 0;
+  int tok;
+
+  modes_open(&lexer, &in, tab, s);
+  out[0] = '\0';
+  while ((tok = gen_lexer_next_token(&lexer)) > 0) {
+    if (tok == M_TEXT) {
+      n += snprintf(out + n, sizeof out - n, "%s%lu:%s", (n > 0) ? "|" : "",
+          (unsigned long)gen_lexer_token_off(&lexer),
+          (const char *)gen_lexer_token_string(&lexer, NULL));
+    } else {
+      n += snprintf(out + n, sizeof out - n, "%s%lu:END", (n > 0) ? "|" : "",
+          (unsigned long)gen_lexer_token_off(&lexer));
+    }
+  }
+  modes_close(&in);
+  return out;
+}
+
+DEFTEST( modes_raw_text )
+{
+  struct gen_lexer_tables cdata;
+
+  EXPECT( 0, gen_lexer_compile(&cdata, &cdata_mode) );
+
+  EXPECT_STR( "0:a]|2:END|5:b", modes_raw(&cdata, "a]]]>b") );
+  EXPECT_STR( "0:END", modes_raw(&cdata, "]]>") );
+  EXPECT_STR( "0:x]]", modes_raw(&cdata, "x]]") );
+  EXPECT_STR( "0:]>]|3:END", modes_raw(&cdata, "]>]]]>") );
+  EXPECT_STR( "", modes_raw(&cdata, "") );
+
+  /* text past the buffer comes in pieces, even partway into a match */
+  EXPECT_STR( "0:aaaaaaaaaaaa|12:aaaaaaaaaaaa|24:aaaaaa|30:END",
+      modes_raw(&cdata, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa]]>") );
+  EXPECT_STR( "0:aaaaaaaaaa]]|12:END", modes_raw(&cdata, "aaaaaaaaaa]]]]>") );
+  EXPECT_STR( "0:aaaaaaaaaa]]|12:]]", modes_raw(&cdata, "aaaaaaaaaa]]]]") );
+
+  gen_lexer_tables_free(&cdata);
+}
+
+DEFTEST( modes_heredoc )
+{
+  struct gen_lexer_tables body, code, bad;
+  struct gen_lexer_config cfg = heredoc_mode;
+  struct modes_input in;
+  struct gen_lexer lexer;
+
+  EXPECT( 0, gen_lexer_compile(&body, &heredoc_mode) );
+  EXPECT( 0, gen_lexer_compile(&code, &code_mode) );
+  modes_open(&lexer, &in, &code, "if\nl1\nl2\nEOF\nafter");
+
+  EXPECT( M_IF, gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_push_mode(&lexer, &body) );
+  EXPECT( M_TEXT, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "\nl1\nl2", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( 0, gen_lexer_token_line(&lexer) );
+  EXPECT( 2, gen_lexer_token_col(&lexer) );
+
+  /* the delimiter keeps its place, newline and all */
+  EXPECT( M_END, gen_lexer_next_token(&lexer) );
+  EXPECT( 8, gen_lexer_token_off(&lexer) );
+  EXPECT( 2, gen_lexer_token_line(&lexer) );
+  EXPECT( 2, gen_lexer_token_col(&lexer) );
+  EXPECT( 0, gen_lexer_pop_mode(&lexer) );
+
+  EXPECT( M_ID, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "after", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( 4, gen_lexer_token_line(&lexer) );
+  EXPECT( 0, gen_lexer_token_col(&lexer) );
+  modes_close(&in);
+
+  /* a reset goes back to the first mode */
+  modes_open(&lexer, &in, &code, "if x");
+  EXPECT( 0, gen_lexer_push_mode(&lexer, &body) );
+#if GLEX_TEST_MODES_STREAM
+  gen_lexer_reset(&lexer, &in.st);
+#else
+  gen_lexer_reset(&lexer, &in.mb);
+#endif
+  EXPECT( 1, gen_lexer_mode(&lexer) == &code );
+  EXPECT( M_IF, gen_lexer_next_token(&lexer) );
+  modes_close(&in);
+
+  cfg.raw_until = "";
+  EXPECT( GENLEX_ERR_INVALID_STATE, gen_lexer_compile(&bad, &cfg) );
+  cfg.raw_until = "12345678";
+  EXPECT( GENLEX_ERR_INVALID_STATE, gen_lexer_compile(&bad, &cfg) );
+
+  gen_lexer_tables_free(&code);
+  gen_lexer_tables_free(&body);
+}
+
+/* A mark keeps the raw_until_token owed after a raw_token, and any
+ * partial match of raw_until */
+DEFTEST( modes_mark )
+{
+  struct gen_lexer_tables text, cdata;
+  struct gen_lexer_mark m;
+  struct modes_input in;
+  struct gen_lexer lexer;
+
+  EXPECT( 0, gen_lexer_compile(&text, &text_mode) );
+  EXPECT( 0, gen_lexer_compile(&cdata, &cdata_mode) );
+  modes_open(&lexer, &in, &text, "ab{{cd");
+
+  EXPECT( M_TEXT, gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_mark(&lexer, &m) );
+  EXPECT( M_OPEN, gen_lexer_next_token(&lexer) );
+  EXPECT( M_TEXT, gen_lexer_next_token(&lexer) );
+
+  EXPECT( 0, gen_lexer_reset_to(&lexer, &m) );
+  EXPECT( M_OPEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 2, gen_lexer_token_off(&lexer) );
+  EXPECT( M_TEXT, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "cd", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+  gen_lexer_release_mark(&lexer, &m);
+
+  modes_close(&in);
+
+  /* and a match that a full buffer had cut short */
+  modes_open(&lexer, &in, &cdata, "aaaaaaaaaa]]]]>x");
+  EXPECT( M_TEXT, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "aaaaaaaaaa]]", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( 0, gen_lexer_mark(&lexer, &m) );
+  EXPECT( M_END, gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_reset_to(&lexer, &m) );
+  EXPECT( M_END, gen_lexer_next_token(&lexer) );
+  EXPECT( 12, gen_lexer_token_off(&lexer) );
+  EXPECT( M_TEXT, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "x", gen_lexer_token_string(&lexer, NULL) );
+  gen_lexer_release_mark(&lexer, &m);
+
+  modes_close(&in);
+  gen_lexer_tables_free(&cdata);
+  gen_lexer_tables_free(&text);
+}
+
+/* A template renderer on gen_lexer_run(): text is copied, and the
+ * handlers switch modes at the delimiters
+ */
+struct modes_render {
+  const struct gen_lexer_tables *code;
+  char out[64];
+  size_t len;
+};
+
+static int modes_put(struct modes_render *r, const char *s, size_t len)
+{
+  r->len += snprintf(r->out + r->len, sizeof r->out - r->len, "%.*s", (int)len, s);
+  return 0;
+}
+
+static int modes_delim(struct gen_lexer *lexer, struct modes_render *r, int tok)
+{
+  if (tok == M_OPEN)  { return gen_lexer_push_mode(lexer, r->code); }
+  if (tok == M_CLOSE) { return gen_lexer_pop_mode(lexer); }
+  return modes_put(r, "?", 1);
+}
+
+#define GENLEX_ON_RAW(ctx,s,len)    modes_put((ctx), (const char *)(s), (len))
+#define GENLEX_ON_IDENT(ctx,s,len)  modes_put((ctx), "<", 1) || modes_put((ctx), (const char *)(s), (len)) || modes_put((ctx), ">", 1)
+#define GENLEX_ON_LITERAL(ctx,tok)  modes_delim(lexer, (ctx), (tok))
+#define GENLEX_ON_KEYWORD(ctx,tok)  modes_put((ctx), "!", 1)
+#define GENLEX_RUN_CTX_T struct modes_render *
+#include "glex_run.h"
+
+DEFTEST( modes_run )
+{
+  struct gen_lexer_tables text, code;
+  struct modes_render r;
+  struct modes_input in;
+  struct gen_lexer lexer;
+
+  EXPECT( 0, gen_lexer_compile(&text, &text_mode) );
+  EXPECT( 0, gen_lexer_compile(&code, &code_mode) );
+  r.code = &code;
+  r.len = 0;
+
+  /* text that starts like a symbol, or like a literal, is still text */
+  modes_open(&lexer, &in, &text, "if {{ x }}|{{name}}.");
+  EXPECT( 0, gen_lexer_run(&lexer, &r) );
+  EXPECT_STR( "if <x>|<name>.", r.out );
+  modes_close(&in);
+
+  gen_lexer_tables_free(&code);
+  gen_lexer_tables_free(&text);
+}
+
+void run_tests_modes(void)
+{
+  (void)gen_lexer_token_int_value;
+
+  RUNTEST( modes_template );
+  RUNTEST( modes_raw_text );
+  RUNTEST( modes_heredoc );
+  RUNTEST( modes_mark );
+  RUNTEST( modes_run );
+}
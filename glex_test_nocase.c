@@ -0,0 +1,115 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "glex_test_nocase_config.h"
+#include "glex.h"
+
+#define MEMBUF(s) { (const unsigned char *)(s), sizeof(s)-1, 0 }
+
+DEFTEST( nocase_keywords )
+{
+  struct gen_lexer_membuf mb = MEMBUF( "SELECT Select select from WhErE X9 x9" );
+  struct gen_lexer lexer;
+
+  gen_lexer_initialize(&lexer, &mb);
+
+  /* the text keeps the input's spelling */
+  EXPECT( KW_SELECT, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "SELECT", (const char *)gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( KW_SELECT, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "Select", (const char *)gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( KW_SELECT, gen_lexer_next_token(&lexer) );
+  EXPECT( KW_FROM, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "from", (const char *)gen_lexer_token_string(&lexer, NULL) );
+
+  /* the first of two keywords that fold the same wins */
+  EXPECT( KW_WHERE, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "WhErE", (const char *)gen_lexer_token_string(&lexer, NULL) );
+
+  EXPECT( KW_X9, gen_lexer_next_token(&lexer) );
+  EXPECT( KW_X9, gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+}
+
+DEFTEST( nocase_longer_than_a_word )
+{
+  struct gen_lexer_membuf mb = MEMBUF(
+      "CURRENT_TIMESTAMP Current_Timestamp current_timestamp_ current_timestam "
+      "CURRENT_TIMESTAMQ ORDER_BY Order_By" );
+  struct gen_lexer lexer;
+
+  gen_lexer_initialize(&lexer, &mb);
+  EXPECT( KW_TS, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "CURRENT_TIMESTAMP", (const char *)gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( KW_TS, gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( KW_ORDER_BY, gen_lexer_next_token(&lexer) );
+  EXPECT( KW_ORDER_BY, gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+}
+
+DEFTEST( nocase_only_letters_fold )
+{
+  /* '@', '[' and '{' are '`', '{' and '[' with 0x20 flipped; none of
+   * them may pass for a letter, or '_' for DEL
+   */
+  struct gen_lexer_membuf mb = MEMBUF( "x9 X9 FRO@ Wher{ sel[ct order_BY" );
+  struct gen_lexer lexer;
+
+  gen_lexer_initialize(&lexer, &mb);
+  EXPECT( KW_X9, gen_lexer_next_token(&lexer) );
+  EXPECT( KW_X9, gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( '@', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( '{', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( '[', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( KW_ORDER_BY, gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+}
+
+DEFTEST( nocase_fold_word )
+{
+  static const char upper[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ@[`{_09\x80\xc1\xda\xff";
+  static const char lower[] = "abcdefghijklmnopqrstuvwxyz@[`{_09\x80\xc1\xda\xff";
+  unsigned char buf[sizeof upper];
+  int c, bad = 0;
+
+  EXPECT( 1, genlex_fold_eq((const unsigned char *)upper, (const unsigned char *)lower, sizeof upper - 1) );
+  EXPECT( 0, genlex_fold_eq((const unsigned char *)"ABCDEFGH@", (const unsigned char *)"abcdefgh`", 9) );
+  EXPECT( 0, genlex_fold_eq((const unsigned char *)"ABCD@FGH", (const unsigned char *)"abcd`fgh", 8) );
+
+  /* every byte folds as GENLEX_FOLD() does, in every lane */
+  for (c = 0; c < 256; c++) {
+    unsigned long long w;
+    size_t k;
+
+    memset(buf, c, 8);
+    memcpy(&w, buf, 8);
+    w = genlex_fold_word(w);
+    memcpy(buf, &w, 8);
+    for (k = 0; k < 8; k++) {
+      if (buf[k] != GENLEX_FOLD(c)) { bad++; }
+    }
+  }
+  EXPECT( 0, bad );
+}
+
+void run_tests_nocase(void)
+{
+  (void)gen_lexer_token_int_value;
+  (void)gen_lexer_token_off;
+  (void)gen_lexer_token_col;
+  (void)gen_lexer_token_line;
+
+  RUNTEST( nocase_keywords );
+  RUNTEST( nocase_longer_than_a_word );
+  RUNTEST( nocase_only_letters_fold );
+  RUNTEST( nocase_fold_word );
+}
@@ -0,0 +1,44 @@
+#ifndef GLEX_TEST_NOCASE_CONFIG_H
+#define GLEX_TEST_NOCASE_CONFIG_H
+
+/* Configuration of glex_test_nocase.c, kept separate so that glexgen
+ * can be built against it as well
+ */
+
+#include <ctype.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+#define GENLEX_CONFIG_MEMORY 1
+
+#define GENLEX_STRING_MAX 64
+
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS "(),;*=@[{"
+
+#define GENLEX_ID_TOKEN      1024
+#define GENLEX_STRING_TOKEN  1025
+#define GENLEX_INT_TOKEN     1026
+
+#define KW_SELECT   1027
+#define KW_FROM     1028
+#define KW_WHERE    1029
+#define KW_ORDER_BY 1030
+#define KW_TS       1031
+#define KW_X9       1032
+
+/* spelled in any case; WHERE and where are the same keyword */
+#define GENLEX_KEYWORDS {                   \
+  { "select"           , KW_SELECT   },     \
+  { "FROM"             , KW_FROM     },     \
+  { "Where"            , KW_WHERE    },     \
+  { "where"            , KW_SELECT   },     \
+  { "order_by"         , KW_ORDER_BY },     \
+  { "current_timestamp", KW_TS       },     \
+  { "x9"               , KW_X9       },     \
+}
+
+#define GENLEX_KEYWORDS_CASE_INSENSITIVE 1
+
+#endif /* GLEX_TEST_NOCASE_CONFIG_H */
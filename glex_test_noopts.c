@@ -2,40 +2,7 @@
 #include <stdio.h>
 #include <ctype.h>
 
-#define GLEX_TEST_BYTESTREAM 1
-#include "glex_tests.h"
-
-#define GENLEX_GETC(ctx) (bytestream_getc(ctx))
-#define GENLEX_UNGETC(ch,ctx) (bytestream_ungetc(ch,ctx))
-
-/* Small so we can check that the bound is enforced */
-#define GENLEX_STRING_MAX 64
-
-#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
-#define GENLEX_LITERALS "()=;+-*/"
-
-#define GENLEX_ID_TOKEN      1024
-#define GENLEX_STRING_TOKEN  1025
-#define GENLEX_INT_TOKEN     1026
-#define GENLEX_COMMENT_TOKEN 1027
-
-#define KW_IF    1028
-#define KW_WHILE 1029
-
-#define LIT_EQ 512
-
-#define GENLEX_LITERAL_PAIRS { \
-  { "==", LIT_EQ },            \
-}
-
-#define GENLEX_KEYWORDS { \
-  { "if"   , KW_IF    }, \
-  { "while", KW_WHILE }, \
-}
-
-/* We do configure one option: comments. */
-#define GENLEX_COMMENT_PAIRS GENLEX_C99_COMMENTS
- 
+#include "glex_test_noopts_config.h"
 #include "glex.h"
 
 DEFTEST( bytestreamd_getc_and_ungetc )
@@ -2,27 +2,7 @@
 #include <stdio.h>
 #include <ctype.h>
 
-#define GLEX_TEST_BYTESTREAM 1
-#include "glex_tests.h"
-
-#define GENLEX_GETC(ctx) (bytestream_getc(ctx))
-#define GENLEX_UNGETC(ch,ctx) (bytestream_ungetc(ch,ctx))
-
-/* Small so we can check that the bound is enforced */
-#define GENLEX_STRING_MAX 64
-
-#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
-#define GENLEX_LITERALS "()"
-
-#define GENLEX_ID_TOKEN     1024
-#define GENLEX_STRING_TOKEN 1025
-#define GENLEX_INT_TOKEN    1026
-#define GENLEX_FLOAT_TOKEN  1027
-
-#define GENLEX_KEYWORDS {}
-
-#define GENLEX_CONFIG_FLOATS      1  /* enable float parsing */
-
+#include "glex_test_numbers_config.h"
 #include "glex.h"
 
 DEFTEST( returns_incomplete_int )
@@ -0,0 +1,229 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+#define GENLEX_CONFIG_MEMORY 1
+
+#define GENLEX_STRING_MAX 128
+
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS "(){}=;+-*/,.<"
+
+#define GENLEX_ID_TOKEN      1024
+#define GENLEX_STRING_TOKEN  1025
+#define GENLEX_INT_TOKEN     1026
+#define GENLEX_COMMENT_TOKEN 1027
+#define GENLEX_FLOAT_TOKEN   1028
+
+#define KW_IF    1029
+#define KW_WHILE 1030
+
+#define GENLEX_KEYWORDS { \
+  { "if"   , KW_IF    }, \
+  { "while", KW_WHILE }, \
+}
+
+#define GENLEX_COMMENT_PAIRS GENLEX_C99_COMMENTS
+#define GENLEX_CONFIG_FLOATS 1
+
+#include "glex.h"
+#include "glex_packed.h"
+
+#define PACK_REPS 500
+
+static char *pack_text(int reps, size_t *lenp)
+{
+  size_t cap = (size_t)reps * 160, len = 0;
+  char *text = malloc(cap);
+  int i;
+
+  for (i=0; i < reps; i++) {
+    len += snprintf(text + len, cap - len,
+        "while (x_%d < %d) {\n"
+        "    if (y) z = -%d * %d.5;\n"
+        "%s"
+        "\n\n\t\t// comment %d\n"
+        "}\n",
+        i, i * 1000003, i, i,
+        (i % 7) ? "" : "    s = \"a string that is longer than sixty-three bytes, to take the long path\";\n",
+        i);
+  }
+  *lenp = len;
+
+  return text;
+}
+
+static int same_token(const struct gen_lexer_token *a, const struct gen_lexer_token *b)
+{
+  if (a->tok != b->tok || a->off != b->off || a->end != b->end ||
+      a->line != b->line || a->col != b->col) {
+    return 0;
+  }
+  if (a->tok == GENLEX_INT_TOKEN) { return a->val.i == b->val.i; }
+  if (a->tok == GENLEX_FLOAT_TOKEN) { return a->val.f == b->val.f; }
+  return 1;
+}
+
+DEFTEST( packed_round_trip )
+{
+  struct gen_lexer_membuf mb, mb2;
+  struct gen_lexer lexer;
+  struct gen_lexer_packed pk;
+  struct gen_lexer_packed_iter it;
+  struct gen_lexer_tokens serial = { NULL, 0, 0 };
+  struct gen_lexer_token rec;
+  size_t len, i, bad = 0;
+  char *text = pack_text(PACK_REPS, &len);
+  int tok;
+
+  mb.data = (const unsigned char *)text; mb.len = len; mb.pos = 0;
+  mb2 = mb;
+
+  gen_lexer_initialize(&lexer, &mb);
+  while ((tok = gen_lexer_next_token(&lexer)) != 0) {
+    gen_lexer_token_record(&lexer, tok, &rec);
+    gen_lexer_tokens_push(&serial, &rec);
+  }
+
+  gen_lexer_packed_init(&pk);
+  gen_lexer_initialize(&lexer, &mb2);
+  EXPECT( 0, gen_lexer_packed_lex(&pk, &lexer) );
+  EXPECT( serial.len, gen_lexer_packed_count(&pk) );
+
+  gen_lexer_packed_seek(&pk, &it, 0);
+  for (i=0; gen_lexer_packed_next(&it, &rec); i++) {
+    if (i >= serial.len || !same_token(&rec, &serial.toks[i])) { bad++; }
+  }
+  EXPECT( serial.len, i );
+  EXPECT( 0, bad );
+
+  /* the end stays put */
+  EXPECT( 0, gen_lexer_packed_next(&it, &rec) );
+
+  /* well under the 40 bytes of a record */
+  EXPECT( 1, gen_lexer_packed_bytes(&pk) < 4 * serial.len );
+
+  gen_lexer_packed_free(&pk);
+  gen_lexer_tokens_free(&serial);
+  free(text);
+}
+
+DEFTEST( packed_seek )
+{
+  struct gen_lexer_membuf mb, mb2;
+  struct gen_lexer lexer;
+  struct gen_lexer_packed pk;
+  struct gen_lexer_packed_iter it;
+  struct gen_lexer_tokens serial = { NULL, 0, 0 };
+  struct gen_lexer_token rec;
+  size_t len, i, bad = 0;
+  char *text = pack_text(50, &len);
+  int tok;
+
+  mb.data = (const unsigned char *)text; mb.len = len; mb.pos = 0;
+  mb2 = mb;
+
+  gen_lexer_initialize(&lexer, &mb);
+  while ((tok = gen_lexer_next_token(&lexer)) != 0) {
+    gen_lexer_token_record(&lexer, tok, &rec);
+    gen_lexer_tokens_push(&serial, &rec);
+  }
+
+  gen_lexer_packed_init(&pk);
+  gen_lexer_initialize(&lexer, &mb2);
+  EXPECT( 0, gen_lexer_packed_lex(&pk, &lexer) );
+
+  /* backwards, so that every seek starts over from a block */
+  for (i = serial.len; i-- > 0; ) {
+    gen_lexer_packed_seek(&pk, &it, i);
+    if (!gen_lexer_packed_next(&it, &rec) || !same_token(&rec, &serial.toks[i])) { bad++; }
+  }
+  EXPECT( 0, bad );
+
+  gen_lexer_packed_seek(&pk, &it, serial.len);
+  EXPECT( 0, gen_lexer_packed_next(&it, &rec) );
+  gen_lexer_packed_seek(&pk, &it, (size_t)-1);
+  EXPECT( 0, gen_lexer_packed_next(&it, &rec) );
+
+  gen_lexer_packed_free(&pk);
+  gen_lexer_tokens_free(&serial);
+  free(text);
+}
+
+DEFTEST( packed_errors_and_escapes )
+{
+  struct gen_lexer_membuf mb = { (const unsigned char *)"a @\n  -7 # 2.5e3", 16, 0 };
+  struct gen_lexer lexer;
+  struct gen_lexer_packed pk;
+  struct gen_lexer_packed_iter it;
+  struct gen_lexer_token rec;
+  int i, bad = 0;
+
+  gen_lexer_packed_init(&pk);
+  gen_lexer_initialize(&lexer, &mb);
+  EXPECT( 0, gen_lexer_packed_lex(&pk, &lexer) );
+
+  gen_lexer_packed_seek(&pk, &it, 0);
+  EXPECT( 1, gen_lexer_packed_next(&it, &rec) );
+  EXPECT( GENLEX_ID_TOKEN, rec.tok );
+  EXPECT( 1, gen_lexer_packed_next(&it, &rec) );
+  EXPECT( GENLEX_ERR_INVALID_CHAR, rec.tok );
+  EXPECT( 2, rec.off );
+  EXPECT( 1, gen_lexer_packed_next(&it, &rec) );
+  EXPECT( '-', rec.tok );
+  EXPECT( 1, rec.line );
+  EXPECT( 2, rec.col );
+  EXPECT( 1, gen_lexer_packed_next(&it, &rec) );
+  EXPECT( GENLEX_INT_TOKEN, rec.tok );
+  EXPECT( 7, rec.val.i );
+  EXPECT( 1, gen_lexer_packed_next(&it, &rec) );
+  EXPECT( GENLEX_ERR_INVALID_CHAR, rec.tok );
+  EXPECT( 1, gen_lexer_packed_next(&it, &rec) );
+  EXPECT( GENLEX_FLOAT_TOKEN, rec.tok );
+  EXPECT( 1, rec.val.f == 2500.0 );
+  EXPECT( 1, rec.line );
+  EXPECT( 7, rec.col );
+  EXPECT( 0, gen_lexer_packed_next(&it, &rec) );
+  gen_lexer_packed_clear(&pk);
+  EXPECT( 0, gen_lexer_packed_count(&pk) );
+
+  /* more kinds than the table holds, and a token that starts before the
+   * end of the one before it
+   */
+  mb.pos = 0;
+  gen_lexer_initialize(&lexer, &mb);
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ERR_INVALID_CHAR, gen_lexer_next_token(&lexer) );
+  EXPECT( '-', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 7, gen_lexer_token_int_value(&lexer) );
+  EXPECT( GENLEX_ERR_INVALID_CHAR, gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_FLOAT_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 1, gen_lexer_token_float_value(&lexer) == 2500.0 );
+  for (i = 0; i < 300; i++) {
+    EXPECT( 0, gen_lexer_packed_push(&pk, &lexer, 2000 + i) );
+  }
+  EXPECT( 300, gen_lexer_packed_count(&pk) );
+  gen_lexer_packed_seek(&pk, &it, 0);
+  for (i = 0; gen_lexer_packed_next(&it, &rec); i++) {
+    if (rec.tok != 2000 + i || rec.off != gen_lexer_token_off(&lexer) ||
+        rec.end != lexer.off || rec.line != gen_lexer_token_line(&lexer) ||
+        rec.col != gen_lexer_token_col(&lexer)) {
+      bad++;
+    }
+  }
+  EXPECT( 300, i );
+  EXPECT( 0, bad );
+  gen_lexer_packed_free(&pk);
+}
+
+void run_tests_packed(void)
+{
+  RUNTEST( packed_round_trip );
+  RUNTEST( packed_seek );
+  RUNTEST( packed_errors_and_escapes );
+}
@@ -0,0 +1,157 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+#define GENLEX_CONFIG_MEMORY 1
+
+/* Tiny chunks, so that chunk boundaries land inside every kind of token */
+#define GENLEX_PARALLEL_MIN_CHUNK 16
+
+#define GENLEX_STRING_MAX 64
+
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS "(){}=;+-*/,"
+
+#define GENLEX_ID_TOKEN      1024
+#define GENLEX_STRING_TOKEN  1025
+#define GENLEX_INT_TOKEN     1026
+#define GENLEX_COMMENT_TOKEN 1027
+#define GENLEX_FLOAT_TOKEN   1028
+
+#define KW_IF    1029
+#define KW_WHILE 1030
+
+#define LIT_EQ 512
+
+#define GENLEX_LITERAL_PAIRS { \
+  { "==", LIT_EQ },            \
+}
+
+#define GENLEX_KEYWORDS { \
+  { "if"   , KW_IF    }, \
+  { "while", KW_WHILE }, \
+}
+
+#define GENLEX_COMMENT_PAIRS GENLEX_C99_COMMENTS
+#define GENLEX_CONFIG_FLOATS 1
+
+#include "glex.h"
+#include "glex_parallel.h"
+
+static const char *parallel_snippets[] = {
+  "while (x == 3.25e1) { y = \"a /* not */ comment\"; }\n",
+  "/* a \"quoted\" comment\n   over // two lines */\n",
+  "if (foo_bar) { s = \"escaped \\\" quote // too\"; } // line \"comment\n",
+  "  n = -17 + 'c' * '\\n';\n",
+  "z = @ 12q;\n",
+  "x = \"unterminated\n",
+  "\t\t{ a, b, c } 100000000000000000000 1.5\n",
+};
+
+static size_t parallel_fill(char *buf, size_t cap, unsigned int seed)
+{
+  size_t n = 0;
+  const size_t nsnip = sizeof parallel_snippets / sizeof parallel_snippets[0];
+
+  for (;;) {
+    const char *snip = parallel_snippets[seed % nsnip];
+    size_t len = strlen(snip);
+
+    if (n + len >= cap) { break; }
+    memcpy(buf+n, snip, len);
+    n += len;
+    seed = seed * 1103515245u + 12345u;
+    seed ^= seed >> 16;
+  }
+
+  return n;
+}
+
+static void parallel_serial(const unsigned char *data, size_t len, struct gen_lexer_tokens *out)
+{
+  struct gen_lexer lexer;
+  struct gen_lexer_membuf mb = { data, len, 0 };
+  struct gen_lexer_token rec;
+  int tok;
+
+  gen_lexer_initialize(&lexer, &mb);
+  while ((tok = gen_lexer_next_token(&lexer)) != 0) {
+    gen_lexer_token_record(&lexer, tok, &rec);
+    gen_lexer_tokens_push(out, &rec);
+  }
+}
+
+static int parallel_same_token(const struct gen_lexer_token *a, const struct gen_lexer_token *b)
+{
+  if ((a->tok != b->tok) || (a->off != b->off) || (a->end != b->end) ||
+      (a->line != b->line) || (a->col != b->col)) {
+    return 0;
+  }
+
+  if (a->tok == GENLEX_FLOAT_TOKEN) {
+    return a->val.f == b->val.f;
+  }
+
+  if (a->tok == GENLEX_INT_TOKEN) {
+    return a->val.i == b->val.i;
+  }
+
+  return 1;
+}
+
+DEFTEST( parallel_matches_serial )
+{
+  static char buf[4096];
+  struct gen_lexer_tokens serial = { NULL, 0, 0 };
+  unsigned int seed, nthreads;
+
+  for (seed=0; seed < 8; seed++) {
+    size_t len = parallel_fill(buf, sizeof buf, seed);
+
+    serial.len = 0;
+    parallel_serial((const unsigned char *)buf, len, &serial);
+
+    for (nthreads=1; nthreads <= 24; nthreads++) {
+      struct gen_lexer_tokens par = { NULL, 0, 0 };
+      size_t i;
+
+      EXPECT( 0, gen_lexer_parallel_lex((const unsigned char *)buf, len, nthreads, &par) );
+      EXPECT( (int)serial.len, (int)par.len );
+      for (i=0; i < serial.len; i++) {
+        EXPECT( 1, parallel_same_token(&serial.toks[i], &par.toks[i]) );
+      }
+
+      gen_lexer_tokens_free(&par);
+    }
+  }
+
+  gen_lexer_tokens_free(&serial);
+}
+
+DEFTEST( parallel_empty_input )
+{
+  struct gen_lexer_tokens par = { NULL, 0, 0 };
+
+  EXPECT( 0, gen_lexer_parallel_lex((const unsigned char *)"", 0, 4, &par) );
+  EXPECT( 0, (int)par.len );
+
+  EXPECT( 0, gen_lexer_parallel_lex((const unsigned char *)"   \n  ", 6, 4, &par) );
+  EXPECT( 0, (int)par.len );
+
+  gen_lexer_tokens_free(&par);
+}
+
+void run_tests_parallel(void)
+{
+  (void)gen_lexer_token_line;
+  (void)gen_lexer_token_col;
+  (void)gen_lexer_token_off;
+  (void)gen_lexer_token_int_value;
+  (void)gen_lexer_token_float_value;
+
+  RUNTEST( parallel_matches_serial );
+  RUNTEST( parallel_empty_input );
+}
@@ -0,0 +1,210 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+#define GENLEX_CONFIG_MEMORY 1
+
+#define GENLEX_STRING_MAX 64
+
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS "()=;+-*/"
+
+#define GENLEX_ID_TOKEN     1024
+#define GENLEX_STRING_TOKEN 1025
+#define GENLEX_INT_TOKEN    1026
+
+#define KW_IF    1027
+#define KW_WHILE 1028
+
+#define GENLEX_KEYWORDS { \
+  { "if"   , KW_IF    }, \
+  { "while", KW_WHILE }, \
+}
+
+/* small, so that the tests wrap the ring and fill it */
+#define GENLEX_PIPELINE_BATCH 7
+#define GENLEX_PIPELINE_SLOTS 3
+
+#include "glex.h"
+#include "glex_pipeline.h"
+
+#define PIPE_REPS 2000
+
+static const char pipe_stmt[] = "while (x_%d) y = \"s%d\" + %d * 3;\n";
+
+static char *pipe_text(int reps, size_t *lenp)
+{
+  size_t cap = (size_t)reps * 64, len = 0;
+  char *text = malloc(cap);
+  int i;
+
+  for (i=0; i < reps; i++) {
+    len += snprintf(text + len, cap - len, pipe_stmt, i, i, i);
+  }
+  *lenp = len;
+
+  return text;
+}
+
+DEFTEST( pipeline_matches_serial )
+{
+  struct gen_lexer_membuf mb, mb2;
+  struct gen_lexer lexer, serial;
+  struct gen_lexer_pipeline pl;
+  const struct gen_lexer_pipeline_token *t;
+  size_t len, n = 0, bad = 0;
+  char *text = pipe_text(PIPE_REPS, &len);
+  int tok;
+
+  mb.data = (const unsigned char *)text; mb.len = len; mb.pos = 0;
+  mb2 = mb;
+  gen_lexer_initialize(&lexer, &mb);
+  gen_lexer_initialize(&serial, &mb2);
+
+  EXPECT( 0, gen_lexer_pipeline_start(&pl, &lexer) );
+  do {
+    struct gen_lexer_token rec;
+    const unsigned char *s;
+    size_t slen;
+
+    tok = gen_lexer_pipeline_next(&pl, &t);
+    EXPECT( tok, gen_lexer_next_token(&serial) );
+    gen_lexer_token_record(&serial, tok, &rec);
+    s = gen_lexer_token_string(&serial, &slen);
+
+    if (rec.off != t->rec.off || rec.end != t->rec.end || rec.line != t->rec.line ||
+        rec.col != t->rec.col || rec.val.i != t->rec.val.i ||
+        slen != t->len || memcmp(s, t->text, slen) != 0 || t->text[slen] != '\0') {
+      bad++;
+    }
+    n++;
+  } while (tok > 0);
+
+  EXPECT( 0, tok );
+  EXPECT( 0, bad );
+  EXPECT( 12*PIPE_REPS + 1, n );
+
+  /* the end stays put */
+  EXPECT( 0, gen_lexer_pipeline_next(&pl, &t) );
+  EXPECT( 0, gen_lexer_pipeline_next(&pl, &t) );
+  gen_lexer_pipeline_finish(&pl);
+
+  free(text);
+}
+
+DEFTEST( pipeline_error_ends_stream )
+{
+  struct gen_lexer_membuf mb = { (const unsigned char *)"a = 1; @ b = 2;", 15, 0 };
+  struct gen_lexer lexer;
+  struct gen_lexer_pipeline pl;
+  const struct gen_lexer_pipeline_token *t;
+
+  gen_lexer_initialize(&lexer, &mb);
+  EXPECT( 0, gen_lexer_pipeline_start(&pl, &lexer) );
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_pipeline_next(&pl, &t) );
+  EXPECT_STR( "a", (const char *)t->text );
+  EXPECT( '=', gen_lexer_pipeline_next(&pl, &t) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_pipeline_next(&pl, &t) );
+  EXPECT( 1, t->rec.val.i );
+  EXPECT( ';', gen_lexer_pipeline_next(&pl, &t) );
+  EXPECT( GENLEX_ERR_INVALID_CHAR, gen_lexer_pipeline_next(&pl, &t) );
+  EXPECT( 7, t->rec.off );
+  EXPECT( GENLEX_ERR_INVALID_CHAR, gen_lexer_pipeline_next(&pl, &t) );
+  gen_lexer_pipeline_finish(&pl);
+
+  /* the lexer carries on after the error */
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "b", (const char *)gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( 9, gen_lexer_token_off(&lexer) );
+  EXPECT( 0, gen_lexer_token_line(&lexer) );
+  EXPECT( 9, gen_lexer_token_col(&lexer) );
+  EXPECT( '=', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 2, gen_lexer_token_int_value(&lexer) );
+}
+
+DEFTEST( pipeline_held_batches )
+{
+  const struct gen_lexer_pipeline_batch *held[GENLEX_PIPELINE_SLOTS];
+  const struct gen_lexer_pipeline_batch *b;
+  struct gen_lexer_membuf mb;
+  struct gen_lexer lexer;
+  struct gen_lexer_pipeline pl;
+  size_t len, n = 0, i, k;
+  char *text = pipe_text(50, &len);
+  int last = 0;
+
+  mb.data = (const unsigned char *)text; mb.len = len; mb.pos = 0;
+  gen_lexer_initialize(&lexer, &mb);
+  EXPECT( 0, gen_lexer_pipeline_start(&pl, &lexer) );
+
+  /* hold a full ring: the text of every held token stays put while the
+   * producer waits for room
+   */
+  for (k=0; k < GENLEX_PIPELINE_SLOTS; k++) {
+    held[k] = gen_lexer_pipeline_pop(&pl);
+    EXPECT( GENLEX_PIPELINE_BATCH, held[k]->len );
+  }
+  EXPECT( 1, held[0]->toks[0].rec.tok == KW_WHILE );
+  EXPECT_STR( "while", (const char *)held[0]->toks[0].text );
+  EXPECT_STR( "x_0", (const char *)held[0]->toks[2].text );
+  EXPECT_STR( "s0", (const char *)held[0]->toks[6].text );
+  EXPECT_STR( "x_1", (const char *)held[2]->toks[0].text );
+  for (k=0; k < GENLEX_PIPELINE_SLOTS; k++) {
+    n += held[k]->len;
+    gen_lexer_pipeline_release(&pl);
+  }
+
+  while ((b = gen_lexer_pipeline_pop(&pl)) != NULL) {
+    EXPECT( 0, last );
+    for (i=0; i < b->len; i++) {
+      EXPECT( 1, (b->toks[i].rec.tok > 0) || (b->last && i == b->len-1) );
+    }
+    n += b->len;
+    last = b->last;
+    gen_lexer_pipeline_release(&pl);
+  }
+  EXPECT( 1, last );
+  EXPECT( 12*50 + 1, n );
+  EXPECT( 1, gen_lexer_pipeline_pop(&pl) == NULL );
+  gen_lexer_pipeline_finish(&pl);
+
+  free(text);
+}
+
+DEFTEST( pipeline_finish_early )
+{
+  struct gen_lexer_membuf mb;
+  struct gen_lexer lexer;
+  struct gen_lexer_pipeline pl;
+  const struct gen_lexer_pipeline_token *t;
+  size_t len;
+  char *text = pipe_text(PIPE_REPS, &len);
+
+  mb.data = (const unsigned char *)text; mb.len = len; mb.pos = 0;
+  gen_lexer_initialize(&lexer, &mb);
+  EXPECT( 0, gen_lexer_pipeline_start(&pl, &lexer) );
+  EXPECT( KW_WHILE, gen_lexer_pipeline_next(&pl, &t) );
+
+  /* stops a producer that is waiting on a full ring */
+  gen_lexer_pipeline_finish(&pl);
+  gen_lexer_pipeline_finish(&pl);
+
+  /* the lexer stopped at a batch boundary, well before the end */
+  EXPECT( 1, lexer.tok_off < len / 2 );
+  EXPECT( 1, gen_lexer_next_token(&lexer) > 0 );
+
+  free(text);
+}
+
+void run_tests_pipeline(void)
+{
+  RUNTEST( pipeline_matches_serial );
+  RUNTEST( pipeline_error_ends_stream );
+  RUNTEST( pipeline_held_batches );
+  RUNTEST( pipeline_finish_early );
+}
@@ -0,0 +1,182 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+#define GENLEX_CONFIG_MEMORY 1
+#define GENLEX_CONFIG_POOL   1
+
+/* As large as a server would configure it */
+#define GENLEX_STRING_MAX (64*1024)
+
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS "()=;"
+
+#define GENLEX_ID_TOKEN     1024
+#define GENLEX_STRING_TOKEN 1025
+#define GENLEX_INT_TOKEN    1026
+
+#define GENLEX_KEYWORDS {}
+
+#include "glex.h"
+
+#define MEMBUF(s) { (const unsigned char *)(s), sizeof(s)-1, 0 }
+
+DEFTEST( pool_borrows_only_for_text )
+{
+  struct gen_lexer_membuf mb = MEMBUF( "(abc = \"x y\");" );
+  struct gen_lexer_pool pool;
+  struct gen_lexer lexer;
+  size_t len;
+
+  /* the state alone, without the 64 KiB buffer (the kind table adds
+   * 256 bytes)
+   */
+#if GENLEX_CONFIG_KIND_TABLE
+  EXPECT( 1, sizeof lexer < 128 + 256 );
+#else
+  EXPECT( 1, sizeof lexer < 128 );
+#endif
+
+  gen_lexer_pool_init(&pool, 4);
+  gen_lexer_initialize(&lexer, &mb);
+  gen_lexer_use_pool(&lexer, &pool);
+
+  EXPECT( '(', gen_lexer_next_token(&lexer) );
+  EXPECT( 0, pool.nborrowed );
+  EXPECT_STR( "", gen_lexer_token_string(&lexer, &len) );
+  EXPECT( 0, len );
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 1, pool.nborrowed );
+  EXPECT_STR( "abc", gen_lexer_token_string(&lexer, NULL) );
+
+  /* no text: the buffer goes back */
+  EXPECT( '=', gen_lexer_next_token(&lexer) );
+  EXPECT( 0, pool.nborrowed );
+  EXPECT( 1, pool.nfree );
+
+  EXPECT( GENLEX_STRING_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 1, pool.nborrowed );
+  EXPECT( 0, pool.nfree );
+  EXPECT_STR( "x y", gen_lexer_token_string(&lexer, NULL) );
+
+  EXPECT( ')', gen_lexer_next_token(&lexer) );
+  EXPECT( ';', gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+  EXPECT( 0, pool.nborrowed );
+
+  gen_lexer_pool_free(&pool);
+  EXPECT( 0, pool.nfree );
+}
+
+/* pooled lexers decode escapes through the shared const table too */
+DEFTEST( pool_escapes )
+{
+  struct gen_lexer_membuf mb = MEMBUF( "\"a\\tb\\\\\" \"\\x\"" );
+  struct gen_lexer_pool pool;
+  struct gen_lexer lexer;
+
+  gen_lexer_pool_init(&pool, 4);
+  gen_lexer_initialize(&lexer, &mb);
+  gen_lexer_use_pool(&lexer, &pool);
+
+  EXPECT( GENLEX_STRING_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "a\tb\\", (const char *)gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( GENLEX_ERR_UNRECOGNIZED_ESCAPE, gen_lexer_next_token(&lexer) );
+
+  gen_lexer_reset(&lexer, &mb);
+  gen_lexer_pool_free(&pool);
+}
+
+DEFTEST( pool_shared_between_lexers )
+{
+  struct gen_lexer_membuf mb1 = MEMBUF( "a b" );
+  struct gen_lexer_membuf mb2 = MEMBUF( "12 c" );
+  struct gen_lexer_pool pool;
+  struct gen_lexer l1, l2;
+  const unsigned char *p1;
+
+  gen_lexer_pool_init(&pool, 4);
+  gen_lexer_initialize(&l1, &mb1);
+  gen_lexer_initialize(&l2, &mb2);
+  gen_lexer_use_pool(&l1, &pool);
+  gen_lexer_use_pool(&l2, &pool);
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&l1) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_next_token(&l2) );
+  EXPECT( 12, gen_lexer_token_int_value(&l2) );
+  EXPECT( 2, pool.nborrowed );
+  EXPECT( 1, l1.buf != l2.buf );
+
+  /* consecutive tokens with text keep the same buffer */
+  p1 = l1.buf;
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&l1) );
+  EXPECT( 1, l1.buf == p1 );
+  EXPECT_STR( "b", gen_lexer_token_string(&l1, NULL) );
+
+  EXPECT( 0, gen_lexer_next_token(&l1) );
+  EXPECT( 1, pool.nborrowed );
+
+  /* ... and a returned one is reused */
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&l2) );
+  EXPECT( 1, l2.buf != p1 );
+  mb1.pos = 0;
+  gen_lexer_reset(&l1, &mb1);
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&l1) );
+  EXPECT( 1, l1.buf == p1 );
+  EXPECT_STR( "a", gen_lexer_token_string(&l1, NULL) );
+
+  gen_lexer_reset(&l1, &mb1);
+  gen_lexer_reset(&l2, &mb2);
+  EXPECT( 0, pool.nborrowed );
+  EXPECT( 2, pool.nfree );
+  gen_lexer_pool_free(&pool);
+}
+
+DEFTEST( pool_reset_and_limits )
+{
+  struct gen_lexer_membuf mb = MEMBUF( "abc\ndef" );
+  struct gen_lexer_membuf mb2 = MEMBUF( "  xyz" );
+  struct gen_lexer_pool pool;
+  struct gen_lexer lexer;
+
+  /* keeps nothing: every buffer goes back to the heap */
+  gen_lexer_pool_init(&pool, 0);
+  gen_lexer_initialize(&lexer, &mb);
+  gen_lexer_use_pool(&lexer, &pool);
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 1, gen_lexer_token_line(&lexer) );
+
+  gen_lexer_reset(&lexer, &mb2);
+  EXPECT( 0, pool.nborrowed );
+  EXPECT( 0, pool.nfree );
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "xyz", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( 0, gen_lexer_token_line(&lexer) );
+  EXPECT( 2, gen_lexer_token_col(&lexer) );
+  EXPECT( 2, gen_lexer_token_off(&lexer) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+  EXPECT( 0, pool.nborrowed );
+
+  /* without a pool, buffers come from the heap */
+  mb2.pos = 0;
+  gen_lexer_initialize(&lexer, &mb2);
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "xyz", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+  EXPECT( 1, lexer.buf == NULL );
+}
+
+void run_tests_pool(void)
+{
+  RUNTEST( pool_borrows_only_for_text );
+  RUNTEST( pool_shared_between_lexers );
+  RUNTEST( pool_reset_and_limits );
+  RUNTEST( pool_escapes );
+}
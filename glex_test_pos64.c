@@ -0,0 +1,217 @@
+#define _FILE_OFFSET_BITS 64
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+/* Built twice: over a mapped file, and as glex_test_pos64_stream.o over
+ * the stream backend
+ */
+#if GLEX_TEST_POS64_STREAM
+#  define GENLEX_CONFIG_STREAM 1
+#else
+#  define GENLEX_CONFIG_MEMORY 1
+#endif
+#define GENLEX_CONFIG_POS64  1
+
+#define GENLEX_STRING_MAX 64
+
+/* the holes of the sparse file read as NULs */
+#define GENLEX_IS_WHITESPACE(ch)  (isspace(ch) || ((ch) == '\0'))
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS "=;"
+
+#define GENLEX_ID_TOKEN     1024
+#define GENLEX_STRING_TOKEN 1025
+#define GENLEX_INT_TOKEN    1026
+
+#define GENLEX_KEYWORDS {}
+
+#include "glex.h"
+
+#if !GLEX_TEST_POS64_STREAM
+#  include "glex_mmap.h"
+#endif
+
+/* A sparse file of a little over 4 GiB: an "x" on a line of its own at
+ * every MiB, and the tail at TAIL_OFF
+ */
+#define TAIL_OFF  ((1ull << 32) + 1000)
+#define NMARKERS  4096
+static const char tail[] = "\n\nalpha = 42;\n  beta";
+
+static int make_sparse(char *path)
+{
+  int fd, k, ok;
+
+  if ((fd = mkstemp(path)) < 0) { return -1; }
+
+  ok = (ftruncate(fd, TAIL_OFF) == 0) &&
+       (pwrite(fd, tail, sizeof tail - 1, TAIL_OFF) == sizeof tail - 1);
+  for (k = 1; ok && (k <= NMARKERS); k++) {
+    ok = (pwrite(fd, "x\n", 2, (off_t)k << 20) == 2);
+  }
+
+  close(fd);
+  if (!ok) {
+    unlink(path);
+    return -1;
+  }
+  return 0;
+}
+
+/* Checks the tokens of the tail, given the line it starts on */
+static void check_tail(struct gen_lexer *lexer, unsigned long long line)
+{
+  struct gen_lexer_token rec;
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(lexer) );
+  EXPECT( 1, gen_lexer_token_off(lexer) == TAIL_OFF + 2 );
+  EXPECT( 1, gen_lexer_token_line(lexer) == line + 2 );
+  EXPECT( 0, gen_lexer_token_col(lexer) );
+
+  EXPECT( '=', gen_lexer_next_token(lexer) );
+  EXPECT( 1, gen_lexer_token_off(lexer) == TAIL_OFF + 8 );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_next_token(lexer) );
+  EXPECT( 42, gen_lexer_token_int_value(lexer) );
+  EXPECT( ';', gen_lexer_next_token(lexer) );
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(lexer) );
+  EXPECT_STR( "beta", gen_lexer_token_string(lexer, NULL) );
+  EXPECT( 1, gen_lexer_token_line(lexer) == line + 3 );
+  EXPECT( 2, gen_lexer_token_col(lexer) );
+
+  /* the end counts the EOF read */
+  gen_lexer_token_record(lexer, GENLEX_ID_TOKEN, &rec);
+  EXPECT( 1, rec.off == TAIL_OFF + 16 );
+  EXPECT( 1, rec.end == TAIL_OFF + sizeof tail );
+  EXPECT( 0, gen_lexer_next_token(lexer) );
+}
+
+static long max_rss_kb(void)
+{
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_maxrss;
+}
+
+#if GLEX_TEST_POS64_STREAM
+DEFTEST( pos64_offsets_near_end )
+{
+  char path[] = "/tmp/glex_test_XXXXXX";
+  struct gen_lexer_mark mark = { TAIL_OFF - 8, 0, 0 };
+  struct gen_lexer_stream st;
+  struct gen_lexer lexer;
+  FILE *f;
+
+  EXPECT( 0, make_sparse(path) );
+  f = fopen(path, "rb");
+  unlink(path);
+  EXPECT( 1, f != NULL );
+  EXPECT( 0, fseeko(f, mark.off, SEEK_SET) );
+
+  /* the input starts partway into the file */
+  EXPECT( 1, gen_lexer_stream_init(&st, gen_lexer_stream_read_file, f, 4096) );
+  st.start = mark.off;
+  gen_lexer_initialize(&lexer, &st);
+  EXPECT( 0, gen_lexer_reset_to(&lexer, &mark) );
+
+  check_tail(&lexer, 0);
+  gen_lexer_stream_free(&st);
+  fclose(f);
+}
+
+/* Reads all of it, so only run when GLEX_TEST_LARGE is set */
+DEFTEST( pos64_whole_file_bounded )
+{
+  char path[] = "/tmp/glex_test_XXXXXX";
+  struct gen_lexer_stream st;
+  struct gen_lexer lexer;
+  long rss = max_rss_kb();
+  int k;
+  FILE *f;
+
+  if (getenv("GLEX_TEST_LARGE") == NULL) { return; }
+
+  EXPECT( 0, make_sparse(path) );
+  f = fopen(path, "rb");
+  unlink(path);
+  EXPECT( 1, f != NULL );
+
+  EXPECT( 1, gen_lexer_stream_init(&st, gen_lexer_stream_read_file, f, 64*1024) );
+  gen_lexer_initialize(&lexer, &st);
+  for (k = 1; k <= NMARKERS; k++) {
+    EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+    EXPECT( 1, gen_lexer_token_off(&lexer) == (unsigned long long)k << 20 );
+  }
+
+  check_tail(&lexer, NMARKERS);
+  EXPECT( 64*1024, st.cap );
+  EXPECT( 1, max_rss_kb() - rss < 64*1024 );
+  gen_lexer_stream_free(&st);
+  fclose(f);
+}
+#else
+DEFTEST( pos64_offsets_near_end )
+{
+  char path[] = "/tmp/glex_test_XXXXXX";
+  struct gen_lexer_mark mark = { TAIL_OFF - 8, 0, 0 };
+  struct gen_lexer_mmap m;
+  struct gen_lexer lexer;
+
+  /* can't be mapped */
+  if (sizeof(size_t) < 8) { return; }
+
+  EXPECT( 0, make_sparse(path) );
+  EXPECT( 0, gen_lexer_mmap_open(&m, path, 1 << 20) );
+  unlink(path);
+
+  gen_lexer_initialize(&lexer, &m.mb);
+  EXPECT( 0, gen_lexer_reset_to(&lexer, &mark) );
+  check_tail(&lexer, 0);
+
+  gen_lexer_mmap_release(&m, TAIL_OFF);
+  EXPECT( 1, m.released == TAIL_OFF - TAIL_OFF % m.pagesize );
+  gen_lexer_mmap_close(&m);
+}
+
+/* Reads all of it, so only run when GLEX_TEST_LARGE is set */
+DEFTEST( pos64_whole_file_bounded )
+{
+  char path[] = "/tmp/glex_test_XXXXXX";
+  struct gen_lexer_mmap m;
+  struct gen_lexer lexer;
+  long rss = max_rss_kb();
+  int k;
+
+  if ((getenv("GLEX_TEST_LARGE") == NULL) || (sizeof(size_t) < 8)) { return; }
+
+  EXPECT( 0, make_sparse(path) );
+  EXPECT( 0, gen_lexer_mmap_open(&m, path, 1 << 20) );
+  unlink(path);
+
+  gen_lexer_initialize(&lexer, &m.mb);
+  for (k = 1; k <= NMARKERS; k++) {
+    EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+    EXPECT( 1, gen_lexer_token_off(&lexer) == (unsigned long long)k << 20 );
+    gen_lexer_mmap_release(&m, gen_lexer_token_off(&lexer));
+  }
+
+  check_tail(&lexer, NMARKERS);
+  EXPECT( 1, max_rss_kb() - rss < 64*1024 );
+  gen_lexer_mmap_close(&m);
+}
+#endif
+
+void run_tests_pos64(void)
+{
+  RUNTEST( pos64_offsets_near_end );
+  RUNTEST( pos64_whole_file_bounded );
+}
@@ -0,0 +1,166 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+#define GENLEX_CONFIG_MEMORY 1
+#define GENLEX_CONFIG_FLOATS 1
+
+#define GENLEX_STRING_MAX 64
+
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS "()=;"
+
+#define GENLEX_ID_TOKEN      1024
+#define GENLEX_STRING_TOKEN  1025
+#define GENLEX_INT_TOKEN     1026
+#define GENLEX_FLOAT_TOKEN   1027
+#define GENLEX_COMMENT_TOKEN 1028
+
+#define KW_IF    1030
+#define KW_WHILE 1031
+
+#define LIT_EQ 512
+
+#define GENLEX_LITERAL_PAIRS { \
+  { "==", LIT_EQ },            \
+}
+
+#define GENLEX_KEYWORDS { \
+  { "if"   , KW_IF    }, \
+  { "while", KW_WHILE }, \
+}
+
+#define GENLEX_COMMENT_PAIRS GENLEX_C99_COMMENTS
+
+#include "glex.h"
+
+/* A transcript of the handlers called, one word per token */
+struct run_log {
+  char text[512];
+  size_t len;
+  int stop_at;   /* token that stops the driver, if not 0 */
+};
+
+static int run_put(struct run_log *log, const char *fmt, const void *s, size_t n, long v)
+{
+  char word[128];
+
+  if (s != NULL) {
+    snprintf(word, sizeof word, fmt, (int)n, (const char *)s);
+  } else {
+    snprintf(word, sizeof word, fmt, v);
+  }
+  log->len += snprintf(log->text + log->len, sizeof log->text - log->len,
+      (log->len > 0) ? " %s" : "%s", word);
+  return 0;
+}
+
+static inline int run_on_token(struct run_log *log, const char *fmt, int tok)
+{
+  run_put(log, fmt, NULL, 0, tok);
+  return (tok == log->stop_at) ? 1 : 0;
+}
+
+/* Every class */
+#define GENLEX_ON_IDENT(ctx,s,len)    run_put((ctx), "I:%.*s", (s), (len), 0)
+#define GENLEX_ON_STRING(ctx,s,len)   run_put((ctx), "S:%.*s", (s), (len), 0)
+#define GENLEX_ON_COMMENT(ctx,s,len)  run_put((ctx), "C:%.*s", (s), (len), 0)
+#define GENLEX_ON_INT(ctx,v)          run_put((ctx), "N:%ld", NULL, 0, (long)(v))
+#define GENLEX_ON_FLOAT(ctx,v)        run_put((ctx), "F:%ld", NULL, 0, (long)((v)*10))
+#define GENLEX_ON_KEYWORD(ctx,tok)    run_on_token((ctx), "K:%ld", (tok))
+#define GENLEX_ON_LITERAL(ctx,tok)    run_on_token((ctx), "L:%ld", (tok))
+#define GENLEX_RUN_CTX_T struct run_log *
+#include "glex_run.h"
+
+/* Only keywords and errors, which it skips */
+#define GENLEX_RUN_NAME run_keywords
+#define GENLEX_ON_KEYWORD(ctx,tok)    run_on_token((ctx), "K:%ld", (tok))
+#define GENLEX_ON_ERROR(ctx,err)      run_put((ctx), "E:%ld", NULL, 0, (err))
+#define GENLEX_RUN_CTX_T struct run_log *
+#include "glex_run.h"
+
+/* No handlers at all */
+#define GENLEX_RUN_NAME run_nothing
+#include "glex_run.h"
+
+#define MEMBUF(s) { (const unsigned char *)(s), sizeof(s)-1, 0 }
+
+static const char run_text[] =
+  "if (x1 == 2.5) /* c */ s = \"ab\"; // t\nwhile (n) n = 'a' ;";
+
+DEFTEST( run_all_classes )
+{
+  struct gen_lexer_membuf mb = MEMBUF( run_text );
+  struct gen_lexer lexer;
+  struct run_log log;
+
+  memset(&log, 0, sizeof log);
+  gen_lexer_initialize(&lexer, &mb);
+  EXPECT( 0, gen_lexer_run(&lexer, &log) );
+  EXPECT_STR( "K:1030 L:40 I:x1 L:512 F:25 L:41 C: c  I:s L:61 S:ab L:59 C: t"
+      " K:1031 L:40 I:n L:41 I:n L:61 N:97 L:59", log.text );
+
+  /* the end stays put */
+  EXPECT( 0, gen_lexer_run(&lexer, &log) );
+}
+
+DEFTEST( run_stop_and_resume )
+{
+  struct gen_lexer_membuf mb = MEMBUF( run_text );
+  struct gen_lexer lexer;
+  struct run_log log;
+
+  memset(&log, 0, sizeof log);
+  log.stop_at = ';';
+  gen_lexer_initialize(&lexer, &mb);
+  EXPECT( 1, gen_lexer_run(&lexer, &log) );
+  EXPECT_STR( "K:1030 L:40 I:x1 L:512 F:25 L:41 C: c  I:s L:61 S:ab L:59", log.text );
+
+  /* the lexer is left after the token that stopped it */
+  EXPECT( 32, lexer.off );
+  EXPECT( 1, gen_lexer_run(&lexer, &log) );
+  EXPECT( 1, gen_lexer_token_line(&lexer) );
+  EXPECT( 18, gen_lexer_token_col(&lexer) );
+  EXPECT( 0, gen_lexer_run(&lexer, &log) );
+}
+
+DEFTEST( run_errors )
+{
+  struct gen_lexer_membuf mb = MEMBUF( "while @ if $ x" );
+  struct gen_lexer lexer;
+  struct run_log log;
+
+  /* by default, an error stops the driver */
+  memset(&log, 0, sizeof log);
+  gen_lexer_initialize(&lexer, &mb);
+  EXPECT( GENLEX_ERR_INVALID_CHAR, gen_lexer_run(&lexer, &log) );
+  EXPECT_STR( "K:1031", log.text );
+  EXPECT( 6, gen_lexer_token_off(&lexer) );
+
+  /* a handler can skip them */
+  memset(&log, 0, sizeof log);
+  mb.pos = 0;
+  gen_lexer_initialize(&lexer, &mb);
+  EXPECT( 0, run_keywords(&lexer, &log) );
+  EXPECT_STR( "K:1031 E:-1 K:1030 E:-1", log.text );
+
+  /* with no handlers, only errors stop it */
+  mb.pos = 0;
+  gen_lexer_initialize(&lexer, &mb);
+  EXPECT( GENLEX_ERR_INVALID_CHAR, run_nothing(&lexer, NULL) );
+  EXPECT( GENLEX_ERR_INVALID_CHAR, run_nothing(&lexer, NULL) );
+  EXPECT( 0, run_nothing(&lexer, NULL) );
+}
+
+void run_tests_run(void)
+{
+  (void)gen_lexer_token_string;
+
+  RUNTEST( run_all_classes );
+  RUNTEST( run_stop_and_resume );
+  RUNTEST( run_errors );
+}
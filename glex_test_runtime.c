@@ -0,0 +1,312 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+#define GENLEX_CONFIG_MEMORY  1
+#define GENLEX_CONFIG_RUNTIME 1
+#define GENLEX_CONFIG_FLOATS  1
+
+#define GENLEX_STRING_MAX 64
+
+#include "glex.h"
+
+#define MEMBUF(s) { (const unsigned char *)(s), sizeof(s)-1, 0 }
+
+enum {
+  RT_ID = 1024, RT_STRING, RT_INT, RT_FLOAT, RT_COMMENT,
+  RT_IF, RT_WHILE, RT_RETURN, RT_FI, RT_THEN, RT_ECHO,
+  RT_EQ, RT_AND, RT_OR,
+};
+
+/* A C-like dialect: C99 comments are returned, floats are parsed */
+static const struct gen_lexer_keyword c_keywords[] = {
+  { "if", RT_IF }, { "while", RT_WHILE }, { "return", RT_RETURN },
+};
+static const struct gen_lexer_literal_pair c_pairs[] = {
+  { "==", RT_EQ }, { "&&", RT_AND },
+};
+static const struct gen_lexer_comment_pairs c_comments[] = GENLEX_C99_COMMENTS;
+
+static const struct gen_lexer_config c_dialect = {
+  "(){}=;+-*/<>&",
+  c_pairs, sizeof c_pairs / sizeof c_pairs[0],
+  c_keywords, sizeof c_keywords / sizeof c_keywords[0],
+  c_comments, sizeof c_comments / sizeof c_comments[0],
+  GENLEX_ALPHA "_", GENLEX_ALPHA "_" GENLEX_DIGITS, NULL,
+  RT_ID, RT_STRING, RT_INT, RT_FLOAT, RT_COMMENT,
+};
+
+/* A shell-like dialect: # comments are skipped, no floats, symbols may
+ * contain '-' and '.' and newlines are literals rather than whitespace
+ */
+static const struct gen_lexer_keyword sh_keywords[] = {
+  { "if", RT_IF }, { "then", RT_THEN }, { "fi", RT_FI }, { "echo", RT_ECHO },
+};
+static const struct gen_lexer_literal_pair sh_pairs[] = {
+  { "||", RT_OR }, { "&&", RT_AND },
+};
+static const struct gen_lexer_comment_pairs sh_comments[] = GENLEX_SH_COMMENTS;
+
+static const struct gen_lexer_config sh_dialect = {
+  ";|&\n",
+  sh_pairs, sizeof sh_pairs / sizeof sh_pairs[0],
+  sh_keywords, sizeof sh_keywords / sizeof sh_keywords[0],
+  sh_comments, sizeof sh_comments / sizeof sh_comments[0],
+  GENLEX_ALPHA "_-", GENLEX_ALPHA "_-." GENLEX_DIGITS, " \t",
+  RT_ID, RT_STRING, RT_INT, 0, 0,
+};
+
+DEFTEST( runtime_c_dialect )
+{
+  struct gen_lexer_tables tab;
+  struct gen_lexer_membuf mb = MEMBUF(
+      "while (x == 2.5) { /* loop */ y = \"s\"; } // done\nreturn iffy && 7;" );
+  struct gen_lexer lexer;
+
+  EXPECT( 0, gen_lexer_compile(&tab, &c_dialect) );
+  gen_lexer_initialize_with(&lexer, &tab, &mb);
+
+  EXPECT( RT_WHILE, gen_lexer_next_token(&lexer) );
+  EXPECT( '(', gen_lexer_next_token(&lexer) );
+  EXPECT( RT_ID, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "x", gen_lexer_token_string(&lexer,NULL) );
+  EXPECT( RT_EQ, gen_lexer_next_token(&lexer) );
+  EXPECT( RT_FLOAT, gen_lexer_next_token(&lexer) );
+  EXPECT( 1, gen_lexer_token_float_value(&lexer) == 2.5 );
+  EXPECT( ')', gen_lexer_next_token(&lexer) );
+  EXPECT( '{', gen_lexer_next_token(&lexer) );
+  EXPECT( RT_COMMENT, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( " loop ", gen_lexer_token_string(&lexer,NULL) );
+  EXPECT( RT_ID, gen_lexer_next_token(&lexer) );
+  EXPECT( '=', gen_lexer_next_token(&lexer) );
+  EXPECT( RT_STRING, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "s", gen_lexer_token_string(&lexer,NULL) );
+  EXPECT( ';', gen_lexer_next_token(&lexer) );
+  EXPECT( '}', gen_lexer_next_token(&lexer) );
+  EXPECT( RT_COMMENT, gen_lexer_next_token(&lexer) );
+  EXPECT( RT_RETURN, gen_lexer_next_token(&lexer) );
+  EXPECT( 1, gen_lexer_token_line(&lexer) );
+  EXPECT( RT_ID, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "iffy", gen_lexer_token_string(&lexer,NULL) );
+  EXPECT( RT_AND, gen_lexer_next_token(&lexer) );
+  EXPECT( RT_INT, gen_lexer_next_token(&lexer) );
+  EXPECT( 7, gen_lexer_token_int_value(&lexer) );
+  EXPECT( ';', gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+
+  gen_lexer_tables_free(&tab);
+}
+
+DEFTEST( runtime_sh_dialect )
+{
+  struct gen_lexer_tables tab;
+  struct gen_lexer_membuf mb = MEMBUF(
+      "if test f_1 a-b.txt # check\nthen echo 2.5 || fi\n" );
+  struct gen_lexer lexer;
+
+  EXPECT( 0, gen_lexer_compile(&tab, &sh_dialect) );
+  gen_lexer_initialize_with(&lexer, &tab, &mb);
+
+  EXPECT( RT_IF, gen_lexer_next_token(&lexer) );
+  EXPECT( RT_ID, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "test", gen_lexer_token_string(&lexer,NULL) );
+  EXPECT( RT_ID, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "f_1", gen_lexer_token_string(&lexer,NULL) );
+  EXPECT( RT_ID, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "a-b.txt", gen_lexer_token_string(&lexer,NULL) );
+
+  /* the comment takes its terminating newline with it */
+  EXPECT( RT_THEN, gen_lexer_next_token(&lexer) );
+  EXPECT( RT_ECHO, gen_lexer_next_token(&lexer) );
+
+  /* no floats in this dialect: "2.5" is an integer, then a symbol */
+  EXPECT( RT_INT, gen_lexer_next_token(&lexer) );
+  EXPECT( 2, gen_lexer_token_int_value(&lexer) );
+  EXPECT( GENLEX_ERR_INVALID_CHAR, gen_lexer_next_token(&lexer) );
+  EXPECT( RT_INT, gen_lexer_next_token(&lexer) );
+  EXPECT( 5, gen_lexer_token_int_value(&lexer) );
+
+  EXPECT( RT_OR, gen_lexer_next_token(&lexer) );
+  EXPECT( RT_FI, gen_lexer_next_token(&lexer) );
+  EXPECT( '\n', gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+
+  gen_lexer_tables_free(&tab);
+}
+
+DEFTEST( runtime_shared_tables )
+{
+  struct gen_lexer_tables c_tab, sh_tab;
+  struct gen_lexer_membuf mb1 = MEMBUF( "if x fi" );
+  struct gen_lexer_membuf mb2 = MEMBUF( "if x fi" );
+  struct gen_lexer_membuf mb3 = MEMBUF( "if x fi" );
+  struct gen_lexer a, b, c;
+
+  EXPECT( 0, gen_lexer_compile(&c_tab, &c_dialect) );
+  EXPECT( 0, gen_lexer_compile(&sh_tab, &sh_dialect) );
+
+  /* a and b share one set of tables, c uses the other */
+  gen_lexer_initialize_with(&a, &c_tab, &mb1);
+  gen_lexer_initialize_with(&b, &c_tab, &mb2);
+  gen_lexer_initialize_with(&c, &sh_tab, &mb3);
+
+  EXPECT( RT_IF, gen_lexer_next_token(&a) );
+  EXPECT( RT_IF, gen_lexer_next_token(&c) );
+  EXPECT( RT_IF, gen_lexer_next_token(&b) );
+  EXPECT( RT_ID, gen_lexer_next_token(&c) );
+  EXPECT( RT_ID, gen_lexer_next_token(&a) );
+  EXPECT( RT_ID, gen_lexer_next_token(&b) );
+  EXPECT( RT_ID, gen_lexer_next_token(&a) );
+  EXPECT( RT_FI, gen_lexer_next_token(&c) );
+  EXPECT( RT_ID, gen_lexer_next_token(&b) );
+
+  EXPECT( 0, gen_lexer_next_token(&a) );
+  EXPECT( 0, gen_lexer_next_token(&b) );
+  EXPECT( 0, gen_lexer_next_token(&c) );
+
+  gen_lexer_tables_free(&c_tab);
+  gen_lexer_tables_free(&sh_tab);
+}
+
+DEFTEST( runtime_no_keywords )
+{
+  static const struct gen_lexer_config cfg = {
+    ",", NULL, 0, NULL, 0, NULL, 0,
+    GENLEX_ALPHA, GENLEX_ALPHA, NULL,
+    1, 2, 3, 4, 0,
+  };
+  struct gen_lexer_tables tab;
+  struct gen_lexer_membuf mb = MEMBUF( "a, /b" );
+  struct gen_lexer lexer;
+
+  EXPECT( 0, gen_lexer_compile(&tab, &cfg) );
+  gen_lexer_initialize_with(&lexer, &tab, &mb);
+
+  EXPECT( 1, gen_lexer_next_token(&lexer) );
+  EXPECT( ',', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ERR_INVALID_CHAR, gen_lexer_next_token(&lexer) );
+  EXPECT( 1, gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+
+  gen_lexer_tables_free(&tab);
+}
+
+DEFTEST( runtime_json_escapes )
+{
+  static const struct gen_lexer_escape json_escapes[] = GENLEX_JSON_ESCAPES;
+  static const struct gen_lexer_config cfg = {
+    "[]{}:,", NULL, 0, NULL, 0, NULL, 0,
+    GENLEX_ALPHA, GENLEX_ALPHA, NULL,
+    RT_ID, RT_STRING, RT_INT, RT_FLOAT, 0,
+    json_escapes, sizeof json_escapes / sizeof json_escapes[0],
+  };
+  static const char *const bad[] = {
+    "\"\\uD83D\"",         /* unpaired high surrogate */
+    "\"\\uD83D\\u0041\"",  /* not followed by a low one */
+    "\"\\uDE00\"",         /* unpaired low surrogate */
+    "\"\\u12G4\"",
+    "\"\\x41\"",
+  };
+  struct gen_lexer_membuf mb = MEMBUF( "[\"caf\\u00e9 \\u20AC\\uD83D\\uDE00\\/\\u0041\", \"\\t\"]" );
+  struct gen_lexer_tables tab;
+  struct gen_lexer lexer;
+  size_t i;
+
+  EXPECT( 0, gen_lexer_compile(&tab, &cfg) );
+  gen_lexer_initialize_with(&lexer, &tab, &mb);
+
+  EXPECT( '[', gen_lexer_next_token(&lexer) );
+  EXPECT( RT_STRING, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "caf\xc3\xa9 \xe2\x82\xac\xf0\x9f\x98\x80/A",
+              (const char *)gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( ',', gen_lexer_next_token(&lexer) );
+  EXPECT( RT_STRING, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "\t", (const char *)gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( ']', gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+
+  for (i = 0; i < sizeof bad / sizeof bad[0]; i++) {
+    struct gen_lexer_membuf mbi = { (const unsigned char *)bad[i], strlen(bad[i]), 0 };
+    gen_lexer_initialize_with(&lexer, &tab, &mbi);
+    EXPECT( GENLEX_ERR_UNRECOGNIZED_ESCAPE, gen_lexer_next_token(&lexer) );
+  }
+
+  /* a character literal's value is the code point */
+  mb.data = (const unsigned char *)"'\\u00e9'";
+  mb.len = 8;
+  mb.pos = 0;
+  gen_lexer_initialize_with(&lexer, &tab, &mb);
+  EXPECT( RT_INT, gen_lexer_next_token(&lexer) );
+  EXPECT( 0xe9, gen_lexer_token_int_value(&lexer) );
+  EXPECT_STR( "\xc3\xa9", (const char *)gen_lexer_token_string(&lexer, NULL) );
+
+  /* without a list, a config gets GENLEX_DEFAULT_ESCAPES */
+  gen_lexer_tables_free(&tab);
+  EXPECT( 0, gen_lexer_compile(&tab, &c_dialect) );
+  EXPECT( GENLEX_ESC_CHAR, tab.esc['n'].action );
+  EXPECT( '\n', tab.esc['n'].arg );
+  EXPECT( GENLEX_ESC_ERROR, tab.esc['u'].action );
+
+  gen_lexer_tables_free(&tab);
+}
+
+DEFTEST( runtime_keywords_nocase )
+{
+  static const struct gen_lexer_keyword sql_keywords[] = {
+    { "select", RT_IF }, { "FROM", RT_WHILE }, { "current_timestamp", RT_RETURN },
+  };
+  static const struct gen_lexer_config cfg = {
+    ",;", NULL, 0, sql_keywords, sizeof sql_keywords / sizeof sql_keywords[0], NULL, 0,
+    GENLEX_ALPHA "_", GENLEX_ALPHA "_" GENLEX_DIGITS, NULL,
+    RT_ID, RT_STRING, RT_INT, 0, 0,
+    NULL, 0,
+    1,
+  };
+  struct gen_lexer_membuf mb = MEMBUF( "SELECT a, Current_Timestamp from t; selects CURRENT_TIMESTAMPS" );
+  struct gen_lexer_tables tab;
+  struct gen_lexer lexer;
+
+  EXPECT( 0, gen_lexer_compile(&tab, &cfg) );
+  gen_lexer_initialize_with(&lexer, &tab, &mb);
+
+  EXPECT( RT_IF, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "SELECT", (const char *)gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( RT_ID, gen_lexer_next_token(&lexer) );
+  EXPECT( ',', gen_lexer_next_token(&lexer) );
+  EXPECT( RT_RETURN, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "Current_Timestamp", (const char *)gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( RT_WHILE, gen_lexer_next_token(&lexer) );
+  EXPECT( RT_ID, gen_lexer_next_token(&lexer) );
+  EXPECT( ';', gen_lexer_next_token(&lexer) );
+  EXPECT( RT_ID, gen_lexer_next_token(&lexer) );
+  EXPECT( RT_ID, gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+  gen_lexer_tables_free(&tab);
+
+  /* c_dialect leaves it off */
+  EXPECT( 0, gen_lexer_compile(&tab, &c_dialect) );
+  mb.data = (const unsigned char *)"IF if";
+  mb.len = 5;
+  mb.pos = 0;
+  gen_lexer_initialize_with(&lexer, &tab, &mb);
+  EXPECT( RT_ID, gen_lexer_next_token(&lexer) );
+  EXPECT( RT_IF, gen_lexer_next_token(&lexer) );
+  gen_lexer_tables_free(&tab);
+}
+
+void run_tests_runtime(void)
+{
+  (void)gen_lexer_token_col;
+  (void)gen_lexer_token_off;
+  (void)gen_lexer_token_record;
+
+  RUNTEST( runtime_c_dialect );
+  RUNTEST( runtime_sh_dialect );
+  RUNTEST( runtime_shared_tables );
+  RUNTEST( runtime_no_keywords );
+  RUNTEST( runtime_json_escapes );
+  RUNTEST( runtime_keywords_nocase );
+}
@@ -0,0 +1,145 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+#define GENLEX_CONFIG_MEMORY 1
+
+#define GENLEX_STRING_MAX 64
+
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS "()[]{}=;,:"
+
+#define GENLEX_ID_TOKEN      1024
+#define GENLEX_STRING_TOKEN  1025
+#define GENLEX_INT_TOKEN     1026
+#define GENLEX_COMMENT_TOKEN 1027
+
+#define GENLEX_KEYWORDS {}
+
+#define GENLEX_COMMENT_PAIRS GENLEX_C99_COMMENTS
+
+#include "glex.h"
+
+#define MEMBUF(s) { (const unsigned char *)(s), sizeof(s)-1, 0 }
+
+/* Skips the first '{' group of text both ways and checks that the two
+ * lexers agree on the close and on every token after it
+ */
+static void check_skip(const char *text)
+{
+  struct gen_lexer_membuf mb1 = { (const unsigned char *)text, strlen(text), 0 };
+  struct gen_lexer_membuf mb2 = mb1;
+  struct gen_lexer l1, l2;
+  int depth, tok;
+
+  gen_lexer_initialize(&l1, &mb1);
+  gen_lexer_initialize(&l2, &mb2);
+
+  while ((tok = gen_lexer_next_token(&l1)) != '{') {
+    EXPECT( 1, tok > 0 );
+    EXPECT( tok, gen_lexer_next_token(&l2) );
+  }
+  EXPECT( '{', gen_lexer_next_token(&l2) );
+
+  EXPECT( '}', gen_lexer_skip_group(&l1, '{', '}') );
+  for (depth = 1; depth > 0; ) {
+    tok = gen_lexer_next_token(&l2);
+    EXPECT( 1, tok > 0 );
+    if (tok == '{') { depth++; }
+    if (tok == '}') { depth--; }
+  }
+
+  do {
+    EXPECT( gen_lexer_token_off(&l2), gen_lexer_token_off(&l1) );
+    EXPECT( gen_lexer_token_line(&l2), gen_lexer_token_line(&l1) );
+    EXPECT( gen_lexer_token_col(&l2), gen_lexer_token_col(&l1) );
+    tok = gen_lexer_next_token(&l2);
+    EXPECT( tok, gen_lexer_next_token(&l1) );
+  } while (tok > 0);
+}
+
+DEFTEST( skip_group_matches_tokens )
+{
+  static const char *const texts[] = {
+    "{}",
+    "x = {} y",
+    "a = { b = { c = 1 }, d = [ { } ] } e;",
+    "{ s = \"}{\" } t",
+    "{ s = \"a \\\" } \\\\\" ; } t",
+    "{ c = '}'; d = '\\\"'; } t",
+    "{ /* } */ x // }\n  y } z",
+    "{\n  a = {\n    b\n  }\n}\n  after = 1;",
+    "k: {\n\t\"v\": [1, 2, {\"w\": \"{\"}]\n}, next: 3",
+  };
+  size_t i;
+
+  for (i = 0; i < sizeof texts / sizeof texts[0]; i++) {
+    check_skip(texts[i]);
+  }
+}
+
+DEFTEST( skip_group_other_brackets )
+{
+  struct gen_lexer_membuf mb = MEMBUF( "f(a, (b), \")\") ; g[1][2]" );
+  struct gen_lexer lexer;
+  size_t len;
+
+  gen_lexer_initialize(&lexer, &mb);
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( '(', gen_lexer_next_token(&lexer) );
+
+  /* brackets of the other kind are ignored */
+  EXPECT( ')', gen_lexer_skip_group(&lexer, '(', ')') );
+  EXPECT( 13, gen_lexer_token_off(&lexer) );
+  EXPECT_STR( "", gen_lexer_token_string(&lexer, &len) );
+  EXPECT( 0, len );
+
+  EXPECT( ';', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( '[', gen_lexer_next_token(&lexer) );
+  EXPECT( ']', gen_lexer_skip_group(&lexer, '[', ']') );
+  EXPECT( '[', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 2, gen_lexer_token_int_value(&lexer) );
+}
+
+DEFTEST( skip_group_errors )
+{
+  struct gen_lexer_membuf mb1 = MEMBUF( "{ a { b }" );
+  struct gen_lexer_membuf mb2 = MEMBUF( "{ \"a\n\" }" );
+  struct gen_lexer_membuf mb3 = MEMBUF( "{ \"\\q\" }" );
+  struct gen_lexer_membuf mb4 = MEMBUF( "{ /* } " );
+  struct gen_lexer_membuf mb5 = MEMBUF( "{ 'ab' }" );
+  struct gen_lexer lexer;
+
+  gen_lexer_initialize(&lexer, &mb1);
+  EXPECT( '{', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ERR_UNEXPECTED_EOF, gen_lexer_skip_group(&lexer, '{', '}') );
+
+  gen_lexer_initialize(&lexer, &mb2);
+  EXPECT( '{', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ERR_UNEXPECTED_EOL, gen_lexer_skip_group(&lexer, '{', '}') );
+
+  gen_lexer_initialize(&lexer, &mb3);
+  EXPECT( '{', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ERR_UNRECOGNIZED_ESCAPE, gen_lexer_skip_group(&lexer, '{', '}') );
+
+  gen_lexer_initialize(&lexer, &mb4);
+  EXPECT( '{', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ERR_UNEXPECTED_EOF, gen_lexer_skip_group(&lexer, '{', '}') );
+
+  gen_lexer_initialize(&lexer, &mb5);
+  EXPECT( '{', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ERR_INVALID_CHAR, gen_lexer_skip_group(&lexer, '{', '}') );
+}
+
+void run_tests_skip(void)
+{
+  RUNTEST( skip_group_matches_tokens );
+  RUNTEST( skip_group_other_brackets );
+  RUNTEST( skip_group_errors );
+}
@@ -0,0 +1,138 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+#define GENLEX_CONFIG_MEMORY 1
+#define GENLEX_CONFIG_FLOATS 1
+#define GENLEX_CONFIG_STATS  1
+
+#define GENLEX_STRING_MAX 64
+
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS "()=;"
+
+#define GENLEX_ID_TOKEN      1024
+#define GENLEX_STRING_TOKEN  1025
+#define GENLEX_INT_TOKEN     1026
+#define GENLEX_FLOAT_TOKEN   1027
+#define GENLEX_COMMENT_TOKEN 1028
+
+#define KW_IF    1030
+#define KW_WHILE 1031
+
+#define LIT_EQ 512
+
+#define GENLEX_LITERAL_PAIRS { \
+  { "==", LIT_EQ },            \
+}
+
+#define GENLEX_KEYWORDS { \
+  { "if"   , KW_IF    }, \
+  { "while", KW_WHILE }, \
+}
+
+#define GENLEX_COMMENT_PAIRS GENLEX_C99_COMMENTS
+
+#include "glex.h"
+
+#define MEMBUF(s) { (const unsigned char *)(s), sizeof(s)-1, 0 }
+
+DEFTEST( stats_by_kind )
+{
+  static const char text[] = "if (x1 == 2.5) /* c */ s = \"ab\"; // t\n@";
+  struct gen_lexer_membuf mb = MEMBUF( text );
+  struct gen_lexer lexer;
+  const struct gen_lexer_stats *st;
+
+  gen_lexer_initialize(&lexer, &mb);
+  st = gen_lexer_stats(&lexer);
+  EXPECT( 0, st->tokens[GENLEX_STAT_LITERAL] );
+  EXPECT( 0, st->getc_calls );
+
+  EXPECT( KW_IF, gen_lexer_next_token(&lexer) );
+  EXPECT( '(', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( LIT_EQ, gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_FLOAT_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( ')', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_COMMENT_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( '=', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_STRING_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( ';', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_COMMENT_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ERR_INVALID_CHAR, gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+
+  EXPECT( 4, st->tokens[GENLEX_STAT_LITERAL] );
+  EXPECT( 1, st->tokens[GENLEX_STAT_PAIR] );
+  EXPECT( 1, st->tokens[GENLEX_STAT_KEYWORD] );
+  EXPECT( 2, st->tokens[GENLEX_STAT_ID] );
+  EXPECT( 1, st->tokens[GENLEX_STAT_STRING] );
+  EXPECT( 0, st->tokens[GENLEX_STAT_INT] );
+  EXPECT( 1, st->tokens[GENLEX_STAT_FLOAT] );
+  EXPECT( 2, st->tokens[GENLEX_STAT_COMMENT] );
+  EXPECT( 1, st->tokens[GENLEX_STAT_ERROR] );
+  EXPECT( 1, st->errors[-GENLEX_ERR_INVALID_CHAR] );
+
+  EXPECT( 8, st->ws_bytes );
+  EXPECT( 12, st->comment_bytes );
+  EXPECT( 0, st->comments_skipped );
+  EXPECT( 4, st->string_bytes );
+  EXPECT( 5, st->symbol_bytes );
+  EXPECT( 3, st->number_bytes );
+
+  /* every byte is read at least once, and every look ahead is put back */
+  EXPECT( 1, st->getc_calls >= sizeof text - 1 );
+  EXPECT( 1, st->ungetc_calls > 0 );
+  EXPECT( 1, st->getc_calls - st->ungetc_calls >= sizeof text - 1 );
+
+  /* "if" matches the first keyword, x1 and s are compared against both */
+  EXPECT( 3, st->keyword_lookups );
+  EXPECT( 5, st->keyword_compares );
+  EXPECT( 3, st->buf_high_water );
+}
+
+DEFTEST( stats_high_water_and_reinitialize )
+{
+  struct gen_lexer_membuf mb = MEMBUF( "a_much_longer_identifier \"a string\" 123456\n" );
+  struct gen_lexer lexer;
+  const struct gen_lexer_stats *st;
+
+  gen_lexer_initialize(&lexer, &mb);
+  st = gen_lexer_stats(&lexer);
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 24, st->buf_high_water );
+  EXPECT( GENLEX_STRING_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+
+  EXPECT( 24, st->buf_high_water );
+  EXPECT( 3, st->ws_bytes );
+  EXPECT( 6, st->number_bytes );
+  EXPECT( 1, st->tokens[GENLEX_STAT_INT] );
+
+  /* the counters start over with the lexer */
+  mb.pos = 0;
+  gen_lexer_initialize(&lexer, &mb);
+  EXPECT( 0, st->buf_high_water );
+  EXPECT( 0, st->tokens[GENLEX_STAT_ID] );
+  EXPECT( 0, st->ws_bytes );
+}
+
+void run_tests_stats(void)
+{
+  (void)gen_lexer_token_string;
+  (void)gen_lexer_token_line;
+  (void)gen_lexer_token_col;
+  (void)gen_lexer_token_off;
+  (void)gen_lexer_token_int_value;
+  (void)gen_lexer_token_float_value;
+
+  RUNTEST( stats_by_kind );
+  RUNTEST( stats_high_water_and_reinitialize );
+}
@@ -0,0 +1,235 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+#define GENLEX_CONFIG_STREAM 1
+
+#define GENLEX_STRING_MAX 64
+
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS "()=;+-*/"
+
+#define GENLEX_ID_TOKEN     1024
+#define GENLEX_STRING_TOKEN 1025
+#define GENLEX_INT_TOKEN    1026
+
+#define KW_IF    1027
+#define KW_WHILE 1028
+
+#define GENLEX_KEYWORDS { \
+  { "if"   , KW_IF    }, \
+  { "while", KW_WHILE }, \
+}
+
+#include "glex.h"
+
+/* Read callback that hands out at most three bytes at a time */
+struct stream_src {
+  const char *s;
+  size_t len;
+  size_t pos;
+};
+
+static size_t stream_src_read(void *arg, unsigned char *dst, size_t n)
+{
+  struct stream_src *src = arg;
+  if (n > 3) { n = 3; }
+  if (n > src->len - src->pos) { n = src->len - src->pos; }
+  memcpy(dst, src->s + src->pos, n);
+  src->pos += n;
+  return n;
+}
+
+DEFTEST( stream_lexes_across_refills )
+{
+  static const char text[] = " 32 + 15 - 5 * (3 + 2);\nfoo(9);\nx = \"bar\";\n";
+  struct stream_src src = { text, sizeof text - 1, 0 };
+  struct gen_lexer_stream st;
+  struct gen_lexer lexer;
+
+  EXPECT( 1, gen_lexer_stream_init(&st, stream_src_read, &src, 4) );
+  gen_lexer_initialize(&lexer, &st);
+
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 32, gen_lexer_token_int_value(&lexer) );
+  EXPECT( '+', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 15, gen_lexer_token_int_value(&lexer) );
+  EXPECT( '-', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( '*', gen_lexer_next_token(&lexer) );
+  EXPECT( '(', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( '+', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( ')', gen_lexer_next_token(&lexer) );
+  EXPECT( ';', gen_lexer_next_token(&lexer) );
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "foo", gen_lexer_token_string(&lexer,NULL) );
+  EXPECT( 1, gen_lexer_token_line(&lexer) );
+  EXPECT( '(', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( ')', gen_lexer_next_token(&lexer) );
+  EXPECT( ';', gen_lexer_next_token(&lexer) );
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( '=', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_STRING_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "bar", gen_lexer_token_string(&lexer,NULL) );
+  EXPECT( ';', gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+
+  /* nothing was marked, so the buffer never had to grow */
+  EXPECT( 4, (int)st.cap );
+
+  gen_lexer_stream_free(&st);
+}
+
+DEFTEST( stream_mark_pins_window )
+{
+  static const char text[] = "if (a) foo = 1; else_thing = \"some string\"; bar(2);";
+  struct stream_src src = { text, sizeof text - 1, 0 };
+  struct gen_lexer_stream st;
+  struct gen_lexer lexer;
+  struct gen_lexer_mark mark;
+  int pass;
+
+  EXPECT( 1, gen_lexer_stream_init(&st, stream_src_read, &src, 4) );
+  gen_lexer_initialize(&lexer, &st);
+
+  EXPECT( KW_IF, gen_lexer_next_token(&lexer) );
+  EXPECT( '(', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( ')', gen_lexer_next_token(&lexer) );
+
+  EXPECT( 0, gen_lexer_mark(&lexer, &mark) );
+
+  /* scan far past the mark twice: the window must hold on to it */
+  for (pass=0; pass < 2; pass++) {
+    EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+    EXPECT_STR( "foo", gen_lexer_token_string(&lexer,NULL) );
+    EXPECT( 7, gen_lexer_token_off(&lexer) );
+    EXPECT( '=', gen_lexer_next_token(&lexer) );
+    EXPECT( GENLEX_INT_TOKEN, gen_lexer_next_token(&lexer) );
+    EXPECT( ';', gen_lexer_next_token(&lexer) );
+    EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+    EXPECT_STR( "else_thing", gen_lexer_token_string(&lexer,NULL) );
+    EXPECT( '=', gen_lexer_next_token(&lexer) );
+    EXPECT( GENLEX_STRING_TOKEN, gen_lexer_next_token(&lexer) );
+    EXPECT_STR( "some string", gen_lexer_token_string(&lexer,NULL) );
+
+    EXPECT( 0, gen_lexer_reset_to(&lexer, &mark) );
+  }
+
+  gen_lexer_release_mark(&lexer, &mark);
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "foo", gen_lexer_token_string(&lexer,NULL) );
+  EXPECT( '=', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( ';', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( '=', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_STRING_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( ';', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "bar", gen_lexer_token_string(&lexer,NULL) );
+
+  /* once released, the old position is gone */
+  EXPECT( GENLEX_ERR_INVALID_STATE, gen_lexer_reset_to(&lexer, &mark) );
+
+  gen_lexer_stream_free(&st);
+}
+
+/* Releasing the oldest of two marks lets the window move up to the other */
+DEFTEST( stream_release_oldest_mark )
+{
+  static const char text[] = "if (a) foo = 1; else_thing = \"some string\"; bar(2);";
+  struct stream_src src = { text, sizeof text - 1, 0 };
+  struct gen_lexer_stream st;
+  struct gen_lexer lexer;
+  struct gen_lexer_mark m1, m2;
+
+  EXPECT( 1, gen_lexer_stream_init(&st, stream_src_read, &src, 4) );
+  gen_lexer_initialize(&lexer, &st);
+
+  EXPECT( KW_IF, gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_mark(&lexer, &m1) );
+  EXPECT( '(', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( ')', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_mark(&lexer, &m2) );
+
+  gen_lexer_release_mark(&lexer, &m1);
+  EXPECT( '=', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( ';', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( '=', gen_lexer_next_token(&lexer) );
+
+  /* the window starts at or before m2, but past m1 */
+  EXPECT( 1, st.start > m1.off );
+  EXPECT( 1, st.start <= m2.off );
+  EXPECT( GENLEX_ERR_INVALID_STATE, gen_lexer_reset_to(&lexer, &m1) );
+  EXPECT( 0, gen_lexer_reset_to(&lexer, &m2) );
+  EXPECT( '=', gen_lexer_next_token(&lexer) );
+  EXPECT( 11, gen_lexer_token_off(&lexer) );
+  gen_lexer_release_mark(&lexer, &m2);
+
+  gen_lexer_stream_free(&st);
+}
+
+/* A parser that always holds a mark, moving it forward, keeps a
+ * bounded window
+ */
+DEFTEST( stream_rolling_mark )
+{
+  static char text[4096];
+  struct stream_src src;
+  struct gen_lexer_stream st;
+  struct gen_lexer lexer;
+  struct gen_lexer_mark old, cur;
+  size_t n = 0;
+  int ntoks = 0;
+
+  while (n + 8 < sizeof text) {
+    memcpy(text + n, "x = 12; ", 8);
+    n += 8;
+  }
+  src.s = text;
+  src.len = n;
+  src.pos = 0;
+
+  EXPECT( 1, gen_lexer_stream_init(&st, stream_src_read, &src, 16) );
+  gen_lexer_initialize(&lexer, &st);
+  EXPECT( 0, gen_lexer_mark(&lexer, &old) );
+
+  while (gen_lexer_next_token(&lexer) > 0) {
+    ntoks++;
+    EXPECT( 0, gen_lexer_mark(&lexer, &cur) );
+    gen_lexer_release_mark(&lexer, &old);
+    old = cur;
+  }
+  gen_lexer_release_mark(&lexer, &old);
+
+  EXPECT( 4 * (int)(n / 8), ntoks );
+  EXPECT( 1, st.cap <= 32 );
+  EXPECT( 0, (int)st.npins );
+
+  gen_lexer_stream_free(&st);
+}
+
+void run_tests_stream(void)
+{
+  (void)gen_lexer_token_col;
+
+  RUNTEST( stream_lexes_across_refills );
+  RUNTEST( stream_mark_pins_window );
+  RUNTEST( stream_release_oldest_mark );
+  RUNTEST( stream_rolling_mark );
+}
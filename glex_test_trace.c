@@ -0,0 +1,211 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+/* Every reading of the clock advances it by 4 cycles, so a token takes
+ * 4 cycles unless another thread reads the clock in between
+ */
+static unsigned long long test_clock;
+#define GENLEX_TRACE_CYCLES() (__atomic_add_fetch(&test_clock, 4, __ATOMIC_RELAXED))
+
+#define GENLEX_CONFIG_MEMORY 1
+#define GENLEX_CONFIG_TRACE  1
+#define GENLEX_TRACE_RING    8
+
+#define GENLEX_STRING_MAX 64
+
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS "()=;"
+
+#define GENLEX_ID_TOKEN     1024
+#define GENLEX_STRING_TOKEN 1025
+#define GENLEX_INT_TOKEN    1026
+
+#define KW_IF 1027
+
+#define GENLEX_KEYWORDS { \
+  { "if", KW_IF },       \
+}
+
+#include "glex.h"
+
+#define MEMBUF(s) { (const unsigned char *)(s), sizeof(s)-1, 0 }
+
+static struct gen_lexer_trace trace;
+
+DEFTEST( trace_histogram_and_events )
+{
+  struct gen_lexer_membuf mb = MEMBUF( "if (x = \"abc\") 12;" );
+  struct gen_lexer lexer;
+  struct gen_lexer_trace_event ev[16];
+
+  gen_lexer_trace_init(&trace);
+  gen_lexer_initialize(&lexer, &mb);
+
+  /* not attached: nothing is recorded */
+  EXPECT( KW_IF, gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_trace_events(&trace, ev, 16) );
+
+  gen_lexer_trace_attach(&lexer, &trace);
+  EXPECT( '(', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( '=', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_STRING_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( ')', gen_lexer_next_token(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( ';', gen_lexer_next_token(&lexer) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+
+  /* 4 cycles is bucket 3 */
+  EXPECT( 4, trace.hist[GENLEX_STAT_LITERAL][3] );
+  EXPECT( 16, trace.cycles[GENLEX_STAT_LITERAL][3] );
+  EXPECT( 1, trace.hist[GENLEX_STAT_ID][3] );
+  EXPECT( 1, trace.hist[GENLEX_STAT_STRING][3] );
+  EXPECT( 1, trace.hist[GENLEX_STAT_INT][3] );
+  EXPECT( 0, trace.hist[GENLEX_STAT_KEYWORD][3] );
+
+  /* newest first, end of input isn't an event */
+  EXPECT( 7, gen_lexer_trace_events(&trace, ev, 16) );
+  EXPECT( ';', ev[0].tok );
+  EXPECT( 17, ev[0].off );
+  EXPECT( 1, ev[0].len );
+  EXPECT( GENLEX_STRING_TOKEN, ev[3].tok );
+  EXPECT( GENLEX_STAT_STRING, ev[3].kind );
+  EXPECT( 8, ev[3].off );
+  EXPECT( 5, ev[3].len );
+  EXPECT( 4, ev[3].cycles );
+  EXPECT( '(', ev[6].tok );
+
+  EXPECT( 2, gen_lexer_trace_events(&trace, ev, 2) );
+  EXPECT( GENLEX_INT_TOKEN, ev[1].tok );
+}
+
+DEFTEST( trace_ring_keeps_newest )
+{
+  struct gen_lexer_membuf mb = MEMBUF( "a b c d e f g h i j k" );
+  struct gen_lexer lexer;
+  struct gen_lexer_trace_event ev[16];
+
+  gen_lexer_trace_init(&trace);
+  gen_lexer_initialize(&lexer, &mb);
+  gen_lexer_trace_attach(&lexer, &trace);
+
+  while (gen_lexer_next_token(&lexer) > 0) { }
+
+  EXPECT( 11, trace.hist[GENLEX_STAT_ID][3] );
+  EXPECT( GENLEX_TRACE_RING, gen_lexer_trace_events(&trace, ev, 16) );
+  EXPECT( 20, ev[0].off );
+  EXPECT( 6, ev[GENLEX_TRACE_RING-1].off );
+}
+
+DEFTEST( trace_folded_dump )
+{
+  struct gen_lexer_membuf mb = MEMBUF( "x = 1;" );
+  struct gen_lexer lexer;
+  char line[128];
+  FILE *f;
+
+  gen_lexer_trace_init(&trace);
+  gen_lexer_initialize(&lexer, &mb);
+  gen_lexer_trace_attach(&lexer, &trace);
+  while (gen_lexer_next_token(&lexer) > 0) { }
+
+  /* a slow string lands in its own frame */
+  trace.hist[GENLEX_STAT_STRING][13]++;
+  trace.cycles[GENLEX_STAT_STRING][13] += 5000;
+
+  f = tmpfile();
+  EXPECT( 1, f != NULL );
+  if (f == NULL) { return; }
+
+  EXPECT( 0, gen_lexer_trace_dump(&trace, f) );
+  rewind(f);
+
+  EXPECT( 1, fgets(line, sizeof line, f) != NULL );
+  EXPECT_STR( "gen_lexer_next_token;literal;4-7 8\n", line );
+  EXPECT( 1, fgets(line, sizeof line, f) != NULL );
+  EXPECT_STR( "gen_lexer_next_token;id;4-7 4\n", line );
+  EXPECT( 1, fgets(line, sizeof line, f) != NULL );
+  EXPECT_STR( "gen_lexer_next_token;string;4096-8191 5000\n", line );
+  EXPECT( 1, fgets(line, sizeof line, f) != NULL );
+  EXPECT_STR( "gen_lexer_next_token;int;4-7 4\n", line );
+  EXPECT( 1, fgets(line, sizeof line, f) == NULL );
+
+  fclose(f);
+}
+
+#define TRACE_THREADS 4
+#define TRACE_ROUNDS  200
+
+static void *trace_worker(void *arg)
+{
+  static const char text[] = "if (a = b) c;";
+  int r;
+
+  (void)arg;
+  for (r = 0; r < TRACE_ROUNDS; r++) {
+    struct gen_lexer_membuf mb = MEMBUF( text );
+    struct gen_lexer lexer;
+
+    gen_lexer_initialize(&lexer, &mb);
+    gen_lexer_trace_attach(&lexer, &trace);
+    while (gen_lexer_next_token(&lexer) > 0) { }
+  }
+
+  return NULL;
+}
+
+DEFTEST( trace_shared_between_threads )
+{
+  pthread_t tids[TRACE_THREADS];
+  struct gen_lexer_trace_event ev[GENLEX_TRACE_RING];
+  unsigned long long n;
+  size_t i, nev;
+  int t, b;
+
+  gen_lexer_trace_init(&trace);
+  for (t = 0; t < TRACE_THREADS; t++) {
+    pthread_create(&tids[t], NULL, trace_worker, NULL);
+  }
+
+  /* read while the workers write: every event returned is whole */
+  for (t = 0; t < 100; t++) {
+    nev = gen_lexer_trace_events(&trace, ev, GENLEX_TRACE_RING);
+    for (i = 0; i < nev; i++) {
+      int ok = (ev[i].kind == GENLEX_STAT_ID) ? (ev[i].tok == GENLEX_ID_TOKEN) :
+               (ev[i].kind == GENLEX_STAT_KEYWORD) ? (ev[i].tok == KW_IF) && (ev[i].len == 2) :
+               (ev[i].kind == GENLEX_STAT_LITERAL) && (ev[i].len == 1);
+      EXPECT( 1, ok );
+      if (!ok) { break; }
+    }
+  }
+
+  for (t = 0; t < TRACE_THREADS; t++) {
+    pthread_join(tids[t], NULL);
+  }
+
+  for (n = 0, b = 0; b < GENLEX_TRACE_BUCKETS; b++) {
+    n += trace.hist[GENLEX_STAT_ID][b];
+  }
+  EXPECT( 3 * TRACE_THREADS * TRACE_ROUNDS, n );
+  EXPECT( 8 * TRACE_THREADS * TRACE_ROUNDS, trace.head );
+}
+
+void run_tests_trace(void)
+{
+  (void)gen_lexer_token_string;
+  (void)gen_lexer_token_line;
+  (void)gen_lexer_token_col;
+  (void)gen_lexer_token_off;
+  (void)gen_lexer_token_int_value;
+
+  RUNTEST( trace_histogram_and_events );
+  RUNTEST( trace_ring_keeps_newest );
+  RUNTEST( trace_folded_dump );
+  RUNTEST( trace_shared_between_threads );
+}
@@ -0,0 +1,185 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#undef GLEX_TEST_BYTESTREAM
+#include "glex_tests.h"
+
+#define GENLEX_CONFIG_MEMORY 1
+#define GENLEX_CONFIG_UTF8   1
+
+#define GENLEX_STRING_MAX 64
+
+#define GENLEX_IS_SYMBOL(ch,pos)  (isalpha(ch) || ((ch) == '_') || (((pos)>0) && isnumber(ch)))
+#define GENLEX_LITERALS "()=;,"
+
+#define GENLEX_ID_TOKEN     1024
+#define GENLEX_STRING_TOKEN 1025
+#define GENLEX_INT_TOKEN    1026
+
+#define KW_FUER  1027
+#define KW_IF    1028
+
+#define GENLEX_KEYWORDS { \
+  { "für", KW_FUER },     \
+  { "if" , KW_IF   },     \
+}
+
+#include "glex.h"
+#include "glex_index.h"
+
+#define MEMBUF(s) { (const unsigned char *)(s), sizeof(s)-1, 0 }
+
+DEFTEST( utf8_identifiers )
+{
+  struct gen_lexer_membuf mb = MEMBUF( "größe = 1;\n  変数 = naïve_π2, für if \"né\"" );
+  struct gen_lexer lexer;
+  size_t len;
+
+  gen_lexer_initialize(&lexer, &mb);
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "größe", gen_lexer_token_string(&lexer, &len) );
+  EXPECT( 7, len );
+
+  /* offsets and columns count bytes */
+  EXPECT( '=', gen_lexer_next_token(&lexer) );
+  EXPECT( 8, gen_lexer_token_off(&lexer) );
+  EXPECT( 8, gen_lexer_token_col(&lexer) );
+  EXPECT( GENLEX_INT_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT( 1, gen_lexer_token_int_value(&lexer) );
+  EXPECT( ';', gen_lexer_next_token(&lexer) );
+
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "変数", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( 1, gen_lexer_token_line(&lexer) );
+  EXPECT( 2, gen_lexer_token_col(&lexer) );
+  EXPECT( '=', gen_lexer_next_token(&lexer) );
+  EXPECT( 9, gen_lexer_token_col(&lexer) );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "naïve_π2", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( ',', gen_lexer_next_token(&lexer) );
+
+  EXPECT( KW_FUER, gen_lexer_next_token(&lexer) );
+  EXPECT( KW_IF, gen_lexer_next_token(&lexer) );
+
+  /* strings take any bytes, as before */
+  EXPECT( GENLEX_STRING_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "né", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( 0, gen_lexer_next_token(&lexer) );
+}
+
+DEFTEST( utf8_start_and_continue )
+{
+  /* U+0301 (combining acute) and U+0663 (Arabic-Indic three) can only
+   * continue a symbol; U+20AC (euro sign) is in neither set
+   */
+  struct gen_lexer_membuf mb1 = MEMBUF( "e\xcc\x81 x\xd9\xa3 \xd9\xa3" );
+  struct gen_lexer_membuf mb2 = MEMBUF( "\xcc\x81x" );
+  struct gen_lexer_membuf mb3 = MEMBUF( "a\xe2\x82\xac" );
+  struct gen_lexer_membuf mb4 = MEMBUF( "12é" );
+  struct gen_lexer lexer;
+  size_t len;
+
+  gen_lexer_initialize(&lexer, &mb1);
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  gen_lexer_token_string(&lexer, &len);
+  EXPECT( 3, len );
+  EXPECT( GENLEX_ID_TOKEN, gen_lexer_next_token(&lexer) );
+  EXPECT_STR( "x\xd9\xa3", gen_lexer_token_string(&lexer, NULL) );
+  EXPECT( GENLEX_ERR_INVALID_CHAR, gen_lexer_next_token(&lexer) );
+
+  gen_lexer_initialize(&lexer, &mb2);
+  EXPECT( GENLEX_ERR_INVALID_CHAR, gen_lexer_next_token(&lexer) );
+
+  gen_lexer_initialize(&lexer, &mb3);
+  EXPECT( GENLEX_ERR_INVALID_CHAR, gen_lexer_next_token(&lexer) );
+
+  gen_lexer_initialize(&lexer, &mb4);
+  EXPECT( GENLEX_ERR_INVALID_CHAR, gen_lexer_next_token(&lexer) );
+}
+
+DEFTEST( utf8_malformed )
+{
+  static const char *const bad[] = {
+    "\x80",              /* continuation byte */
+    "\xc0\xaf",          /* overlong '/' */
+    "\xe0\x80\xaf",      /* overlong '/' */
+    "\xf0\x80\x80\xaf",  /* overlong '/' */
+    "\xed\xa0\x80",      /* surrogate */
+    "\xf4\x90\x80\x80",  /* past U+10FFFF */
+    "\xf8\x88\x80\x80",  /* no such lead byte */
+    "ab\xe2\x82",        /* cut short by the end */
+  };
+  struct gen_lexer_membuf mb = MEMBUF( "x\xc3(" );
+  struct gen_lexer lexer;
+  size_t i;
+
+  for (i = 0; i < sizeof bad / sizeof bad[0]; i++) {
+    struct gen_lexer_membuf mbi = { (const unsigned char *)bad[i], strlen(bad[i]), 0 };
+    gen_lexer_initialize(&lexer, &mbi);
+    EXPECT( GENLEX_ERR_INVALID_UTF8, gen_lexer_next_token(&lexer) );
+  }
+
+  /* the byte that cut the sequence short is the next token */
+  gen_lexer_initialize(&lexer, &mb);
+  EXPECT( GENLEX_ERR_INVALID_UTF8, gen_lexer_next_token(&lexer) );
+  EXPECT( '(', gen_lexer_next_token(&lexer) );
+  EXPECT( 2, gen_lexer_token_off(&lexer) );
+}
+
+DEFTEST( utf8_tables )
+{
+  EXPECT( GENLEX_XID_START | GENLEX_XID_CONTINUE, genlex_xid('A') );
+  EXPECT( GENLEX_XID_CONTINUE, genlex_xid('_') );
+  EXPECT( GENLEX_XID_CONTINUE, genlex_xid('7') );
+  EXPECT( 0, genlex_xid(' ') );
+  EXPECT( GENLEX_XID_START | GENLEX_XID_CONTINUE, genlex_xid(0xe9) );     /* é */
+  EXPECT( GENLEX_XID_CONTINUE, genlex_xid(0x301) );
+  EXPECT( 0, genlex_xid(0x20ac) );
+  EXPECT( GENLEX_XID_START | GENLEX_XID_CONTINUE, genlex_xid(0x4e00) );   /* 一 */
+  EXPECT( GENLEX_XID_START | GENLEX_XID_CONTINUE, genlex_xid(0x1d400) );  /* bold A */
+  EXPECT( 0, genlex_xid(0x1f600) );                                       /* emoji */
+  EXPECT( GENLEX_XID_CONTINUE, genlex_xid(0xe0100) );                     /* VS17 */
+  EXPECT( 0, genlex_xid(0x10ffff) );
+}
+
+DEFTEST( utf8_index_matches_serial )
+{
+  static const char text[] =
+    "größe = 1; x\xd9\xa3 = \"né\";\n変数 = naïve_π2, abc€ für (q\xc3";
+  struct gen_lexer_membuf mb = MEMBUF( text );
+  struct gen_lexer_tokens indexed = { NULL, 0, 0 };
+  struct gen_lexer_index idx;
+  struct gen_lexer_token rec;
+  struct gen_lexer lexer;
+  size_t i;
+  int tok;
+
+  gen_lexer_index_init(&idx);
+  EXPECT( 0, gen_lexer_index_build(&idx, (const unsigned char *)text, sizeof text - 1) );
+  EXPECT( 0, gen_lexer_index_lex(&idx, &indexed) );
+
+  gen_lexer_initialize(&lexer, &mb);
+  for (i = 0; (tok = gen_lexer_next_token(&lexer)) != 0; i++) {
+    gen_lexer_token_record(&lexer, tok, &rec);
+    EXPECT( 1, i < indexed.len );
+    EXPECT( rec.tok, indexed.toks[i].tok );
+    EXPECT( rec.off, indexed.toks[i].off );
+    EXPECT( rec.end, indexed.toks[i].end );
+    EXPECT( rec.col, indexed.toks[i].col );
+  }
+  EXPECT( i, indexed.len );
+
+  gen_lexer_tokens_free(&indexed);
+  gen_lexer_index_free(&idx);
+}
+
+void run_tests_utf8(void)
+{
+  RUNTEST( utf8_identifiers );
+  RUNTEST( utf8_start_and_continue );
+  RUNTEST( utf8_malformed );
+  RUNTEST( utf8_tables );
+  RUNTEST( utf8_index_matches_serial );
+}
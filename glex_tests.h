@@ -27,9 +27,17 @@ static int bytestream_ungetc(int c, struct bytestream *ctx)
 }
 #endif /* GLEX_TEST_BYTESTREAM */
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 extern int glex_test_failures;
 extern int glex_test_numtests;
 
+#ifdef __cplusplus
+}
+#endif
+
 #define EXPECT( val, expr ) do { \
   int expt_val = (val); int expt_act = (expr); \
   if (expt_val != expt_act) { \
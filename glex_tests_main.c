@@ -10,12 +10,78 @@ int glex_test_numtests = 0;
 extern void run_all_tests_noopts(void);
 extern void run_tests_stdio(void);
 extern void run_tests_numbers(void);
+extern void run_tests_parallel(void);
+extern void run_tests_batch(void);
+extern void run_tests_lookahead(void);
+extern void run_tests_stream(void);
+extern void run_tests_mark(void);
+extern void run_tests_runtime(void);
+extern void run_tests_stats(void);
+extern void run_tests_trace(void);
+extern void run_tests_pool(void);
+extern void run_tests_index(void);
+extern void run_tests_skip(void);
+extern void run_tests_pos64(void);
+extern void run_tests_pos64_stream(void);
+extern void run_all_tests_noopts_dfa(void);
+extern void run_tests_numbers_dfa(void);
+extern void run_all_tests_noopts_kinds(void);
+extern void run_tests_runtime_kinds(void);
+extern void run_tests_cxx(void);
+extern void run_tests_utf8(void);
+extern void run_tests_utf8_kinds(void);
+extern void run_tests_pipeline(void);
+extern void run_tests_escapes(void);
+extern void run_tests_escapes_kinds(void);
+extern void run_tests_packed(void);
+extern void run_tests_nocase(void);
+extern void run_tests_nocase_dfa(void);
+extern void run_tests_convert(void);
+extern void run_tests_run(void);
+extern void run_tests_decimal(void);
+extern void run_tests_modes(void);
+extern void run_tests_modes_stream(void);
+extern void run_tests_blobs(void);
+extern void run_tests_blobs_stream(void);
 
 int main(int argc, const char **argv)
 {
   run_all_tests_noopts();
   run_tests_stdio();
   run_tests_numbers();
+  run_tests_parallel();
+  run_tests_batch();
+  run_tests_lookahead();
+  run_tests_stream();
+  run_tests_mark();
+  run_tests_runtime();
+  run_tests_stats();
+  run_tests_trace();
+  run_tests_pool();
+  run_tests_index();
+  run_tests_skip();
+  run_tests_pos64();
+  run_tests_pos64_stream();
+  run_all_tests_noopts_dfa();
+  run_tests_numbers_dfa();
+  run_all_tests_noopts_kinds();
+  run_tests_runtime_kinds();
+  run_tests_cxx();
+  run_tests_utf8();
+  run_tests_utf8_kinds();
+  run_tests_pipeline();
+  run_tests_escapes();
+  run_tests_escapes_kinds();
+  run_tests_packed();
+  run_tests_nocase();
+  run_tests_nocase_dfa();
+  run_tests_convert();
+  run_tests_run();
+  run_tests_decimal();
+  run_tests_modes();
+  run_tests_modes_stream();
+  run_tests_blobs();
+  run_tests_blobs_stream();
 
   printf("%d tests run... ", glex_test_numtests);
   if (glex_test_failures > 0) {
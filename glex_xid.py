@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""Generates glex_xid.h, the Unicode identifier tables of GENLEX_CONFIG_UTF8.
+
+    python3 glex_xid.py > glex_xid.h
+
+The XID_Start and XID_Continue properties come from the Unicode database
+of the Python that runs this (str.isidentifier() is defined by them), so
+regenerating with a newer Python picks up a newer Unicode version.
+
+Two bits per code point, in two levels: genlex_xid_index maps each block
+of 256 code points to one of the distinct blocks in genlex_xid_blocks,
+which hold the bits of four code points per byte.
+"""
+
+import sys
+import unicodedata
+
+BLOCK = 256
+START, CONTINUE = 1, 2
+
+
+def flags(cp):
+    if 0xd800 <= cp <= 0xdfff:
+        return 0
+    ch = chr(cp)
+    f = 0
+    # '_' is an identifier start for Python, but not XID_Start
+    if ch.isidentifier() and ch != '_':
+        f |= START
+    if ('a' + ch).isidentifier():
+        f |= CONTINUE
+    return f
+
+
+def main():
+    cps = [flags(cp) for cp in range(0x110000)]
+    limit = max(cp for cp in range(0x110000) if cps[cp]) + 1
+    nblocks = (limit + BLOCK - 1) // BLOCK
+
+    blocks, index = {}, []
+    for b in range(nblocks):
+        bits = bytearray(BLOCK // 4)
+        for i in range(BLOCK):
+            cp = b*BLOCK + i
+            if cp < limit:
+                bits[i >> 2] |= cps[cp] << ((i & 3) * 2)
+        index.append(blocks.setdefault(bytes(bits), len(blocks)))
+
+    assert len(blocks) <= 256
+
+    out = sys.stdout
+    out.write("/* Generated by glex_xid.py from Unicode %s: don't edit */\n\n"
+              % unicodedata.unidata_version)
+    out.write("#ifndef GLEX_XID_H\n#define GLEX_XID_H\n\n")
+    out.write("#define GENLEX_XID_UNICODE \"%s\"\n" % unicodedata.unidata_version)
+    out.write("#define GENLEX_XID_LIMIT   0x%x  /* no identifier code points from here */\n\n"
+              % (nblocks * BLOCK))
+
+    out.write("static const unsigned char genlex_xid_index[%d] = {\n" % nblocks)
+    for i in range(0, nblocks, 16):
+        out.write("  " + " ".join("%d," % x for x in index[i:i+16]) + "\n")
+    out.write("};\n\n")
+
+    out.write("static const unsigned char genlex_xid_blocks[%d][%d] = {\n"
+              % (len(blocks), BLOCK // 4))
+    for bits in sorted(blocks, key=blocks.get):
+        out.write("  {\n")
+        for i in range(0, len(bits), 16):
+            out.write("    " + " ".join("0x%02x," % x for x in bits[i:i+16]) + "\n")
+        out.write("  },\n")
+    out.write("};\n\n#endif /* GLEX_XID_H */\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,448 @@
+/* glexgen: compiles a GenLexer configuration into a direct-coded header.
+ *
+ * glex.h normally works from its configuration at run time: keywords
+ * are found by a linear scan with strcmp(), literal pairs and comment
+ * openers by scanning their tables, and literals by memchr().  glexgen
+ * turns the same configuration into code instead:
+ *
+ *   - a 256-entry class table for whitespace, literals, symbol starts
+ *     and the first characters of literal pairs and comment openers,
+ *
+ *   - a keyword matcher that switches on the length of the symbol and
+ *     then on each character, so that a symbol is rejected on its first
+ *     mismatching character and a keyword is found with no string
+ *     compares,
+ *
+ *   - switches for the second character of literal pairs and comment
+ *     openers.
+ *
+ * With GENLEX_KEYWORDS_CASE_INSENSITIVE, keywords are folded to
+ * lowercase first and the matcher takes either case of each letter.
+ *
+ * Strings, characters and numbers are scanned by the same code as
+ * before, so a generated lexer behaves exactly like the macro-configured
+ * one.
+ *
+ * The configuration is a header holding the #defines that would precede
+ * #include "glex.h".  glexgen is built against it:
+ *
+ *   cc -DGLEXGEN_CONFIG='"mylexer_config.h"' -o mylexer_glexgen glexgen.c
+ *   ./mylexer_glexgen mylexer_dfa.h
+ *
+ * (or make glexgen GLEXGEN_CONFIG=mylexer_config.h), and the lexer is
+ * then compiled with
+ *
+ *   #include "mylexer_config.h"
+ *   #define GENLEX_DFA_HEADER "mylexer_dfa.h"
+ *   #include "glex.h"
+ *
+ * The generated header checks that it is used with the configuration it
+ * was generated from.
+ */
+
+#if !defined(GLEXGEN_CONFIG)
+#  error GLEXGEN_CONFIG must name the configuration header
+#endif
+
+#include GLEXGEN_CONFIG
+
+#if defined(GENLEX_DFA_HEADER)
+#  error the configuration must not define GENLEX_DFA_HEADER
+#endif
+
+#if GENLEX_CONFIG_RUNTIME
+#  error glexgen compiles macro configurations, not GENLEX_CONFIG_RUNTIME
+#endif
+
+#include "glex.h"
+
+#define GLEXGEN_MAX_KEYWORDS 4096
+
+#if GENLEX_KEYWORDS_CASE_INSENSITIVE
+#  define GLEXGEN_NOCASE 1
+#else
+#  define GLEXGEN_NOCASE 0
+#endif
+
+struct glexgen_kw {
+  const unsigned char *s;
+  size_t len;
+  int token;
+};
+
+static const char *glexgen_out_name;
+
+static void glexgen_char(FILE *out, int c)
+{
+  if ((c >= 0x20) && (c < 0x7f) && (c != '\'') && (c != '\\')) {
+    fprintf(out, "'%c'", c);
+  } else {
+    fprintf(out, "0x%02x", c);
+  }
+}
+
+/* Emits the case labels that match the keyword character c */
+static void glexgen_case(FILE *out, int c)
+{
+  fprintf(out, "case ");
+  glexgen_char(out, c);
+  fprintf(out, ":");
+#if GENLEX_KEYWORDS_CASE_INSENSITIVE
+  if ((c >= 'a') && (c <= 'z')) {
+    fprintf(out, " case ");
+    glexgen_char(out, c - 0x20);
+    fprintf(out, ":");
+  }
+#endif
+  fprintf(out, "\n");
+}
+
+static void glexgen_indent(FILE *out, int depth)
+{
+  fprintf(out, "%*s", 2*depth, "");
+}
+
+static void glexgen_class_table(FILE *out)
+{
+  unsigned int c, i;
+
+  fprintf(out, "static const unsigned char genlex_dfa_class[256] = {\n");
+  for (c = 0; c < 256; c += 16) {
+    fprintf(out, " ");
+    for (i = c; i < c+16; i++) {
+      unsigned int cls = 0;
+
+      if (GENLEX_IS_WHITESPACE((int)i)) { cls |= GENLEX_CLS_WS; }
+      if (GENLEX_IS_SYMBOL((int)i, 0))  { cls |= GENLEX_CLS_SYM0; }
+      if (GENLEX_IS_SYMBOL((int)i, 1))  { cls |= GENLEX_CLS_SYM; }
+      if ((i != 0) && memchr(gen_lexer_literals, i, sizeof(gen_lexer_literals))) {
+        cls |= GENLEX_CLS_LITERAL;
+      }
+#if defined(GENLEX_LITERAL_PAIRS)
+      {
+        unsigned int k;
+        for (k = 0; k < GENLEX_NUM_LITERAL_PAIRS; k++) {
+          if (gen_lexer_literal_pairs[k].pair[0] == i) { cls |= GENLEX_CLS_PAIR; }
+        }
+      }
+#endif
+#if defined(GENLEX_COMMENT_PAIRS)
+      {
+        unsigned int k;
+        for (k = 0; k < GENLEX_NUM_COMMENT_PAIRS; k++) {
+          if (gen_lexer_comments[k].beg[0] == i) { cls |= GENLEX_CLS_COMMENT; }
+        }
+      }
+#endif
+
+      fprintf(out, " 0x%02x,", cls);
+    }
+    fprintf(out, "\n");
+  }
+  fprintf(out, "};\n\n");
+}
+
+/* Emits a matcher for kw[0..n), which all have the same length and
+ * agree on their first depth characters.
+ */
+static void glexgen_trie(FILE *out, const struct glexgen_kw *kw, size_t n, size_t depth, int ind)
+{
+  size_t i, j;
+
+  if (n == 1) {
+    size_t len = kw[0].len;
+
+    glexgen_indent(out, ind);
+    if (depth == len) {
+      fprintf(out, "return %d;\n", kw[0].token);
+      return;
+    }
+
+    fprintf(out, "if (");
+    for (i = depth; i < len; i++) {
+      /* s[i] | 0x20 is a lowercase letter only for either case of it */
+      int fold = GLEXGEN_NOCASE && (kw[0].s[i] >= 'a') && (kw[0].s[i] <= 'z');
+
+      fprintf(out, "%s(%ss[%u]%s == ", (i > depth) ? " && " : "",
+          fold ? "(" : "", (unsigned int)i, fold ? " | 0x20)" : "");
+      glexgen_char(out, kw[0].s[i]);
+      fprintf(out, ")");
+    }
+    fprintf(out, ") { return %d; }\n", kw[0].token);
+    glexgen_indent(out, ind);
+    fprintf(out, "break;\n");
+    return;
+  }
+
+  glexgen_indent(out, ind);
+  fprintf(out, "switch (s[%u]) {\n", (unsigned int)depth);
+  for (i = 0; i < n; i = j) {
+    for (j = i+1; (j < n) && (kw[j].s[depth] == kw[i].s[depth]); j++) {
+      continue;
+    }
+
+    glexgen_indent(out, ind);
+    glexgen_case(out, kw[i].s[depth]);
+    glexgen_trie(out, kw+i, j-i, depth+1, ind+1);
+  }
+  glexgen_indent(out, ind);
+  fprintf(out, "}\n");
+  glexgen_indent(out, ind);
+  fprintf(out, "break;\n");
+}
+
+static int glexgen_kw_cmp(const void *a, const void *b)
+{
+  const struct glexgen_kw *x = a, *y = b;
+
+  if (x->len != y->len) { return (x->len < y->len) ? -1 : 1; }
+  return memcmp(x->s, y->s, x->len);
+}
+
+static int glexgen_keywords(FILE *out)
+{
+  static struct glexgen_kw kw[GLEXGEN_MAX_KEYWORDS];
+  size_t i, j, n = 0;
+
+  for (i = 0; i < GENLEX_NUM_KEYWORDS; i++) {
+    const unsigned char *s = (const unsigned char *)gen_lexer_keywords[i].keyword;
+    size_t len = strlen((const char *)s);
+
+#if GENLEX_KEYWORDS_CASE_INSENSITIVE
+    {
+      unsigned char *f = (unsigned char *)malloc(len + 1);
+
+      if (f == NULL) {
+        fprintf(stderr, "glexgen: out of memory\n");
+        return 0;
+      }
+      for (j = 0; j <= len; j++) { f[j] = GENLEX_FOLD(s[j]); }
+      s = f;
+    }
+#endif
+
+    /* the first of two equal keywords wins, as in the linear scan */
+    for (j = 0; j < n; j++) {
+      if ((kw[j].len == len) && (memcmp(kw[j].s, s, len) == 0)) { break; }
+    }
+    if ((j < n) || (len == 0)) { continue; }
+
+    if (n == GLEXGEN_MAX_KEYWORDS) {
+      fprintf(stderr, "glexgen: more than %d keywords\n", GLEXGEN_MAX_KEYWORDS);
+      return 0;
+    }
+    kw[n].s = s;
+    kw[n].len = len;
+    kw[n].token = gen_lexer_keywords[i].token;
+    n++;
+  }
+
+  qsort(kw, n, sizeof kw[0], glexgen_kw_cmp);
+
+  fprintf(out, "static int genlex_dfa_keyword(const unsigned char *s, size_t n)\n{\n");
+  if (n == 0) {
+    fprintf(out, "  (void)s;\n  (void)n;\n");
+  } else {
+    fprintf(out, "  switch (n) {\n");
+    for (i = 0; i < n; i = j) {
+      for (j = i+1; (j < n) && (kw[j].len == kw[i].len); j++) {
+        continue;
+      }
+      fprintf(out, "  case %u:\n", (unsigned int)kw[i].len);
+      glexgen_trie(out, kw+i, j-i, 0, 2);
+    }
+    fprintf(out, "  }\n\n");
+  }
+  fprintf(out, "  return -1;\n}\n\n");
+
+  return 1;
+}
+
+#if defined(GENLEX_LITERAL_PAIRS)
+static void glexgen_pairs(FILE *out)
+{
+  unsigned int c, k, m;
+
+  fprintf(out, "static int genlex_dfa_pair(int ch, int c2)\n{\n");
+  fprintf(out, "  switch (ch) {\n");
+  for (c = 1; c < 256; c++) {
+    int any = 0;
+
+    for (k = 0; k < GENLEX_NUM_LITERAL_PAIRS; k++) {
+      if (gen_lexer_literal_pairs[k].pair[0] != c) { continue; }
+
+      /* the first pair wins */
+      for (m = 0; m < k; m++) {
+        if ((gen_lexer_literal_pairs[m].pair[0] == c) &&
+            (gen_lexer_literal_pairs[m].pair[1] == gen_lexer_literal_pairs[k].pair[1])) {
+          break;
+        }
+      }
+      if (m < k) { continue; }
+
+      if (!any) {
+        fprintf(out, "  case ");
+        glexgen_char(out, c);
+        fprintf(out, ":\n    switch (c2) {\n");
+        any = 1;
+      }
+      fprintf(out, "    case ");
+      glexgen_char(out, gen_lexer_literal_pairs[k].pair[1]);
+      fprintf(out, ": return %d;\n", gen_lexer_literal_pairs[k].token);
+    }
+
+    if (any) {
+      fprintf(out, "    }\n    break;\n");
+    }
+  }
+  fprintf(out, "  }\n\n  return -1;\n}\n\n");
+}
+#endif
+
+#if defined(GENLEX_COMMENT_PAIRS)
+/* Returns the index into gen_lexer_comments of the comment that starts
+ * with ch, or -1.  Openers are tried in order, as in gen_lexer_next_token(),
+ * so a one-character opener hides any later opener with the same first
+ * character.
+ */
+static void glexgen_comments(FILE *out)
+{
+  unsigned int c, k, m;
+
+  int two = 0;
+
+  for (k = 0; k < GENLEX_NUM_COMMENT_PAIRS; k++) {
+    if (gen_lexer_comments[k].beg[1]) { two = 1; }
+  }
+
+  fprintf(out, "static int genlex_dfa_comment(struct gen_lexer *lexer, int ch)\n{\n");
+  if (two) {
+    fprintf(out, "  int next;\n\n");
+  } else {
+    fprintf(out, "  (void)lexer;\n\n");
+  }
+  fprintf(out, "  switch (ch) {\n");
+  for (c = 1; c < 256; c++) {
+    int any = 0, single = -1;
+
+    for (k = 0; k < GENLEX_NUM_COMMENT_PAIRS; k++) {
+      if (gen_lexer_comments[k].beg[0] != c) { continue; }
+
+      if (!gen_lexer_comments[k].beg[1]) {
+        single = k;
+        break;
+      }
+
+      for (m = 0; m < k; m++) {
+        if ((gen_lexer_comments[m].beg[0] == c) &&
+            (gen_lexer_comments[m].beg[1] == gen_lexer_comments[k].beg[1])) {
+          break;
+        }
+      }
+      if (m < k) { continue; }
+
+      if (!any) {
+        fprintf(out, "  case ");
+        glexgen_char(out, c);
+        fprintf(out, ":\n    next = genlex_getc(lexer);\n    switch (next) {\n");
+        any = 1;
+      }
+      fprintf(out, "    case ");
+      glexgen_char(out, gen_lexer_comments[k].beg[1]);
+      fprintf(out, ": return %u;\n", k);
+    }
+
+    if (any) {
+      fprintf(out, "    }\n    genlex_ungetc(next, lexer);\n");
+      if (single >= 0) {
+        fprintf(out, "    return %d;\n", single);
+      } else {
+        fprintf(out, "    break;\n");
+      }
+    } else if (single >= 0) {
+      fprintf(out, "  case ");
+      glexgen_char(out, c);
+      fprintf(out, ":\n    return %d;\n", single);
+    }
+  }
+  fprintf(out, "  }\n\n  return -1;\n}\n\n");
+}
+#endif
+
+static void glexgen_check_int(FILE *out, const char *name, long val)
+{
+  fprintf(out, "#if %s != %ld\n", name, val);
+  fprintf(out, "#  error %s does not match the configuration %s was generated from\n",
+      name, glexgen_out_name);
+  fprintf(out, "#endif\n");
+}
+
+/* Emits checks that the header is compiled with its own configuration */
+static void glexgen_checks(FILE *out)
+{
+  glexgen_check_int(out, "GENLEX_ID_TOKEN", GENLEX_ID_TOKEN);
+  glexgen_check_int(out, "GENLEX_STRING_TOKEN", GENLEX_STRING_TOKEN);
+  glexgen_check_int(out, "GENLEX_INT_TOKEN", GENLEX_INT_TOKEN);
+#if defined(GENLEX_COMMENT_PAIRS)
+  glexgen_check_int(out, "GENLEX_COMMENT_TOKEN", GENLEX_COMMENT_TOKEN);
+#endif
+#if GENLEX_CONFIG_FLOATS
+  glexgen_check_int(out, "GENLEX_FLOAT_TOKEN", GENLEX_FLOAT_TOKEN);
+#endif
+  glexgen_check_int(out, "GENLEX_KEYWORDS_CASE_INSENSITIVE", GLEXGEN_NOCASE);
+  fprintf(out, "\n");
+
+  fprintf(out, "typedef char genlex_dfa_check_config[\n"
+      "    (GENLEX_NUM_LITERALS == %u) &&\n"
+      "    (GENLEX_NUM_KEYWORDS == %u)",
+      (unsigned int)GENLEX_NUM_LITERALS, (unsigned int)GENLEX_NUM_KEYWORDS);
+#if defined(GENLEX_LITERAL_PAIRS)
+  fprintf(out, " &&\n    (GENLEX_NUM_LITERAL_PAIRS == %u)",
+      (unsigned int)GENLEX_NUM_LITERAL_PAIRS);
+#endif
+#if defined(GENLEX_COMMENT_PAIRS)
+  fprintf(out, " &&\n    (GENLEX_NUM_COMMENT_PAIRS == %u)",
+      (unsigned int)GENLEX_NUM_COMMENT_PAIRS);
+#endif
+  fprintf(out, " ? 1 : -1];\n\n");
+}
+
+int main(int argc, char **argv)
+{
+  FILE *out;
+
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s output.h\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  glexgen_out_name = argv[1];
+  if ((out = fopen(argv[1], "w")) == NULL) {
+    perror(argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  fprintf(out, "/* Generated by glexgen from %s; do not edit. */\n\n", GLEXGEN_CONFIG);
+
+  glexgen_checks(out);
+  glexgen_class_table(out);
+  if (!glexgen_keywords(out)) {
+    fclose(out);
+    remove(argv[1]);
+    return EXIT_FAILURE;
+  }
+#if defined(GENLEX_LITERAL_PAIRS)
+  glexgen_pairs(out);
+#endif
+#if defined(GENLEX_COMMENT_PAIRS)
+  glexgen_comments(out);
+#endif
+
+  if (fclose(out) != 0) {
+    perror(argv[1]);
+    remove(argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}